@@ -53,4 +53,7 @@
 
 #define FRUIT_USES_BOOST 1
 
+// Whether the construction of objects can be recorded with Injector::enableProfiling() (see InjectionProfile).
+// #define FRUIT_ENABLE_PROFILING 1
+
 #endif // FRUIT_CONFIG_BASE_H
@@ -0,0 +1,160 @@
+/*
+ * Copyright 2014 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// A multi-threaded stress benchmark for injectors in concurrent mode (see Injector::enableConcurrentInjection()).
+// It measures:
+// * the cost of get() on already-constructed objects, with a varying number of threads sharing the same injector
+// * the cost of lazily constructing the objects of a new injector while multiple threads request them at the same time.
+
+#include <fruit/fruit.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+// A chain of types, where Node<i> depends on Node<i-1>.
+template <int i>
+struct Node {
+  INJECT(Node(Node<i - 1>& prev)) : prev(prev) {
+  }
+
+  Node<i - 1>& prev;
+};
+
+template <>
+struct Node<0> {
+  INJECT(Node()) = default;
+};
+
+using Root = Node<15>;
+using Middle = Node<7>;
+using Leaf = Node<0>;
+
+fruit::Component<Root, Middle, Leaf> getComponent() {
+  return fruit::createComponent();
+}
+
+using Clock = std::chrono::high_resolution_clock;
+
+double secondsSince(Clock::time_point start_time) {
+  return std::chrono::duration_cast<std::chrono::duration<double>>(Clock::now() - start_time).count();
+}
+
+// Runs f(thread_index) on num_threads threads, all starting at (approximately) the same time.
+// Returns the elapsed time from the start to when the last thread finished.
+template <typename F>
+double runConcurrently(std::size_t num_threads, F f) {
+  std::atomic<std::size_t> num_ready(0);
+  std::atomic<bool> start(false);
+  std::vector<std::thread> threads;
+  for (std::size_t i = 0; i < num_threads; i++) {
+    threads.push_back(std::thread([&, i]() {
+      num_ready++;
+      while (!start.load(std::memory_order_acquire)) {
+        // Spin, so that all threads start together.
+      }
+      f(i);
+    }));
+  }
+  while (num_ready.load() != num_threads) {
+    std::this_thread::yield();
+  }
+  Clock::time_point start_time = Clock::now();
+  start.store(true, std::memory_order_release);
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  return secondsSince(start_time);
+}
+
+int main(int argc, const char* argv[]) {
+  if (argc != 2) {
+    std::cout << "Error: you need to specify the number of loops as argument." << std::endl;
+    return 1;
+  }
+  std::size_t num_loops = std::atoi(argv[1]);
+  std::size_t num_gets = num_loops * 10000;
+
+  std::cout << std::fixed;
+  std::cout << std::setprecision(3);
+
+  fruit::NormalizedComponent<Root, Middle, Leaf> normalizedComponent(getComponent());
+
+  {
+    // Baseline: a single thread, without concurrent mode.
+    fruit::Injector<Root, Middle, Leaf> injector(normalizedComponent);
+    std::size_t checksum = 0;
+    Clock::time_point start_time = Clock::now();
+    for (std::size_t i = 0; i < num_gets; i++) {
+      checksum += reinterpret_cast<std::uintptr_t>(injector.get<Root*>()) % 2;
+      checksum += reinterpret_cast<std::uintptr_t>(injector.get<Middle*>()) % 2;
+      checksum += reinterpret_cast<std::uintptr_t>(injector.get<Leaf*>()) % 2;
+    }
+    double time = secondsSince(start_time);
+    std::cout << "get(), non-concurrent mode,  1 thread(s): " << std::setw(10) << time * 1e9 / (num_gets * 3)
+              << " ns per get()  (checksum " << checksum << ")" << std::endl;
+  }
+
+  for (std::size_t num_threads : {1, 2, 4, 8, 16}) {
+    fruit::Injector<Root, Middle, Leaf> injector(normalizedComponent);
+    injector.enableConcurrentInjection();
+    std::vector<std::size_t> checksums(num_threads);
+    double time = runConcurrently(num_threads, [&](std::size_t thread_index) {
+      std::size_t checksum = 0;
+      for (std::size_t i = 0; i < num_gets; i++) {
+        checksum += reinterpret_cast<std::uintptr_t>(injector.get<Root*>()) % 2;
+        checksum += reinterpret_cast<std::uintptr_t>(injector.get<Middle*>()) % 2;
+        checksum += reinterpret_cast<std::uintptr_t>(injector.get<Leaf*>()) % 2;
+      }
+      checksums[thread_index] = checksum;
+    });
+    // Each thread performs num_gets*3 get()s, so this is the average time per get() from the point of view of a thread.
+    std::cout << "get(), concurrent mode,     " << std::setw(2) << num_threads << " thread(s): " << std::setw(10)
+              << time * 1e9 / (num_gets * 3) << " ns per get()" << std::endl;
+  }
+
+  for (std::size_t num_threads : {1, 2, 4, 8, 16}) {
+    double total_time = 0;
+    for (std::size_t i = 0; i < num_loops; i++) {
+      fruit::Injector<Root, Middle, Leaf> injector(normalizedComponent);
+      injector.enableConcurrentInjection();
+      total_time += runConcurrently(num_threads, [&](std::size_t thread_index) {
+        // Different threads start from different points of the chain, so that they contend on the construction of the
+        // same objects.
+        switch (thread_index % 3) {
+        case 0:
+          injector.get<Leaf*>();
+          injector.get<Root*>();
+          break;
+        case 1:
+          injector.get<Middle*>();
+          break;
+        default:
+          injector.get<Root*>();
+          break;
+        }
+      });
+    }
+    std::cout << "Lazy construction under contention, " << std::setw(2) << num_threads << " thread(s): "
+              << std::setw(10) << total_time * 1e6 / num_loops << " us per injector" << std::endl;
+  }
+
+  return 0;
+}
@@ -0,0 +1,746 @@
+/*
+ * Copyright 2014 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// Microbenchmarks for the operations on the hot paths of injector creation and injection, based on Google Benchmark.
+// Unlike the benchmarks run by run_benchmarks.py (that only measure the total time to compile, to set up and to perform the
+// injection for a generated codebase), each benchmark here isolates a single operation.
+//
+// Build this in Release mode (in Debug mode Fruit prints debugging information on most operations), then run e.g.:
+//
+// ./fruit_microbenchmarks --benchmark_out=results.json --benchmark_out_format=json
+//
+// to get the results as JSON. Use --benchmark_filter=<regex> to only run some of the benchmarks.
+//
+// On Linux, the benchmarks that construct objects also report the L1 data cache and last-level cache misses per iteration
+// (L1D_misses and LLC_misses), read from the hardware performance counters. These are omitted if the counters are not
+// available (e.g. in most VMs, or if /proc/sys/kernel/perf_event_paranoid is 3 or more).
+
+#define IN_FRUIT_CPP_FILE
+#include <fruit/fruit.h>
+#include <fruit/impl/data_structures/semistatic_map.templates.h>
+#include <fruit/impl/data_structures/semistatic_graph.templates.h>
+#include <fruit/impl/data_structures/fixed_size_allocator.h>
+#include <fruit/impl/binding_normalization.h>
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cstring>
+#endif
+
+using namespace fruit::impl;
+
+namespace {
+
+// Counts the L1 data cache read misses and the last-level cache misses (of this thread, in user space) between calls to
+// start() and stop(), and reports them as counters of the benchmark.
+class CacheMissCounters {
+public:
+  CacheMissCounters() {
+#ifdef __linux__
+    fds[0] = open(PERF_COUNT_HW_CACHE_L1D);
+    fds[1] = open(PERF_COUNT_HW_CACHE_LL);
+#endif
+  }
+  
+  ~CacheMissCounters() {
+    for (int fd : fds) {
+      if (fd >= 0) {
+        close(fd);
+      }
+    }
+  }
+  
+  CacheMissCounters(const CacheMissCounters&) = delete;
+  CacheMissCounters& operator=(const CacheMissCounters&) = delete;
+  
+  void start() {
+#ifdef __linux__
+    for (int fd : fds) {
+      if (fd >= 0) {
+        ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+      }
+    }
+#endif
+  }
+  
+  void stop() {
+#ifdef __linux__
+    for (int fd : fds) {
+      if (fd >= 0) {
+        ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+      }
+    }
+#endif
+  }
+  
+  // Sets the counters of `state' to the average number of misses per iteration.
+  void report(benchmark::State& state) {
+    const char* names[] = {"L1D_misses", "LLC_misses"};
+    for (std::size_t i = 0; i < 2; i++) {
+      std::uint64_t count;
+      if (fds[i] >= 0 && read(fds[i], &count, sizeof(count)) == sizeof(count)) {
+        state.counters[names[i]] = benchmark::Counter(double(count), benchmark::Counter::kAvgIterations);
+      }
+    }
+  }
+  
+private:
+  int fds[2] = {-1, -1};
+  
+#ifdef __linux__
+  // Returns -1 if the counter is not available.
+  static int open(std::uint64_t cache) {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HW_CACHE;
+    attr.config = cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return int(syscall(__NR_perf_event_open, &attr, 0 /* this thread */, -1 /* any CPU */, -1 /* no group */, 0));
+  }
+#endif
+};
+
+// The keys of the maps and graphs are addresses of objects in an array, to mimic the TypeId keys used by Fruit (pointers to
+// static TypeInfo objects).
+using Key = const void*;
+
+struct alignas(16) KeyTarget {
+  char data[16];
+};
+
+// The components used in the injector benchmarks have 100 types, in 10 chains of 10 types (each type depends on the previous
+// one in its chain). Longer chains would make the compile-time checks too slow.
+constexpr int num_types = 100;
+constexpr int chain_length = 10;
+
+template <int N, bool first_in_chain = (N % chain_length == 0)>
+struct X;
+
+template <int N>
+struct X<N, true> {
+  INJECT(X()) = default;
+};
+
+template <int N>
+struct X<N, false> {
+  X<N - 1>& x;
+  INJECT(X(X<N - 1>& x)) : x(x) {}
+};
+
+template <typename... Ts>
+struct TypeList {};
+
+// The last type of each chain.
+using XTypes = TypeList<X<9>, X<19>, X<29>, X<39>, X<49>, X<59>, X<69>, X<79>, X<89>, X<99>>;
+
+template <typename... Ts>
+fruit::Component<Ts...> getXComponentHelper(TypeList<Ts...>) {
+  return fruit::createComponent();
+}
+
+using XComponent = decltype(getXComponentHelper(XTypes()));
+
+XComponent getXComponent() {
+  return getXComponentHelper(XTypes());
+}
+
+template <typename Injector, typename... Ts>
+void getAll(Injector& injector, TypeList<Ts...>) {
+  int unused[] = {(benchmark::DoNotOptimize(injector.template get<Ts*>()), 0)...};
+  (void)unused;
+}
+
+// The per-request types, they depend on a type in the XComponent and on the Request.
+struct Request {
+  int id;
+};
+
+template <int N>
+struct R {
+  X<N * chain_length + chain_length - 1>& x;
+  Request& request;
+  INJECT(R(X<N * chain_length + chain_length - 1>& x, Request& request)) : x(x), request(request) {}
+};
+
+constexpr int num_request_types = 10;
+
+struct Listener {
+  virtual ~Listener() = default;
+};
+
+template <int N>
+struct ListenerImpl : public Listener {
+  INJECT(ListenerImpl()) = default;
+};
+
+XComponent getXComponentWithMultibindings() {
+  return fruit::createComponent()
+      .install(getXComponent())
+      .addMultibinding<Listener, ListenerImpl<0>>()
+      .addMultibinding<Listener, ListenerImpl<1>>()
+      .addMultibinding<Listener, ListenerImpl<2>>()
+      .addMultibinding<Listener, ListenerImpl<3>>();
+}
+
+using RTypes = TypeList<R<0>, R<1>, R<2>, R<3>, R<4>, R<5>, R<6>, R<7>, R<8>, R<9>>;
+
+// The component that is normalized once, it provides all the R types (and, implicitly, the X types they depend on).
+using RComponent = fruit::Component<fruit::Required<Request>, R<0>, R<1>, R<2>, R<3>, R<4>, R<5>, R<6>, R<7>, R<8>, R<9>>;
+using NormalizedRComponent =
+    fruit::NormalizedComponent<fruit::Required<Request>, R<0>, R<1>, R<2>, R<3>, R<4>, R<5>, R<6>, R<7>, R<8>, R<9>>;
+using PreparedRDelta =
+    fruit::PreparedDelta<fruit::Required<Request>, R<0>, R<1>, R<2>, R<3>, R<4>, R<5>, R<6>, R<7>, R<8>, R<9>>;
+using RequestInjector = fruit::Injector<R<0>, R<1>, R<2>, R<3>, R<4>, R<5>, R<6>, R<7>, R<8>, R<9>>;
+
+RComponent getRComponent() {
+  return fruit::createComponent();
+}
+
+// The component created for each request.
+fruit::Component<Request> getRequestComponent(Request& request) {
+  return fruit::createComponent()
+      .bindInstance(request);
+}
+
+// The component created for each request when using a child injector of an XInjector: it only contains the request
+// bindings, the X types are shared with the parent.
+using ChildRComponent = fruit::Component<fruit::Required<X<9>, X<19>, X<29>, X<39>, X<49>, X<59>, X<69>, X<79>, X<89>, X<99>>,
+                                         R<0>, R<1>, R<2>, R<3>, R<4>, R<5>, R<6>, R<7>, R<8>, R<9>>;
+
+ChildRComponent getChildRComponent(Request& request) {
+  return fruit::createComponent()
+      .bindInstance(request);
+}
+
+template <typename... Ts>
+fruit::Injector<Ts...> getInjectorTypeHelper(TypeList<Ts...>);
+
+using XInjector = decltype(getInjectorTypeHelper(XTypes()));
+
+template <typename... Ts>
+fruit::FrozenInjector<Ts...> getFrozenInjectorTypeHelper(TypeList<Ts...>);
+
+using FrozenXInjector = decltype(getFrozenInjectorTypeHelper(XTypes()));
+
+// Returns n (key, value) pairs, with the keys pointing into `targets'.
+std::vector<std::pair<Key, std::size_t>> getMapValues(std::vector<KeyTarget>& targets) {
+  std::vector<std::pair<Key, std::size_t>> values;
+  for (std::size_t i = 0; i < targets.size(); i++) {
+    values.push_back(std::make_pair(&targets[i], i));
+  }
+  return values;
+}
+
+void BM_SemistaticMapAt(benchmark::State& state) {
+  std::vector<KeyTarget> targets(state.range(0));
+  std::vector<std::pair<Key, std::size_t>> values = getMapValues(targets);
+  SemistaticMap<Key, std::size_t> map(values.begin(), values.size(), SemistaticMap<Key, std::size_t>::PerfectHashing());
+  std::shuffle(values.begin(), values.end(), std::default_random_engine(42));
+  for (auto _ : state) {
+    for (const std::pair<Key, std::size_t>& x : values) {
+      benchmark::DoNotOptimize(map.at(x.first));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * values.size());
+}
+BENCHMARK(BM_SemistaticMapAt)->RangeMultiplier(8)->Range(16, 16384);
+
+void BM_SemistaticMapFind(benchmark::State& state) {
+  std::vector<KeyTarget> targets(state.range(0));
+  std::vector<std::pair<Key, std::size_t>> values = getMapValues(targets);
+  SemistaticMap<Key, std::size_t> map(values.begin(), values.size(), SemistaticMap<Key, std::size_t>::PerfectHashing());
+  // Half of the lookups are for keys that are not in the map.
+  std::vector<KeyTarget> missing_targets(state.range(0));
+  std::vector<Key> lookups;
+  for (std::size_t i = 0; i < values.size(); i++) {
+    lookups.push_back(values[i].first);
+    lookups.push_back(&missing_targets[i]);
+  }
+  std::shuffle(lookups.begin(), lookups.end(), std::default_random_engine(42));
+  for (auto _ : state) {
+    for (Key key : lookups) {
+      benchmark::DoNotOptimize(map.find(key));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * lookups.size());
+}
+BENCHMARK(BM_SemistaticMapFind)->RangeMultiplier(8)->Range(16, 16384);
+
+// Lookups in a map built with a random hash function, where a bucket can have up to beta-1 keys.
+void BM_SemistaticMapAtRandomHash(benchmark::State& state) {
+  std::vector<KeyTarget> targets(state.range(0));
+  std::vector<std::pair<Key, std::size_t>> values = getMapValues(targets);
+  SemistaticMap<Key, std::size_t> map(values.begin(), values.size());
+  std::shuffle(values.begin(), values.end(), std::default_random_engine(42));
+  for (auto _ : state) {
+    for (const std::pair<Key, std::size_t>& x : values) {
+      benchmark::DoNotOptimize(map.at(x.first));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * values.size());
+}
+BENCHMARK(BM_SemistaticMapAtRandomHash)->RangeMultiplier(8)->Range(16, 16384);
+
+// Lookups in a shallow copy of a map with as many additional keys as the original one, like the map of an injector created
+// from a NormalizedComponent and a Component of similar size. The shared buckets get longer.
+void BM_SemistaticMapAtAfterInsertions(benchmark::State& state) {
+  std::vector<KeyTarget> targets(state.range(0));
+  std::vector<std::pair<Key, std::size_t>> values = getMapValues(targets);
+  std::size_t num_old_values = values.size() / 2;
+  SemistaticMap<Key, std::size_t> old_map(values.begin(), num_old_values,
+                                          SemistaticMap<Key, std::size_t>::PerfectHashing());
+  SemistaticMap<Key, std::size_t> map(old_map,
+                                      std::vector<std::pair<Key, std::size_t>>(values.begin() + num_old_values, values.end()));
+  std::shuffle(values.begin(), values.end(), std::default_random_engine(42));
+  for (auto _ : state) {
+    for (const std::pair<Key, std::size_t>& x : values) {
+      benchmark::DoNotOptimize(map.at(x.first));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * values.size());
+}
+BENCHMARK(BM_SemistaticMapAtAfterInsertions)->RangeMultiplier(8)->Range(16, 16384);
+
+// Shallow copies of a map with a few additional keys, like the map of an injector created from a NormalizedComponent and a
+// small per-request Component. The time should not depend on the size of the original map.
+void BM_SemistaticMapCopyWithAdditions(benchmark::State& state) {
+  std::vector<KeyTarget> targets(state.range(0) + num_request_types);
+  std::vector<std::pair<Key, std::size_t>> values = getMapValues(targets);
+  SemistaticMap<Key, std::size_t> map(values.begin(), state.range(0), SemistaticMap<Key, std::size_t>::PerfectHashing());
+  for (auto _ : state) {
+    SemistaticMap<Key, std::size_t> new_map(
+        map, std::vector<std::pair<Key, std::size_t>>(values.begin() + state.range(0), values.end()));
+    benchmark::DoNotOptimize(new_map);
+  }
+}
+BENCHMARK(BM_SemistaticMapCopyWithAdditions)->RangeMultiplier(8)->Range(16, 16384);
+
+void BM_SemistaticMapConstructionRandomHash(benchmark::State& state) {
+  std::vector<KeyTarget> targets(state.range(0));
+  std::vector<std::pair<Key, std::size_t>> values = getMapValues(targets);
+  for (auto _ : state) {
+    SemistaticMap<Key, std::size_t> map(values.begin(), values.size());
+    benchmark::DoNotOptimize(map);
+  }
+  state.SetItemsProcessed(state.iterations() * values.size());
+}
+BENCHMARK(BM_SemistaticMapConstructionRandomHash)->RangeMultiplier(8)->Range(16, 16384);
+
+struct GraphNode {
+  Key id;
+  std::size_t value;
+  std::vector<Key> edges;
+  
+  Key getId() const {
+    return id;
+  }
+  std::size_t getValue() const {
+    return value;
+  }
+  bool isTerminal() const {
+    return false;
+  }
+  std::vector<Key>::const_iterator getEdgesBegin() const {
+    return edges.begin();
+  }
+  std::vector<Key>::const_iterator getEdgesEnd() const {
+    return edges.end();
+  }
+};
+
+using Graph = SemistaticGraph<Key, std::size_t>;
+
+// Returns the nodes for targets[first_node, last_node). Each node has edges to up to 3 (random) nodes in
+// targets[0, last_node), similarly to a binding with a few dependencies.
+std::vector<GraphNode> getGraphNodes(std::vector<KeyTarget>& targets, std::size_t first_node, std::size_t last_node) {
+  std::default_random_engine random_generator(42);
+  std::vector<GraphNode> nodes;
+  for (std::size_t i = first_node; i < last_node; i++) {
+    GraphNode node{&targets[i], i, {}};
+    for (std::size_t j = 0; j < 3 && i > 0; j++) {
+      node.edges.push_back(&targets[std::uniform_int_distribution<std::size_t>(0, i - 1)(random_generator)]);
+    }
+    std::sort(node.edges.begin(), node.edges.end());
+    node.edges.erase(std::unique(node.edges.begin(), node.edges.end()), node.edges.end());
+    nodes.push_back(node);
+  }
+  return nodes;
+}
+
+void BM_SemistaticGraphConstruction(benchmark::State& state) {
+  std::vector<KeyTarget> targets(state.range(0));
+  std::vector<GraphNode> nodes = getGraphNodes(targets, 0, targets.size());
+  for (auto _ : state) {
+    Graph graph(nodes.begin(), nodes.end());
+    benchmark::DoNotOptimize(graph);
+  }
+  state.SetItemsProcessed(state.iterations() * nodes.size());
+}
+BENCHMARK(BM_SemistaticGraphConstruction)->RangeMultiplier(8)->Range(16, 16384);
+
+// Adds `num_request_types' nodes to a graph with state.range(0) nodes, as done when creating an injector from a normalized
+// component and a (small) component.
+void BM_SemistaticGraphCopyWithAdditions(benchmark::State& state) {
+  std::vector<KeyTarget> targets(state.range(0) + num_request_types);
+  std::vector<GraphNode> nodes = getGraphNodes(targets, 0, state.range(0));
+  std::vector<GraphNode> new_nodes = getGraphNodes(targets, state.range(0), targets.size());
+  Graph graph(nodes.begin(), nodes.end());
+  for (auto _ : state) {
+    Graph new_graph(graph, new_nodes.begin(), new_nodes.end());
+    benchmark::DoNotOptimize(new_graph);
+  }
+}
+BENCHMARK(BM_SemistaticGraphCopyWithAdditions)->RangeMultiplier(8)->Range(16, 16384);
+
+// Same as BM_SemistaticGraphCopyWithAdditions, but also modifies 30 (random) nodes of the copy, as done when constructing
+// the objects of an injector. Only the pages of these nodes are copied, so the time still doesn't depend on the size of the
+// graph (for graphs with many more nodes than the ones modified).
+void BM_SemistaticGraphCopyWithAdditionsAndModify(benchmark::State& state) {
+  std::vector<KeyTarget> targets(state.range(0) + num_request_types);
+  std::vector<GraphNode> nodes = getGraphNodes(targets, 0, state.range(0));
+  std::vector<GraphNode> new_nodes = getGraphNodes(targets, state.range(0), targets.size());
+  Graph graph(nodes.begin(), nodes.end());
+  std::vector<Key> modified_nodes;
+  std::default_random_engine random_generator(42);
+  for (std::size_t i = 0; i < 30; i++) {
+    modified_nodes.push_back(nodes[std::uniform_int_distribution<std::size_t>(0, nodes.size() - 1)(random_generator)].id);
+  }
+  for (auto _ : state) {
+    Graph new_graph(graph, new_nodes.begin(), new_nodes.end());
+    for (Key key : modified_nodes) {
+      Graph::node_iterator itr = new_graph.at(key);
+      benchmark::DoNotOptimize(itr.getNode());
+      itr.setTerminal();
+    }
+    benchmark::DoNotOptimize(new_graph);
+  }
+}
+BENCHMARK(BM_SemistaticGraphCopyWithAdditionsAndModify)->RangeMultiplier(8)->Range(16, 16384);
+
+// Visits the nodes reachable from `itr' that are not terminal yet, in the same order in which the injector would construct
+// them, and marks them as terminal.
+void visitAsInjection(Graph::node_iterator itr, Graph::node_iterator nodes_begin) {
+  if (itr.isTerminal()) {
+    return;
+  }
+  for (Graph::edge_iterator edge_itr = itr.neighborsBegin(); !edge_itr.isEnd(); ++edge_itr) {
+    visitAsInjection(edge_itr.getNodeIterator(nodes_begin), nodes_begin);
+  }
+  benchmark::DoNotOptimize(itr.getNode());
+  itr.setTerminal();
+}
+
+// Measures the graph accesses done when getting objects from a new injector (where no object has been constructed yet),
+// without the cost of constructing the objects. The graph is too big to fit in the L1 cache, so the time mostly depends on
+// how many cache lines have to be loaded, i.e. on how close each node is to its neighbors.
+void BM_SemistaticGraphFirstTraversal(benchmark::State& state) {
+  std::vector<KeyTarget> targets(state.range(0));
+  std::vector<GraphNode> nodes = getGraphNodes(targets, 0, targets.size());
+  // The nodes are passed to the graph with the ones that nothing depends on first, as for exposed types in a normalized
+  // component.
+  Graph graph(nodes.rbegin(), nodes.rend());
+  Graph copy(graph, (GraphNode*)nullptr, (GraphNode*)nullptr);
+  Graph::node_iterator nodes_begin = copy.begin();
+  // The traversal starts from the nodes that nothing depends on (as get() calls start from exposed types).
+  std::vector<bool> has_incoming_edges(targets.size());
+  for (const GraphNode& node : nodes) {
+    for (Key key : node.edges) {
+      has_incoming_edges[reinterpret_cast<const KeyTarget*>(key) - targets.data()] = true;
+    }
+  }
+  std::vector<Graph::node_iterator> roots;
+  for (const GraphNode& node : nodes) {
+    if (!has_incoming_edges[node.value]) {
+      roots.push_back(copy.at(node.id));
+    }
+  }
+  CacheMissCounters counters;
+  for (auto _ : state) {
+    counters.start();
+    for (Graph::node_iterator root : roots) {
+      visitAsInjection(root, nodes_begin);
+    }
+    counters.stop();
+    state.PauseTiming();
+    copy.resetNodes(graph);
+    state.ResumeTiming();
+  }
+  counters.report(state);
+  state.SetItemsProcessed(state.iterations() * nodes.size());
+}
+BENCHMARK(BM_SemistaticGraphFirstTraversal)->RangeMultiplier(8)->Range(1024, 65536);
+
+// The bindings of a big component, as passed to BindingNormalization::normalizeBindings(). The types are in chains of
+// `chain_length' (as in the injector benchmarks) and the last type of each chain is bound to an interface, with a
+// compressible binding. The interfaces are the exposed types.
+struct BindingsForNormalization {
+  std::vector<TypeInfo> type_infos;
+  std::vector<TypeId> deps;
+  std::vector<BindingDeps> binding_deps;
+  std::vector<std::pair<TypeId, BindingData>> bindings;
+  std::vector<CompressedBinding> compressed_bindings;
+  std::vector<TypeId> exposed_types;
+  
+  explicit BindingsForNormalization(std::size_t num_classes) {
+    std::size_t num_interfaces = num_classes / chain_length;
+    type_infos.assign(num_classes + num_interfaces, TypeInfo(TypeInfo::ConcreteTypeInfo{8, 8, true}));
+    // Each class has (at most) 1 dep, and each interface has 1 dep.
+    deps.resize(num_classes + num_interfaces);
+    binding_deps.resize(num_classes + num_interfaces);
+    for (std::size_t i = 0; i < num_classes; i++) {
+      if (i % chain_length == 0) {
+        binding_deps[i] = BindingDeps{&deps[i], 0};
+      } else {
+        deps[i] = TypeId{&type_infos[i - 1]};
+        binding_deps[i] = BindingDeps{&deps[i], 1};
+      }
+      bindings.push_back(std::make_pair(TypeId{&type_infos[i]}, BindingData(nullptr, &binding_deps[i], true)));
+    }
+    for (std::size_t i = num_classes; i < num_classes + num_interfaces; i++) {
+      std::size_t c = (i - num_classes) * chain_length + chain_length - 1;
+      TypeId i_id{&type_infos[i]};
+      TypeId c_id{&type_infos[c]};
+      deps[i] = c_id;
+      binding_deps[i] = BindingDeps{&deps[i], 1};
+      bindings.push_back(std::make_pair(i_id, BindingData(nullptr, &binding_deps[i], false)));
+      compressed_bindings.push_back(CompressedBinding{i_id, c_id, BindingData(nullptr, &binding_deps[c], true)});
+      exposed_types.push_back(i_id);
+    }
+    // Bindings come in the order in which the components are installed, that's unrelated to the TypeIds.
+    std::default_random_engine random_generator(42);
+    std::shuffle(bindings.begin(), bindings.end(), random_generator);
+  }
+};
+
+void BM_NormalizeBindings(benchmark::State& state) {
+  BindingsForNormalization bindings(state.range(0));
+  for (auto _ : state) {
+    FixedSizeAllocator::FixedSizeAllocatorData fixed_size_allocator_data;
+    BindingNormalization::BindingCompressionInfoMap binding_compression_info_map =
+        createHashMap<TypeId, BindingNormalization::BindingCompressionInfo>();
+    benchmark::DoNotOptimize(BindingNormalization::normalizeBindings(bindings.bindings,
+                                                                     fixed_size_allocator_data,
+                                                                     std::vector<CompressedBinding>(bindings.compressed_bindings),
+                                                                     std::vector<std::pair<TypeId, MultibindingData>>(),
+                                                                     bindings.exposed_types,
+                                                                     binding_compression_info_map));
+  }
+  state.SetItemsProcessed(state.iterations() * bindings.bindings.size());
+}
+BENCHMARK(BM_NormalizeBindings)->RangeMultiplier(8)->Range(1024, 65536);
+
+struct SmallObject {
+  int n;
+};
+
+struct NonTriviallyDestructibleObject {
+  std::vector<int> v;
+};
+
+template <typename T>
+void BM_FixedSizeAllocatorConstructObject(benchmark::State& state) {
+  FixedSizeAllocator::FixedSizeAllocatorData allocator_data;
+  for (int i = 0; i < state.range(0); i++) {
+    allocator_data.addType(getTypeId<T>());
+  }
+  FixedSizeAllocator allocator(allocator_data);
+  for (auto _ : state) {
+    for (int i = 0; i < state.range(0); i++) {
+      benchmark::DoNotOptimize(allocator.constructObject<T>());
+    }
+    // This also destroys the objects, if needed.
+    allocator.reset(allocator_data);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK_TEMPLATE(BM_FixedSizeAllocatorConstructObject, SmallObject)->Arg(1000);
+BENCHMARK_TEMPLATE(BM_FixedSizeAllocatorConstructObject, NonTriviallyDestructibleObject)->Arg(1000);
+
+void BM_InjectorGetConstructed(benchmark::State& state) {
+  XInjector injector(getXComponent());
+  injector.get<X<99>*>();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(injector.get<X<99>*>());
+  }
+}
+BENCHMARK(BM_InjectorGetConstructed);
+
+void BM_FrozenInjectorGet(benchmark::State& state) {
+  FrozenXInjector injector{XInjector(getXComponent())};
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(injector.get<X<99>*>());
+  }
+}
+BENCHMARK(BM_FrozenInjectorGet);
+
+// Same as BM_InjectorGetConstructed, but for a type of the NormalizedComponent that's not in the injector's types (for
+// these, get<T>() can't be used, and unsafeGet<T>() has to look the type up).
+void BM_InjectorGetWithBindingHandle(benchmark::State& state) {
+  NormalizedRComponent normalized_component(getRComponent());
+  fruit::BindingHandle<R<9>> handle = normalized_component.getBindingHandle<R<9>>();
+  Request request{0};
+  fruit::Injector<R<0>> injector(normalized_component, getRequestComponent(request));
+  injector.get(handle);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(injector.get(handle));
+  }
+}
+BENCHMARK(BM_InjectorGetWithBindingHandle);
+
+void BM_InjectorUnsafeGet(benchmark::State& state) {
+  NormalizedRComponent normalized_component(getRComponent());
+  Request request{0};
+  fruit::Injector<R<0>> injector(normalized_component, getRequestComponent(request));
+  injector.unsafeGet<R<9>>();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(injector.unsafeGet<R<9>>());
+  }
+}
+BENCHMARK(BM_InjectorUnsafeGet);
+
+// Each iteration constructs all the objects (with a get() call for each request type, that depends on a chain of Xs).
+void BM_InjectorGetUnconstructed(benchmark::State& state) {
+  NormalizedRComponent normalized_component(getRComponent());
+  Request request{0};
+  PreparedRDelta prepared_delta(normalized_component, getRequestComponent(request));
+  RequestInjector injector(prepared_delta, getRequestComponent(request));
+  CacheMissCounters counters;
+  for (auto _ : state) {
+    counters.start();
+    getAll(injector, RTypes());
+    counters.stop();
+    state.PauseTiming();
+    injector.reset(prepared_delta, getRequestComponent(request));
+    state.ResumeTiming();
+  }
+  counters.report(state);
+  state.SetItemsProcessed(state.iterations() * (num_types + num_request_types));
+}
+BENCHMARK(BM_InjectorGetUnconstructed);
+
+void BM_ProviderGet(benchmark::State& state) {
+  XInjector injector(getXComponent());
+  fruit::Provider<X<99>> provider = injector.get<fruit::Provider<X<99>>>();
+  provider.get();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(provider.get());
+  }
+}
+BENCHMARK(BM_ProviderGet);
+
+// The first call constructs the multibindings, the following ones return the cached vector.
+void BM_GetMultibindings(benchmark::State& state) {
+  XInjector injector(getXComponentWithMultibindings());
+  injector.getMultibindings<Listener>();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(injector.getMultibindings<Listener>());
+  }
+}
+BENCHMARK(BM_GetMultibindings);
+
+void BM_GetMultibindingsRange(benchmark::State& state) {
+  XInjector injector(getXComponentWithMultibindings());
+  injector.getMultibindingsRange<Listener>();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(injector.getMultibindingsRange<Listener>());
+  }
+}
+BENCHMARK(BM_GetMultibindingsRange);
+
+// Creates an injector for a request from a NormalizedComponent, without injecting anything.
+void BM_InjectorFromNormalizedComponent(benchmark::State& state) {
+  NormalizedRComponent normalized_component(getRComponent());
+  Request request{0};
+  for (auto _ : state) {
+    RequestInjector injector(normalized_component, getRequestComponent(request));
+    benchmark::DoNotOptimize(injector);
+  }
+}
+BENCHMARK(BM_InjectorFromNormalizedComponent);
+
+// Same as BM_InjectorFromNormalizedComponent, but also injects all types of the request.
+void BM_InjectorFromNormalizedComponentAndInject(benchmark::State& state) {
+  NormalizedRComponent normalized_component(getRComponent());
+  Request request{0};
+  for (auto _ : state) {
+    RequestInjector injector(normalized_component, getRequestComponent(request));
+    injector.eagerlyInjectAll();
+  }
+}
+BENCHMARK(BM_InjectorFromNormalizedComponentAndInject);
+
+void BM_InjectorFromPreparedDelta(benchmark::State& state) {
+  NormalizedRComponent normalized_component(getRComponent());
+  Request request{0};
+  PreparedRDelta prepared_delta(normalized_component, getRequestComponent(request));
+  for (auto _ : state) {
+    RequestInjector injector(prepared_delta, getRequestComponent(request));
+    benchmark::DoNotOptimize(injector);
+  }
+}
+BENCHMARK(BM_InjectorFromPreparedDelta);
+
+void BM_InjectorReset(benchmark::State& state) {
+  NormalizedRComponent normalized_component(getRComponent());
+  Request request{0};
+  PreparedRDelta prepared_delta(normalized_component, getRequestComponent(request));
+  RequestInjector injector(prepared_delta, getRequestComponent(request));
+  for (auto _ : state) {
+    injector.reset(prepared_delta, getRequestComponent(request));
+  }
+}
+BENCHMARK(BM_InjectorReset);
+
+// Creates a child injector for a request, sharing the (already constructed) X objects of the parent injector.
+void BM_ChildInjector(benchmark::State& state) {
+  XInjector parent_injector(getXComponent());
+  getAll(parent_injector, XTypes());
+  Request request{0};
+  for (auto _ : state) {
+    RequestInjector injector(parent_injector, getChildRComponent(request));
+    benchmark::DoNotOptimize(injector);
+  }
+}
+BENCHMARK(BM_ChildInjector);
+
+// Same as BM_ChildInjector, but also injects all types of the request.
+void BM_ChildInjectorAndInject(benchmark::State& state) {
+  XInjector parent_injector(getXComponent());
+  getAll(parent_injector, XTypes());
+  Request request{0};
+  for (auto _ : state) {
+    RequestInjector injector(parent_injector, getChildRComponent(request));
+    injector.eagerlyInjectAll();
+  }
+}
+BENCHMARK(BM_ChildInjectorAndInject);
+
+} // namespace
+
+BENCHMARK_MAIN();
@@ -29,46 +29,11 @@ def add_node(n, deps, source_generator, output_dir):
         sourceFile.write(source_generator.generate_component_source(n, deps))
 
 
-def generate_benchmark(
-        di_library,
-        compiler,
-        cxx_std,
-        fruit_build_dir,
-        fruit_sources_dir,
-        output_dir,
-        num_components_with_no_deps,
-        num_components_with_deps,
-        num_deps,
-        boost_di_sources_dir=None):
-    """Generates a sample codebase using the specified DI library, meant for benchmarking.
+def add_random_dag(num_components_with_no_deps, num_components_with_deps, num_deps, source_generator, output_dir):
+    """Adds the components for the 'random' topology (see generate_benchmark()) and returns the number of components.
 
-    :param boost_di_sources_dir: this is only used if di_library=='boost_di', it can be None otherwise.
+    The last component transitively installs all the others.
     """
-
-    if num_components_with_no_deps < num_deps:
-        raise Exception(
-            "Too few components with no deps. num_components_with_no_deps=%s but num_deps=%s." % (num_components_with_no_deps, num_deps))
-    if num_deps < 2:
-        raise Exception("num_deps should be at least 2.")
-
-    # This is a constant so that we always generate the same file (=> benchmark more repeatable).
-    random.seed(42)
-
-    if di_library == 'fruit':
-        source_generator = FruitSourceGenerator()
-        include_dirs = [fruit_build_dir + '/include', fruit_sources_dir + '/include']
-        library_dirs = [fruit_build_dir + '/src']
-        link_libraries = ['fruit']
-    elif di_library == 'boost_di':
-        source_generator = BoostDiSourceGenerator()
-        include_dirs = [boost_di_sources_dir + '/include']
-        library_dirs = []
-        link_libraries = []
-    else:
-        raise Exception('Unrecognized di_library: %s' % di_library)
-
-    os.makedirs(output_dir, exist_ok=True)
-
     num_used_ids = 0
     is_toplevel = [True for i in range(0, num_components_with_no_deps + num_components_with_deps)]
     toplevel_components = set()
@@ -89,7 +54,7 @@ def generate_benchmark(
             # We need at least 1 dep with deps, otherwise the last few components will not be enough
             # to tie together all components.
             num_deps_with_deps = len(toplevel_components) - (num_components_with_deps - 1 - i) * (num_deps - 1)
-            deps |= set(random.sample(toplevel_components, num_deps_with_deps))
+            deps |= set(random.sample(sorted(toplevel_components), num_deps_with_deps))
 
         if i != 0 and len(deps) < num_deps:
             # Pick one random component with deps.
@@ -114,8 +79,92 @@ def generate_benchmark(
         add_node(component_id, deps_list, source_generator, output_dir=output_dir)
 
     assert len(toplevel_components) == 1, toplevel_components
+    assert is_toplevel[num_used_ids - 1]
+    return num_used_ids
+
+
+def add_diamond_dag(num_components_with_deps, num_deps, source_generator, output_dir):
+    """Adds the components for the 'diamond' topology (see generate_benchmark()) and returns the number of components.
+
+    The last component transitively installs all the others.
+    """
+    previous_layer = list(range(0, num_deps))
+    for id in previous_layer:
+        add_node(id, [], source_generator=source_generator, output_dir=output_dir)
+    num_used_ids = num_deps
+
+    num_layers = max(0, num_components_with_deps - 1) // num_deps
+    for layer in range(0, num_layers):
+        layer_components = list(range(num_used_ids, num_used_ids + num_deps))
+        for id in layer_components:
+            deps_list = list(previous_layer)
+            random.shuffle(deps_list)
+            add_node(id, deps_list, source_generator=source_generator, output_dir=output_dir)
+        num_used_ids += num_deps
+        previous_layer = layer_components
+
+    add_node(num_used_ids, previous_layer, source_generator=source_generator, output_dir=output_dir)
+    return num_used_ids + 1
+
+
+def generate_benchmark(
+        di_library,
+        compiler,
+        cxx_std,
+        fruit_build_dir,
+        fruit_sources_dir,
+        output_dir,
+        num_components_with_no_deps,
+        num_components_with_deps,
+        num_deps,
+        boost_di_sources_dir=None,
+        topology='random'):
+    """Generates a sample codebase using the specified DI library, meant for benchmarking.
+
+    :param boost_di_sources_dir: this is only used if di_library=='boost_di', it can be None otherwise.
+    :param topology: how the components install each other. One of:
+        * 'random': each component with deps has num_deps deps, mostly components with no deps.
+        * 'diamond': the components with deps are arranged in layers of num_deps components, and each of them
+          installs all the components in the previous layer (the first layer installs num_deps components with no
+          deps). The last component installs the last layer. So the components in the lower layers are reachable
+          through exponentially many install paths from the last one, and the benchmark measures how well diamond
+          installs are deduplicated. num_components_with_no_deps is ignored.
+    """
+
+    if topology == 'diamond':
+        num_components_with_no_deps = num_deps
+    elif topology != 'random':
+        raise Exception('Unrecognized topology: %s' % topology)
+
+    if num_components_with_no_deps < num_deps:
+        raise Exception(
+            "Too few components with no deps. num_components_with_no_deps=%s but num_deps=%s." % (num_components_with_no_deps, num_deps))
+    if num_deps < 2:
+        raise Exception("num_deps should be at least 2.")
+
+    # This is a constant so that we always generate the same file (=> benchmark more repeatable).
+    random.seed(42)
+
+    if di_library == 'fruit':
+        source_generator = FruitSourceGenerator()
+        include_dirs = [fruit_build_dir + '/include', fruit_sources_dir + '/include']
+        library_dirs = [fruit_build_dir + '/src']
+        link_libraries = ['fruit']
+    elif di_library == 'boost_di':
+        source_generator = BoostDiSourceGenerator()
+        include_dirs = [boost_di_sources_dir + '/include']
+        library_dirs = []
+        link_libraries = []
+    else:
+        raise Exception('Unrecognized di_library: %s' % di_library)
+
+    os.makedirs(output_dir, exist_ok=True)
+
+    if topology == 'diamond':
+        num_used_ids = add_diamond_dag(num_components_with_deps, num_deps, source_generator, output_dir)
+    else:
+        num_used_ids = add_random_dag(num_components_with_no_deps, num_components_with_deps, num_deps, source_generator, output_dir)
     toplevel_component = num_used_ids - 1
-    assert is_toplevel[toplevel_component]
 
     with open("%s/main.cpp" % output_dir, 'w') as mainFile:
         mainFile.write(source_generator.generate_main(toplevel_component))
@@ -146,6 +195,8 @@ def main():
     parser.add_argument('--num-components-with-no-deps', default=10, help='Number of components with no deps that will be generated')
     parser.add_argument('--num-components-with-deps', default=90, help='Number of components with deps that will be generated')
     parser.add_argument('--num-deps', default=10, help='Number of deps in each component with deps that will be generated')
+    parser.add_argument('--topology', default='random',
+                        help='How the generated components install each other. One of {random, diamond}. (default: random)')
     parser.add_argument('--output-dir', help='Output directory for generated files')
     parser.add_argument('--cxx-std', default='c++11',
                         help='Version of the C++ standard to use. Typically one of \'c++11\' and \'c++14\'. (default: \'c++11\')')
@@ -183,7 +234,8 @@ def main():
         num_components_with_deps=num_components_with_deps,
         num_components_with_no_deps=num_components_with_no_deps,
         fruit_build_dir=args.fruit_build_dir,
-        num_deps=num_deps)
+        num_deps=num_deps,
+        topology=args.topology)
 
 
 if __name__ == "__main__":
@@ -203,6 +203,7 @@ class GenericGeneratedSourcesBenchmark:
             output_dir=self.tmpdir,
             cxx_std=cxx_std,
             di_library=self.di_library,
+            topology=self.benchmark_definition.get('topology', 'random'),
             **self.other_args)
 
     def prepare_runtime_benchmark(self):
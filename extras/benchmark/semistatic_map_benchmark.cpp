@@ -0,0 +1,104 @@
+/*
+ * Copyright 2014 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Compares the construction time and the lookup time of a SemistaticMap built with a random hash function (re-drawn until
+// no bucket is too big) and of one built with a perfect hash function.
+// The keys are addresses of objects in an array, to mimic the TypeId keys used by Fruit (pointers to static TypeInfo objects).
+
+#define IN_FRUIT_CPP_FILE
+#include <fruit/impl/data_structures/semistatic_map.templates.h>
+
+#include <vector>
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <algorithm>
+#include <random>
+#include <cstdlib>
+
+using namespace fruit::impl;
+
+using Key = const void*;
+using Map = SemistaticMap<Key, std::size_t>;
+
+struct alignas(16) KeyTarget {
+  char data[16];
+};
+
+template <typename F>
+double measure(std::size_t num_loops, F f) {
+  std::chrono::high_resolution_clock::time_point start_time = std::chrono::high_resolution_clock::now();
+  for (std::size_t i = 0; i < num_loops; i++) {
+    f();
+  }
+  double total_time = std::chrono::duration_cast<std::chrono::duration<double>>(
+      std::chrono::high_resolution_clock::now() - start_time).count();
+  return total_time / num_loops;
+}
+
+template <typename... Args>
+void runBenchmark(const char* name, std::size_t num_loops, const std::vector<std::pair<Key, std::size_t>>& values,
+                  const std::vector<Key>& lookups, Args... args) {
+  double construction_time = measure(num_loops, [&]() {
+    Map map(values.begin(), values.size(), args...);
+    (void) map;
+  });
+
+  Map map(values.begin(), values.size(), args...);
+  std::size_t checksum = 0;
+  double lookup_time = measure(1, [&]() {
+    for (Key key : lookups) {
+      checksum += map.at(key);
+    }
+  }) / lookups.size();
+
+  std::cout << std::setw(8) << values.size() << "  " << std::setw(10) << name
+            << "  construction = " << std::setw(14) << construction_time * 1e6 << " us"
+            << "  lookup = " << std::setw(8) << lookup_time * 1e9 << " ns"
+            << "  (checksum " << checksum << ")" << std::endl;
+}
+
+int main(int argc, const char* argv[]) {
+  if (argc != 2) {
+    std::cout << "Error: you need to specify the number of loops as argument." << std::endl;
+    return 1;
+  }
+  size_t num_loops = std::atoi(argv[1]);
+
+  std::cout << std::fixed;
+  std::cout << std::setprecision(3);
+
+  for (std::size_t n : {100, 1000, 10000, 100000}) {
+    std::vector<KeyTarget> targets(n);
+    std::vector<std::pair<Key, std::size_t>> values;
+    for (std::size_t i = 0; i < n; i++) {
+      values.push_back(std::make_pair(&targets[i], i));
+    }
+
+    // Look up all keys multiple times, in a random order.
+    std::vector<Key> lookups;
+    for (std::size_t i = 0; i < std::max(n, std::size_t(1000000)); i++) {
+      lookups.push_back(values[i % n].first);
+    }
+    std::shuffle(lookups.begin(), lookups.end(), std::default_random_engine(42));
+
+    std::size_t num_construction_loops = std::max(std::size_t(1), num_loops * 100 / n);
+    runBenchmark("random", num_construction_loops, values, lookups);
+    runBenchmark("perfect", num_construction_loops, values, lookups, Map::PerfectHashing());
+  }
+
+  return 0;
+}
@@ -0,0 +1,86 @@
+/*
+ * Copyright 2014 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FRUIT_BINDING_HANDLE_H
+#define FRUIT_BINDING_HANDLE_H
+
+// This include is not required here, but having it here shortens the include trace in error messages.
+#include <fruit/impl/injection_errors.h>
+
+#include <fruit/fruit_forward_decls.h>
+#include <fruit/impl/fruit_internal_forward_decls.h>
+#include <fruit/impl/meta/component.h>
+#include <cstddef>
+#include <cstdint>
+
+namespace fruit {
+
+/**
+ * A handle for the binding of C (that can be annotated, e.g. Annotated<Annotation, SomeClass>) in a NormalizedComponent,
+ * obtained with NormalizedComponent::getBindingHandle<C>().
+ * 
+ * The handle can then be passed to the get()/unsafeGet() methods of any injector, but it's only useful with injectors
+ * created from that NormalizedComponent (directly or through a PreparedDelta): in those injectors the binding of C is at
+ * the same position as in the NormalizedComponent, so getting the object doesn't require any lookup (not even for types
+ * that aren't in the Injector's type parameters). With other injectors, the type is looked up as in unsafeGet<C>().
+ * 
+ * Example usage in a server:
+ * 
+ * NormalizedComponent<Required<Request>, Foo, Bar> normalizedComponent = ...;
+ * BindingHandle<Bar> barHandle = normalizedComponent.getBindingHandle<Bar>();
+ * 
+ * for (...) {
+ *   // For each request.
+ *   Injector<Foo> injector(normalizedComponent, getRequestComponent(request));
+ *   Bar* bar = injector.get(barHandle);
+ *   ...
+ * }
+ * 
+ * A handle is just a pair of an id and an index, so it's cheap to copy. It must not be used after the
+ * NormalizedComponent it was obtained from has been destroyed.
+ */
+template <typename C>
+class BindingHandle {
+public:
+  BindingHandle(const BindingHandle&) = default;
+  BindingHandle& operator=(const BindingHandle&) = default;
+  
+private:
+  using Check1 = typename fruit::impl::meta::CheckIfError<fruit::impl::meta::Eval<fruit::impl::meta::CheckNormalizedTypes(fruit::impl::meta::Type<C>)>>::type;
+  // Force instantiation of Check1.
+  static_assert(true || sizeof(Check1), "");
+  
+  // The id of the NormalizedComponentStorage of the NormalizedComponent that this handle was obtained from. This is an id
+  // instead of a pointer so that a handle can't match a different NormalizedComponent that was later allocated at the
+  // same address.
+  std::uint64_t normalized_component_id;
+  
+  // The index of the node of C in the bindings of that NormalizedComponentStorage (see SemistaticGraph::nodeIndex()).
+  std::size_t node_index;
+  
+  BindingHandle(std::uint64_t normalized_component_id, std::size_t node_index);
+  
+  template <typename... Params>
+  friend class NormalizedComponent;
+  
+  friend class fruit::impl::InjectorStorage;
+};
+
+} // namespace fruit
+
+#include <fruit/impl/binding_handle.defn.h>
+
+#endif // FRUIT_BINDING_HANDLE_H
@@ -76,6 +76,10 @@ class Component {
   friend
   class NormalizedComponent;
 
+  template<typename... OtherParams>
+  friend
+  class PreparedDelta;
+
   template<typename... OtherParams>
   friend
   class Injector;
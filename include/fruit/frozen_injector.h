@@ -0,0 +1,116 @@
+/*
+ * Copyright 2014 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FRUIT_FROZEN_INJECTOR_H
+#define FRUIT_FROZEN_INJECTOR_H
+
+#include <fruit/injector.h>
+
+#include <memory>
+
+namespace fruit {
+
+/**
+ * A read-only version of an injector, where all objects have already been constructed.
+ *
+ * A FrozenInjector is constructed from an Injector: all the objects reachable from the types in P... are constructed
+ * (like eagerlyInjectAll(), but also including the types only injected through a Provider) together with all the
+ * multibindings, and then the data that is only needed to construct objects (e.g. the dependencies between the bindings)
+ * is released. The objects of the types in P... are stored in an array of pointers that's never modified afterwards,
+ * so get() is just an indexed load (it doesn't check whether the object was constructed, nor lock) and it can be called
+ * by any number of threads concurrently.
+ *
+ * Example usage:
+ *
+ * // At startup (e.g. inside main()).
+ * FrozenInjector<Foo, Bar> injector(Injector<Foo, Bar>(getFooBarComponent()));
+ *
+ * // In worker threads (or in processes forked after this point).
+ * Foo* foo = injector.get<Foo*>();
+ *
+ * The array of pointers is the only memory allocated from the MemoryResource passed to the constructor, so e.g. a
+ * MemoryResource that allocates from dedicated pages can be used to ensure that these pages are never written after the
+ * FrozenInjector is constructed (and therefore they stay shared between processes forked after that).
+ *
+ * The constructed objects can keep using the Providers injected in them (the objects of those Providers were constructed
+ * too). Multibindings can't be retrieved from a FrozenInjector, but the MultibindingsRange objects retrieved from the
+ * Injector before freezing it remain valid until the FrozenInjector is destroyed.
+ */
+template <typename... P>
+class FrozenInjector {
+private:
+  template <typename T>
+  using RemoveAnnotations = fruit::impl::meta::UnwrapType<fruit::impl::meta::Eval<
+      fruit::impl::meta::RemoveAnnotations(fruit::impl::meta::Type<T>)
+      >>;
+
+public:
+  /**
+   * Constructs all the objects of `injector' (see above) and freezes it.
+   *
+   * The Injector must not have constructed any object before (otherwise the types only injected through a Provider in
+   * the objects already constructed might not be constructed here, and they couldn't be constructed later) and it must not
+   * have child injectors; these are checked, and a fatal error is reported if they're not satisfied. The Injector must
+   * not be used concurrently by other threads while this constructor runs (the objects are constructed on the calling
+   * thread).
+   * `memory_resource' is used to allocate the array of pointers to the objects of P..., and must remain valid until this
+   * object is destroyed.
+   */
+  explicit FrozenInjector(Injector<P...>&& injector, MemoryResource& memory_resource = getDefaultMemoryResource());
+
+  FrozenInjector(FrozenInjector&&) = default;
+  FrozenInjector(const FrozenInjector&) = delete;
+
+  FrozenInjector& operator=(FrozenInjector&&) = delete;
+  FrozenInjector& operator=(const FrozenInjector&) = delete;
+
+  /**
+   * Returns an instance of the specified type. The types allowed are the same as in Injector::get(), for the same C.
+   *
+   * This is thread-safe, even if the FrozenInjector is used by multiple threads at the same time.
+   */
+  template <typename T>
+  RemoveAnnotations<T> get() const;
+
+  /**
+   * This is a convenient way to call get(). E.g.:
+   *
+   * MyInterface* x(injector);
+   *
+   * is equivalent to:
+   *
+   * MyInterface* x = injector.get<MyInterface*>();
+   */
+  template <typename T>
+  explicit operator T() const;
+
+private:
+  std::unique_ptr<fruit::impl::InjectorStorage> storage;
+
+  using ExposedNodes = std::array<fruit::impl::InjectorStorage::Graph::node_iterator, sizeof...(P)>;
+
+  // The nodes for the types in P... (in the same order). These are only used to construct Providers.
+  ExposedNodes exposed_nodes;
+
+  // The objects for the types in P... (in the same order). This array is owned by `storage'.
+  void* const* objects;
+};
+
+} // namespace fruit
+
+#include <fruit/impl/frozen_injector.defn.h>
+
+#endif // FRUIT_FROZEN_INJECTOR_H
@@ -27,8 +27,14 @@
 #include <fruit/fruit_forward_decls.h>
 #include <fruit/component.h>
 #include <fruit/normalized_component.h>
+#include <fruit/binding_handle.h>
 #include <fruit/macro.h>
+#include <fruit/memory_resource.h>
+#include <fruit/multibindings_range.h>
+#include <fruit/injection_profile.h>
 #include <fruit/injector.h>
 #include <fruit/provider.h>
+#include <fruit/versioned_injector.h>
+#include <fruit/frozen_injector.h>
 
 #endif // FRUIT_FRUIT_H
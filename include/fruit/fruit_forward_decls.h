@@ -47,12 +47,31 @@ class PartialComponent;
 template <typename... Types>
 class NormalizedComponent;
 
+template <typename... Types>
+class PreparedDelta;
+
 template <typename C>
 class Provider;
 
+template <typename C>
+class BindingHandle;
+
 template <typename... P>
 class Injector;
 
+template <typename... P>
+class VersionedInjector;
+
+template <typename... P>
+class FrozenInjector;
+
+class MemoryResource;
+
+template <typename C>
+class MultibindingsRange;
+
+class InjectionProfile;
+
 } // namespace fruit
 
 #endif // FRUIT_FRUIT_FORWARD_DECLS_H
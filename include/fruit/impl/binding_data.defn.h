@@ -136,7 +136,6 @@ inline NormalizedMultibindingData::Elem::Elem(MultibindingData multibinding_data
   object = multibinding_data.object;
 }
 
-
 } // namespace impl
 } // namespace fruit
 
@@ -147,7 +147,7 @@ struct MultibindingData {
   using object_t = void*;
   using destroy_t = void(*)(void*);
   using create_t = object_t(*)(InjectorStorage&);
-  using get_multibindings_vector_t = std::shared_ptr<char>(*)(InjectorStorage&);
+  using get_multibindings_vector_t = object_t(*)(InjectorStorage&, const object_t* objects_begin, const object_t* objects_end);
   
   MultibindingData(create_t create, const BindingDeps* deps, get_multibindings_vector_t get_multibindings_vector, 
                    bool needs_allocation);
@@ -163,8 +163,8 @@ struct MultibindingData {
   // If object==nullptr (i.e. create!=nullptr), the types that will be injected directly when `create' is called.
   const BindingDeps* deps = nullptr;
   
-  // Returns the std::vector<T*> of instances, or nullptr if none.
-  // Caches the result in the `v' member of NormalizedMultibindingData.
+  // Returns a new std::vector<T*> (owned by the InjectorStorage) with the objects in [objects_begin, objects_end), that
+  // must be the (already constructed) objects of all multibindings for the type.
   get_multibindings_vector_t get_multibindings_vector;
 
   bool needs_allocation = true;
@@ -182,20 +182,19 @@ struct NormalizedMultibindingData {
     MultibindingData::object_t object = nullptr;
   };
   
-  // Can be empty, but only if v is present and non-empty.
-  std::vector<Elem> elems;
+  TypeId type;
   
-  // TODO: Check this comment.
-  // Returns the std::vector<T*> of instances, or nullptr if none.
-  // Caches the result in the `v' member.
-  MultibindingData::get_multibindings_vector_t get_multibindings_vector;
+  // The multibindings for `type', in the order in which they were added. These point into the elems of a
+  // NormalizedMultibindingTable, so this object is trivially copyable.
+  // This range is never empty.
+  const Elem* elems_begin;
+  const Elem* elems_end;
   
-  // A (casted) pointer to the std::vector<T*> of objects, or nullptr if the vector hasn't been constructed yet.
-  // Can't be empty.
-  std::shared_ptr<char> v;
+  // See MultibindingData::get_multibindings_vector. The result is cached by the InjectorStorage, this object is never
+  // modified.
+  MultibindingData::get_multibindings_vector_t get_multibindings_vector;
 };
 
-
 } // namespace impl
 } // namespace fruit
 
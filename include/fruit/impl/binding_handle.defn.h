@@ -0,0 +1,32 @@
+/*
+ * Copyright 2014 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FRUIT_BINDING_HANDLE_DEFN_H
+#define FRUIT_BINDING_HANDLE_DEFN_H
+
+// Redundant, but makes KDevelop happy.
+#include <fruit/binding_handle.h>
+
+namespace fruit {
+
+template <typename C>
+inline BindingHandle<C>::BindingHandle(std::uint64_t normalized_component_id, std::size_t node_index)
+  : normalized_component_id(normalized_component_id), node_index(node_index) {
+}
+
+} // namespace fruit
+
+#endif // FRUIT_BINDING_HANDLE_DEFN_H
@@ -53,11 +53,6 @@ struct BindingNormalization {
       const std::vector<std::pair<TypeId, MultibindingData>>& multibindings,
       const std::vector<TypeId>& exposed_types,
       BindingCompressionInfoMap& bindingCompressionInfoMap);
-
-  static void addMultibindings(std::unordered_map<TypeId, NormalizedMultibindingData>& multibindings,
-                               FixedSizeAllocator::FixedSizeAllocatorData& fixed_size_allocator_data,
-                               const std::vector<std::pair<TypeId, MultibindingData>>& multibindings_vector);
-  
 };
 
 } // namespace impl
@@ -70,15 +70,19 @@ inline void FixedSizeAllocator::FixedSizeAllocatorData::addExternallyAllocatedTy
   num_types_to_destroy++;
 }
 
+inline void FixedSizeAllocator::FixedSizeAllocatorData::addPointerArray(std::size_t n) {
+#ifdef FRUIT_EXTRA_DEBUG
+  num_pointers += n;
+#endif
+  total_size += alignof(void*) + sizeof(void*) * n - 1;
+}
+
 inline std::size_t FixedSizeAllocator::FixedSizeAllocatorData::maximumRequiredSpace(TypeId type) {
   return type.type_info->alignment() + type.type_info->size() - 1;
 }
 
-template <typename AnnotatedT, typename... Args>
-inline fruit::impl::meta::UnwrapType<fruit::impl::meta::Eval<fruit::impl::meta::RemoveAnnotations(fruit::impl::meta::Type<AnnotatedT>)>>* 
-FixedSizeAllocator::constructObject(Args&&... args) {
-  using T = fruit::impl::meta::UnwrapType<fruit::impl::meta::Eval<fruit::impl::meta::RemoveAnnotations(fruit::impl::meta::Type<AnnotatedT>)>>;
-  
+template <typename AnnotatedT, typename T>
+inline T* FixedSizeAllocator::allocateObject() {
   char* p = storage_last_used;
   size_t misalignment = std::uintptr_t(p) % alignof(T);
 #ifdef FRUIT_EXTRA_DEBUG
@@ -87,8 +91,20 @@ FixedSizeAllocator::constructObject(Args&&... args) {
 #endif
   p += alignof(T) - misalignment;
   FruitAssert(std::uintptr_t(p) % alignof(T) == 0);
-  T* x = reinterpret_cast<T*>(p);
   storage_last_used = p + sizeof(T) - 1;
+  return reinterpret_cast<T*>(p);
+}
+
+template <typename AnnotatedT, typename... Args>
+inline fruit::impl::meta::UnwrapType<fruit::impl::meta::Eval<fruit::impl::meta::RemoveAnnotations(fruit::impl::meta::Type<AnnotatedT>)>>* 
+FixedSizeAllocator::constructObject(Args&&... args) {
+  using T = fruit::impl::meta::UnwrapType<fruit::impl::meta::Eval<fruit::impl::meta::RemoveAnnotations(fruit::impl::meta::Type<AnnotatedT>)>>;
+  
+  if (mutex != nullptr) {
+    return constructObjectWithMutex<AnnotatedT, T>(std::forward<Args>(args)...);
+  }
+  
+  T* x = allocateObject<AnnotatedT, T>();
   
   // This runs arbitrary code (T's constructor), which might end up calling
   // constructObject recursively. We must make sure all invariants are satisfied before
@@ -104,18 +120,73 @@ FixedSizeAllocator::constructObject(Args&&... args) {
   return x;
 }
 
+template <typename AnnotatedT, typename T, typename... Args>
+inline T* FixedSizeAllocator::constructObjectWithMutex(Args&&... args) {
+  T* x;
+  {
+    std::lock_guard<std::mutex> lock(*mutex);
+    x = allocateObject<AnnotatedT, T>();
+  }
+  
+  // The mutex is not held here, since T's constructor might construct other objects using this allocator.
+  new (x) T(std::forward<Args>(args)...);
+  
+  if (!std::is_trivially_destructible<T>::value) {
+    std::lock_guard<std::mutex> lock(*mutex);
+    on_destruction.push_back(
+        std::pair<destroy_t, void*>{destroyObject<T>, x});
+  }
+  return x;
+}
+
 template <typename T>
 inline void FixedSizeAllocator::registerExternallyAllocatedObject(T* p) {
+  if (mutex != nullptr) {
+    std::lock_guard<std::mutex> lock(*mutex);
+    on_destruction.push_back(std::pair<destroy_t, void*>{destroyExternalObject<T>, p});
+    return;
+  }
   on_destruction.push_back(std::pair<destroy_t, void*>{destroyExternalObject<T>, p});
 }
 
-inline FixedSizeAllocator::FixedSizeAllocator(FixedSizeAllocatorData allocator_data)
-  : on_destruction(allocator_data.num_types_to_destroy) {
+inline void** FixedSizeAllocator::allocatePointerArray(std::size_t n) {
+  FruitAssert(n != 0);
+  std::unique_lock<std::mutex> lock;
+  if (mutex != nullptr) {
+    lock = std::unique_lock<std::mutex>(*mutex);
+  }
+#ifdef FRUIT_EXTRA_DEBUG
+  FruitAssert(remaining_pointers >= n);
+  remaining_pointers -= n;
+#endif
+  char* p = storage_last_used;
+  size_t misalignment = std::uintptr_t(p) % alignof(void*);
+  p += alignof(void*) - misalignment;
+  FruitAssert(std::uintptr_t(p) % alignof(void*) == 0);
+  storage_last_used = p + sizeof(void*) * n - 1;
+  FruitAssert(storage_last_used < storage_begin + storage_size);
+  return reinterpret_cast<void**>(p);
+}
+
+inline void FixedSizeAllocator::setMutex(std::mutex* mutex) {
+  this->mutex = mutex;
+}
+
+inline std::size_t FixedSizeAllocator::getUsedBytes() const {
+  return storage_last_used - storage_begin;
+}
+
+inline FixedSizeAllocator::FixedSizeAllocator(FixedSizeAllocatorData allocator_data, MemoryResource& memory_resource)
+  : memory_resource(&memory_resource),
+    on_destruction(allocator_data.num_types_to_destroy, memory_resource) {
   // The +1 is because we waste the first byte (storage_last_used points to the beginning of storage).
-  storage_begin = new char[allocator_data.total_size + 1];
+  // constructObject() aligns each object, so there's no alignment requirement for the whole chunk.
+  storage_size = allocator_data.total_size + 1;
+  storage_begin = reinterpret_cast<char*>(memory_resource.allocate(storage_size, 1));
   storage_last_used = storage_begin;
 #ifdef FRUIT_EXTRA_DEBUG
   remaining_types = allocator_data.types;
+  remaining_pointers = allocator_data.num_pointers;
   std::cerr << "Constructing allocator for types:";
   for (auto x : remaining_types) {
     std::cerr << " " << x.first;
@@ -128,18 +199,26 @@ inline FixedSizeAllocator::FixedSizeAllocator(FixedSizeAllocator&& x)
   : FixedSizeAllocator() {
   std::swap(storage_begin, x.storage_begin);
   std::swap(storage_last_used, x.storage_last_used);
+  std::swap(storage_size, x.storage_size);
+  std::swap(memory_resource, x.memory_resource);
   std::swap(on_destruction, x.on_destruction);
+  std::swap(mutex, x.mutex);
 #ifdef FRUIT_EXTRA_DEBUG
   std::swap(remaining_types, x.remaining_types);
+  std::swap(remaining_pointers, x.remaining_pointers);
 #endif
 }
 
 inline FixedSizeAllocator& FixedSizeAllocator::operator=(FixedSizeAllocator&& x) {
   std::swap(storage_begin, x.storage_begin);
   std::swap(storage_last_used, x.storage_last_used);
+  std::swap(storage_size, x.storage_size);
+  std::swap(memory_resource, x.memory_resource);
   std::swap(on_destruction, x.on_destruction);
+  std::swap(mutex, x.mutex);
 #ifdef FRUIT_EXTRA_DEBUG
   std::swap(remaining_types, x.remaining_types);
+  std::swap(remaining_pointers, x.remaining_pointers);
 #endif
   return *this;
 }
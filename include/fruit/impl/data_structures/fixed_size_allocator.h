@@ -20,6 +20,9 @@
 #include <fruit/impl/util/type_info.h>
 #include <fruit/impl/data_structures/fixed_size_vector.h>
 #include <fruit/impl/meta/component.h>
+#include <fruit/impl/fruit_internal_forward_decls.h>
+
+#include <mutex>
 
 #ifdef FRUIT_EXTRA_DEBUG
 #include <unordered_map>
@@ -42,8 +45,15 @@ private:
   // The chunk of memory that will be used for all allocations.
   char* storage_begin = nullptr;
   
+  // The size of the chunk starting at storage_begin.
+  std::size_t storage_size = 0;
+  
+  // The MemoryResource used to allocate storage_begin (and on_destruction). This is nullptr iff storage_begin is nullptr.
+  MemoryResource* memory_resource = nullptr;
+  
 #ifdef FRUIT_EXTRA_DEBUG
    std::unordered_map<TypeId, std::size_t> remaining_types;
+   std::size_t remaining_pointers = 0;
 #endif
   
   // This vector contains the destroy operations that have to be performed at destruction, and
@@ -51,6 +61,10 @@ private:
   // These must be called in reverse order.
   FixedSizeVector<std::pair<destroy_t, void*>> on_destruction;
   
+  // If this is not nullptr, it's locked while updating the fields above, so that multiple threads can construct objects
+  // concurrently. See setMutex().
+  std::mutex* mutex = nullptr;
+  
   // Destroys an object previously created using constructObject().
   template <typename C>
   static void destroyObject(void* p);
@@ -59,6 +73,18 @@ private:
   template <typename C>
   static void destroyExternalObject(void* p);
   
+  // Reserves the space for an object of type T (the type AnnotatedT without annotations), without constructing it.
+  // If a mutex is set, the caller must hold it.
+  template <typename AnnotatedT, typename T>
+  T* allocateObject();
+  
+  // The implementation of constructObject() used while a mutex is set, so that the common case doesn't pay for it.
+  template <typename AnnotatedT, typename T, typename... Args>
+  T* constructObjectWithMutex(Args&&... args);
+  
+  // Destroys all objects in on_destruction (in reverse order) and clears it.
+  void destroyAll();
+  
 public:
   // Data used to construct an allocator for a fixed set of types.
   class FixedSizeAllocatorData {
@@ -67,6 +93,7 @@ public:
     std::size_t num_types_to_destroy = 0;
 #ifdef FRUIT_EXTRA_DEBUG
     std::unordered_map<TypeId, std::size_t> types;
+    std::size_t num_pointers = 0;
 #endif
   
     static std::size_t maximumRequiredSpace(TypeId type);
@@ -84,13 +111,25 @@ public:
     // Each call to this method with getTypeId<T>() allows 1 registerExternallyAllocatedType<T>(...) call on the resulting
     // allocator.
     void addExternallyAllocatedType(TypeId typeId);
+    
+    // Each call to this method allows 1 allocatePointerArray(n) call on the resulting allocator. The space reserved by
+    // multiple calls can also be used for a single, larger array: e.g. after addPointerArray(n1) and addPointerArray(n2),
+    // allocatePointerArray(n1 + n2) can be called once.
+    void addPointerArray(std::size_t n);
+    
+    // Writes this object to `writer' (see NormalizedComponentImage).
+    void writeImage(ImageWriter& writer) const;
+    
+    // Replaces the contents of this object with the ones written by writeImage().
+    void readImage(ImageReader& reader);
   };
   
   // Constructs an empty allocator (no allocations are allowed).
   FixedSizeAllocator() = default;
   
-  // Constructs an allocator for the type set in FixedSizeAllocatorData.
-  FixedSizeAllocator(FixedSizeAllocatorData allocator_data);
+  // Constructs an allocator for the type set in FixedSizeAllocatorData. All the memory used by the allocator is allocated
+  // from `memory_resource' (but externally-allocated objects are still deallocated with delete).
+  FixedSizeAllocator(FixedSizeAllocatorData allocator_data, MemoryResource& memory_resource = getDefaultMemoryResource());
   
   FixedSizeAllocator(FixedSizeAllocator&&);
   FixedSizeAllocator& operator=(FixedSizeAllocator&&);
@@ -102,6 +141,10 @@ public:
   // registerExternallyAllocatedObject() are destroyed.
   ~FixedSizeAllocator();
   
+  // Destroys all objects (as the destructor does) and then makes the allocator usable again, reusing the same memory.
+  // `allocator_data' must be the same FixedSizeAllocatorData used to construct this allocator.
+  void reset(const FixedSizeAllocatorData& allocator_data);
+  
   // Allocates an object of type T, constructing it with the specified arguments. Similar to:
   // new C(args...)
   template <typename AnnotatedT, typename... Args>
@@ -109,6 +152,19 @@ public:
   
   template <typename T>
   void registerExternallyAllocatedObject(T* p);
+  
+  // Allocates an uninitialized array of `n' pointers (n>0). Nothing is destroyed for the array: its memory is just reused
+  // after a reset() and released with the rest of the allocator's memory.
+  void** allocatePointerArray(std::size_t n);
+  
+  // While a mutex is set (i.e. until the next setMutex(nullptr) call), constructObject() and
+  // registerExternallyAllocatedObject() can be called concurrently from multiple threads.
+  // Objects are destroyed in the reverse order of when their construction completed, so an object must be fully
+  // constructed before starting the construction of the objects that depend on it.
+  void setMutex(std::mutex* mutex);
+  
+  // Returns the number of bytes used so far by constructObject() and allocatePointerArray() (including padding).
+  std::size_t getUsedBytes() const;
 };
 
 } // namespace impl
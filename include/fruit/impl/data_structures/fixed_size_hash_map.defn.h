@@ -0,0 +1,106 @@
+/*
+ * Copyright 2014 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FRUIT_FIXED_SIZE_HASH_MAP_DEFN_H
+#define FRUIT_FIXED_SIZE_HASH_MAP_DEFN_H
+
+#include <fruit/impl/data_structures/fixed_size_hash_map.h>
+
+#include <fruit/impl/fruit_assert.h>
+
+#include <functional>
+#include <type_traits>
+
+namespace fruit {
+namespace impl {
+
+template <typename Key, typename Value>
+inline typename FixedSizeHashMap<Key, Value>::Slot& FixedSizeHashMap<Key, Value>::findSlot(const Key& key) {
+  return const_cast<Slot&>(static_cast<const FixedSizeHashMap*>(this)->findSlot(key));
+}
+
+template <typename Key, typename Value>
+inline const typename FixedSizeHashMap<Key, Value>::Slot& FixedSizeHashMap<Key, Value>::findSlot(const Key& key) const {
+  // Multiplicative (Fibonacci) hashing, since std::hash is often the identity (e.g. for TypeId and pointers) and the low
+  // bits of addresses are mostly 0.
+  Unsigned h = Unsigned(std::hash<typename std::remove_cv<Key>::type>()(key));
+  Unsigned i = Unsigned(h * Unsigned(0x9E3779B97F4A7C15ULL)) >> shift;
+  while (slots[i].index_plus_one != 0 && !(slots[i].key == key)) {
+    i = (i + 1) & mask;
+  }
+  return slots[i];
+}
+
+template <typename Key, typename Value>
+inline std::pair<typename FixedSizeHashMap<Key, Value>::iterator, bool>
+FixedSizeHashMap<Key, Value>::insert(const Key& key, const Value& value) {
+  Slot& slot = findSlot(key);
+  if (slot.index_plus_one != 0) {
+    return std::make_pair(elements.begin() + (slot.index_plus_one - 1), false);
+  }
+  slot.key = key;
+  elements.push_back(value_type(key, value));
+  slot.index_plus_one = elements.size();
+  return std::make_pair(elements.end() - 1, true);
+}
+
+template <typename Key, typename Value>
+inline typename FixedSizeHashMap<Key, Value>::iterator FixedSizeHashMap<Key, Value>::find(const Key& key) {
+  const Slot& slot = findSlot(key);
+  if (slot.index_plus_one == 0) {
+    return elements.end();
+  }
+  return elements.begin() + (slot.index_plus_one - 1);
+}
+
+template <typename Key, typename Value>
+inline typename FixedSizeHashMap<Key, Value>::const_iterator FixedSizeHashMap<Key, Value>::find(const Key& key) const {
+  const Slot& slot = findSlot(key);
+  if (slot.index_plus_one == 0) {
+    return elements.end();
+  }
+  return elements.begin() + (slot.index_plus_one - 1);
+}
+
+template <typename Key, typename Value>
+inline std::size_t FixedSizeHashMap<Key, Value>::size() const {
+  return elements.size();
+}
+
+template <typename Key, typename Value>
+inline typename FixedSizeHashMap<Key, Value>::iterator FixedSizeHashMap<Key, Value>::begin() {
+  return elements.begin();
+}
+
+template <typename Key, typename Value>
+inline typename FixedSizeHashMap<Key, Value>::iterator FixedSizeHashMap<Key, Value>::end() {
+  return elements.end();
+}
+
+template <typename Key, typename Value>
+inline typename FixedSizeHashMap<Key, Value>::const_iterator FixedSizeHashMap<Key, Value>::begin() const {
+  return elements.begin();
+}
+
+template <typename Key, typename Value>
+inline typename FixedSizeHashMap<Key, Value>::const_iterator FixedSizeHashMap<Key, Value>::end() const {
+  return elements.end();
+}
+
+} // namespace impl
+} // namespace fruit
+
+#endif // FRUIT_FIXED_SIZE_HASH_MAP_DEFN_H
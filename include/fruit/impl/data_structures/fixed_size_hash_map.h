@@ -0,0 +1,100 @@
+/*
+ * Copyright 2014 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FRUIT_FIXED_SIZE_HASH_MAP_H
+#define FRUIT_FIXED_SIZE_HASH_MAP_H
+
+#include <fruit/impl/data_structures/fixed_size_vector.h>
+
+#include <cstdint>
+#include <utility>
+
+namespace fruit {
+namespace impl {
+
+/**
+ * A hash map for temporary lookups, e.g. while normalizing bindings or constructing a SemistaticGraph.
+ * The maximum number of elements is fixed at construction time, so it allocates two arrays once (instead of a node for each
+ * element as std::unordered_map does) and never rehashes. Elements can't be removed.
+ * Collisions are resolved with linear probing in a table that's at least twice as big as the capacity; each slot of the
+ * table stores the key, so a lookup usually touches a single cache line of the table.
+ * Iteration is in insertion order.
+ * Key and Value must be trivially copyable, and Key must be default-constructible.
+ */
+template <typename Key, typename Value>
+class FixedSizeHashMap {
+public:
+  using value_type = std::pair<Key, Value>;
+  using iterator = value_type*;
+  using const_iterator = const value_type*;
+  
+private:
+  using Unsigned = std::uintptr_t;
+  
+  struct Slot {
+    Key key;
+    // The index of the element with this key in `elements', plus 1. 0 if the slot is empty.
+    Unsigned index_plus_one;
+  };
+  
+  FixedSizeVector<Slot> slots;
+  
+  // slots.size() - 1. slots.size() is a power of 2.
+  Unsigned mask;
+  
+  // The number of bits to right-shift the multiplied hash by, to get a slot index.
+  unsigned shift;
+  
+  FixedSizeVector<value_type> elements;
+  
+  // Returns the slot where `key' is, or the empty slot where it would be inserted.
+  Slot& findSlot(const Key& key);
+  const Slot& findSlot(const Key& key) const;
+  
+public:
+  // Constructs an empty map that can hold up to `capacity' elements.
+  explicit FixedSizeHashMap(std::size_t capacity, MemoryResource& memory_resource = getDefaultMemoryResource());
+  
+  FixedSizeHashMap(FixedSizeHashMap&&) = default;
+  FixedSizeHashMap(const FixedSizeHashMap&) = delete;
+  
+  FixedSizeHashMap& operator=(FixedSizeHashMap&&) = default;
+  FixedSizeHashMap& operator=(const FixedSizeHashMap&) = delete;
+  
+  // Inserts (key, value) unless `key' is already in the map. Returns the element with that key, and whether it was
+  // inserted.
+  // This yields undefined behavior (instead of rehashing) if the map's capacity is exceeded.
+  std::pair<iterator, bool> insert(const Key& key, const Value& value);
+  
+  // Returns the element with the specified key, or end() if there's none.
+  iterator find(const Key& key);
+  const_iterator find(const Key& key) const;
+  
+  std::size_t size() const;
+  
+  iterator begin();
+  iterator end();
+  
+  const_iterator begin() const;
+  const_iterator end() const;
+};
+
+} // namespace impl
+} // namespace fruit
+
+#include <fruit/impl/data_structures/fixed_size_hash_map.defn.h>
+
+#endif // FRUIT_FIXED_SIZE_HASH_MAP_H
@@ -0,0 +1,48 @@
+/*
+ * Copyright 2014 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FRUIT_FIXED_SIZE_HASH_MAP_TEMPLATES_H
+#define FRUIT_FIXED_SIZE_HASH_MAP_TEMPLATES_H
+
+#ifndef IN_FRUIT_CPP_FILE
+#error "Fruit .template.h file included in non-cpp file."
+#endif
+
+#include <fruit/impl/data_structures/fixed_size_hash_map.h>
+#include <fruit/impl/data_structures/fixed_size_vector.templates.h>
+
+#include <climits>
+
+namespace fruit {
+namespace impl {
+
+template <typename Key, typename Value>
+FixedSizeHashMap<Key, Value>::FixedSizeHashMap(std::size_t capacity, MemoryResource& memory_resource)
+  : elements(capacity, memory_resource) {
+  // At least 2 slots, so that `shift' is less than the number of bits in Unsigned.
+  unsigned num_bits = 1;
+  while ((Unsigned(1) << num_bits) < 2 * capacity) {
+    ++num_bits;
+  }
+  slots = FixedSizeVector<Slot>(Unsigned(1) << num_bits, Slot{Key(), 0}, memory_resource);
+  mask = (Unsigned(1) << num_bits) - 1;
+  shift = sizeof(Unsigned) * CHAR_BIT - num_bits;
+}
+
+} // namespace impl
+} // namespace fruit
+
+#endif // FRUIT_FIXED_SIZE_HASH_MAP_TEMPLATES_H
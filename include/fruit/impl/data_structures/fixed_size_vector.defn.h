@@ -29,22 +29,23 @@ namespace fruit {
 namespace impl {
 
 template <typename T>
-inline FixedSizeVector<T>::FixedSizeVector(std::size_t capacity) {
+inline FixedSizeVector<T>::FixedSizeVector(std::size_t capacity, MemoryResource& memory_resource)
+  : memory_resource(&memory_resource) {
   if (capacity == 0) {
     v_begin = 0;
   } else {
-    v_begin = reinterpret_cast<T*>(operator new(sizeof(T) * capacity));
+    v_begin = reinterpret_cast<T*>(memory_resource.allocate(sizeof(T) * capacity, alignof(T)));
   }
   v_end = v_begin;
-#ifdef FRUIT_EXTRA_DEBUG
   v_end_of_storage = v_begin + capacity;
-#endif
 }
 
 template <typename T>
 inline FixedSizeVector<T>::~FixedSizeVector() {
   clear();
-  operator delete(v_begin);
+  if (v_begin != nullptr) {
+    memory_resource->deallocate(v_begin, sizeof(T) * (v_end_of_storage - v_begin), alignof(T));
+  }
 }
 
 template <typename T>
@@ -80,21 +81,16 @@ template <typename T>
 inline void FixedSizeVector<T>::swap(FixedSizeVector& x) {
   std::swap(v_end, x.v_end);
   std::swap(v_begin, x.v_begin); 
-#ifdef FRUIT_EXTRA_DEBUG
   std::swap(v_end_of_storage, x.v_end_of_storage);
-#endif
+  std::swap(memory_resource, x.memory_resource);
 }
 
 template <typename T>
 inline void FixedSizeVector<T>::push_back(T x) {
-#ifdef FRUIT_EXTRA_DEBUG
   FruitAssert(v_end != v_end_of_storage);
-#endif
   new (v_end) T(x);
   ++v_end;
-#ifdef FRUIT_EXTRA_DEBUG
   FruitAssert(v_end <= v_end_of_storage);
-#endif
 }
 
 // This method is covered by tests, even though lcov doesn't detect that.
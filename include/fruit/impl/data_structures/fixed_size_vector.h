@@ -17,6 +17,8 @@
 #ifndef FRUIT_FIXED_SIZE_VECTOR_H
 #define FRUIT_FIXED_SIZE_VECTOR_H
 
+#include <fruit/memory_resource.h>
+
 #include <cstdlib>
 
 namespace fruit {
@@ -35,22 +37,25 @@ private:
   // v_end is before v_begin here, because it's the most commonly accessed field.
   T* v_end;
   T* v_begin;
-#ifdef FRUIT_EXTRA_DEBUG
+  // This is needed to know the size of the memory to deallocate.
   T* v_end_of_storage;
-#endif
+  
+  // The memory of this vector is allocated from (and released to) this MemoryResource.
+  MemoryResource* memory_resource;
   
 public:
   using iterator = T*;
   using const_iterator = const T*;
   
-  FixedSizeVector(std::size_t capacity = 0);
+  FixedSizeVector(std::size_t capacity = 0, MemoryResource& memory_resource = getDefaultMemoryResource());
   // Creates a vector with the specified size (and equal capacity) initialized with the specified value.
-  FixedSizeVector(std::size_t size, const T& value);
+  FixedSizeVector(std::size_t size, const T& value, MemoryResource& memory_resource = getDefaultMemoryResource());
   ~FixedSizeVector();
   
   // Copy construction is not allowed, you need to specify the capacity in order to construct the copy.
   FixedSizeVector(const FixedSizeVector& other) = delete;
-  FixedSizeVector(const FixedSizeVector& other, std::size_t capacity);
+  FixedSizeVector(const FixedSizeVector& other, std::size_t capacity,
+                  MemoryResource& memory_resource = getDefaultMemoryResource());
   
   FixedSizeVector(FixedSizeVector&& other);
   
@@ -29,8 +29,8 @@ namespace fruit {
 namespace impl {
 
 template <typename T>
-FixedSizeVector<T>::FixedSizeVector(const FixedSizeVector& other, std::size_t capacity)
-  : FixedSizeVector(capacity) {
+FixedSizeVector<T>::FixedSizeVector(const FixedSizeVector& other, std::size_t capacity, MemoryResource& memory_resource)
+  : FixedSizeVector(capacity, memory_resource) {
   FruitAssert(other.size() <= capacity);
   // This is not just an optimization, we also want to make sure that other.capacity (and therefore
   // also this.capacity) is >0, or we'd pass nullptr to memcpy (although with a size of 0).
@@ -43,8 +43,8 @@ FixedSizeVector<T>::FixedSizeVector(const FixedSizeVector& other, std::size_t ca
 }
 
 template <typename T>
-FixedSizeVector<T>::FixedSizeVector(std::size_t size, const T& value)
-  : FixedSizeVector(size) {
+FixedSizeVector<T>::FixedSizeVector(std::size_t size, const T& value, MemoryResource& memory_resource)
+  : FixedSizeVector(size, memory_resource) {
   for (std::size_t i = 0; i < size; ++i) {
     push_back(value);
   }
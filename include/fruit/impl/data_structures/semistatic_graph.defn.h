@@ -31,58 +31,80 @@ inline bool SemistaticGraphInternalNodeId::operator<(const SemistaticGraphIntern
 }
 
 template <typename NodeId, typename Node>
-inline SemistaticGraph<NodeId, Node>::node_iterator::node_iterator(NodeData* itr) 
-  : itr(itr) {
+inline SemistaticGraph<NodeId, Node>::node_iterator::node_iterator(NodePage* pages, std::size_t index) 
+  : pages(pages), index(index) {
 }
 
 template <typename NodeId, typename Node>
 inline Node& SemistaticGraph<NodeId, Node>::node_iterator::getNode() {
+  NodeData* itr = mutableNodeDataAt(pages, index);
+  FruitAssert(itr->edges_begin != 1);
+  return itr->node;
+}
+
+template <typename NodeId, typename Node>
+inline const Node& SemistaticGraph<NodeId, Node>::node_iterator::getConstNode() {
+  const NodeData* itr = nodeDataAt(pages, index);
   FruitAssert(itr->edges_begin != 1);
   return itr->node;
 }
 
 template <typename NodeId, typename Node>
 inline bool SemistaticGraph<NodeId, Node>::node_iterator::isTerminal() {
+  const NodeData* itr = nodeDataAt(pages, index);
   FruitAssert(itr->edges_begin != 1);
   return itr->edges_begin == 0;
 }
 
+template <typename NodeId, typename Node>
+inline const Node* SemistaticGraph<NodeId, Node>::node_iterator::getConstNodeIfTerminal() {
+  const NodeData* itr = nodeDataAt(pages, index);
+  FruitAssert(itr->edges_begin != 1);
+  return (itr->edges_begin == 0) ? &itr->node : nullptr;
+}
+
 template <typename NodeId, typename Node>
 inline void SemistaticGraph<NodeId, Node>::node_iterator::setTerminal() {
+  NodePage& page = pages[index >> node_page_bits];
+  FruitAssert(page.nodes == page.private_nodes);
+  NodeData* itr = page.nodes + (index & (node_page_size - 1));
   FruitAssert(itr->edges_begin != 1);
   itr->edges_begin = 0;
 }
 
 template <typename NodeId, typename Node>
 inline bool SemistaticGraph<NodeId, Node>::node_iterator::operator==(const node_iterator& other) const {
-  return itr == other.itr;
+  return pages == other.pages && index == other.index;
 }
 
 template <typename NodeId, typename Node>
-inline SemistaticGraph<NodeId, Node>::const_node_iterator::const_node_iterator(const NodeData* itr) 
-  : itr(itr) {
+inline SemistaticGraph<NodeId, Node>::const_node_iterator::const_node_iterator(const NodePage* pages, std::size_t index) 
+  : pages(pages), index(index) {
 }
 
 template <typename NodeId, typename Node>
 inline const Node& SemistaticGraph<NodeId, Node>::const_node_iterator::getNode() {
+  const NodeData* itr = nodeDataAt(pages, index);
   FruitAssert(itr->edges_begin != 1);
   return itr->node;
 }
 
 template <typename NodeId, typename Node>
 inline bool SemistaticGraph<NodeId, Node>::const_node_iterator::isTerminal() {
+  const NodeData* itr = nodeDataAt(pages, index);
   FruitAssert(itr->edges_begin != 1);
   return itr->edges_begin == 0;
 }
 
 template <typename NodeId, typename Node>
 inline bool SemistaticGraph<NodeId, Node>::const_node_iterator::operator==(const const_node_iterator& other) const {
-  return itr == other.itr;
+  return pages == other.pages && index == other.index;
 }
 
 
 template <typename NodeId, typename Node>
 inline typename SemistaticGraph<NodeId, Node>::edge_iterator SemistaticGraph<NodeId, Node>::node_iterator::neighborsBegin() {
+  const NodeData* itr = nodeDataAt(pages, index);
   FruitAssert(itr->edges_begin != 0);
   FruitAssert(itr->edges_begin != 1);
   return edge_iterator{reinterpret_cast<InternalNodeId*>(itr->edges_begin)};
@@ -96,7 +118,7 @@ inline SemistaticGraph<NodeId, Node>::edge_iterator::edge_iterator(InternalNodeI
 template <typename NodeId, typename Node>
 inline typename SemistaticGraph<NodeId, Node>::node_iterator SemistaticGraph<NodeId, Node>::edge_iterator::getNodeIterator(
     node_iterator nodes_begin) {
-  return node_iterator{nodeAtId(nodes_begin.itr, *itr)};
+  return node_iterator{nodes_begin.pages, itr->id};
 }
 
 template <typename NodeId, typename Node>
@@ -111,81 +133,92 @@ inline typename SemistaticGraph<NodeId, Node>::node_iterator SemistaticGraph<Nod
   return getNodeIterator(nodes_begin);
 }
 
+template <typename NodeId, typename Node>
+inline bool SemistaticGraph<NodeId, Node>::edge_iterator::isEnd() const {
+  return itr->id == end_of_edges_marker;
+}
+
 template <typename NodeId, typename Node>
 inline typename SemistaticGraph<NodeId, Node>::node_iterator SemistaticGraph<NodeId, Node>::begin() {
-  return node_iterator{nodes.begin()};
+  return node_iterator{pages.data(), 0};
 }
 
 template <typename NodeId, typename Node>
 inline typename SemistaticGraph<NodeId, Node>::node_iterator SemistaticGraph<NodeId, Node>::end() {
-  return node_iterator{nodes.end()};
+  return node_iterator{pages.data(), first_unused_index};
 }
 
 template <typename NodeId, typename Node>
 inline typename SemistaticGraph<NodeId, Node>::const_node_iterator SemistaticGraph<NodeId, Node>::end() const {
-  return const_node_iterator{nodes.end()};
+  return const_node_iterator{pages.data(), first_unused_index};
 }
 
 template <typename NodeId, typename Node>
 inline typename SemistaticGraph<NodeId, Node>::node_iterator SemistaticGraph<NodeId, Node>::at(NodeId nodeId) {
   InternalNodeId internalNodeId = node_index_map.at(nodeId);
-  return node_iterator{nodeAtId(internalNodeId)};
+  return node_iterator{pages.data(), internalNodeId.id};
 }
 
 template <typename NodeId, typename Node>
 inline typename SemistaticGraph<NodeId, Node>::const_node_iterator SemistaticGraph<NodeId, Node>::find(NodeId nodeId) const {
   const InternalNodeId* internalNodeIdPtr = node_index_map.find(nodeId);
-  if (internalNodeIdPtr == nullptr) {
-    return const_node_iterator{nodes.end()};
-  } else {
-    const NodeData* p = nodeAtId(*internalNodeIdPtr);
-    if (p->edges_begin == 1) {
-      return const_node_iterator{nodes.end()};
-    }
-    return const_node_iterator{p};
+  if (internalNodeIdPtr == nullptr || nodeDataAt(pages.data(), internalNodeIdPtr->id)->edges_begin == 1) {
+    return end();
   }
+  return const_node_iterator{pages.data(), internalNodeIdPtr->id};
 }
 
 template <typename NodeId, typename Node>
 inline typename SemistaticGraph<NodeId, Node>::node_iterator SemistaticGraph<NodeId, Node>::find(NodeId nodeId) {
   const InternalNodeId* internalNodeIdPtr = node_index_map.find(nodeId);
-  if (internalNodeIdPtr == nullptr) {
-    return node_iterator{nodes.end()};
-  } else {
-    NodeData* p = nodeAtId(*internalNodeIdPtr);
-    if (p->edges_begin == 1) {
-      return node_iterator{nodes.end()};
-    }
-    return node_iterator{p};
+  if (internalNodeIdPtr == nullptr || nodeDataAt(pages.data(), internalNodeIdPtr->id)->edges_begin == 1) {
+    return end();
   }
+  return node_iterator{pages.data(), internalNodeIdPtr->id};
+}
+
+template <typename NodeId, typename Node>
+inline std::size_t SemistaticGraph<NodeId, Node>::numNodes() const {
+  return first_unused_index;
+}
+
+template <typename NodeId, typename Node>
+inline std::size_t SemistaticGraph<NodeId, Node>::nodeIndex(node_iterator itr) const {
+  FruitAssert(itr.pages == pages.data() && itr.index < first_unused_index);
+  return itr.index;
+}
+
+template <typename NodeId, typename Node>
+inline typename SemistaticGraph<NodeId, Node>::node_iterator SemistaticGraph<NodeId, Node>::nodeAtIndex(std::size_t index) {
+  FruitAssert(index < first_unused_index);
+  return node_iterator{pages.data(), index};
 }
 
 template <typename NodeId, typename Node>
-inline typename SemistaticGraph<NodeId, Node>::NodeData* SemistaticGraph<NodeId, Node>::nodeAtId(InternalNodeId internalNodeId) {
-  return nodeAtId(nodes.data(), internalNodeId);
+inline void SemistaticGraph<NodeId, Node>::copySharedPage(node_iterator itr) {
+  FruitAssert(itr.pages == pages.data() && itr.index < first_unused_index);
+  mutableNodeDataAt(itr.pages, itr.index);
 }
 
 template <typename NodeId, typename Node>
-inline const typename SemistaticGraph<NodeId, Node>::NodeData* SemistaticGraph<NodeId, Node>::nodeAtId(InternalNodeId internalNodeId) const {
-  return nodeAtId(nodes.data(), internalNodeId);
+inline std::size_t SemistaticGraph<NodeId, Node>::numPages(std::size_t num_nodes) {
+  return (num_nodes + node_page_size - 1) >> node_page_bits;
 }
 
 template <typename NodeId, typename Node>
-inline typename SemistaticGraph<NodeId, Node>::NodeData* SemistaticGraph<NodeId, Node>::nodeAtId(NodeData* nodes_begin, InternalNodeId internalNodeId) {
-  FruitAssert(internalNodeId.id % sizeof(NodeData) == 0);
-  NodeData* p = reinterpret_cast<NodeData*>(reinterpret_cast<char*>(nodes_begin) + internalNodeId.id);
-  // The code above is faster (the compiler doesn't have to worry about internalNodeId.id%sizeof(NodeData), that we know to be 0).
-  FruitAssert(p == nodes_begin + internalNodeId.id/sizeof(NodeData));
-  return p;
+inline const typename SemistaticGraph<NodeId, Node>::NodeData* SemistaticGraph<NodeId, Node>::nodeDataAt(
+    const NodePage* pages, std::size_t index) {
+  return pages[index >> node_page_bits].nodes + (index & (node_page_size - 1));
 }
 
 template <typename NodeId, typename Node>
-inline const typename SemistaticGraph<NodeId, Node>::NodeData* SemistaticGraph<NodeId, Node>::nodeAtId(const NodeData* nodes_begin, InternalNodeId internalNodeId) {
-  FruitAssert(internalNodeId.id % sizeof(NodeData) == 0);
-  const NodeData* p = reinterpret_cast<const NodeData*>(reinterpret_cast<const char*>(nodes_begin) + internalNodeId.id);
-  // The code above is faster (the compiler doesn't have to worry about internalNodeId.id%sizeof(NodeData), that we know to be 0).
-  FruitAssert(p == nodes_begin + internalNodeId.id/sizeof(NodeData));
-  return p;
+inline typename SemistaticGraph<NodeId, Node>::NodeData* SemistaticGraph<NodeId, Node>::mutableNodeDataAt(
+    NodePage* pages, std::size_t index) {
+  NodePage& page = pages[index >> node_page_bits];
+  if (page.nodes != page.private_nodes) {
+    copyPage(page);
+  }
+  return page.nodes + (index & (node_page_size - 1));
 }
 
 } // namespace impl
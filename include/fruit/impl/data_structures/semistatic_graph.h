@@ -28,7 +28,7 @@ namespace impl {
 
 // The alignas ensures that a SemistaticGraphInternalNodeId* always has 0 in the low-order bit.
 struct alignas(2) alignas(alignof(std::size_t)) SemistaticGraphInternalNodeId {
-  // This stores the index in the vector times sizeof(NodeData).
+  // The index of the node.
   std::size_t id;
   
   bool operator==(const SemistaticGraphInternalNodeId& x) const;
@@ -48,6 +48,10 @@ struct alignas(2) alignas(alignof(std::size_t)) SemistaticGraphInternalNodeId {
  * Even though adding nodes/edges after construction is inefficient, it is efficient to turn non-terminal nodes into terminal ones
  * (and therefore removing all the outgoing edges from the node) after construction.
  * 
+ * Copies of a graph share its nodes, in pages of a fixed number of nodes; a page is copied only when one of its nodes is
+ * modified for the first time in the copy. So the cost of copying a graph doesn't depend on the number of nodes, but only
+ * on the number of nodes added and modified in the copy.
+ * 
  * NodeId and Node must be default constructible and trivially copyable.
  */
 template <typename NodeId, typename Node>
@@ -55,16 +59,15 @@ class SemistaticGraph {
 private:
   using InternalNodeId = SemistaticGraphInternalNodeId;
   
-  // The node data for nodeId is in nodes[node_index_map.at(nodeId)/sizeof(NodeData)].
-  // To avoid hash table lookups, the edges in edges_storage are stored as indexes of `nodes' instead of as NodeIds.
+  // The node data for nodeId is the one with index node_index_map.at(nodeId) (see nodeDataAt()).
+  // To avoid hash table lookups, the edges in edges_storage are stored as node indexes instead of as NodeIds.
+  // Nodes are stored in DFS order (see the 2-argument constructor), so a node is usually close to its neighbors.
   // node_index_map contains all known NodeIds, including ones known only due to an outgoing edge ending there from another node.
   SemistaticMap<NodeId, InternalNodeId> node_index_map;
   
+  // This only contains the data needed when getting an object (the edges are stored separately, in edges_storage), so that
+  // nodes are small and several neighboring nodes fit in a cache line.
   struct NodeData {
-#ifdef FRUIT_EXTRA_DEBUG
-    NodeId key;
-#endif
-    
   public:
     // If edges_begin==0, this is a terminal node.
     // If edges_begin==1, this node doesn't exist, it's just referenced by another node.
@@ -77,25 +80,60 @@ private:
     Node node;
   };
   
+  // The nodes are stored in pages of node_page_size nodes. The node with index i is the (i % node_page_size)-th node of the
+  // page i / node_page_size.
+  static constexpr std::size_t node_page_bits = 6;
+  static constexpr std::size_t node_page_size = std::size_t(1) << node_page_bits;
+  
+  struct NodePage {
+    // The nodes in this page. This is either private_nodes or (if the page is shared with another graph) a page of the
+    // other graph.
+    NodeData* nodes;
+    
+    // The space reserved for this page in this graph, where the page is copied before modifying it.
+    NodeData* private_nodes;
+  };
+  
+  // The number of nodes (also counting the ones that are only referenced by other nodes).
   std::size_t first_unused_index;
   
+  // The storage for the pages of this graph that are not shared with another graph. Its capacity is pages.size() *
+  // node_page_size; the nodes after first_unused_index in the last page are unused (they're set as non-existing nodes).
+  // In graphs constructed as a copy of another graph, only the pages that were copied are initialized (and nodes.size()
+  // is 0, the space is only accessed through `pages').
   FixedSizeVector<NodeData> nodes;
   
-  // Stores vectors of edges as contiguous chunks of node IDs.
-  // The NodeData elements in `nodes' contain indexes into this vector (stored as already multiplied by sizeof(NodeData)).
+  FixedSizeVector<NodePage> pages;
+  
+  // Stores vectors of edges as contiguous chunks of node IDs. Each chunk is followed by an element with
+  // id==end_of_edges_marker.
+  // The NodeData elements of the nodes contain pointers into this vector.
   // The first element is unused.
   FixedSizeVector<InternalNodeId> edges_storage;
   
+  // This is never a valid node ID, since there can't be this many nodes.
+  static constexpr std::size_t end_of_edges_marker = ~std::size_t(0);
+  
 #ifdef FRUIT_EXTRA_DEBUG
   template <typename NodeIter>
   void printGraph(NodeIter first, NodeIter last);
 #endif
   
-  NodeData* nodeAtId(InternalNodeId internalNodeId);
-  const NodeData* nodeAtId(InternalNodeId internalNodeId) const;
+  static std::size_t numPages(std::size_t num_nodes);
+  
+  // Returns the node with index `index'. The result must not be modified, since the page might be shared with another graph.
+  static const NodeData* nodeDataAt(const NodePage* pages, std::size_t index);
   
-  static NodeData* nodeAtId(NodeData* nodes_begin, InternalNodeId internalNodeId);  
-  static const NodeData* nodeAtId(const NodeData* nodes_begin, InternalNodeId internalNodeId);
+  // Similar to nodeDataAt(), but if the page is shared with another graph this copies it first, so that the node can be
+  // modified.
+  static NodeData* mutableNodeDataAt(NodePage* pages, std::size_t index);
+  
+  // Copies `page' to page.private_nodes.
+  static void copyPage(NodePage& page);
+  
+  // Allocates `nodes' and `pages' for a graph with first_unused_index nodes. The first num_shared_pages pages are shared
+  // with the ones in shared_pages, the nodes of the other pages must then be set by the caller.
+  void initPages(const NodePage* shared_pages, std::size_t num_shared_pages, MemoryResource& memory_resource);
     
 public:
   
@@ -103,22 +141,34 @@ public:
   
   class node_iterator {
   private:
-    NodeData* itr;
+    NodePage* pages;
+    std::size_t index;
     
     friend class SemistaticGraph<NodeId, Node>;
     
-    node_iterator(NodeData* itr);
+    node_iterator(NodePage* pages, std::size_t index);
     
   public:
+    // If the node is in a page shared with another graph, this copies the page, so that the result can be modified.
     Node& getNode();
     
+    // Prefer this to getNode() if the node won't be modified: this never copies the page.
+    const Node& getConstNode();
+    
     bool isTerminal();
     
+    // Returns &getConstNode() if the node is terminal, and nullptr otherwise. This looks up the page of the node only once,
+    // unlike calling isTerminal() and then getConstNode().
+    const Node* getConstNodeIfTerminal();
+    
     // Turns the node into a terminal node, also removing all the deps.
+    // The page of the node must have already been copied (e.g. by calling getNode()). This way the node can be turned into a
+    // terminal node while constructing its object, without checking that again.
     void setTerminal();
   
     // Assumes !isTerminal().
     // neighborsEnd() is NOT provided/stored for efficiency, the client code is expected to know the number of neighbors.
+    // If that's not the case, edge_iterator::isEnd() can be used instead (but that's slower).
     edge_iterator neighborsBegin();
     
     bool operator==(const node_iterator&) const;
@@ -126,11 +176,12 @@ public:
   
   class const_node_iterator {
   private:
-    const NodeData* itr;
+    const NodePage* pages;
+    std::size_t index;
     
     friend class SemistaticGraph<NodeId, Node>;
     
-    const_node_iterator(const NodeData* itr);
+    const_node_iterator(const NodePage* pages, std::size_t index);
     
   public:
     const Node& getNode();
@@ -151,13 +202,17 @@ public:
     edge_iterator(InternalNodeId* itr);
 
   public:
-    // getNodeIterator(graph.nodes.begin()) returns the first neighbor.
+    // getNodeIterator(graph.begin()) returns the first neighbor.
     node_iterator getNodeIterator(node_iterator nodes_begin);
     
     void operator++();
     
     // Equivalent to i times operator++ followed by getNodeIterator(nodes_begin).
     node_iterator getNodeIterator(std::size_t i, node_iterator nodes_begin);
+    
+    // Returns true if this iterator was obtained from neighborsBegin() and then incremented once per neighbor, i.e. if
+    // there are no more neighbors to visit.
+    bool isEnd() const;
   };
   
   // Constructs an *invalid* graph (as if this graph was just moved from).
@@ -171,19 +226,25 @@ public:
   // 
   // This constructor is *not* defined in semistatic_graph.templates.h, but only in semistatic_graph.cc.
   // All instantiations must have a matching instantiation in semistatic_graph.cc.
+  // 
+  // The memory retained by the graph is allocated from `memory_resource'; temporary buffers used during the construction
+  // are not.
   template <typename NodeIter>
-  SemistaticGraph(NodeIter first, NodeIter last);
+  SemistaticGraph(NodeIter first, NodeIter last, MemoryResource& memory_resource = getDefaultMemoryResource());
   
   SemistaticGraph(SemistaticGraph&&) = default;
   SemistaticGraph(const SemistaticGraph&) = delete;
   
   // Creates a copy of x with the additional nodes in [first, last). The requirements on NodeIter as the same as for the 2-arg
   // constructor.
+  // The nodes of x are not copied, only the pages that contain nodes modified later (or nodes in [first, last)) are.
   // The nodes in [first, last) must NOT be already in x, but can be neighbors of nodes in x.
   // The new graph will share data with `x', so must be destroyed before `x' is destroyed.
   // Also, after this is called, `x' must not be modified until this object has been destroyed.
+  // The data that isn't shared with `x' is allocated from `memory_resource'.
   template <typename NodeIter>
-  SemistaticGraph(const SemistaticGraph& x, NodeIter first, NodeIter last);
+  SemistaticGraph(const SemistaticGraph& x, NodeIter first, NodeIter last,
+                  MemoryResource& memory_resource = getDefaultMemoryResource());
   
   ~SemistaticGraph();
   
@@ -205,6 +266,54 @@ public:
   node_iterator find(NodeId nodeId);
   const_node_iterator find(NodeId nodeId) const;
   
+  // The number of node slots in this graph. This also counts the nodes that are only referenced by edges of other nodes.
+  std::size_t numNodes() const;
+  
+  // Returns an index in [0, numNodes()) that is different for each node of the graph. This can be used by client code to
+  // store additional per-node data in a separate array.
+  // Precondition: `itr' must be a valid iterator of this graph (and != end()).
+  std::size_t nodeIndex(node_iterator itr) const;
+  
+  // The inverse of nodeIndex().
+  // Precondition: index < numNodes().
+  node_iterator nodeAtIndex(std::size_t index);
+  
+  // Restores all nodes of this graph (including whether they're terminal) to the ones in x, without allocating memory.
+  // The pages that have been copied in this graph are overwritten (they're not shared with `x' again).
+  // Precondition: this graph must have been constructed as a copy of `x' with no additional nodes.
+  void resetNodes(const SemistaticGraph& x);
+  
+  // Copies the page of `itr' if it's shared with another graph, so that the nodes in that page can then be modified without
+  // copying pages (e.g. when different nodes are modified concurrently by different threads, as long as each node is
+  // modified by a single thread). This doesn't allocate memory.
+  void copySharedPage(node_iterator itr);
+  
+  // Calls copySharedPage() for all non-terminal nodes. The pages that only contain terminal nodes stay shared, so the nodes
+  // that will be modified later must all be non-terminal at this point (e.g. because only nodes that are not constructed
+  // yet will be modified).
+  void copySharedPagesOfNonTerminalNodes();
+  
+  // Deallocates the edges stored in this graph. The nodes are still valid after this, but the neighbors of non-terminal
+  // nodes must no longer be accessed (e.g. with neighborsBegin()).
+  void releaseEdges();
+  
+  // If at() and find() might have to compare more than `max_bucket_size' node IDs (as can happen after copying a graph with
+  // additional nodes, especially if the copy is copied again), re-builds the index of the node IDs with a perfect hash
+  // function. After this, the graph no longer shares the index with the graph it was copied from (it still shares the edges).
+  void rehashIfNeeded(std::size_t max_bucket_size, MemoryResource& memory_resource = getDefaultMemoryResource());
+  
+  // Writes this graph to `writer', in a format that can be read back with readImage(). Writer must have the methods required
+  // by SemistaticMap::writeImage(), and also a write() method for Node.
+  // This graph must have been constructed with the 2-argument constructor (not as a copy of another graph).
+  template <typename Writer>
+  void writeImage(Writer& writer) const;
+  
+  // Replaces the contents of this graph with the ones written by writeImage(). If the data is invalid (including node IDs
+  // out of range, and edges ranges that don't end before the end of the edges), this calls reader.fail() and the graph must
+  // not be used. See SemistaticMap::readImage().
+  template <typename Reader>
+  void readImage(Reader& reader, MemoryResource& memory_resource);
+  
 #ifdef FRUIT_EXTRA_DEBUG
   // Emits a runtime error if some node was not created but there is an edge pointing to it.
   void checkFullyConstructed();
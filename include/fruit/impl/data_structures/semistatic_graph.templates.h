@@ -23,8 +23,11 @@
 
 #include <fruit/impl/data_structures/semistatic_graph.h>
 #include <fruit/impl/data_structures/semistatic_map.templates.h>
-#include <fruit/impl/util/hash_helpers.h>
 #include <fruit/impl/data_structures/fixed_size_vector.templates.h>
+#include <fruit/impl/data_structures/fixed_size_hash_map.templates.h>
+
+#include <algorithm>
+#include <cstring>
 
 #ifdef FRUIT_EXTRA_DEBUG
 #include <iostream>
@@ -33,21 +36,6 @@
 namespace fruit {
 namespace impl {
 
-template <typename Iter, std::size_t index_increment>
-struct indexing_iterator {
-  Iter iter;
-  std::size_t index;
-  
-  void operator++() {
-    ++iter;
-    index += index_increment;
-  }
-  
-  auto operator*() -> decltype(std::make_pair(*iter, SemistaticGraphInternalNodeId{index})) {
-    return std::make_pair(*iter, SemistaticGraphInternalNodeId{index});
-  }
-};
-
 #ifdef FRUIT_EXTRA_DEBUG
 template <typename NodeId, typename Node>
 template <typename NodeIter>
@@ -73,56 +61,125 @@ void SemistaticGraph<NodeId, Node>::printGraph(NodeIter first, NodeIter last) {
 }
 #endif // FRUIT_EXTRA_DEBUG
 
+template <typename NodeId, typename Node>
+void SemistaticGraph<NodeId, Node>::copyPage(NodePage& page) {
+  std::memcpy(page.private_nodes, page.nodes, sizeof(NodeData) * node_page_size);
+  page.nodes = page.private_nodes;
+}
+
+template <typename NodeId, typename Node>
+void SemistaticGraph<NodeId, Node>::initPages(const NodePage* shared_pages, std::size_t num_shared_pages,
+                                              MemoryResource& memory_resource) {
+  std::size_t num_pages = numPages(first_unused_index);
+  FruitAssert(num_shared_pages <= num_pages);
+  nodes = FixedSizeVector<NodeData>(num_pages * node_page_size, memory_resource);
+  pages = FixedSizeVector<NodePage>(num_pages, memory_resource);
+  for (std::size_t p = 0; p < num_pages; ++p) {
+    NodeData* private_nodes = nodes.data() + p * node_page_size;
+    pages.push_back(NodePage{p < num_shared_pages ? shared_pages[p].nodes : private_nodes, private_nodes});
+  }
+}
+
 template <typename NodeId, typename Node>
 template <typename NodeIter>
-SemistaticGraph<NodeId, Node>::SemistaticGraph(NodeIter first, NodeIter last) {
+SemistaticGraph<NodeId, Node>::SemistaticGraph(NodeIter first, NodeIter last, MemoryResource& memory_resource) {
   std::size_t num_edges = 0;
   
-  // Step 1: assign IDs to all nodes, fill node_index_map and set first_unused_index.
-  HashSet<NodeId> node_ids = createHashSet<NodeId>(last - first);
   for (NodeIter i = first; i != last; ++i) {
-    node_ids.insert(i->getId());
+    if (!i->isTerminal()) {
+      // The edges, plus the end-of-edges marker.
+      num_edges += (i->getEdgesEnd() - i->getEdgesBegin()) + 1;
+    }
+  }
+  
+  // Step 1: collect all node IDs. Each one is mapped to the element of [first, last) for that node (or to `last' if the node
+  // is only referenced by edges of other nodes) and to whether the node has been visited in step 2.
+  // There are at most (last - first) + num_edges distinct IDs, so the map never needs to be resized.
+  FixedSizeHashMap<NodeId, std::pair<NodeIter, bool>> node_ids((last - first) + num_edges);
+  for (NodeIter i = first; i != last; ++i) {
+    auto p = node_ids.insert(i->getId(), std::make_pair(i, false));
+    if (!p.second) {
+      // The node was already referenced by an edge.
+      p.first->second.first = i;
+    }
     if (!i->isTerminal()) {
       for (auto j = i->getEdgesBegin(); j != i->getEdgesEnd(); ++j) {
-        node_ids.insert(*j);
-        ++num_edges;
+        node_ids.insert(*j, std::make_pair(last, false));
       }
     }
   }
   
-  using itr_t = typename HashSet<NodeId>::iterator;
-  node_index_map = SemistaticMap<NodeId, InternalNodeId>(indexing_iterator<itr_t, sizeof(NodeData)>{node_ids.begin(), 0},
-                                                         node_ids.size());
+  // Step 2: assign IDs to all nodes, in DFS pre-order (starting from the nodes in the order they appear in [first, last)).
+  // This way a node is usually stored right before its neighbors (and the neighbors' neighbors), so getting an object that
+  // still has to be constructed touches few cache lines, instead of a cache line per dependency as it would happen if nodes
+  // were stored in hash order.
+  std::vector<std::pair<NodeId, InternalNodeId>> assigned_ids;
+  assigned_ids.reserve(node_ids.size());
+  std::vector<NodeIter> nodes_by_index;
+  nodes_by_index.reserve(node_ids.size());
+  std::vector<NodeId> stack;
+  for (NodeIter i = first; i != last; ++i) {
+    stack.push_back(i->getId());
+    while (!stack.empty()) {
+      NodeId node_id = stack.back();
+      stack.pop_back();
+      auto node_itr = node_ids.find(node_id);
+      FruitAssert(node_itr != node_ids.end());
+      std::pair<NodeIter, bool>& node = node_itr->second;
+      if (node.second) {
+        continue;
+      }
+      node.second = true;
+      assigned_ids.push_back(std::make_pair(node_id, InternalNodeId{nodes_by_index.size()}));
+      nodes_by_index.push_back(node.first);
+      if (node.first != last && !node.first->isTerminal()) {
+        // The neighbors are pushed in reverse order, so that they're visited (and stored) in the order of the edges.
+        auto edges_begin = node.first->getEdgesBegin();
+        for (auto j = node.first->getEdgesEnd(); j != edges_begin; ) {
+          --j;
+          stack.push_back(*j);
+        }
+      }
+    }
+  }
+  FruitAssert(nodes_by_index.size() == node_ids.size());
   
-  first_unused_index = node_ids.size();
+  // We use perfect hashing here so that the construction time doesn't vary from run to run, and lookups only need to compare
+  // 1 key.
+  node_index_map = SemistaticMap<NodeId, InternalNodeId>(assigned_ids.begin(),
+                                                         assigned_ids.size(),
+                                                         typename SemistaticMap<NodeId, InternalNodeId>::PerfectHashing(),
+                                                         memory_resource);
   
-  // Step 2: fill `nodes' and edges_storage.
+  first_unused_index = nodes_by_index.size();
   
-  // Note that not all of these will be assigned in the loop below.
-  nodes = FixedSizeVector<NodeData>(first_unused_index, NodeData{
-#ifdef FRUIT_EXTRA_DEBUG
-    NodeId(),
-#endif
-    1,
-    Node()});
+  // Step 3: fill `nodes' and edges_storage. The edges are also stored in node order, so that the edges of neighboring
+  // nodes are close to each other.
+  initPages(nullptr, 0, memory_resource);
   
   // edges_storage[0] is unused, that's the reason for the +1
-  edges_storage = FixedSizeVector<InternalNodeId>(num_edges + 1);
+  edges_storage = FixedSizeVector<InternalNodeId>(num_edges + 1, memory_resource);
   edges_storage.push_back(InternalNodeId());
   
-  for (NodeIter i = first; i != last; ++i) {
-    NodeData& nodeData = *nodeAtId(node_index_map.at(i->getId()));
-    nodeData.node = i->getValue();
-    if (i->isTerminal()) {
-      nodeData.edges_begin = 0;
+  for (NodeIter i : nodes_by_index) {
+    if (i == last) {
+      // This node doesn't exist, it's just referenced by another node.
+      nodes.push_back(NodeData{1, Node()});
+    } else if (i->isTerminal()) {
+      nodes.push_back(NodeData{0, i->getValue()});
     } else {
-      nodeData.edges_begin = reinterpret_cast<std::uintptr_t>(edges_storage.data() + edges_storage.size());
+      nodes.push_back(NodeData{reinterpret_cast<std::uintptr_t>(edges_storage.data() + edges_storage.size()),
+                               i->getValue()});
       for (auto j = i->getEdgesBegin(); j != i->getEdgesEnd(); ++j) {
-        InternalNodeId other_node_id = node_index_map.at(*j);
-        edges_storage.push_back(other_node_id);
+        edges_storage.push_back(node_index_map.at(*j));
       }
+      edges_storage.push_back(InternalNodeId{end_of_edges_marker});
     }
   }
+  // The unused nodes at the end of the last page.
+  while (nodes.size() != pages.size() * node_page_size) {
+    nodes.push_back(NodeData{1, Node()});
+  }
   
 #ifdef FRUIT_EXTRA_DEBUG
   printGraph(first, last);
@@ -131,7 +188,8 @@ SemistaticGraph<NodeId, Node>::SemistaticGraph(NodeIter first, NodeIter last) {
 
 template <typename NodeId, typename Node>
 template <typename NodeIter>
-SemistaticGraph<NodeId, Node>::SemistaticGraph(const SemistaticGraph& x, NodeIter first, NodeIter last)
+SemistaticGraph<NodeId, Node>::SemistaticGraph(const SemistaticGraph& x, NodeIter first, NodeIter last,
+                                               MemoryResource& memory_resource)
   : first_unused_index(x.first_unused_index) {
   
   // TODO: The code below is very similar to the other constructor, extract the common parts in separate functions.
@@ -153,6 +211,8 @@ SemistaticGraph<NodeId, Node>::SemistaticGraph(const SemistaticGraph& x, NodeIte
         }
         ++num_new_edges;
       }
+      // For the end-of-edges marker.
+      ++num_new_edges;
     }
   }
   
@@ -162,31 +222,35 @@ SemistaticGraph<NodeId, Node>::SemistaticGraph(const SemistaticGraph& x, NodeIte
   
   // Step 1c: assign new IDs.
   for (auto& p : node_ids) {
-    p.second = InternalNodeId{first_unused_index*sizeof(NodeData)};
+    p.second = InternalNodeId{first_unused_index};
     ++first_unused_index;
   }
   
   // Step 1d: actually populate node_index_map.
-  node_index_map = SemistaticMap<NodeId, InternalNodeId>(x.node_index_map, std::move(node_ids));
+  node_index_map = SemistaticMap<NodeId, InternalNodeId>(x.node_index_map, std::move(node_ids), memory_resource);
   
-  // Step 2: fill `nodes' and `edges_storage'
-  nodes = FixedSizeVector<NodeData>(x.nodes, first_unused_index);
-  // Note that the loop below does not necessarily assign all of these.
-  for (std::size_t i = x.nodes.size(); i < first_unused_index; ++i) {
-    nodes.push_back(NodeData{
-#ifdef FRUIT_EXTRA_DEBUG
-        NodeId(),
-#endif
-        1,
-        Node()});
+  // Step 2: share the pages of `x' and fill `edges_storage'. The last page of `x' is only shared if it's full, or if no
+  // nodes are added. The new nodes are in new pages, where they start as non-existing nodes (the loop below does not
+  // necessarily assign all of them), as are the unused nodes at the end of the last page of `x'.
+  std::size_t num_shared_pages = (first_unused_index == x.first_unused_index)
+      ? x.pages.size()
+      : (x.first_unused_index >> node_page_bits);
+  initPages(x.pages.data(), num_shared_pages, memory_resource);
+  for (std::size_t p = num_shared_pages; p < pages.size(); ++p) {
+    NodeData* page_nodes = pages[p].private_nodes;
+    if (p < x.pages.size()) {
+      std::memcpy(page_nodes, x.pages[p].nodes, sizeof(NodeData) * node_page_size);
+    } else {
+      std::fill(page_nodes, page_nodes + node_page_size, NodeData{1, Node()});
+    }
   }
   
   // edges_storage[0] is unused, that's the reason for the +1
-  edges_storage = FixedSizeVector<InternalNodeId>(num_new_edges + 1);
+  edges_storage = FixedSizeVector<InternalNodeId>(num_new_edges + 1, memory_resource);
   edges_storage.push_back(InternalNodeId());
   
   for (NodeIter i = first; i != last; ++i) {
-    NodeData& nodeData = *nodeAtId(node_index_map.at(i->getId()));
+    NodeData& nodeData = *mutableNodeDataAt(pages.data(), node_index_map.at(i->getId()).id);
     nodeData.node = i->getValue();
     if (i->isTerminal()) {
       nodeData.edges_begin = 0;
@@ -196,6 +260,7 @@ SemistaticGraph<NodeId, Node>::SemistaticGraph(const SemistaticGraph& x, NodeIte
         InternalNodeId otherNodeId = node_index_map.at(*j);
         edges_storage.push_back(otherNodeId);
       }
+      edges_storage.push_back(InternalNodeId{end_of_edges_marker});
     }
   }  
   
@@ -204,11 +269,133 @@ SemistaticGraph<NodeId, Node>::SemistaticGraph(const SemistaticGraph& x, NodeIte
 #endif  
 }
 
+template <typename NodeId, typename Node>
+void SemistaticGraph<NodeId, Node>::resetNodes(const SemistaticGraph& x) {
+  FruitAssert(pages.size() == x.pages.size());
+  for (std::size_t p = 0; p < pages.size(); ++p) {
+    NodePage& page = pages[p];
+    if (page.nodes == page.private_nodes) {
+      std::memcpy(page.private_nodes, x.pages[p].nodes, sizeof(NodeData) * node_page_size);
+    } else {
+      FruitAssert(page.nodes == x.pages[p].nodes);
+    }
+  }
+}
+
+template <typename NodeId, typename Node>
+void SemistaticGraph<NodeId, Node>::copySharedPagesOfNonTerminalNodes() {
+  for (NodePage& page : pages) {
+    if (page.nodes == page.private_nodes) {
+      continue;
+    }
+    for (std::size_t i = 0; i < node_page_size; ++i) {
+      // Non-existing nodes have edges_begin==1 and terminal nodes have edges_begin==0.
+      if (page.nodes[i].edges_begin > 1) {
+        copyPage(page);
+        break;
+      }
+    }
+  }
+}
+
+template <typename NodeId, typename Node>
+void SemistaticGraph<NodeId, Node>::releaseEdges() {
+  edges_storage = FixedSizeVector<InternalNodeId>();
+}
+
+template <typename NodeId, typename Node>
+void SemistaticGraph<NodeId, Node>::rehashIfNeeded(std::size_t max_bucket_size, MemoryResource& memory_resource) {
+  if (node_index_map.maxBucketSize() > max_bucket_size) {
+    node_index_map = SemistaticMap<NodeId, InternalNodeId>(
+        node_index_map, typename SemistaticMap<NodeId, InternalNodeId>::PerfectHashing(), memory_resource);
+  }
+}
+
+template <typename NodeId, typename Node>
+template <typename Writer>
+void SemistaticGraph<NodeId, Node>::writeImage(Writer& writer) const {
+  // The number of nodes is written first, so that readImage() can check the node IDs in node_index_map.
+  writer.writeWord(first_unused_index);
+  node_index_map.writeImage(writer);
+  writer.writeWord(edges_storage.size());
+  for (InternalNodeId edge : edges_storage) {
+    writer.writeWord(edge.id);
+  }
+  writer.writeWord(first_unused_index);
+  for (std::size_t i = 0; i < first_unused_index; ++i) {
+    const NodeData& node_data = *nodeDataAt(pages.data(), i);
+    // The edge pointers are written as 1 + their index in edges_storage, so that they don't collide with the special
+    // values 0 and 1 (the index is never 0, since edges_storage[0] is unused).
+    if (node_data.edges_begin <= 1) {
+      writer.writeWord(node_data.edges_begin);
+    } else {
+      writer.writeWord(
+          std::uint64_t(1 + (reinterpret_cast<const InternalNodeId*>(node_data.edges_begin) - edges_storage.data())));
+    }
+    writer.write(node_data.node);
+  }
+}
+
+template <typename NodeId, typename Node>
+template <typename Reader>
+void SemistaticGraph<NodeId, Node>::readImage(Reader& reader, MemoryResource& memory_resource) {
+  std::size_t num_nodes_in_image = std::size_t(reader.readWord());
+  first_unused_index = num_nodes_in_image;
+  node_index_map.readImage(reader, memory_resource, [num_nodes_in_image](InternalNodeId node_id) {
+    return node_id.id < num_nodes_in_image;
+  });
+  if (reader.hasFailed()) {
+    return;
+  }
+  
+  std::size_t num_edges = reader.readSize(1);
+  edges_storage = FixedSizeVector<InternalNodeId>(num_edges, memory_resource);
+  for (std::size_t i = 0; i < num_edges; ++i) {
+    InternalNodeId edge{std::size_t(reader.readWord())};
+    if (i != 0
+        && edge.id != end_of_edges_marker
+        && edge.id >= first_unused_index) {
+      reader.fail();
+      return;
+    }
+    edges_storage.push_back(edge);
+  }
+  // Each node's edges range ends with end_of_edges_marker, so if the last edge is one the edges of any node end before the
+  // end of edges_storage.
+  if (num_edges > 1 && edges_storage[num_edges - 1].id != end_of_edges_marker) {
+    reader.fail();
+    return;
+  }
+  
+  std::size_t num_nodes = reader.readSize(2);
+  if (num_nodes != first_unused_index) {
+    reader.fail();
+    return;
+  }
+  initPages(nullptr, 0, memory_resource);
+  for (std::size_t i = 0; i < num_nodes; ++i) {
+    NodeData node_data{std::uintptr_t(reader.readWord()), Node()};
+    if (node_data.edges_begin > 1) {
+      std::size_t edges_index = node_data.edges_begin - 1;
+      if (edges_index >= num_edges) {
+        reader.fail();
+        return;
+      }
+      node_data.edges_begin = reinterpret_cast<std::uintptr_t>(edges_storage.data() + edges_index);
+    }
+    reader.read(node_data.node);
+    nodes.push_back(node_data);
+  }
+  while (nodes.size() != pages.size() * node_page_size) {
+    nodes.push_back(NodeData{1, Node()});
+  }
+}
+
 #ifdef FRUIT_EXTRA_DEBUG
 template <typename NodeId, typename Node>
 void SemistaticGraph<NodeId, Node>::checkFullyConstructed() {
-  for (NodeData& data : nodes) {
-    if (data.edges_begin == 1) {
+  for (std::size_t i = 0; i < first_unused_index; ++i) {
+    if (nodeDataAt(pages.data(), i)->edges_begin == 1) {
       std::cerr << "Fruit bug: the dependency graph was not fully constructed." << std::endl;
       abort();
     }
@@ -34,7 +34,24 @@ inline typename SemistaticMap<Key, Value>::Unsigned SemistaticMap<Key, Value>::H
   
 template <typename Key, typename Value>
 inline typename SemistaticMap<Key, Value>::Unsigned SemistaticMap<Key, Value>::hash(const Key& key) const {
-  return hash_function.hash(std::hash<typename std::remove_cv<Key>::type>()(key));
+  Unsigned x = std::hash<typename std::remove_cv<Key>::type>()(key);
+  if (displacements == nullptr) {
+    return hash_function.hash(x);
+  }
+  return hash_function.hash(x) ^ displacements[displacement_hash_function.hash(x)];
+}
+
+template <typename Key, typename Value>
+inline const typename SemistaticMap<Key, Value>::Bucket& SemistaticMap<Key, Value>::getBucket(Unsigned h) const {
+  if (overlay_size != 0) {
+    Unsigned mask = overlay.size() - 1;
+    for (Unsigned i = h & mask; overlay[i].h != empty_overlay_hash; i = (i + 1) & mask) {
+      if (overlay[i].h == h) {
+        return overlay[i].bucket;
+      }
+    }
+  }
+  return base_lookup_table[h];
 }
 
 } // namespace impl
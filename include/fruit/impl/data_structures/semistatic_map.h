@@ -17,16 +17,28 @@
 #ifndef SEMISTATIC_MAP_H
 #define SEMISTATIC_MAP_H
 
+#include <fruit/impl/fruit-config.h>
 #include <fruit/impl/data_structures/fixed_size_vector.h>
 
 #include <vector>
 #include <limits>
 #include <climits>
 #include <cstdint>
+#include <type_traits>
 
 namespace fruit {
 namespace impl {
 
+struct TypeId;
+
+// Whether two keys of this type are equal iff their bits are equal, and they're 64-bit words. Keys like this can be compared
+// with SIMD instructions, several at once.
+template <typename Key>
+struct IsSemistaticMapWordKey : std::integral_constant<bool,
+    sizeof(Key) == sizeof(std::uint64_t)
+    && (std::is_integral<Key>::value || std::is_pointer<Key>::value || std::is_same<Key, TypeId>::value)> {
+};
+
 /**
  * Provides a subset of the interface of std::map, and also has these additional assumptions:
  * - Key must be default constructible and trivially copyable
@@ -34,6 +46,15 @@ namespace impl {
  * 
  * Also, while insertion of elements after construction is supported, inserting more than O(1) elements
  * after construction will raise the cost of any further lookups to more than O(1).
+ * 
+ * There are two ways to construct a map:
+ * - With a random hash function, re-drawn until no bucket has `beta' or more keys. The seed is taken from the clock, so the
+ *   resulting layout (and the construction time) differs from run to run.
+ * - With a perfect hash function (at most 1 key per bucket), built with a fixed seed using a displacement table (similar to the
+ *   CHD algorithm). This is deterministic and guarantees that each lookup only needs a single key comparison.
+ * 
+ * The keys are stored in an array separate from the values, so that (for word-sized keys) find() can compare all the keys
+ * in a bucket with the one being looked up using SIMD instructions, when the target platform has them.
  */
 template <typename Key, typename Value>
 class SemistaticMap {
@@ -42,7 +63,16 @@ private:
   using NumBits = unsigned char;
   using value_type = std::pair<Key, Value>;
   
-  static constexpr unsigned char beta = 4;
+  // Whether find() compares the keys in a bucket with SIMD instructions (FRUIT_SIMD_WORDS_PER_VECTOR at a time).
+  static constexpr bool use_simd = FRUIT_SIMD_WORDS_PER_VECTOR > 1 && IsSemistaticMapWordKey<Key>::value;
+  
+  // When using a random hash function, buckets must have less than `beta' keys. When find() can compare the keys with SIMD
+  // instructions we allow up to 8 keys (a cache line), so that construction needs to re-draw the hash function less often.
+  static constexpr unsigned char beta = use_simd ? 9 : 4;
+  
+  // A SIMD comparison may read past the last key in a bucket, up to the end of the last vector. So the arrays of keys
+  // have this many (unused) keys at the end.
+  static constexpr std::size_t num_padding_keys = use_simd ? FRUIT_SIMD_WORDS_PER_VECTOR - 1 : 0;
     
   static_assert(std::numeric_limits<NumBits>::max() >= sizeof(Unsigned)*CHAR_BIT,
                 "An unsigned char is not enough to contain the number of bits in your platform. Please report this issue.");
@@ -58,38 +88,123 @@ private:
   
   static NumBits pickNumBits(std::size_t n);
   
-  struct CandidateValuesRange {
-    value_type* begin;
-    value_type* end;
+  // The seed used when constructing a map with a perfect hash function. This is fixed so that the construction is
+  // deterministic.
+  static constexpr unsigned perfect_hash_seed = 1;
+  
+  // The keys in a bucket are [keys_begin, keys_end), and the value of keys_begin[i] is values_begin[i].
+  struct Bucket {
+    Key* keys_begin;
+    Key* keys_end;
+    Value* values_begin;
   };
 
   HashFunction hash_function;
-  // Given a key x, if p=lookup_table[hash_function.hash(x)] the candidate places for x are [p.first, p.second). These pointers
-  // point to the values[] vector, but it might be either the one of this object or the one of an object that was shallow-copied
-  // into this one.
-  FixedSizeVector<CandidateValuesRange> lookup_table;
-  FixedSizeVector<value_type> values;
+  
+  // The bucket of a key x is hash_function.hash(x) ^ displacements[displacement_hash_function.hash(x)].
+  // For maps that don't use perfect hashing there's no displacement table (displacements==nullptr) and the bucket is just
+  // hash_function.hash(x), so that hash() doesn't need the additional multiplication and load.
+  HashFunction displacement_hash_function;
+  
+  // This points to displacements_storage.data(), but it might be either the one of this object or the one of an object that
+  // was shallow-copied into this one. This is nullptr for maps that don't use perfect hashing.
+  const Unsigned* displacements = nullptr;
+  FixedSizeVector<Unsigned> displacements_storage;
+  
+  // A bucket of a shallow copy that differs from the one in base_lookup_table. h is the index of the bucket, or
+  // empty_overlay_hash for the unused entries of the overlay table.
+  struct OverlayEntry {
+    Unsigned h;
+    Bucket bucket;
+  };
+  
+  // Hashes are always less than the number of buckets, so this can't be the index of a bucket.
+  static constexpr Unsigned empty_overlay_hash = ~Unsigned(0);
+  
+  // Given a key x, the candidate places for x are in the bucket getBucket(hash(x)). The bucket points to the keys[] and
+  // values[] vectors, but they might be either the ones of this object or the ones of an object that was shallow-copied into
+  // this one.
+  // lookup_table is usually empty in shallow copies: those share the lookup table of the map they were (ultimately) copied
+  // from, that is pointed to by base_lookup_table, and only store the buckets they modified, in `overlay'.
+  FixedSizeVector<Bucket> lookup_table;
+  const Bucket* base_lookup_table = nullptr;
+  std::size_t num_buckets = 0;
+  
+  // An open-addressing hash table (with linear probing) indexed by bucket index. Its size is 0 (for maps that are not
+  // shallow copies) or a power of 2 that's at least twice the number of used entries, so that lookups only have to probe a
+  // few entries.
+  FixedSizeVector<OverlayEntry> overlay;
+  // The number of entries of `overlay' that are not empty.
+  std::size_t overlay_size = 0;
+  
+  // Shallow copies that would modify at least 1/max_overlay_fraction_inverse of the buckets copy the whole lookup table
+  // instead of using an overlay.
+  static constexpr std::size_t max_overlay_fraction_inverse = 8;
+  // keys[i] is the key of values[i]. keys also contains num_padding_keys keys at the end, that aren't in any bucket.
+  FixedSizeVector<Key> keys;
+  FixedSizeVector<Value> values;
+  
+  // The number of keys in the largest bucket of lookup_table.
+  std::size_t max_bucket_size = 0;
   
   Unsigned hash(const Key& key) const;
   
+  // Returns the bucket with index h.
+  const Bucket& getBucket(Unsigned h) const;
+  
+  // Returns the entry of the bucket with index h in `overlay', adding it (as a copy of base_lookup_table[h]) if needed.
+  // `overlay' must have space for another entry.
+  Bucket& getOverlayBucket(Unsigned h);
+  
+  // Returns the index of `key' in `bucket' or, if the bucket doesn't contain it, the number of keys in the bucket.
+  static std::size_t findInBucket(const Bucket& bucket, Key key);
+  static std::size_t findInBucket(const Bucket& bucket, Key key, std::true_type /* use_simd */);
+  static std::size_t findInBucket(const Bucket& bucket, Key key, std::false_type /* use_simd */);
+  
   // Inserts a range [elems_begin, elems_end) of new (key,value) pairs with hash h. The keys must not exist in the map.
-  // Before calling this, ensure that the capacity of `values' is sufficient to contain the new values without re-allocating.
+  // Before calling this, ensure that the capacity of `keys' and `values' is sufficient to contain the new values without re-allocating.
   void insert(std::size_t h, const value_type* elems_begin, const value_type* elems_end);
   
+  // Fills `lookup_table', `keys' and `values' with the elements in [values_begin, values_begin + num_values), once the hash function
+  // has been picked. count[h] must be the number of keys with hash h.
+  template <typename Iter>
+  void fillLookupTableAndValues(Iter values_begin, std::size_t num_values, FixedSizeVector<Unsigned>& count,
+                                MemoryResource& memory_resource);
+  
 public:
+  // Used to select the constructor that uses perfect hashing.
+  struct PerfectHashing {};
+  
   // Constructs an *invalid* map (as if this map was just moved from).
   SemistaticMap() = default;
   
   // Iter must be a forward iterator with value type std::pair<Key, Value>.
+  // The memory retained by the map is allocated from `memory_resource'; temporary buffers used during the construction are
+  // not.
+  template <typename Iter>
+  SemistaticMap(Iter begin, std::size_t num_values, MemoryResource& memory_resource = getDefaultMemoryResource());
+  
+  // Same as above, but uses a perfect hash function built with a fixed seed (so the result only depends on the keys).
+  // The keys must be distinct.
   template <typename Iter>
-  SemistaticMap(Iter begin, std::size_t num_values);
+  SemistaticMap(Iter begin, std::size_t num_values, PerfectHashing,
+                MemoryResource& memory_resource = getDefaultMemoryResource());
   
   // Creates a shallow copy of `map' with the additional elements in new_elements.
   // The keys in new_elements must be unique and must not be present in `map'.
   // The new map will share data with `map', so must be destroyed before `map' is destroyed.
   // NOTE: If more than O(1) elements are added, calls to at() and find() on the result will *not* be O(1).
-  // This is O(new_elements.size()*log(new_elements.size())).
-  SemistaticMap(const SemistaticMap<Key, Value>& map, std::vector<value_type>&& new_elements);
+  // The lookup table of `map' is shared too (only the modified buckets are stored in the new map, unless they're a
+  // significant fraction of all buckets), so this is
+  // O(new_elements.size()*log(new_elements.size()) + k), where k is the number of buckets that `map' itself modified (0
+  // unless `map' is a shallow copy), independent of the number of keys in `map'.
+  SemistaticMap(const SemistaticMap<Key, Value>& map, std::vector<value_type>&& new_elements,
+                MemoryResource& memory_resource = getDefaultMemoryResource());
+  
+  // Creates a copy of `map' (that might be a shallow copy of other maps) that uses a perfect hash function, and doesn't
+  // share data with `map'. This is O(n) (on average), where n is the number of keys in `map'.
+  SemistaticMap(const SemistaticMap<Key, Value>& map, PerfectHashing,
+                MemoryResource& memory_resource = getDefaultMemoryResource());
   
   SemistaticMap(SemistaticMap&&) = default;
   SemistaticMap(const SemistaticMap&) = delete;
@@ -106,6 +221,25 @@ public:
   // Prefer using at() when possible, this is slightly slower.
   // Returns nullptr if the key was not found.
   const Value* find(Key key) const;
+  
+  // Returns the maximum number of keys that at() and find() might have to compare. This is 1 for maps built with a perfect
+  // hash function, but it can grow when creating shallow copies with additional elements.
+  std::size_t maxBucketSize() const;
+  
+  // Writes the contents of this map to `writer', in a format that can be read back with readImage(). Writer must have a
+  // writeWord() method and write() methods for Key and Value (e.g. ImageWriter).
+  // This map must not be a shallow copy of another map.
+  template <typename Writer>
+  void writeImage(Writer& writer) const;
+  
+  // Replaces the contents of this map with the ones written by writeImage(). Reader must have the corresponding read
+  // methods (e.g. ImageReader); if the data is invalid, this calls reader.fail() and the map must not be used.
+  // The values are only checked by is_valid_value(value), e.g. if they're indexes in another array that must be in range.
+  // The hash function that was written is only reused if it still maps each key to its bucket (that might not be the case
+  // if the hash of a key depends on its address, and the address changed). Otherwise a perfect hash function is picked
+  // again for the keys that were read.
+  template <typename Reader, typename IsValidValue>
+  void readImage(Reader& reader, MemoryResource& memory_resource, const IsValidValue& is_valid_value);
 };
 
 } // namespace impl
@@ -24,11 +24,20 @@
 #include <algorithm>
 #include <cassert>
 #include <chrono>
+#include <cstring>
 #include <random>
 #include <utility>
 // This include is not necessary for GCC/Clang, but it's necessary for MSVC.
 #include <numeric>
 
+#if FRUIT_USE_AVX2
+#include <immintrin.h>
+#elif FRUIT_USE_SSE2
+#include <emmintrin.h>
+#elif FRUIT_USE_NEON
+#include <arm_neon.h>
+#endif
+
 #include <fruit/impl/data_structures/semistatic_map.h>
 
 #include <fruit/impl/fruit_assert.h>
@@ -37,9 +46,60 @@
 namespace fruit {
 namespace impl {
 
+#if FRUIT_SIMD_WORDS_PER_VECTOR > 1
+
+// Returns the index of the lowest bit set in `mask'. `mask' must not be 0.
+inline unsigned lowestSetBit(unsigned mask) {
+#ifdef __GNUC__
+  return unsigned(__builtin_ctz(mask));
+#else
+  unsigned result = 0;
+  for (; (mask & 1) == 0; mask >>= 1) {
+    ++result;
+  }
+  return result;
+#endif
+}
+
+// Returns the index of `key' in [words, words + num_words), or num_words if it's not there.
+// This compares FRUIT_SIMD_WORDS_PER_VECTOR words at a time, so it can read up to FRUIT_SIMD_WORDS_PER_VECTOR - 1 words
+// after words[num_words - 1]; these must be readable (but their values don't matter).
+inline std::size_t findWord(const std::uint64_t* words, std::size_t num_words, std::uint64_t key) {
+#if FRUIT_USE_AVX2
+  const __m256i needle = _mm256_set1_epi64x(static_cast<long long>(key));
+  for (std::size_t i = 0; i < num_words; i += 4) {
+    __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(words + i));
+    unsigned mask = unsigned(_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(block, needle))));
+#elif FRUIT_USE_SSE2
+  const __m128i needle = _mm_set1_epi64x(static_cast<long long>(key));
+  for (std::size_t i = 0; i < num_words; i += 2) {
+    __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(words + i));
+    // SSE2 can only compare 32-bit lanes: a word matches if both of its halves do.
+    __m128i equal_halves = _mm_cmpeq_epi32(block, needle);
+    __m128i equal_words = _mm_and_si128(equal_halves, _mm_shuffle_epi32(equal_halves, _MM_SHUFFLE(2, 3, 0, 1)));
+    unsigned mask = unsigned(_mm_movemask_pd(_mm_castsi128_pd(equal_words)));
+#elif FRUIT_USE_NEON
+  const uint64x2_t needle = vdupq_n_u64(key);
+  for (std::size_t i = 0; i < num_words; i += 2) {
+    uint64x2_t equal_words = vceqq_u64(vld1q_u64(words + i), needle);
+    unsigned mask = unsigned(vgetq_lane_u64(equal_words, 0) & 1) | unsigned(vgetq_lane_u64(equal_words, 1) & 2);
+#endif
+    if (num_words - i < FRUIT_SIMD_WORDS_PER_VECTOR) {
+      // Ignore the matches past the end.
+      mask &= (1u << (num_words - i)) - 1;
+    }
+    if (mask != 0) {
+      return i + lowestSetBit(mask);
+    }
+  }
+  return num_words;
+}
+
+#endif // FRUIT_SIMD_WORDS_PER_VECTOR > 1
+
 template <typename Key, typename Value>
 template <typename Iter>
-SemistaticMap<Key, Value>::SemistaticMap(Iter values_begin, std::size_t num_values) {
+SemistaticMap<Key, Value>::SemistaticMap(Iter values_begin, std::size_t num_values, MemoryResource& memory_resource) {
   NumBits num_bits = pickNumBits(num_values);
   std::size_t num_buckets = size_t(1) << num_bits;
   
@@ -47,6 +107,8 @@ SemistaticMap<Key, Value>::SemistaticMap(Iter values_begin, std::size_t num_valu
   
   hash_function.shift = (sizeof(Unsigned)*CHAR_BIT - num_bits);
   
+  // No displacement table (displacements stays nullptr), so hash() is just hash_function.hash().
+  
   // The cast is a no-op in some systems (e.g. GCC and Clang under Linux 64bit) but it's needed in other systems (e.g. MSVC).
   unsigned seed = (unsigned) std::chrono::system_clock::now().time_since_epoch().count();
   std::default_random_engine random_generator(seed);
@@ -71,31 +133,189 @@ pick_another:
     }
   }
   
-  values = FixedSizeVector<value_type>(num_values, value_type());
+  fillLookupTableAndValues(values_begin, num_values, count, memory_resource);
+}
+
+template <typename Key, typename Value>
+template <typename Iter>
+SemistaticMap<Key, Value>::SemistaticMap(Iter values_begin, std::size_t num_values, PerfectHashing,
+                                         MemoryResource& memory_resource) {
+  // We keep the load factor below 0.8: with fuller tables the last groups can take many attempts to find a displacement
+  // (or not find one at all, requiring a new hash function).
+  NumBits num_bits = pickNumBits(num_values + num_values / 4);
+  std::size_t num_buckets = size_t(1) << num_bits;
+  
+  // Keys are first split in groups (with 4 buckets per group), then each group gets a displacement
+  // so that all keys in the group end up in a (different) empty bucket.
+  NumBits num_group_bits = num_bits > 2 ? num_bits - 2 : 0;
+  std::size_t num_groups = size_t(1) << num_group_bits;
+  
+  hash_function.shift = (sizeof(Unsigned)*CHAR_BIT - num_bits);
+  // When there's a single group we can't use a shift of sizeof(Unsigned)*CHAR_BIT, we use a==0 instead.
+  displacement_hash_function.shift = (num_group_bits == 0) ? 0 : (sizeof(Unsigned)*CHAR_BIT - num_group_bits);
+  
+  // The hashes of the keys, before applying hash_function.
+  FixedSizeVector<Unsigned> key_hashes(num_values);
+  Iter itr = values_begin;
+  for (std::size_t i = 0; i < num_values; ++i, ++itr) {
+    key_hashes.push_back(std::hash<typename std::remove_cv<Key>::type>()((*itr).first));
+  }
+  
+  // group_begin[g] is the index (in keys_by_group) of the first key in group g. group_begin[num_groups] is num_values.
+  FixedSizeVector<std::size_t> group_begin(num_groups + 1, 0);
+  FixedSizeVector<Unsigned> keys_by_group(num_values, 0);
+  // The groups with at least 2 keys, sorted by decreasing size.
+  std::vector<std::size_t> groups_to_displace;
+  FixedSizeVector<bool> bucket_used(num_buckets, false);
+  
+  displacements_storage = FixedSizeVector<Unsigned>(num_groups, 0, memory_resource);
+  displacements = displacements_storage.data();
+  
+  std::default_random_engine random_generator(perfect_hash_seed);
+  std::uniform_int_distribution<Unsigned> random_distribution;
+  
+  while (1) {
+    // The multipliers must be odd, otherwise the low-order bit of x would be discarded.
+    hash_function.a = random_distribution(random_generator) | 1;
+    displacement_hash_function.a = (num_group_bits == 0) ? 0 : (random_distribution(random_generator) | 1);
+    
+    // Step 1: sort the keys by group (counting sort).
+    for (std::size_t g = 0; g <= num_groups; ++g) {
+      group_begin[g] = 0;
+    }
+    for (Unsigned x : key_hashes) {
+      ++group_begin[displacement_hash_function.hash(x) + 1];
+    }
+    std::partial_sum(group_begin.begin(), group_begin.end(), group_begin.begin());
+    {
+      FixedSizeVector<std::size_t> next_in_group(group_begin, num_groups + 1);
+      for (Unsigned x : key_hashes) {
+        keys_by_group[next_in_group[displacement_hash_function.hash(x)]++] = x;
+      }
+    }
+    
+    groups_to_displace.clear();
+    for (std::size_t g = 0; g < num_groups; ++g) {
+      displacements_storage[g] = 0;
+      if (group_begin[g + 1] - group_begin[g] > 1) {
+        groups_to_displace.push_back(g);
+      }
+    }
+    std::stable_sort(groups_to_displace.begin(), groups_to_displace.end(), [&group_begin](std::size_t g1, std::size_t g2) {
+      return group_begin[g1 + 1] - group_begin[g1] > group_begin[g2 + 1] - group_begin[g2];
+    });
+    
+    for (std::size_t h = 0; h < num_buckets; ++h) {
+      bucket_used[h] = false;
+    }
+    
+    // Step 2: find a displacement for each group with 2+ keys, starting from the largest ones (while most buckets are still
+    // empty).
+    for (std::size_t g : groups_to_displace) {
+      const Unsigned* keys_begin = keys_by_group.data() + group_begin[g];
+      const Unsigned* keys_end = keys_by_group.data() + group_begin[g + 1];
+      
+      // If 2 keys in the group have the same bucket before the displacement, no displacement can separate them.
+      for (const Unsigned* p = keys_begin; p != keys_end; ++p) {
+        for (const Unsigned* q = keys_begin; q != p; ++q) {
+          if (hash_function.hash(*p) == hash_function.hash(*q)) {
+            goto pick_another;
+          }
+        }
+      }
+      
+      for (Unsigned d = 0; d < num_buckets; ++d) {
+        for (const Unsigned* p = keys_begin; p != keys_end; ++p) {
+          if (bucket_used[hash_function.hash(*p) ^ d]) {
+            goto try_next_displacement;
+          }
+        }
+        for (const Unsigned* p = keys_begin; p != keys_end; ++p) {
+          bucket_used[hash_function.hash(*p) ^ d] = true;
+        }
+        displacements_storage[g] = d;
+        goto group_done;
+        
+try_next_displacement:
+        ;
+      }
+      // No displacement found for this group.
+      goto pick_another;
+      
+group_done:
+      ;
+    }
+    
+    // Step 3: groups with a single key can always be displaced into any empty bucket, we just pick the first one available.
+    {
+      std::size_t next_free_bucket = 0;
+      for (std::size_t g = 0; g < num_groups; ++g) {
+        if (group_begin[g + 1] - group_begin[g] == 1) {
+          while (bucket_used[next_free_bucket]) {
+            ++next_free_bucket;
+          }
+          bucket_used[next_free_bucket] = true;
+          displacements_storage[g] = hash_function.hash(keys_by_group[group_begin[g]]) ^ next_free_bucket;
+        }
+      }
+    }
+    break;
+    
+pick_another:
+    ;
+  }
+  
+  FixedSizeVector<Unsigned> count(num_buckets, 0);
+  itr = values_begin;
+  for (std::size_t i = 0; i < num_values; ++i, ++itr) {
+    Unsigned& this_count = count[hash((*itr).first)];
+    ++this_count;
+    FruitAssert(this_count == 1);
+  }
+  
+  fillLookupTableAndValues(values_begin, num_values, count, memory_resource);
+}
+
+template <typename Key, typename Value>
+template <typename Iter>
+void SemistaticMap<Key, Value>::fillLookupTableAndValues(Iter values_begin, std::size_t num_values,
+                                                         FixedSizeVector<Unsigned>& count,
+                                                         MemoryResource& memory_resource) {
+  keys = FixedSizeVector<Key>(num_values + num_padding_keys, Key(), memory_resource);
+  values = FixedSizeVector<Value>(num_values, Value(), memory_resource);
+  
+  max_bucket_size = count.size() == 0 ? 0 : *std::max_element(count.begin(), count.end());
   
   std::partial_sum(count.begin(), count.end(), count.begin());
-  lookup_table = FixedSizeVector<CandidateValuesRange>(count.size());
+  lookup_table = FixedSizeVector<Bucket>(count.size(), memory_resource);
   for (Unsigned n : count) {
-    lookup_table.push_back(CandidateValuesRange{values.data() + n, values.data() + n});
+    lookup_table.push_back(Bucket{keys.data() + n, keys.data() + n, values.data() + n});
   }
+  base_lookup_table = lookup_table.data();
+  num_buckets = lookup_table.size();
   
   // At this point lookup_table[h] is the number of keys in [first, last) that have a hash <=h.
   // Note that even though we ensure this after construction, it is not maintained by insert() so it's not an invariant.
   
   Iter itr = values_begin;
   for (std::size_t i = 0; i < num_values; ++i, ++itr) {
-    value_type*& first_value_ptr = lookup_table[hash((*itr).first)].begin;
-    --first_value_ptr;
-    FruitAssert(values.data() <= first_value_ptr);
-    FruitAssert(first_value_ptr < values.data() + values.size());
-    *first_value_ptr = *itr;
+    Bucket& bucket = lookup_table[hash((*itr).first)];
+    --bucket.keys_begin;
+    --bucket.values_begin;
+    FruitAssert(values.data() <= bucket.values_begin);
+    FruitAssert(bucket.values_begin < values.data() + values.size());
+    *bucket.keys_begin = (*itr).first;
+    *bucket.values_begin = (*itr).second;
   }
 }
 
 template <typename Key, typename Value>
 SemistaticMap<Key, Value>::SemistaticMap(const SemistaticMap<Key, Value>& map,
-                                         std::vector<value_type>&& new_elements)
-  : hash_function(map.hash_function), lookup_table(map.lookup_table, map.lookup_table.size()) {
+                                         std::vector<value_type>&& new_elements,
+                                         MemoryResource& memory_resource)
+  : hash_function(map.hash_function), displacement_hash_function(map.displacement_hash_function),
+    displacements(map.displacements), base_lookup_table(map.base_lookup_table), num_buckets(map.num_buckets),
+    max_bucket_size(map.max_bucket_size) {
     
   // Sort by hash.
   std::sort(new_elements.begin(), new_elements.end(), [this](const value_type& x, const value_type& y) {
@@ -103,16 +323,38 @@ SemistaticMap<Key, Value>::SemistaticMap(const SemistaticMap<Key, Value>& map,
   });
   
   std::size_t num_additional_values = new_elements.size();
+  std::size_t max_overlay_size = map.overlay_size;
   // Add the space needed to store copies of the old buckets.
   for (auto itr = new_elements.begin(), itr_end = new_elements.end(); itr != itr_end; /* no increment */) {
     Unsigned h = hash(itr->first);
-    auto p = map.lookup_table[h];
-    num_additional_values += (p.end - p.begin);
+    const Bucket& bucket = map.getBucket(h);
+    num_additional_values += (bucket.keys_end - bucket.keys_begin);
+    ++max_overlay_size;
     for (; itr != itr_end && hash(itr->first) == h; ++itr) {
     }
   }
   
-  values = FixedSizeVector<value_type>(num_additional_values);
+  if (max_overlay_size * max_overlay_fraction_inverse >= num_buckets) {
+    // So many buckets might change that lookups would often have to probe the overlay before finding the bucket in
+    // base_lookup_table. Copying the lookup table is cheap compared to inserting the new elements anyway.
+    lookup_table = FixedSizeVector<Bucket>(num_buckets, memory_resource);
+    for (std::size_t h = 0; h < num_buckets; ++h) {
+      lookup_table.push_back(map.getBucket(h));
+    }
+    base_lookup_table = lookup_table.data();
+  } else if (max_overlay_size != 0) {
+    overlay = FixedSizeVector<OverlayEntry>(std::size_t(1) << pickNumBits(2 * max_overlay_size),
+                                            OverlayEntry{empty_overlay_hash, Bucket()},
+                                            memory_resource);
+    for (const OverlayEntry& entry : map.overlay) {
+      if (entry.h != empty_overlay_hash) {
+        getOverlayBucket(entry.h) = entry.bucket;
+      }
+    }
+  }
+  
+  keys = FixedSizeVector<Key>(num_additional_values + num_padding_keys, memory_resource);
+  values = FixedSizeVector<Value>(num_additional_values, memory_resource);
   
   // Now actually perform the insertions.
 
@@ -125,59 +367,140 @@ SemistaticMap<Key, Value>::SemistaticMap(const SemistaticMap<Key, Value>& map,
        itr != itr_end;
        /* no increment */) {
     Unsigned h = hash(itr->first);
-    auto p = map.lookup_table[h];
-    num_additional_values += (p.end - p.begin);
     value_type* first = itr;
     for (; itr != itr_end && hash(itr->first) == h; ++itr) {
     }
     value_type* last = itr;
     insert(h, first, last);
   }
+  
+  for (std::size_t i = 0; i < num_padding_keys; ++i) {
+    keys.push_back(Key());
+  }
+}
+
+template <typename Key, typename Value>
+SemistaticMap<Key, Value>::SemistaticMap(const SemistaticMap<Key, Value>& map, PerfectHashing,
+                                         MemoryResource& memory_resource) {
+  std::vector<value_type> elements;
+  for (std::size_t h = 0; h < map.num_buckets; ++h) {
+    const Bucket& bucket = map.getBucket(h);
+    for (std::size_t i = 0, n = bucket.keys_end - bucket.keys_begin; i < n; ++i) {
+      elements.push_back(value_type(bucket.keys_begin[i], bucket.values_begin[i]));
+    }
+  }
+  *this = SemistaticMap(elements.begin(), elements.size(), PerfectHashing(), memory_resource);
+}
+
+template <typename Key, typename Value>
+typename SemistaticMap<Key, Value>::Bucket& SemistaticMap<Key, Value>::getOverlayBucket(Unsigned h) {
+  FruitAssert(h < num_buckets);
+  Unsigned mask = overlay.size() - 1;
+  Unsigned i = h & mask;
+  for (; overlay[i].h != empty_overlay_hash; i = (i + 1) & mask) {
+    if (overlay[i].h == h) {
+      return overlay[i].bucket;
+    }
+  }
+  FruitAssert(2 * (overlay_size + 1) <= overlay.size());
+  ++overlay_size;
+  overlay[i].h = h;
+  overlay[i].bucket = base_lookup_table[h];
+  return overlay[i].bucket;
 }
 
 template <typename Key, typename Value>
 void SemistaticMap<Key, Value>::insert(std::size_t h, const value_type* elems_begin, const value_type* elems_end) {
   
-  value_type* old_bucket_begin = lookup_table[h].begin;
-  value_type* old_bucket_end = lookup_table[h].end;
+  Bucket& bucket = lookup_table.size() == 0 ? getOverlayBucket(h) : lookup_table[h];
+  Bucket old_bucket = bucket;
   
-  lookup_table[h].begin = values.data() + values.size();
+  bucket.keys_begin = keys.data() + keys.size();
+  bucket.values_begin = values.data() + values.size();
   
   // Step 1: re-insert all keys with the same hash at the end (if any).
-  for (value_type* p = old_bucket_begin; p != old_bucket_end; ++p) {
-    values.push_back(*p);
+  for (std::size_t i = 0, n = old_bucket.keys_end - old_bucket.keys_begin; i < n; ++i) {
+    keys.push_back(old_bucket.keys_begin[i]);
+    values.push_back(old_bucket.values_begin[i]);
   }
   
   // Step 2: also insert the new keys and values
   for (auto itr = elems_begin; itr != elems_end; ++itr) {
-    values.push_back(*itr);
+    keys.push_back(itr->first);
+    values.push_back(itr->second);
   }
   
-  lookup_table[h].end = values.data() + values.size();
+  bucket.keys_end = keys.data() + keys.size();
+  
+  max_bucket_size = std::max(max_bucket_size, std::size_t(bucket.keys_end - bucket.keys_begin));
   
-  // The old sequence is no longer pointed to by any index in the lookup table, but recompacting the vectors would be too slow.
+  // The old sequence is no longer pointed to by any bucket of this map, but recompacting the vectors would be too slow.
+}
+
+template <typename Key, typename Value>
+inline std::size_t SemistaticMap<Key, Value>::findInBucket(const Bucket& bucket, Key key) {
+  return findInBucket(bucket, key, std::integral_constant<bool, use_simd>());
+}
+
+template <typename Key, typename Value>
+inline std::size_t SemistaticMap<Key, Value>::findInBucket(const Bucket& bucket, Key key, std::true_type) {
+#if FRUIT_SIMD_WORDS_PER_VECTOR > 1
+  // Most buckets have a single key, and then this branch is easy to predict. That's important: the CPU can then start
+  // loading the value before the comparison is done (with SIMD, the index of the value depends on the comparison).
+  if (bucket.keys_begin == bucket.keys_end || *bucket.keys_begin == key) {
+    return 0;
+  }
+  std::uint64_t word;
+  std::memcpy(&word, &key, sizeof(word));
+  return 1 + findWord(reinterpret_cast<const std::uint64_t*>(bucket.keys_begin + 1),
+                      std::size_t(bucket.keys_end - bucket.keys_begin) - 1, word);
+#else
+  // use_simd is always false in this case.
+  (void)key;
+  FruitAssert(false);
+  return bucket.keys_end - bucket.keys_begin;
+#endif
+}
+
+template <typename Key, typename Value>
+inline std::size_t SemistaticMap<Key, Value>::findInBucket(const Bucket& bucket, Key key, std::false_type) {
+  const Key* p = bucket.keys_begin;
+  for (; p != bucket.keys_end; ++p) {
+    if (*p == key) {
+      break;
+    }
+  }
+  return p - bucket.keys_begin;
 }
 
 template <typename Key, typename Value>
 const Value& SemistaticMap<Key, Value>::at(Key key) const {
-  Unsigned h = hash(key);
-  for (const value_type* p = lookup_table[h].begin; /* p!=lookup_table[h].end but no need to check */; ++p) {
-    FruitAssert(p != lookup_table[h].end);
-    if (p->first == key) {
-      return p->second;
+  // This doesn't use SIMD instructions even when available. Here the key is known to be in the bucket, so the loop
+  // below has no exit condition and its branch is mostly predicted correctly, so the CPU can start loading the value before
+  // the key comparisons are done. With SIMD the index of the value would depend on the comparison result; in benchmarks
+  // that was slower.
+  const Bucket& bucket = getBucket(hash(key));
+  for (const Key* p = bucket.keys_begin; /* p!=bucket.keys_end but no need to check */; ++p) {
+    FruitAssert(p != bucket.keys_end);
+    if (*p == key) {
+      return bucket.values_begin[p - bucket.keys_begin];
     }
   }
 }
 
 template <typename Key, typename Value>
 const Value* SemistaticMap<Key, Value>::find(Key key) const {
-  Unsigned h = hash(key);
-  for (const value_type *p = lookup_table[h].begin, *p_end = lookup_table[h].end; p != p_end; ++p) {
-    if (p->first == key) {
-      return &(p->second);
-    }
+  const Bucket& bucket = getBucket(hash(key));
+  std::size_t i = findInBucket(bucket, key);
+  if (bucket.keys_begin + i == bucket.keys_end) {
+    return nullptr;
   }
-  return nullptr;
+  return bucket.values_begin + i;
+}
+
+template <typename Key, typename Value>
+std::size_t SemistaticMap<Key, Value>::maxBucketSize() const {
+  return max_bucket_size;
 }
 
 template <typename Key, typename Value>
@@ -189,6 +512,132 @@ typename SemistaticMap<Key, Value>::NumBits SemistaticMap<Key, Value>::pickNumBi
   return result;
 }
 
+template <typename Key, typename Value>
+template <typename Writer>
+void SemistaticMap<Key, Value>::writeImage(Writer& writer) const {
+  FruitAssert(displacements == displacements_storage.data());
+  FruitAssert(base_lookup_table == lookup_table.data());
+  writer.writeWord(hash_function.a);
+  writer.writeWord(hash_function.shift);
+  writer.writeWord(displacement_hash_function.a);
+  writer.writeWord(displacement_hash_function.shift);
+  writer.writeWord(displacements_storage.size());
+  for (Unsigned displacement : displacements_storage) {
+    writer.writeWord(displacement);
+  }
+  // The values are written before the lookup table, so that readImage() can convert the offsets back to pointers.
+  writer.writeWord(values.size());
+  for (std::size_t i = 0; i < values.size(); ++i) {
+    writer.write(keys[i]);
+    writer.write(values[i]);
+  }
+  writer.writeWord(lookup_table.size());
+  for (const Bucket& bucket : lookup_table) {
+    writer.writeWord(std::uint64_t(bucket.keys_begin - keys.data()));
+    writer.writeWord(std::uint64_t(bucket.keys_end - keys.data()));
+  }
+}
+
+template <typename Key, typename Value>
+template <typename Reader, typename IsValidValue>
+void SemistaticMap<Key, Value>::readImage(Reader& reader, MemoryResource& memory_resource,
+                                          const IsValidValue& is_valid_value) {
+  constexpr std::size_t num_bits_in_unsigned = sizeof(Unsigned)*CHAR_BIT;
+  
+  hash_function.a = Unsigned(reader.readWord());
+  std::uint64_t shift = reader.readWord();
+  displacement_hash_function.a = Unsigned(reader.readWord());
+  std::uint64_t displacement_shift = reader.readWord();
+  if (shift >= num_bits_in_unsigned || displacement_shift >= num_bits_in_unsigned) {
+    reader.fail();
+    return;
+  }
+  hash_function.shift = NumBits(shift);
+  displacement_hash_function.shift = NumBits(displacement_shift);
+  
+  std::size_t num_displacements = reader.readSize(1);
+  displacements_storage = FixedSizeVector<Unsigned>(num_displacements, memory_resource);
+  for (std::size_t i = 0; i < num_displacements; ++i) {
+    displacements_storage.push_back(Unsigned(reader.readWord()));
+  }
+  // This is nullptr if there are no displacements (for maps that don't use perfect hashing).
+  displacements = displacements_storage.data();
+  
+  std::size_t num_values = reader.readSize(2);
+  keys = FixedSizeVector<Key>(num_values + num_padding_keys, memory_resource);
+  values = FixedSizeVector<Value>(num_values, memory_resource);
+  for (std::size_t i = 0; i < num_values; ++i) {
+    Key key;
+    Value value;
+    reader.read(key);
+    reader.read(value);
+    if (!is_valid_value(value)) {
+      reader.fail();
+      return;
+    }
+    keys.push_back(key);
+    values.push_back(value);
+  }
+  for (std::size_t i = 0; i < num_padding_keys; ++i) {
+    keys.push_back(Key());
+  }
+  
+  std::size_t num_buckets = reader.readSize(2);
+  lookup_table = FixedSizeVector<Bucket>(num_buckets, memory_resource);
+  for (std::size_t h = 0; h < num_buckets; ++h) {
+    std::uint64_t begin = reader.readWord();
+    std::uint64_t end = reader.readWord();
+    if (begin > end || end > num_values) {
+      reader.fail();
+      return;
+    }
+    lookup_table.push_back(Bucket{keys.data() + begin, keys.data() + end, values.data() + begin});
+    max_bucket_size = std::max(max_bucket_size, std::size_t(end - begin));
+  }
+  base_lookup_table = lookup_table.data();
+  this->num_buckets = num_buckets;
+  if (reader.hasFailed()) {
+    return;
+  }
+  
+  // Check that hash() returns a valid bucket for any key, and that each key is in the range of its bucket.
+  bool hash_function_valid =
+      shift != 0
+      && num_buckets == (Unsigned(1) << (num_bits_in_unsigned - shift))
+      && (displacement_hash_function.a == 0 || displacement_shift != 0)
+      && (displacement_hash_function.a == 0
+              ? num_displacements <= 1
+              : num_displacements == Unsigned(1) << (num_bits_in_unsigned - displacement_shift));
+  for (std::size_t i = 0; hash_function_valid && i < num_displacements; ++i) {
+    hash_function_valid = displacements_storage[i] < num_buckets;
+  }
+  for (std::size_t i = 0; hash_function_valid && i < num_values; ++i) {
+    const Bucket& bucket = lookup_table[hash(keys[i])];
+    hash_function_valid = bucket.keys_begin <= keys.data() + i && keys.data() + i < bucket.keys_end;
+  }
+  
+  if (!hash_function_valid) {
+    // A perfect hash function can only be found if the keys have distinct hashes.
+    std::vector<Unsigned> key_hashes;
+    key_hashes.reserve(num_values);
+    for (std::size_t i = 0; i < num_values; ++i) {
+      key_hashes.push_back(std::hash<typename std::remove_cv<Key>::type>()(keys[i]));
+    }
+    std::sort(key_hashes.begin(), key_hashes.end());
+    if (std::adjacent_find(key_hashes.begin(), key_hashes.end()) != key_hashes.end()) {
+      reader.fail();
+      return;
+    }
+    
+    std::vector<value_type> old_values;
+    old_values.reserve(num_values);
+    for (std::size_t i = 0; i < num_values; ++i) {
+      old_values.push_back(value_type(keys[i], values[i]));
+    }
+    *this = SemistaticMap(old_values.begin(), old_values.size(), PerfectHashing(), memory_resource);
+  }
+}
+
 // This is here so that we don't have to include fixed_size_vector.templates.h in fruit.h.
 template <typename Key, typename Value>
 SemistaticMap<Key, Value>::~SemistaticMap() {
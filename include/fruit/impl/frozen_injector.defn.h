@@ -0,0 +1,70 @@
+/*
+ * Copyright 2014 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FRUIT_FROZEN_INJECTOR_DEFN_H
+#define FRUIT_FROZEN_INJECTOR_DEFN_H
+
+// Redundant, but makes KDevelop happy.
+#include <fruit/frozen_injector.h>
+
+namespace fruit {
+namespace impl {
+
+// The accessor used by FrozenInjector in GetHelper: `object' is the already-constructed object of `node_itr'.
+struct FrozenNodeObjectAccessor {
+  InjectorStorage& injector;
+  InjectorStorage::Graph::node_iterator node_itr;
+  void* object;
+  
+  template <typename C>
+  C* getPtr() const {
+    return static_cast<C*>(object);
+  }
+};
+
+} // namespace impl
+
+template <typename... P>
+inline FrozenInjector<P...>::FrozenInjector(Injector<P...>&& injector, MemoryResource& memory_resource)
+  : storage(std::move(injector.storage)),
+    exposed_nodes(injector.exposed_nodes),
+    objects(storage->freeze(exposed_nodes.data(), exposed_nodes.data() + exposed_nodes.size(), memory_resource)) {
+}
+
+template <typename... P>
+template <typename T>
+inline FrozenInjector<P...>::RemoveAnnotations<T> FrozenInjector<P...>::get() const {
+
+  using E = typename fruit::impl::meta::InjectorImplHelper<P...>::template CheckGet<T>::type;
+  (void)typename fruit::impl::meta::CheckIfError<E>::type();
+
+  // The position of T in P... (see Injector::get()).
+  using Index = fruit::impl::meta::Eval<fruit::impl::meta::IndexInVector(
+      fruit::impl::meta::NormalizeType(fruit::impl::meta::Type<T>),
+      fruit::impl::meta::Vector<fruit::impl::meta::Type<P>...>)>;
+  return fruit::impl::GetHelper<RemoveAnnotations<T>>()(
+      fruit::impl::FrozenNodeObjectAccessor{*storage, exposed_nodes[Index::value], objects[Index::value]});
+}
+
+template <typename... P>
+template <typename T>
+inline FrozenInjector<P...>::operator T() const {
+  return get<T>();
+}
+
+} // namespace fruit
+
+#endif // FRUIT_FROZEN_INJECTOR_DEFN_H
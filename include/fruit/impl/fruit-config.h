@@ -58,4 +58,20 @@
 #endif // FRUIT_HAS_STD_IS_TRIVIALLY_COPY_CONSTRUCTIBLE
 #endif
 
+// The SIMD instruction set that SemistaticMap uses to compare several keys at once, and how many 64-bit words fit in a
+// vector register. Define FRUIT_DISABLE_SIMD to always use the scalar code instead.
+#if !defined(FRUIT_DISABLE_SIMD) && defined(__AVX2__)
+#define FRUIT_USE_AVX2 1
+#define FRUIT_SIMD_WORDS_PER_VECTOR 4
+#elif !defined(FRUIT_DISABLE_SIMD) && (defined(__x86_64__) || defined(_M_X64))
+// SSE2 is always available on x86-64.
+#define FRUIT_USE_SSE2 1
+#define FRUIT_SIMD_WORDS_PER_VECTOR 2
+#elif !defined(FRUIT_DISABLE_SIMD) && defined(__aarch64__) && defined(__ARM_NEON)
+#define FRUIT_USE_NEON 1
+#define FRUIT_SIMD_WORDS_PER_VECTOR 2
+#else
+#define FRUIT_SIMD_WORDS_PER_VECTOR 1
+#endif
+
 #endif // FRUIT_CONFIG_H
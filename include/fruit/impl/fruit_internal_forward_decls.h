@@ -24,7 +24,13 @@ namespace fruit {
 namespace impl {
 
 class ComponentStorage;
+struct BindingSegment;
 class NormalizedComponentStorage;
+class NormalizedComponentStorageHolder;
+class NormalizedComponentImage;
+class ImageWriter;
+class ImageReader;
+class PreparedDeltaStorage;
 class InjectorStorage;
 struct TypeId;
 
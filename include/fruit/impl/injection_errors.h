@@ -188,6 +188,14 @@ struct UnsatisfiedRequirementsInNormalizedComponentError {
     "not provided by the Component (second parameter of the Injector constructor).");
 };
 
+template <typename... UnsatisfiedRequirements>
+struct UnsatisfiedRequirementsInChildInjectorError {
+  static_assert(
+    AlwaysFalse<UnsatisfiedRequirements...>::value,
+    "The requirements in UnsatisfiedRequirements are required by the Component but are not provided "
+    "by the parent injector (first parameter of the Injector constructor).");
+};
+
 template <typename... TypesNotProvided>
 struct TypesInInjectorNotProvidedError {
   static_assert(
@@ -196,6 +204,22 @@ struct TypesInInjectorNotProvidedError {
     "components passed to the Injector constructor provides them.");
 };
 
+template <typename... TypesNotProvided>
+struct TypesInExtendedNormalizedComponentNotProvidedError {
+  static_assert(
+    AlwaysFalse<TypesNotProvided...>::value,
+    "The types in TypesNotProvided are declared as provided by the extended NormalizedComponent, but neither the "
+    "NormalizedComponent nor the Component passed to NormalizedComponent::extend() provides them.");
+};
+
+template <typename... UndeclaredRequirements>
+struct UndeclaredRequirementsInExtendedNormalizedComponentError {
+  static_assert(
+    AlwaysFalse<UndeclaredRequirements...>::value,
+    "The requirements in UndeclaredRequirements are not provided by the NormalizedComponent nor by the Component passed "
+    "to NormalizedComponent::extend(), but they are not declared as required by the extended NormalizedComponent.");
+};
+
 template <typename T>
 struct TypeNotProvidedError {
   static_assert(
@@ -203,6 +227,13 @@ struct TypeNotProvidedError {
     "Trying to get an instance of T, but it is not provided by this Provider/Injector.");
 };
 
+template <typename T>
+struct TypeNotProvidedByNormalizedComponentError {
+  static_assert(
+    AlwaysFalse<T>::value,
+    "Trying to get a BindingHandle for T, but T is not provided by this NormalizedComponent.");
+};
+
 template <typename C, typename InjectSignature>
 struct NoConstructorMatchingInjectSignatureError {
   static_assert(
@@ -367,11 +398,26 @@ struct UnsatisfiedRequirementsInNormalizedComponentErrorTag {
   using apply = UnsatisfiedRequirementsInNormalizedComponentError<UnsatisfiedRequirements...>;
 };
 
+struct UnsatisfiedRequirementsInChildInjectorErrorTag {
+  template <typename... UnsatisfiedRequirements>
+  using apply = UnsatisfiedRequirementsInChildInjectorError<UnsatisfiedRequirements...>;
+};
+
 struct TypesInInjectorNotProvidedErrorTag {
   template <typename... TypesNotProvided>
   using apply = TypesInInjectorNotProvidedError<TypesNotProvided...>;
 };
 
+struct TypesInExtendedNormalizedComponentNotProvidedErrorTag {
+  template <typename... TypesNotProvided>
+  using apply = TypesInExtendedNormalizedComponentNotProvidedError<TypesNotProvided...>;
+};
+
+struct UndeclaredRequirementsInExtendedNormalizedComponentErrorTag {
+  template <typename... UndeclaredRequirements>
+  using apply = UndeclaredRequirementsInExtendedNormalizedComponentError<UndeclaredRequirements...>;
+};
+
 struct FunctorUsedAsProviderErrorTag {
   template <typename ProviderType>
   using apply = FunctorUsedAsProviderError<ProviderType>;
@@ -402,6 +448,11 @@ struct TypeNotProvidedErrorTag {
   using apply = TypeNotProvidedError<T>;
 };
 
+struct TypeNotProvidedByNormalizedComponentErrorTag {
+  template <typename T>
+  using apply = TypeNotProvidedByNormalizedComponentError<T>;
+};
+
 struct NoConstructorMatchingInjectSignatureErrorTag {
   template <typename C, typename InjectSignature>
   using apply = NoConstructorMatchingInjectSignatureError<C, InjectSignature>;
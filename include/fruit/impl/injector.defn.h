@@ -25,9 +25,11 @@
 namespace fruit {
 
 template <typename... P>
-inline Injector<P...>::Injector(const Component<P...>& component)
+inline Injector<P...>::Injector(const Component<P...>& component, MemoryResource& memory_resource)
   : storage(new fruit::impl::InjectorStorage(component.storage,
-                                             std::initializer_list<fruit::impl::TypeId>{fruit::impl::getTypeId<P>()...})) {
+                                             std::initializer_list<fruit::impl::TypeId>{fruit::impl::getTypeId<P>()...},
+                                             memory_resource)),
+    exposed_nodes(lookupExposedNodes()) {
 }
 
 namespace impl {
@@ -59,6 +61,28 @@ struct InjectorImplHelper {
         None)))>;
   };
   
+  // This performs all checks needed in the constructor of Injector that takes a parent injector. Unlike the
+  // NormalizedComponent case, the component can have requirements, as long as the parent provides them.
+  template <typename ParentComp, typename Comp>
+  struct CheckConstructionFromParentInjector {
+    using Op = InstallComponent(Comp, ParentComp);
+    
+    // The calculation of MergedComp will also do some checks, e.g. multiple bindings for the same type.
+    using MergedComp = GetResult(Op);
+    
+    using TypesNotProvided = SetDifference(Vector<Type<P>...>,
+                                           GetComponentPs(MergedComp));
+    using MergedCompRs = SetDifference(GetComponentRsSuperset(MergedComp),
+                                       GetComponentPs(MergedComp));
+    
+    using type = Eval<
+        If(Not(IsEmptySet(MergedCompRs)),
+           ConstructErrorWithArgVector(UnsatisfiedRequirementsInChildInjectorErrorTag, SetToVector(MergedCompRs)),
+        If(Not(IsContained(VectorToSetUnchecked(Vector<Type<P>...>), GetComponentPs(MergedComp))),
+           ConstructErrorWithArgVector(TypesInInjectorNotProvidedErrorTag, SetToVector(TypesNotProvided)),
+        None))>;
+  };
+  
   template <typename T>
   struct CheckGet {
     using Comp = ConstructComponentImpl(Type<P>...);
@@ -76,14 +100,17 @@ struct InjectorImplHelper {
 template <typename... P>
 template <typename... NormalizedComponentParams, typename... ComponentParams>
 inline Injector<P...>::Injector(const NormalizedComponent<NormalizedComponentParams...>& normalized_component,
-                                Component<ComponentParams...> component)
+                                Component<ComponentParams...> component,
+                                MemoryResource& memory_resource)
   : storage(new fruit::impl::InjectorStorage(*(normalized_component.storage.storage),
                                              std::move(component.storage), 
                                              fruit::impl::getTypeIdsForList<fruit::impl::meta::Eval<
                                                  fruit::impl::meta::ConcatVectors(
                                                     fruit::impl::meta::SetToVector(fruit::impl::meta::GetComponentPs(fruit::impl::meta::ConstructComponentImpl(fruit::impl::meta::Type<ComponentParams>...))),
                                                     fruit::impl::meta::SetToVector(fruit::impl::meta::GetComponentPs(fruit::impl::meta::ConstructComponentImpl(fruit::impl::meta::Type<NormalizedComponentParams>...))))
-                                             >>())) {
+                                             >>(),
+                                             memory_resource)),
+    exposed_nodes(lookupExposedNodes()) {
     
   using NormalizedComp = fruit::impl::meta::ConstructComponentImpl(fruit::impl::meta::Type<NormalizedComponentParams>...);
   using Comp1 = fruit::impl::meta::ConstructComponentImpl(fruit::impl::meta::Type<ComponentParams>...);
@@ -94,13 +121,72 @@ inline Injector<P...>::Injector(const NormalizedComponent<NormalizedComponentPar
   (void)typename fruit::impl::meta::CheckIfError<E>::type();
 }
 
+template <typename... P>
+template <typename... NormalizedComponentParams, typename... ComponentParams>
+inline Injector<P...>::Injector(const PreparedDelta<NormalizedComponentParams...>& prepared_delta,
+                                Component<ComponentParams...> component,
+                                MemoryResource& memory_resource)
+  : storage(new fruit::impl::InjectorStorage(*(prepared_delta.storage.storage),
+                                             std::move(component.storage), 
+                                             fruit::impl::getTypeIdsForList<fruit::impl::meta::Eval<
+                                                 fruit::impl::meta::ConcatVectors(
+                                                    fruit::impl::meta::SetToVector(fruit::impl::meta::GetComponentPs(fruit::impl::meta::ConstructComponentImpl(fruit::impl::meta::Type<ComponentParams>...))),
+                                                    fruit::impl::meta::SetToVector(fruit::impl::meta::GetComponentPs(fruit::impl::meta::ConstructComponentImpl(fruit::impl::meta::Type<NormalizedComponentParams>...))))
+                                             >>(),
+                                             memory_resource)),
+    exposed_nodes(lookupExposedNodes()) {
+  
+  using NormalizedComp = fruit::impl::meta::ConstructComponentImpl(fruit::impl::meta::Type<NormalizedComponentParams>...);
+  using Comp1 = fruit::impl::meta::ConstructComponentImpl(fruit::impl::meta::Type<ComponentParams>...);
+  // The checks are the same as in the constructor that takes a NormalizedComponent and a Component.
+  using E = typename fruit::impl::meta::InjectorImplHelper<P...>::template CheckConstructionFromNormalizedComponent<NormalizedComp, Comp1>::type;
+  (void)typename fruit::impl::meta::CheckIfError<E>::type();
+}
+
+template <typename... P>
+template <typename... NormalizedComponentParams>
+inline Injector<P...>::Injector(const NormalizedComponent<NormalizedComponentParams...>& normalized_component,
+                                MemoryResource& memory_resource)
+  : storage(new fruit::impl::InjectorStorage(*(normalized_component.storage.storage), memory_resource)),
+    exposed_nodes(lookupExposedNodes()) {
+
+  using NormalizedComp = fruit::impl::meta::ConstructComponentImpl(fruit::impl::meta::Type<NormalizedComponentParams>...);
+  // This is equivalent to installing an empty component, so we can re-use the checks done in the 2-argument constructor.
+  using EmptyComp = fruit::impl::meta::ConstructComponentImpl();
+
+  using E = typename fruit::impl::meta::InjectorImplHelper<P...>::template CheckConstructionFromNormalizedComponent<NormalizedComp, EmptyComp>::type;
+  (void)typename fruit::impl::meta::CheckIfError<E>::type();
+}
+
+template <typename... P>
+template <typename... ParentParams, typename... ComponentParams>
+inline Injector<P...>::Injector(Injector<ParentParams...>& parent_injector,
+                                Component<ComponentParams...> component,
+                                MemoryResource& memory_resource)
+  : storage(new fruit::impl::InjectorStorage(*(parent_injector.storage),
+                                             std::move(component.storage),
+                                             std::vector<fruit::impl::TypeId>{fruit::impl::getTypeId<P>()...},
+                                             memory_resource)),
+    exposed_nodes(lookupExposedNodes()) {
+  
+  using ParentComp = fruit::impl::meta::ConstructComponentImpl(fruit::impl::meta::Type<ParentParams>...);
+  using Comp1 = fruit::impl::meta::ConstructComponentImpl(fruit::impl::meta::Type<ComponentParams>...);
+  using E = typename fruit::impl::meta::InjectorImplHelper<P...>::template CheckConstructionFromParentInjector<ParentComp, Comp1>::type;
+  (void)typename fruit::impl::meta::CheckIfError<E>::type();
+}
+
 template <typename... P>
 template <typename T>
 inline Injector<P...>::RemoveAnnotations<T> Injector<P...>::get() {
 
   using E = typename fruit::impl::meta::InjectorImplHelper<P...>::template CheckGet<T>::type;
   (void)typename fruit::impl::meta::CheckIfError<E>::type();
-  return storage->template get<T>();
+  
+  // The position of T in P... (all types in P... are normalized, so this is found whenever the check above succeeds).
+  using Index = fruit::impl::meta::Eval<fruit::impl::meta::IndexInVector(
+      fruit::impl::meta::NormalizeType(fruit::impl::meta::Type<T>),
+      fruit::impl::meta::Vector<fruit::impl::meta::Type<P>...>)>;
+  return storage->template get<RemoveAnnotations<T>>(exposed_nodes[Index::value]);
 }
 
 template <typename... P>
@@ -109,6 +195,18 @@ inline Injector<P...>::RemoveAnnotations<C>* Injector<P...>::unsafeGet() {
   return storage->template unsafeGet<C>();
 }
 
+template <typename... P>
+template <typename C>
+inline Injector<P...>::RemoveAnnotations<C>* Injector<P...>::get(const BindingHandle<C>& handle) {
+  return storage->getWithHandle(handle);
+}
+
+template <typename... P>
+template <typename C>
+inline Injector<P...>::RemoveAnnotations<C>* Injector<P...>::unsafeGet(const BindingHandle<C>& handle) {
+  return storage->unsafeGetWithHandle(handle);
+}
+
 template <typename... P>
 template <typename T>
 inline Injector<P...>::operator T() {
@@ -124,6 +222,15 @@ inline const std::vector<
   return storage->template getMultibindings<AnnotatedC>();
 }
 
+template <typename... P>
+template <typename AnnotatedC>
+inline MultibindingsRange<
+	fruit::impl::meta::UnwrapType<fruit::impl::meta::Eval<
+	    fruit::impl::meta::RemoveAnnotations(fruit::impl::meta::Type<AnnotatedC>)
+	>>> Injector<P...>::getMultibindingsRange() {
+  return storage->template getMultibindingsRange<AnnotatedC>();
+}
+
 template <typename... P>
 inline void Injector<P...>::eagerlyInjectAll() {
   // Eagerly inject normal bindings.
@@ -133,6 +240,59 @@ inline void Injector<P...>::eagerlyInjectAll() {
   storage->eagerlyInjectMultibindings();
 }
 
+template <typename... P>
+template <typename Executor>
+inline void Injector<P...>::eagerlyInjectAll(Executor& executor) {
+  storage->eagerlyInjectAllInParallel(
+      std::vector<fruit::impl::TypeId>{fruit::impl::getTypeId<P>()...},
+      [&executor](std::function<void()> task) {
+        executor.execute(std::move(task));
+      });
+}
+
+template <typename... P>
+inline void Injector<P...>::enableConcurrentInjection() {
+  storage->enableConcurrentInjection();
+}
+
+template <typename... P>
+inline void Injector<P...>::enableProfiling() {
+  storage->enableProfiling();
+}
+
+template <typename... P>
+inline const InjectionProfile& Injector<P...>::getProfile() const {
+  return storage->getProfile();
+}
+
+template <typename... P>
+template <typename... NormalizedComponentParams, typename... ComponentParams>
+inline void Injector<P...>::reset(const PreparedDelta<NormalizedComponentParams...>& prepared_delta,
+                                  Component<ComponentParams...> component) {
+  using NormalizedComp = fruit::impl::meta::ConstructComponentImpl(fruit::impl::meta::Type<NormalizedComponentParams>...);
+  using Comp1 = fruit::impl::meta::ConstructComponentImpl(fruit::impl::meta::Type<ComponentParams>...);
+  // The checks are the same as in the constructor that takes a PreparedDelta and a Component.
+  using E = typename fruit::impl::meta::InjectorImplHelper<P...>::template CheckConstructionFromNormalizedComponent<NormalizedComp, Comp1>::type;
+  (void)typename fruit::impl::meta::CheckIfError<E>::type();
+  
+  if (!storage->resetInPlace(*(prepared_delta.storage.storage), component.storage)) {
+    // The exposed types are only computed here, since that requires allocating a vector.
+    storage->reset(*(prepared_delta.storage.storage),
+                   std::move(component.storage),
+                   fruit::impl::getTypeIdsForList<fruit::impl::meta::Eval<
+                       fruit::impl::meta::ConcatVectors(
+                          fruit::impl::meta::SetToVector(fruit::impl::meta::GetComponentPs(fruit::impl::meta::ConstructComponentImpl(fruit::impl::meta::Type<ComponentParams>...))),
+                          fruit::impl::meta::SetToVector(fruit::impl::meta::GetComponentPs(fruit::impl::meta::ConstructComponentImpl(fruit::impl::meta::Type<NormalizedComponentParams>...))))
+                   >>());
+    exposed_nodes = lookupExposedNodes();
+  }
+}
+
+template <typename... P>
+inline typename Injector<P...>::ExposedNodes Injector<P...>::lookupExposedNodes() {
+  return ExposedNodes{{storage->getExposedNode(fruit::impl::getTypeId<P>())...}};
+}
+
 } // namespace fruit
 
 
@@ -102,6 +102,27 @@ struct IsInVector {
   };
 };
 
+// IndexInVector(T, V) returns the position of T in V, or VectorSize(V) if T is not in V.
+struct IndexInVector {
+  template <typename T, typename V>
+  struct apply;
+  
+  template <typename T>
+  struct apply<T, Vector<>> {
+    using type = Int<0>;
+  };
+  
+  template <typename T, typename... Ts>
+  struct apply<T, Vector<T, Ts...>> {
+    using type = Int<0>;
+  };
+  
+  template <typename T, typename T1, typename... Ts>
+  struct apply<T, Vector<T1, Ts...>> {
+    using type = Int<1 + apply<T, Vector<Ts...>>::type::value>;
+  };
+};
+
 struct IsVectorContained {
   template <typename V1, typename V2>
   struct apply;
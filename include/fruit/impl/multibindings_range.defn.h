@@ -0,0 +1,155 @@
+/*
+ * Copyright 2014 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FRUIT_MULTIBINDINGS_RANGE_DEFN_H
+#define FRUIT_MULTIBINDINGS_RANGE_DEFN_H
+
+// Redundant, but makes KDevelop happy.
+#include <fruit/multibindings_range.h>
+
+namespace fruit {
+
+template <typename C>
+inline MultibindingsRange<C>::iterator::iterator(void* const* p)
+  : p(p) {
+}
+
+template <typename C>
+inline C* MultibindingsRange<C>::iterator::operator*() const {
+  return reinterpret_cast<C*>(*p);
+}
+
+template <typename C>
+inline C* MultibindingsRange<C>::iterator::operator[](std::ptrdiff_t i) const {
+  return reinterpret_cast<C*>(p[i]);
+}
+
+template <typename C>
+inline typename MultibindingsRange<C>::iterator& MultibindingsRange<C>::iterator::operator++() {
+  ++p;
+  return *this;
+}
+
+template <typename C>
+inline typename MultibindingsRange<C>::iterator MultibindingsRange<C>::iterator::operator++(int) {
+  iterator result = *this;
+  ++p;
+  return result;
+}
+
+template <typename C>
+inline typename MultibindingsRange<C>::iterator& MultibindingsRange<C>::iterator::operator--() {
+  --p;
+  return *this;
+}
+
+template <typename C>
+inline typename MultibindingsRange<C>::iterator MultibindingsRange<C>::iterator::operator--(int) {
+  iterator result = *this;
+  --p;
+  return result;
+}
+
+template <typename C>
+inline typename MultibindingsRange<C>::iterator& MultibindingsRange<C>::iterator::operator+=(std::ptrdiff_t n) {
+  p += n;
+  return *this;
+}
+
+template <typename C>
+inline typename MultibindingsRange<C>::iterator& MultibindingsRange<C>::iterator::operator-=(std::ptrdiff_t n) {
+  p -= n;
+  return *this;
+}
+
+template <typename C>
+inline typename MultibindingsRange<C>::iterator MultibindingsRange<C>::iterator::operator+(std::ptrdiff_t n) const {
+  return iterator(p + n);
+}
+
+template <typename C>
+inline typename MultibindingsRange<C>::iterator MultibindingsRange<C>::iterator::operator-(std::ptrdiff_t n) const {
+  return iterator(p - n);
+}
+
+template <typename C>
+inline std::ptrdiff_t MultibindingsRange<C>::iterator::operator-(iterator other) const {
+  return p - other.p;
+}
+
+template <typename C>
+inline bool MultibindingsRange<C>::iterator::operator==(iterator other) const {
+  return p == other.p;
+}
+
+template <typename C>
+inline bool MultibindingsRange<C>::iterator::operator!=(iterator other) const {
+  return p != other.p;
+}
+
+template <typename C>
+inline bool MultibindingsRange<C>::iterator::operator<(iterator other) const {
+  return p < other.p;
+}
+
+template <typename C>
+inline bool MultibindingsRange<C>::iterator::operator<=(iterator other) const {
+  return p <= other.p;
+}
+
+template <typename C>
+inline bool MultibindingsRange<C>::iterator::operator>(iterator other) const {
+  return p > other.p;
+}
+
+template <typename C>
+inline bool MultibindingsRange<C>::iterator::operator>=(iterator other) const {
+  return p >= other.p;
+}
+
+template <typename C>
+inline MultibindingsRange<C>::MultibindingsRange(void* const* objects_begin, void* const* objects_end)
+  : objects_begin(objects_begin), objects_end(objects_end) {
+}
+
+template <typename C>
+inline typename MultibindingsRange<C>::iterator MultibindingsRange<C>::begin() const {
+  return iterator(objects_begin);
+}
+
+template <typename C>
+inline typename MultibindingsRange<C>::iterator MultibindingsRange<C>::end() const {
+  return iterator(objects_end);
+}
+
+template <typename C>
+inline std::size_t MultibindingsRange<C>::size() const {
+  return objects_end - objects_begin;
+}
+
+template <typename C>
+inline bool MultibindingsRange<C>::empty() const {
+  return objects_begin == objects_end;
+}
+
+template <typename C>
+inline C* MultibindingsRange<C>::operator[](std::size_t i) const {
+  return reinterpret_cast<C*>(objects_begin[i]);
+}
+
+} // namespace fruit
+
+#endif // FRUIT_MULTIBINDINGS_RANGE_DEFN_H
@@ -17,20 +17,123 @@
 #ifndef FRUIT_NORMALIZED_COMPONENT_INLINES_H
 #define FRUIT_NORMALIZED_COMPONENT_INLINES_H
 
+#include <fruit/component.h>
+
+// Redundant, but makes KDevelop happy.
 #include <fruit/normalized_component.h>
 #include <fruit/impl/util/type_info.h>
 
 namespace fruit {
 
 template <typename... Params>
-inline NormalizedComponent<Params...>::NormalizedComponent(const Component<Params...>& component)
-  : storage(
-      component.storage,
-      fruit::impl::getTypeIdsForList<
-        typename fruit::impl::meta::Eval<fruit::impl::meta::SetToVector(
-            typename fruit::impl::meta::Eval<
-                fruit::impl::meta::ConstructComponentImpl(fruit::impl::meta::Type<Params>...)
-            >::Ps)>>()) {
+inline std::vector<fruit::impl::TypeId> NormalizedComponent<Params...>::getExposedTypes() {
+  return fruit::impl::getTypeIdsForList<
+      typename fruit::impl::meta::Eval<fruit::impl::meta::SetToVector(
+          typename fruit::impl::meta::Eval<
+              fruit::impl::meta::ConstructComponentImpl(fruit::impl::meta::Type<Params>...)
+          >::Ps)>>();
+}
+
+template <typename... Params>
+inline NormalizedComponent<Params...>::NormalizedComponent(const Component<Params...>& component,
+                                                           MemoryResource& memory_resource)
+  : storage(component.storage, getExposedTypes(), memory_resource) {
+}
+
+template <typename... Params>
+inline NormalizedComponent<Params...>::NormalizedComponent(const Component<Params...>& component,
+                                                           const void* image,
+                                                           std::size_t image_size,
+                                                           const std::string& build_fingerprint,
+                                                           MemoryResource& memory_resource)
+  : storage(component.storage, getExposedTypes(), image, image_size, build_fingerprint, memory_resource) {
+}
+
+template <typename... Params>
+inline NormalizedComponent<Params...>::NormalizedComponent(
+    const fruit::impl::NormalizedComponentStorageHolder& normalized_component,
+    const fruit::impl::ComponentStorage& component,
+    MemoryResource& memory_resource)
+  : storage(normalized_component, component, getExposedTypes(), memory_resource) {
+}
+
+namespace impl {
+namespace meta {
+
+// This performs all checks needed in NormalizedComponent::extend().
+template <typename NormalizedComp, typename Comp, typename NewComp>
+struct CheckNormalizedComponentExtension {
+  // The calculation of MergedComp will also do some checks, e.g. multiple bindings for the same type.
+  using MergedComp = GetResult(InstallComponent(Comp, NormalizedComp));
+  
+  using MergedCompRs = SetDifference(GetComponentRsSuperset(MergedComp),
+                                     GetComponentPs(MergedComp));
+  using NewCompRs = SetDifference(GetComponentRsSuperset(NewComp),
+                                  GetComponentPs(NewComp));
+  
+  using type = Eval<
+      If(Not(IsContained(GetComponentPs(NewComp), GetComponentPs(MergedComp))),
+         ConstructErrorWithArgVector(TypesInExtendedNormalizedComponentNotProvidedErrorTag,
+                                     SetToVector(SetDifference(GetComponentPs(NewComp), GetComponentPs(MergedComp)))),
+      If(Not(IsContained(MergedCompRs, NewCompRs)),
+         ConstructErrorWithArgVector(UndeclaredRequirementsInExtendedNormalizedComponentErrorTag,
+                                     SetToVector(SetDifference(MergedCompRs, NewCompRs))),
+      None))>;
+};
+
+template <typename NormalizedComp, typename C>
+struct CheckGetBindingHandle {
+  using type = Eval<
+      If(Not(IsInSet(Type<C>, GetComponentPs(NormalizedComp))),
+         ConstructError(TypeNotProvidedByNormalizedComponentErrorTag, Type<C>),
+      None)>;
+};
+
+} // namespace meta
+} // namespace impl
+
+template <typename... Params>
+template <typename C>
+inline BindingHandle<C> NormalizedComponent<Params...>::getBindingHandle() const {
+  using NormalizedComp = fruit::impl::meta::ConstructComponentImpl(fruit::impl::meta::Type<Params>...);
+  using E = typename fruit::impl::meta::CheckGetBindingHandle<NormalizedComp, C>::type;
+  (void)typename fruit::impl::meta::CheckIfError<E>::type();
+  
+  return BindingHandle<C>(storage.getId(), storage.getNodeIndex(fruit::impl::getTypeId<C>()));
+}
+
+template <typename... Params>
+template <typename... NewParams, typename... ComponentParams>
+inline NormalizedComponent<NewParams...> NormalizedComponent<Params...>::extend(Component<ComponentParams...> component,
+                                                                                MemoryResource& memory_resource) const {
+  using NormalizedComp = fruit::impl::meta::ConstructComponentImpl(fruit::impl::meta::Type<Params>...);
+  using Comp1 = fruit::impl::meta::ConstructComponentImpl(fruit::impl::meta::Type<ComponentParams>...);
+  using NewComp = fruit::impl::meta::ConstructComponentImpl(fruit::impl::meta::Type<NewParams>...);
+  // We don't check whether the construction of Comp1 or NewComp resulted in errors here; if they did, the instantiation
+  // of Component<ComponentParams...> or NormalizedComponent<NewParams...> would have resulted in an error already.
+  
+  using E = typename fruit::impl::meta::CheckNormalizedComponentExtension<NormalizedComp, Comp1, NewComp>::type;
+  (void)typename fruit::impl::meta::CheckIfError<E>::type();
+  
+  return NormalizedComponent<NewParams...>(storage, component.storage, memory_resource);
+}
+
+template <typename... Params>
+inline std::string NormalizedComponent<Params...>::serialize(const Component<Params...>& component,
+                                                             const std::string& build_fingerprint) const {
+  return storage.writeImage(component.storage, getExposedTypes(), build_fingerprint);
+}
+
+template <typename... Params>
+inline bool NormalizedComponent<Params...>::isLoadedFromImage() const {
+  return storage.isLoadedFromImage();
+}
+
+template <typename... Params>
+template <typename... ComponentParams>
+inline PreparedDelta<Params...>::PreparedDelta(const NormalizedComponent<Params...>& normalized_component,
+                                               const Component<ComponentParams...>& prototype_component)
+  : storage(normalized_component.storage, prototype_component.storage) {
 }
 
 } // namespace fruit
@@ -31,39 +31,51 @@ namespace fruit {
 namespace impl {
 
 inline std::size_t ComponentStorage::numBindings() const {
-  return bindings.size();
+  std::unique_ptr<BindingSegment> flattened_segment;
+  return flatten(flattened_segment).bindings.size();
 }
 
 inline std::size_t ComponentStorage::numCompressedBindings() const {
-  return compressed_bindings.size();
+  std::unique_ptr<BindingSegment> flattened_segment;
+  return flatten(flattened_segment).compressed_bindings.size();
 }
 
 inline std::size_t ComponentStorage::numMultibindings() const {
-  return multibindings.size();
+  std::unique_ptr<BindingSegment> flattened_segment;
+  return flatten(flattened_segment).multibindings.size();
 }
 
 inline void ComponentStorage::expectBindings(std::size_t n) {
-  bindings.reserve(n);
+  getMutableSegment().bindings.reserve(n);
 }
 
 inline void ComponentStorage::expectCompressedBindings(std::size_t n) {
-  compressed_bindings.reserve(n);
+  getMutableSegment().compressed_bindings.reserve(n);
 }
 
 inline void ComponentStorage::expectMultibindings(std::size_t n) {
-  multibindings.reserve(n);
+  getMutableSegment().multibindings.reserve(n);
+}
+
+inline BindingSegment& ComponentStorage::getMutableSegment() {
+  if (segment == nullptr) {
+    segment = std::make_shared<BindingSegment>();
+  } else if (segment.use_count() != 1) {
+    segment = std::make_shared<BindingSegment>(*segment);
+  }
+  return *segment;
 }
 
 inline void ComponentStorage::addBinding(std::tuple<TypeId, BindingData> t) throw() {
-  bindings.push_back(std::make_pair(std::get<0>(t), std::get<1>(t)));
+  getMutableSegment().bindings.push_back(std::make_pair(std::get<0>(t), std::get<1>(t)));
 }
 
 inline void ComponentStorage::addCompressedBinding(std::tuple<TypeId, TypeId, BindingData> t) throw() {
-  compressed_bindings.push_back(CompressedBinding{std::get<0>(t), std::get<1>(t), std::get<2>(t)});
+  getMutableSegment().compressed_bindings.push_back(CompressedBinding{std::get<0>(t), std::get<1>(t), std::get<2>(t)});
 }
 
 inline void ComponentStorage::addMultibinding(std::tuple<TypeId, MultibindingData> t) throw() {
-  multibindings.emplace_back(std::get<0>(t), std::get<1>(t));
+  getMutableSegment().multibindings.emplace_back(std::get<0>(t), std::get<1>(t));
 }
 
 } // namespace fruit
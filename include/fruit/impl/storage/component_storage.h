@@ -21,11 +21,32 @@
 #include <fruit/fruit_forward_decls.h>
 #include <fruit/impl/binding_data.h>
 
-#include <forward_list>
+#include <memory>
+#include <vector>
 
 namespace fruit {
 namespace impl {
 
+/**
+ * The bindings added directly to a component, and the segments of the components installed in it.
+ * Segments are shared (by copies of a ComponentStorage and by the components that installed it) and are immutable once
+ * shared, so installing a component or copying it is O(1) instead of copying all its bindings.
+ */
+struct BindingSegment {
+  // Duplicate elements (elements with the same typeId) are not meaningful and will be removed later.
+  std::vector<std::pair<TypeId, BindingData>> bindings;
+  
+  // All elements in this vector are best-effort. Removing an element from this vector does not affect correctness.
+  std::vector<CompressedBinding> compressed_bindings;
+  
+  // Duplicate elements (elements with the same typeId) *are* meaningful, these are multibindings.
+  std::vector<std::pair<TypeId, MultibindingData>> multibindings;
+  
+  // The segments of the installed components. Each one is paired with the number of elements of `multibindings' that
+  // were added before the install, so that flattening preserves the order of the multibindings.
+  std::vector<std::pair<std::size_t, std::shared_ptr<const BindingSegment>>> installed_segments;
+};
+
 /**
  * A component where all types have to be explicitly registered, and all checks are at runtime.
  * Used to implement Component<>, don't use directly.
@@ -38,23 +59,32 @@ namespace impl {
  * - Injector<T1, ..., Tk> (with T1, ..., Tk of the above forms).
  */
 class ComponentStorage {
-private:  
-  // Duplicate elements (elements with the same typeId) are not meaningful and will be removed later.
-  std::vector<std::pair<TypeId, BindingData>> bindings;
+private:
+  // This is nullptr for an empty component.
+  std::shared_ptr<BindingSegment> segment;
   
-  // All elements in this vector are best-effort. Removing an element from this vector does not affect correctness.
-  std::vector<CompressedBinding> compressed_bindings;
+  // Returns the segment of this component, allocating it if it's nullptr or copying it if it's shared (copy-on-write).
+  BindingSegment& getMutableSegment();
   
-  // Duplicate elements (elements with the same typeId) *are* meaningful, these are multibindings.
-  std::vector<std::pair<TypeId, MultibindingData>> multibindings;
-
   template <typename... Ts>
   friend class fruit::Injector;
   
   friend class NormalizedComponentStorage;
+  friend class NormalizedComponentImage;
   friend class InjectorStorage;
+  friend class PreparedDeltaStorage;
 
 public:
+  ComponentStorage() = default;
+  
+  ComponentStorage(const ComponentStorage&) = default;
+  // This is declared explicitly (like the other special members) since the user-declared destructor would otherwise
+  // prevent the implicit move constructor.
+  ComponentStorage(ComponentStorage&&) = default;
+  
+  ComponentStorage& operator=(const ComponentStorage&) = default;
+  ComponentStorage& operator=(ComponentStorage&&) = default;
+  
   ~ComponentStorage();
 
   void addBinding(std::tuple<TypeId, BindingData> t) throw();
@@ -64,8 +94,18 @@ public:
   
   void addMultibinding(std::tuple<TypeId, MultibindingData> t) throw();
   
+  // This is O(1): the segment of `other' is shared, not copied.
   void install(const ComponentStorage& other) throw();
   
+  // Returns a segment with all the bindings of this component and of the components installed in it (with no installed
+  // segments). A segment that was installed through multiple paths (e.g. the same component installed by two components
+  // that are both installed here) is only visited once, so its multibindings are only added once.
+  // When there's nothing to merge (no installs, or a component that only installs another one), this returns an existing
+  // segment instead of copying the bindings. Otherwise the result is stored in `flattened_segment'.
+  // The result is valid as long as both this object and `flattened_segment' are.
+  const BindingSegment& flatten(std::unique_ptr<BindingSegment>& flattened_segment) const;
+  
+  // These count the elements in flatten().
   std::size_t numBindings() const;
   std::size_t numCompressedBindings() const;
   std::size_t numMultibindings() const;
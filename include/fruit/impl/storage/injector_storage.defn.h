@@ -74,66 +74,87 @@ inline const TypeId* InjectorStorage::BindingDataNodeIter::getEdgesEnd() {
   return deps->deps + deps->num_deps;
 }
 
+// The default accessor of GetHelper: gets the object of `node_itr' from `injector', constructing it if needed.
+struct NodeObjectAccessor {
+  InjectorStorage& injector;
+  InjectorStorage::Graph::node_iterator node_itr;
+  
+  template <typename C>
+  C* getPtr() const {
+    return injector.getPtr<C>(node_itr);
+  }
+};
+
+// GetHelper<AnnotatedT>()(accessor) returns the object for AnnotatedT. `accessor' has the `injector' and the `node_itr'
+// of the requested type, and its getPtr<C>() method returns the object of that node (see e.g. NodeObjectAccessor).
 template <typename AnnotatedT>
 struct GetHelper;
 
 // General case, value.
 template <typename C>
 struct GetHelper {
-  C operator()(InjectorStorage& injector, InjectorStorage::Graph::node_iterator node_itr) {
-    return *(injector.getPtr<C>(node_itr));
+  template <typename Accessor>
+  C operator()(const Accessor& accessor) {
+    return *(accessor.template getPtr<C>());
   }
 };
 
 template <typename C>
 struct GetHelper<const C> {
-  const C operator()(InjectorStorage& injector, InjectorStorage::Graph::node_iterator node_itr) {
-    return *(injector.getPtr<C>(node_itr));
+  template <typename Accessor>
+  const C operator()(const Accessor& accessor) {
+    return *(accessor.template getPtr<C>());
   }
 };
 
 template <typename C>
 struct GetHelper<std::shared_ptr<C>> {
   // This method is covered by tests, even though lcov doesn't detect that.
-  std::shared_ptr<C> operator()(InjectorStorage& injector, InjectorStorage::Graph::node_iterator node_itr) {
-    return std::shared_ptr<C>(std::shared_ptr<char>(), injector.getPtr<C>(node_itr));
+  template <typename Accessor>
+  std::shared_ptr<C> operator()(const Accessor& accessor) {
+    return std::shared_ptr<C>(std::shared_ptr<char>(), accessor.template getPtr<C>());
   }
 };
 
 template <typename C>
 struct GetHelper<C*> {
-  C* operator()(InjectorStorage& injector, InjectorStorage::Graph::node_iterator node_itr) {
-    return injector.getPtr<C>(node_itr);
+  template <typename Accessor>
+  C* operator()(const Accessor& accessor) {
+    return accessor.template getPtr<C>();
   }
 };
 
 template <typename C>
 struct GetHelper<const C*> {
   // This method is covered by tests, even though lcov doesn't detect that.
-  const C* operator()(InjectorStorage& injector, InjectorStorage::Graph::node_iterator node_itr) {
-    return injector.getPtr<C>(node_itr);
+  template <typename Accessor>
+  const C* operator()(const Accessor& accessor) {
+    return accessor.template getPtr<C>();
   }
 };
 
 template <typename C>
 struct GetHelper<C&> {
-  C& operator()(InjectorStorage& injector, InjectorStorage::Graph::node_iterator node_itr) {
-    return *(injector.getPtr<C>(node_itr));
+  template <typename Accessor>
+  C& operator()(const Accessor& accessor) {
+    return *(accessor.template getPtr<C>());
   }
 };
 
 template <typename C>
 struct GetHelper<const C&> {
   // This method is covered by tests, even though lcov doesn't detect that.
-  const C& operator()(InjectorStorage& injector, InjectorStorage::Graph::node_iterator node_itr) {
-    return *(injector.getPtr<C>(node_itr));
+  template <typename Accessor>
+  const C& operator()(const Accessor& accessor) {
+    return *(accessor.template getPtr<C>());
   }
 };
 
 template <typename C>
 struct GetHelper<Provider<C>> {
-  Provider<C> operator()(InjectorStorage& injector, InjectorStorage::Graph::node_iterator node_itr) {
-    return Provider<C>(&injector, node_itr);
+  template <typename Accessor>
+  Provider<C> operator()(const Accessor& accessor) {
+    return Provider<C>(&accessor.injector, accessor.node_itr);
   }
 };
 
@@ -143,13 +164,13 @@ struct GetHelper<fruit::Annotated<Annotation, T>> : public GetHelper<T> {
 
 template <typename AnnotatedT>
 inline InjectorStorage::RemoveAnnotations<AnnotatedT> InjectorStorage::get() {
-  return GetHelper<AnnotatedT>()(*this, lazyGetPtr<NormalizeType<AnnotatedT>>());
+  return GetHelper<AnnotatedT>()(NodeObjectAccessor{*this, lazyGetPtr<NormalizeType<AnnotatedT>>()});
 }
 
 template <typename T>
 inline T InjectorStorage::get(InjectorStorage::Graph::node_iterator node_iterator) {
   FruitStaticAssert(fruit::impl::meta::IsSame(fruit::impl::meta::Type<T>, fruit::impl::meta::RemoveAnnotations(fruit::impl::meta::Type<T>)));
-  return GetHelper<T>()(*this, node_iterator);
+  return GetHelper<T>()(NodeObjectAccessor{*this, node_iterator});
 }
 
 template <typename AnnotatedC>
@@ -179,14 +200,50 @@ inline InjectorStorage::RemoveAnnotations<AnnotatedC>* InjectorStorage::unsafeGe
   return reinterpret_cast<C*>(p);
 }
 
+template <typename AnnotatedC>
+inline InjectorStorage::RemoveAnnotations<AnnotatedC>* InjectorStorage::getWithHandle(const BindingHandle<AnnotatedC>& handle) {
+  using C = RemoveAnnotations<AnnotatedC>;
+  void* p = unsafeGetPtr(handle);
+  if (p == nullptr) {
+    fatal("attempting to get an instance for the type " + std::string(getTypeId<AnnotatedC>())
+        + " with a BindingHandle, but the type is not bound in this injector");
+  }
+  return reinterpret_cast<C*>(p);
+}
+
+template <typename AnnotatedC>
+inline InjectorStorage::RemoveAnnotations<AnnotatedC>* InjectorStorage::unsafeGetWithHandle(const BindingHandle<AnnotatedC>& handle) {
+  using C = RemoveAnnotations<AnnotatedC>;
+  void* p = unsafeGetPtr(handle);
+  return reinterpret_cast<C*>(p);
+}
+
 inline InjectorStorage::Graph::node_iterator InjectorStorage::lazyGetPtr(TypeId type) {
   return bindings.at(type);
 }
 
+template <typename AnnotatedC>
+inline void* InjectorStorage::unsafeGetPtr(const BindingHandle<AnnotatedC>& handle) {
+  if (handle.normalized_component_id == base_normalized_component_id) {
+    return getPtrInternal(bindings.nodeAtIndex(handle.node_index));
+  }
+  return unsafeGetPtr(getTypeId<AnnotatedC>());
+}
+
+inline InjectorStorage::Graph::node_iterator InjectorStorage::getExposedNode(TypeId type) {
+  return lazyGetPtr(type);
+}
+
 inline void* InjectorStorage::unsafeGetPtr(TypeId type) {
+  // The lock is needed since find() also reads the node's state, that might be modified concurrently by another thread.
+  std::unique_lock<std::recursive_mutex> lock;
+  if (concurrent_objects != nullptr) {
+    lock = std::unique_lock<std::recursive_mutex>(concurrent_injection_mutex);
+  }
   Graph::node_iterator itr = bindings.find(type);
   if (itr == bindings.end()) {
-    return nullptr;
+    // A child injector only has nodes for the types of its parent that it needs, the other ones are looked up in the parent.
+    return (parent != nullptr) ? parent->unsafeGetPtr(type) : nullptr;
   }
   return getPtrInternal(itr);
 }
@@ -203,52 +260,50 @@ inline const std::vector<InjectorStorage::RemoveAnnotations<AnnotatedC>*>& Injec
   }
 }
 
-inline void* InjectorStorage::getPtrInternal(Graph::node_iterator node_itr) {
-  NormalizedBindingData& bindingData = node_itr.getNode();
-  if (!node_itr.isTerminal()) {
-    bindingData.create(*this, node_itr);
-    FruitAssert(node_itr.isTerminal());
-  }
-  return bindingData.getObject();
+template <typename AnnotatedC>
+inline MultibindingsRange<InjectorStorage::RemoveAnnotations<AnnotatedC>> InjectorStorage::getMultibindingsRange() {
+  std::pair<void* const*, void* const*> objects = getMultibindingsRange(getTypeId<AnnotatedC>());
+  return MultibindingsRange<RemoveAnnotations<AnnotatedC>>(objects.first, objects.second);
 }
 
-inline NormalizedMultibindingData* InjectorStorage::getNormalizedMultibindingData(TypeId type) {
-  auto itr = multibindings.find(type);
-  if (itr != multibindings.end())
-    return &(itr->second);
-  else
-    return nullptr;
+inline void* InjectorStorage::getPtrInternal(Graph::node_iterator node_itr) {
+  if (concurrent_objects != nullptr) {
+    // Concurrent mode. Note that we must not read the graph node here (the node might be being modified by another thread),
+    // only its slot in concurrent_objects.
+    void* p = concurrent_objects[bindings.nodeIndex(node_itr)].load(std::memory_order_acquire);
+    if (p != nullptr) {
+      return p;
+    }
+    return getPtrInternalConcurrent(node_itr);
+  }
+  // This is the path taken when getting an object that was already constructed, so the node is read only once.
+  const NormalizedBindingData* terminal_node = node_itr.getConstNodeIfTerminal();
+  if (terminal_node != nullptr) {
+    return terminal_node->getObject();
+  }
+  constructed_any_object = true;
+  // getNode() makes the node's page private, so the reference stays valid while the object is constructed.
+  NormalizedBindingData& binding_data = node_itr.getNode();
+  binding_data.create(*this, node_itr);
+  FruitAssert(node_itr.isTerminal());
+  return binding_data.getObject();
 }
 
 template <typename AnnotatedC>
-inline std::shared_ptr<char> InjectorStorage::createMultibindingVector(InjectorStorage& storage) {
+inline void* InjectorStorage::createMultibindingVector(InjectorStorage& storage,
+                                                       const MultibindingData::object_t* objects_begin,
+                                                       const MultibindingData::object_t* objects_end) {
   using C = RemoveAnnotations<AnnotatedC>;
-  TypeId type = getTypeId<AnnotatedC>();
-  NormalizedMultibindingData* multibinding = storage.getNormalizedMultibindingData(type);
   
-  // This method is only called if there was at least 1 multibinding (otherwise the would-be caller would have returned nullptr
-  // instead of calling this).
-  FruitAssert(multibinding != nullptr);
-  
-  if (multibinding->v.get() != nullptr) {
-    // Result cached, return early.
-    return multibinding->v;
-  }
-  
-  storage.ensureConstructedMultibinding(*multibinding);
-  
-  std::vector<C*> s;
-  s.reserve(multibinding->elems.size());
-  for (const NormalizedMultibindingData::Elem& elem : multibinding->elems) {
-    s.push_back(reinterpret_cast<C*>(elem.object));
+  // The vector is held in a unique_ptr until it's registered in the allocator.
+  std::unique_ptr<std::vector<C*>> v(new std::vector<C*>());
+  v->reserve(objects_end - objects_begin);
+  for (const MultibindingData::object_t* p = objects_begin; p != objects_end; ++p) {
+    v->push_back(reinterpret_cast<C*>(*p));
   }
   
-  std::shared_ptr<std::vector<C*>> vector_ptr = std::make_shared<std::vector<C*>>(std::move(s));
-  std::shared_ptr<char> result(vector_ptr, reinterpret_cast<char*>(vector_ptr.get()));
-  
-  multibinding->v = result;
-  
-  return result;
+  storage.allocator.registerExternallyAllocatedObject(v.get());
+  return v.release();
 }
 
 // I, C must not be pointers.
@@ -386,6 +441,23 @@ struct InvokeLambdaWithInjectedArgVector<AnnotatedSignature, Lambda, false /* la
   }
 };
 
+#if FRUIT_ENABLE_PROFILING
+
+inline InjectorStorage::ProfiledConstruction::ProfiledConstruction(InjectorStorage& injector, TypeId type)
+  : profile(injector.active_profile), allocator(injector.allocator) {
+  if (profile != nullptr) {
+    profile->beginConstruction(type, allocator.getUsedBytes());
+  }
+}
+
+inline InjectorStorage::ProfiledConstruction::~ProfiledConstruction() {
+  if (profile != nullptr) {
+    profile->endConstruction(allocator.getUsedBytes());
+  }
+}
+
+#endif // FRUIT_ENABLE_PROFILING
+
 template <typename AnnotatedSignature, typename Lambda>
 inline std::tuple<TypeId, BindingData> InjectorStorage::createBindingDataForProvider() {
 #ifdef FRUIT_EXTRA_DEBUG
@@ -398,6 +470,9 @@ inline std::tuple<TypeId, BindingData> InjectorStorage::createBindingDataForProv
   using T          = RemoveAnnotations<AnnotatedT>;
   using C          = NormalizeType<T>;
   auto create = [](InjectorStorage& injector, Graph::node_iterator node_itr) {
+#if FRUIT_ENABLE_PROFILING
+    ProfiledConstruction profiled_construction(injector, getTypeId<AnnotatedC>());
+#endif
     C* cPtr = InvokeLambdaWithInjectedArgVector<AnnotatedSignature, Lambda, std::is_pointer<T>::value>()(
         injector, injector.bindings, injector.allocator, node_itr.neighborsBegin());
     node_itr.setTerminal();
@@ -421,6 +496,9 @@ inline std::tuple<TypeId, TypeId, BindingData> InjectorStorage::createBindingDat
   using C          = NormalizeType<T>;
   using I          = RemoveAnnotations<AnnotatedI>;
   auto create = [](InjectorStorage& injector, Graph::node_iterator node_itr) {
+#if FRUIT_ENABLE_PROFILING
+    ProfiledConstruction profiled_construction(injector, getTypeId<AnnotatedC>());
+#endif
     C* cPtr = InvokeLambdaWithInjectedArgVector<AnnotatedSignature, Lambda, std::is_pointer<T>::value>()(
         injector, injector.bindings, injector.allocator, node_itr.neighborsBegin());
     node_itr.setTerminal();
@@ -479,6 +557,9 @@ inline std::tuple<TypeId, BindingData> InjectorStorage::createBindingDataForCons
   using AnnotatedC = SignatureType<AnnotatedSignature>;
   using C          = RemoveAnnotations<AnnotatedC>;
   auto create = [](InjectorStorage& injector, Graph::node_iterator node_itr) {
+#if FRUIT_ENABLE_PROFILING
+    ProfiledConstruction profiled_construction(injector, getTypeId<AnnotatedC>());
+#endif
     C* cPtr = InvokeConstructorWithInjectedArgVector<AnnotatedSignature>()(injector, 
                   injector.bindings, injector.allocator, node_itr.neighborsBegin());
     node_itr.setTerminal();
@@ -494,6 +575,9 @@ inline std::tuple<TypeId, TypeId, BindingData> InjectorStorage::createBindingDat
   using C          = RemoveAnnotations<AnnotatedC>;
   using I          = RemoveAnnotations<AnnotatedI>;
   auto create = [](InjectorStorage& injector, Graph::node_iterator node_itr) {
+#if FRUIT_ENABLE_PROFILING
+    ProfiledConstruction profiled_construction(injector, getTypeId<AnnotatedC>());
+#endif
     C* cPtr = InvokeConstructorWithInjectedArgVector<AnnotatedSignature>()(injector, 
                   injector.bindings, injector.allocator, node_itr.neighborsBegin());
     node_itr.setTerminal();
@@ -537,6 +621,9 @@ inline std::tuple<TypeId, MultibindingData> InjectorStorage::createMultibindingD
   using T          = RemoveAnnotations<AnnotatedT>;
   using C          = NormalizeType<T>;
   auto create = [](InjectorStorage& injector) {
+#if FRUIT_ENABLE_PROFILING
+    ProfiledConstruction profiled_construction(injector, getTypeId<AnnotatedC>());
+#endif
     C* cPtr = InvokeLambdaWithInjectedArgVector<AnnotatedSignature, Lambda, std::is_pointer<T>::value>()(
         injector, injector.allocator);
     return reinterpret_cast<BindingData::object_t>(cPtr);
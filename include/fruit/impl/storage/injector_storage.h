@@ -18,12 +18,21 @@
 #define FRUIT_INJECTOR_STORAGE_H
 
 #include <fruit/fruit_forward_decls.h>
+#include <fruit/binding_handle.h>
+#include <fruit/injection_profile.h>
+#include <fruit/multibindings_range.h>
 #include <fruit/impl/binding_data.h>
+#include <fruit/impl/fruit-config.h>
 #include <fruit/impl/data_structures/fixed_size_allocator.h>
+#include <fruit/impl/storage/normalized_multibinding_table.h>
 #include <fruit/impl/meta/component.h>
 
+#include <cstdint>
 #include <vector>
 #include <unordered_map>
+#include <atomic>
+#include <functional>
+#include <mutex>
 
 namespace fruit {
   
@@ -106,6 +115,10 @@ public:
   static std::tuple<TypeId, MultibindingData> createMultibindingDataForProvider();
 
 private:
+  // All the memory retained by this object (except the memory of externally-allocated objects and of the vectors returned
+  // by getMultibindings()) is allocated from this MemoryResource.
+  MemoryResource& memory_resource;
+  
   // The NormalizedComponentStorage owned by this object (if any).
   // Only used for the 1-argument constructor, otherwise it's nullptr.
   std::unique_ptr<NormalizedComponentStorage> normalized_component_storage_ptr;
@@ -116,16 +129,89 @@ private:
   // For types that have a constructed object already, the corresponding node is stored as terminal node.
   SemistaticGraph<TypeId, NormalizedBindingData> bindings;
   
-  // Maps the type index of a type T to the corresponding NormalizedMultibindingData object (that stores all multibindings).
-  std::unordered_map<TypeId, NormalizedMultibindingData> multibindings;
+  // The id of the NormalizedComponentStorage whose graph `bindings' was copied from (directly or through a
+  // PreparedDeltaStorage), or 0 if this injector wasn't created from a NormalizedComponent. The nodes of that graph have the
+  // same index in `bindings', so they can be found without a lookup (see BindingHandle).
+  std::uint64_t base_normalized_component_id = 0;
+  
+  // The multibindings of the normalized component used to create this injector. These are shared with the
+  // NormalizedComponentStorage, not copied.
+  const NormalizedMultibindingTable* normalized_multibindings = nullptr;
+  
+  // The multibindings added on top of *normalized_multibindings (see NormalizedMultibindingTable). Types with multibindings
+  // here must be looked up here first.
+  NormalizedMultibindingTable multibindings;
+  
+  // The objects constructed (in this injector) for the multibindings of a type.
+  struct MultibindingObjects {
+    // An array with the objects, allocated in `allocator'. These are nullptr if the objects haven't been constructed yet.
+    void** objects_begin;
+    void** objects_end;
+    
+    // The std::vector<T*> returned by getMultibindings() (owned by `allocator'), or nullptr if it hasn't been constructed
+    // yet.
+    void* vector;
+  };
+  
+  // Element i corresponds to multibindings.getGroup(i) for i < multibindings.numGroups(), and to
+  // normalized_multibindings->getGroup(i - multibindings.numGroups()) for the following elements.
+  FixedSizeVector<MultibindingObjects> multibinding_objects;
+  
+  // The injector that this injector falls back to for the types it doesn't bind (see the constructor that takes a parent
+  // InjectorStorage), or nullptr if this is not a child injector.
+  InjectorStorage* parent = nullptr;
+  
+  // The number of child injectors of this injector that currently exist. This is atomic since child injectors of an
+  // injector in concurrent mode might be created and destroyed concurrently.
+  std::atomic<std::size_t> num_child_injectors{0};
+  
+  // Whether any object was constructed by this injector (since it was created or reset). Only used to check the
+  // preconditions of freeze().
+  bool constructed_any_object = false;
+  
+  // Only used if parent != nullptr. For each node of `bindings' (see Graph::nodeIndex()) that forwards to a node of
+  // parent->bindings whose object wasn't constructed yet when this injector was created, this stores that node. The other
+  // elements are parent->bindings.end().
+  FixedSizeVector<Graph::node_iterator> parent_nodes;
+  
+  // If `bindings' was constructed as a copy of the graph in a PreparedDeltaStorage (with no additional nodes), this points to
+  // that PreparedDeltaStorage. Otherwise this is nullptr. See resetInPlace().
+  const PreparedDeltaStorage* copied_prepared_delta = nullptr;
+  
+  // Only used in concurrent mode (see enableConcurrentInjection()), otherwise this is nullptr.
+  // For each node of `bindings' (see Graph::nodeIndex()) this stores the constructed object, or nullptr if the object hasn't
+  // been constructed yet (or if it was constructed before entering concurrent mode, and then not requested since).
+  // Reading these doesn't require any lock, so once an object is constructed it can be retrieved by multiple threads
+  // concurrently without contention.
+  // This array has bindings.numNodes() elements, and it's allocated from memory_resource.
+  std::atomic<void*>* concurrent_objects = nullptr;
+  
+  // Only used after freeze(), otherwise this is nullptr. The objects of the exposed types passed to freeze(), allocated from
+  // *frozen_objects_memory_resource. This is never modified after freeze() returns.
+  void** frozen_objects = nullptr;
+  std::size_t num_frozen_objects = 0;
+  MemoryResource* frozen_objects_memory_resource = nullptr;
+  
+  // Only used in concurrent mode. This is held while constructing objects (and while accessing the graph or the
+  // multibindings), so that at most 1 thread at a time modifies them. This is recursive since constructing an object
+  // requires getting its dependencies first.
+  std::recursive_mutex concurrent_injection_mutex;
+  
+  // The objects constructed so far, if profiling is enabled (see InjectionProfile). This is nullptr until
+  // enableProfiling() is called.
+  std::unique_ptr<InjectionProfile> profile;
+  
+  // The profile where constructions are recorded: profile.get(), or nullptr while constructions are not recorded. This is
+  // also nullptr while objects are constructed by multiple threads at once (see eagerlyInjectAllInParallel()), since then
+  // they don't form a single construction stack.
+  InjectionProfile* active_profile = nullptr;
   
 private:
   
   template <typename AnnotatedC>
-  static std::shared_ptr<char> createMultibindingVector(InjectorStorage& storage);
-  
-  // If not bound, returns nullptr.
-  NormalizedMultibindingData* getNormalizedMultibindingData(TypeId type);
+  static void* createMultibindingVector(InjectorStorage& storage,
+                                       const MultibindingData::object_t* objects_begin,
+                                       const MultibindingData::object_t* objects_end);
   
   // Looks up the location where the type is (or will be) stored, but does not construct the class.
   template <typename AnnotatedC>
@@ -138,6 +224,9 @@ private:
   // Similar to the previous, but takes a node_iterator. Use this when the node_iterator is known, it's faster.
   void* getPtrInternal(Graph::node_iterator itr);
   
+  // The slow path of getPtrInternal() in concurrent mode, when the object for `itr' isn't in concurrent_objects yet.
+  void* getPtrInternalConcurrent(Graph::node_iterator itr);
+  
   // getPtr(typeInfo) is equivalent to getPtr(lazyGetPtr(typeInfo)).
   Graph::node_iterator lazyGetPtr(TypeId type);
   
@@ -147,20 +236,90 @@ private:
   // Similar to getPtr, but the binding might not exist. Returns nullptr if it doesn't.
   void* unsafeGetPtr(TypeId type);
   
-  void* getPtrForMultibinding(TypeId type);
+  // Similar to unsafeGetPtr(getTypeId<AnnotatedC>()), but if this injector was created from the NormalizedComponentStorage
+  // of `handle' the node is the one at handle.node_index, so it's not looked up.
+  template <typename AnnotatedC>
+  void* unsafeGetPtr(const BindingHandle<AnnotatedC>& handle);
   
   // Returns a std::vector<T*>*, or nullptr if there are no multibindings.
   void* getMultibindings(TypeId type);
   
-  // Constructs any necessary instances, but NOT the instance set.
-  void ensureConstructedMultibinding(NormalizedMultibindingData& multibinding_data);
+  // Returns the objects for the multibindings of `type' as a range of (casted) T* pointers, constructing them if needed.
+  // Returns an empty range if there are no multibindings.
+  std::pair<void* const*, void* const*> getMultibindingsRange(TypeId type);
+  
+  // Returns the index of the element of multibinding_objects for `type', or multibinding_objects.size() if there are no
+  // multibindings for `type'.
+  std::size_t findMultibindings(TypeId type) const;
+  
+  // Returns the number of multibindings for `type' in this injector, including the ones inherited from `parent' (if any).
+  std::size_t numMultibindings(TypeId type) const;
+  
+  // The create operation of the nodes of a child injector that forward to a node of the parent injector (see parent_nodes).
+  static BindingData::object_t createFromParent(InjectorStorage& storage, Graph::node_iterator node_itr);
+  
+  // Used when constructing a child injector whose component also binds `type', that's bound in this injector (at
+  // `node_itr'). Reports a fatal error unless `binding_data' is the same binding.
+  void checkSameBindingAsParent(TypeId type, Graph::node_iterator node_itr, const BindingData& binding_data);
+  
+  // Returns the NormalizedMultibindingData for multibinding_objects[i].
+  const NormalizedMultibindingData& getNormalizedMultibindingData(std::size_t i) const;
+  
+  // Constructs the objects in multibinding_objects[i] if they haven't been constructed yet.
+  // In concurrent mode, the caller must hold concurrent_injection_mutex.
+  MultibindingObjects& ensureConstructedMultibindings(std::size_t i);
+  
+  // Sets multibinding_objects to a vector with an (empty) element for each group of `multibindings' and
+  // *normalized_multibindings.
+  void initMultibindingObjects();
+  
+  // Implementation of the constructor that takes a PreparedDeltaStorage. This assumes that the fields of this object are
+  // empty (or only contain data that can be discarded).
+  void initFromPreparedDelta(const PreparedDeltaStorage& prepared_delta,
+                             const ComponentStorage& component,
+                             std::vector<TypeId>&& exposed_types);
+  
+  // Returns the nodes reachable from the specified roots (in the dependency graph) that haven't been constructed yet, split
+  // in layers: element i contains the nodes that only depend on nodes in the previous elements (or on nodes that are
+  // already constructed). The nodes of a child injector that forward to the parent are resolved here.
+  std::vector<std::vector<Graph::node_iterator>> getNodesByLayer(const Graph::node_iterator* roots_begin,
+                                                                 const Graph::node_iterator* roots_end);
+  
+  // Deallocates concurrent_objects (if allocated) and sets it to nullptr. This must be called before changing `bindings'.
+  void releaseConcurrentObjects();
+  
+  // Replaces the objects of the instance bindings copied from `prepared_delta' with the ones in `component'.
+  // `component' is the result of ComponentStorage::flatten().
+  // Precondition: prepared_delta.matches(component).
+  void patchInstances(const PreparedDeltaStorage& prepared_delta, const BindingSegment& component);
+  
+  // Normalizes the bindings in `component' and merges them into `bindings' and `fixed_size_allocator_data'.
+  // `fixed_size_allocator_data' must initially contain the allocator data of `normalized_component'; `bindings' is
+  // overwritten with a graph that shares data with the one in `normalized_component' (the rest is allocated from
+  // `memory_resource'). `multibindings' is overwritten with a table containing the multibindings in `component', that
+  // can be used as an overlay on top of the multibindings of `normalized_component'.
+  // If `undone_binding_compressions' is not nullptr, the types whose binding compression (in `normalized_component') had
+  // to be undone are appended to it.
+  static void mergeBindings(const NormalizedComponentStorage& normalized_component,
+                            const ComponentStorage& component,
+                            std::vector<TypeId>&& exposed_types,
+                            Graph& bindings,
+                            NormalizedMultibindingTable& multibindings,
+                            FixedSizeAllocator::FixedSizeAllocatorData& fixed_size_allocator_data,
+                            MemoryResource& memory_resource,
+                            std::vector<TypeId>* undone_binding_compressions = nullptr);
   
   template <typename T>
   friend struct GetHelper;
   
+  friend struct NodeObjectAccessor;
+  
   template <typename T>
   friend class fruit::Provider;
   
+  friend class PreparedDeltaStorage;
+  friend class NormalizedComponentStorage;
+  
 public:
   
   // Wraps a std::vector<std::pair<TypeId, BindingData>>::iterator as an iterator on tuples
@@ -184,14 +343,44 @@ public:
     const TypeId* getEdgesEnd();
   };
   
-  InjectorStorage(const ComponentStorage& storage, const std::vector<TypeId>& exposed_types);
+  // In all constructors, `memory_resource' must remain valid until this object has been destroyed.
+  
+  InjectorStorage(const ComponentStorage& storage,
+                  const std::vector<TypeId>& exposed_types,
+                  MemoryResource& memory_resource);
   
   InjectorStorage(const NormalizedComponentStorage& normalized_storage, 
                   const ComponentStorage& storage,
-                  std::vector<TypeId>&& exposed_types);
+                  std::vector<TypeId>&& exposed_types,
+                  MemoryResource& memory_resource);
+  
+  // Creates an injector with exactly the bindings in `normalized_storage'. No binding normalization is performed, the
+  // binding graph is just copied.
+  InjectorStorage(const NormalizedComponentStorage& normalized_storage, MemoryResource& memory_resource);
+  
+  // Equivalent to InjectorStorage(normalized_storage, storage, exposed_types), where normalized_storage is the one used to
+  // construct `prepared_delta'. If `storage' has the same shape as the prototype component of `prepared_delta' (see
+  // PreparedDeltaStorage), no binding normalization is performed: the pre-merged bindings are copied and only the objects
+  // of instance bindings are replaced.
+  InjectorStorage(const PreparedDeltaStorage& prepared_delta,
+                  const ComponentStorage& storage,
+                  std::vector<TypeId>&& exposed_types,
+                  MemoryResource& memory_resource);
+  
+  // Creates a child injector of `parent', with the bindings in `storage'. The types that are bound in `parent' are never
+  // bound again here: getting them (directly or as dependencies of the bindings in `storage') returns the objects of
+  // `parent', constructing them in `parent' if needed. So only the bindings in `storage' are normalized, and this injector
+  // only stores nodes for those bindings and for the types of `parent' that they depend on.
+  // The multibindings of a type in this injector are the ones in `parent' followed by the ones in `storage'.
+  // `parent' must remain valid (and must not be reset) until this object has been destroyed. If `parent' can be used by
+  // multiple threads at the same time (including through child injectors), it must be in concurrent mode.
+  InjectorStorage(InjectorStorage& parent,
+                  const ComponentStorage& storage,
+                  std::vector<TypeId>&& exposed_types,
+                  MemoryResource& memory_resource);
   
-  // This is just the default destructor, but we declare it here to avoid including
-  // normalized_component_storage.h in fruit.h.
+  // We declare this here (instead of using the default destructor) to avoid including normalized_component_storage.h in
+  // fruit.h.
   ~InjectorStorage();
   
   InjectorStorage(InjectorStorage&&) = delete;
@@ -209,6 +398,10 @@ public:
   // Note that T should *not* be annotated.
   template <typename T>
   T get(InjectorStorage::Graph::node_iterator node_iterator);
+  
+  // Returns the node_iterator for a type exposed by the injector (so it's always in the graph), to be used with the
+  // get() above. The result is invalidated by reset(), but not by resetInPlace() (that doesn't move the nodes).
+  Graph::node_iterator getExposedNode(TypeId type);
    
   // Looks up the location where the type is (or will be) stored, but does not construct the class.
   // get<AnnotatedT>() is equivalent to get<AnnotatedT>(lazyGetPtr<Apply<NormalizeType, AnnotatedT>>(deps, dep_index))
@@ -221,10 +414,91 @@ public:
   template <typename AnnotatedC>
   RemoveAnnotations<AnnotatedC>* unsafeGet();
   
+  // Same as get<AnnotatedC*>() and unsafeGet<AnnotatedC>(), but using a handle (see BindingHandle).
+  // getWithHandle() reports a fatal error if AnnotatedC was not bound.
+  template <typename AnnotatedC>
+  RemoveAnnotations<AnnotatedC>* getWithHandle(const BindingHandle<AnnotatedC>& handle);
+  template <typename AnnotatedC>
+  RemoveAnnotations<AnnotatedC>* unsafeGetWithHandle(const BindingHandle<AnnotatedC>& handle);
+  
   template <typename AnnotatedC>
   const std::vector<RemoveAnnotations<AnnotatedC>*>& getMultibindings();
   
+  // Similar to getMultibindings(), but this doesn't allocate memory.
+  template <typename AnnotatedC>
+  MultibindingsRange<RemoveAnnotations<AnnotatedC>> getMultibindingsRange();
+  
   void eagerlyInjectMultibindings();
+  
+  // Constructs all the objects reachable (in the dependency graph) from the specified types, then all the multibindings.
+  // `schedule' is called with tasks that can be run concurrently; the nodes are split in layers (where each node only
+  // depends on nodes in previous layers) and all tasks of a layer must complete before the tasks of the next layer are
+  // scheduled.
+  // In concurrent mode this holds concurrent_injection_mutex until it returns, so other threads can keep getting objects
+  // (and wait if they need to construct one). Otherwise it must not be called concurrently with any other method.
+  // The objects constructed by the tasks are not recorded in the profile (see active_profile).
+  void eagerlyInjectAllInParallel(const std::vector<TypeId>& types,
+                                  const std::function<void(std::function<void()>)>& schedule);
+  
+  // Constructs all the objects reachable (in the dependency graph) from the specified nodes, including the ones that are
+  // only injected through a Provider, and all the multibindings. Then releases the data that's only needed to construct
+  // objects (the edges of the graph, and the data for concurrent mode and for forwarding to a parent injector).
+  // Returns an array with the objects of the specified nodes (in the same order), allocated from `objects_memory_resource'
+  // and deallocated by the destructor. The array is never written after this returns.
+  // After this, the only supported methods are get() for these nodes and Provider::get() for the Providers obtained from
+  // this injector (including the ones injected in the constructed objects). Those never modify this object, so they can be
+  // called concurrently without locking.
+  // This must be called at most once, not concurrently with other methods, and only if there are no child injectors of this
+  // injector and no object has been constructed yet (the neighbors of terminal nodes aren't known, so the nodes only
+  // reachable through them wouldn't be constructed here). The last two conditions are checked, reporting a fatal error.
+  void* const* freeze(const Graph::node_iterator* exposed_nodes_begin,
+                      const Graph::node_iterator* exposed_nodes_end,
+                      MemoryResource& objects_memory_resource);
+  
+  // Destroys all the objects constructed so far, and then makes this injector equivalent to a newly-constructed
+  // InjectorStorage(prepared_delta, component, exposed_types), reusing the memory already allocated by this object instead
+  // of allocating new memory.
+  // This is only possible if this object was constructed (or last reset) from the same `prepared_delta' and `component'
+  // has the same shape as its prototype component; otherwise this returns false and doesn't modify this object.
+  // Concurrent mode (if enabled) stays enabled. This must not be called concurrently with other methods.
+  bool resetInPlace(const PreparedDeltaStorage& prepared_delta, const ComponentStorage& component);
+  
+  // Similar to resetInPlace(), but this always succeeds: the data structures of this object are rebuilt from scratch.
+  void reset(const PreparedDeltaStorage& prepared_delta,
+             const ComponentStorage& component,
+             std::vector<TypeId>&& exposed_types);
+  
+  // Starts recording the constructions of objects (see InjectionProfile). This has no effect unless FRUIT_ENABLE_PROFILING
+  // is set. This must not be called concurrently with the construction of objects.
+  void enableProfiling();
+  
+  // Returns the constructions recorded so far (see InjectionProfile). This must not be called concurrently with the
+  // construction of objects.
+  const InjectionProfile& getProfile() const;
+  
+#if FRUIT_ENABLE_PROFILING
+  // While an object of this class exists, the construction of an object of type `type' is recorded in the profile of
+  // `injector' (if profiling is enabled). This is only used in the create functions generated when Fruit is configured with
+  // FRUIT_ENABLE_PROFILING; otherwise they contain no profiling code at all.
+  class ProfiledConstruction {
+  public:
+    ProfiledConstruction(InjectorStorage& injector, TypeId type);
+    ~ProfiledConstruction();
+    
+    ProfiledConstruction(const ProfiledConstruction&) = delete;
+    ProfiledConstruction& operator=(const ProfiledConstruction&) = delete;
+    
+  private:
+    // nullptr if this construction is not being recorded.
+    InjectionProfile* profile;
+    const FixedSizeAllocator& allocator;
+  };
+#endif // FRUIT_ENABLE_PROFILING
+  
+  // Switches this injector to concurrent mode: after this returns, all methods above (except the constructors and the
+  // destructor) can be called concurrently, from multiple threads, on the same InjectorStorage.
+  // This must not be called concurrently with other methods (or with itself).
+  void enableConcurrentInjection();
 };
 
 } // namespace impl
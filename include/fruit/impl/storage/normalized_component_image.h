@@ -0,0 +1,163 @@
+/*
+ * Copyright 2014 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef FRUIT_NORMALIZED_COMPONENT_IMAGE_H
+#define FRUIT_NORMALIZED_COMPONENT_IMAGE_H
+
+#ifndef IN_FRUIT_CPP_FILE
+// We don't want to include it in public headers to save some compile time.
+#error "normalized_component_image.h included in non-cpp file."
+#endif
+
+#include <fruit/impl/binding_data.h>
+#include <fruit/impl/util/hash_helpers.h>
+#include <fruit/impl/fruit_internal_forward_decls.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace fruit {
+namespace impl {
+
+/**
+ * Writes the data of a normalized component as a sequence of 64-bit words.
+ * 
+ * The pointers stored in a normalized component (TypeInfo objects, create operations, bound objects, etc.) are different in
+ * each process, so they're not written as-is. Instead, each pointer is written as its index in the "pointer dictionary": the
+ * list of all pointers in the ComponentStorage that was normalized, in a fixed order (see NormalizedComponentImage). The
+ * dictionary is computed again when the image is read, so that the indexes can be mapped back to pointers.
+ */
+class ImageWriter {
+private:
+  // Maps each pointer in the dictionary to its index (the first one, if it's in the dictionary multiple times), plus 1.
+  HashMap<const void*, std::size_t> pointer_indexes;
+  
+  std::vector<std::uint64_t> words;
+  
+  bool failed = false;
+  
+public:
+  explicit ImageWriter(const std::vector<const void*>& dictionary);
+  
+  void writeWord(std::uint64_t x);
+  
+  // Writes 0 for nullptr. If `p' is not in the dictionary the image can't be written, and hasFailed() will return true.
+  void writePointer(const void* p);
+  
+  void write(TypeId x);
+  void write(std::size_t x);
+  void write(SemistaticGraphInternalNodeId x);
+  void write(NormalizedBindingData x);
+  void write(BindingData x);
+  
+  bool hasFailed() const;
+  
+  const std::vector<std::uint64_t>& getWords() const;
+};
+
+/**
+ * Reads the words written by an ImageWriter, mapping the indexes back to the pointers in the dictionary.
+ * 
+ * The image is not trusted: reading past its end or reading an invalid index doesn't yield undefined behavior, it just
+ * makes hasFailed() return true (and dummy values are returned from then on). Callers are also expected to call fail()
+ * when they read an invalid value (e.g. a size, index or offset in another array that is out of range), before using it,
+ * so that the data structures loaded from an image never access memory out of bounds.
+ */
+class ImageReader {
+private:
+  // The image might not be aligned, so words are read with memcpy().
+  const char* next;
+  std::size_t num_remaining_words;
+  
+  const std::vector<const void*>& dictionary;
+  
+  bool failed = false;
+  
+public:
+  ImageReader(const char* words_begin, std::size_t num_words, const std::vector<const void*>& dictionary);
+  
+  std::uint64_t readWord();
+  
+  // Reads a number of elements n, where each element takes at least `words_per_elem' words. If there are less than
+  // n*words_per_elem words left in the image, this fails and returns 0 (so that the caller doesn't allocate too much memory).
+  std::size_t readSize(std::size_t words_per_elem);
+  
+  const void* readPointer();
+  
+  void read(TypeId& x);
+  void read(std::size_t& x);
+  void read(SemistaticGraphInternalNodeId& x);
+  void read(NormalizedBindingData& x);
+  void read(BindingData& x);
+  
+  void fail();
+  
+  bool hasFailed() const;
+  
+  bool atEnd() const;
+};
+
+/**
+ * Saves a NormalizedComponentStorage to a binary image and loads it back, so that the bindings don't need to be normalized
+ * again when the same component is used in another process (e.g. in the next run of the same binary).
+ * 
+ * The image doesn't contain any pointer, so it can be stored in a file and loaded with mmap(). Loading an image is a linear
+ * copy of its contents, plus a linear check of the hash functions of the SemistaticMaps (that are re-computed if the TypeInfo
+ * addresses changed, e.g. due to ASLR).
+ * 
+ * An image is only loaded if it was written by a binary with the same build fingerprint (a string provided by the user),
+ * and from a component with the same shape (same number of bindings, for the same types in the same order, with the same
+ * number of dependencies, with the same pointers being equal and the other pointers being distinct, etc.). Otherwise, the
+ * component is normalized as usual.
+ * 
+ * All the sizes, indexes and offsets in an image are checked when loading it, so a truncated or corrupted image never causes
+ * out-of-bounds accesses. However the image still decides which pointer of the component is used for each binding (among
+ * the ones in the dictionary) and how much memory is reserved for the objects, so images must only be loaded from trusted
+ * sources (e.g. files written by the same binary).
+ */
+class NormalizedComponentImage {
+private:
+  // Fills `dictionary' with the pointers in `component' and `exposed_types', in a fixed order. This also computes a hash of
+  // the shape of the component.
+  static void buildDictionary(const ComponentStorage& component,
+                              const std::vector<TypeId>& exposed_types,
+                              std::vector<const void*>& dictionary,
+                              std::uint64_t& shape_hash);
+  
+public:
+  // Returns the image, or an empty string if `storage' contains a pointer that's not in `component' (this can happen if
+  // `component' is not the one that was normalized into `storage') or if `storage' extends another normalized component.
+  static std::string write(const NormalizedComponentStorage& storage,
+                           const ComponentStorage& component,
+                           const std::vector<TypeId>& exposed_types,
+                           const std::string& build_fingerprint);
+  
+  // Loads the image into `storage', that must have been constructed but not normalized yet. Returns false (without modifying
+  // `storage') if the image can't be loaded.
+  static bool read(NormalizedComponentStorage& storage,
+                   const ComponentStorage& component,
+                   const std::vector<TypeId>& exposed_types,
+                   const void* image,
+                   std::size_t image_size,
+                   const std::string& build_fingerprint);
+};
+
+} // namespace impl
+} // namespace fruit
+
+#endif // FRUIT_NORMALIZED_COMPONENT_IMAGE_H
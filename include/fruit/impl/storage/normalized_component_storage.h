@@ -30,7 +30,9 @@
 #include <fruit/impl/storage/injector_storage.h>
 #include <fruit/impl/binding_normalization.h>
 
+#include <cstdint>
 #include <memory>
+#include <string>
 #include <unordered_map>
 
 namespace fruit {
@@ -46,12 +48,20 @@ public:
   using Graph = InjectorStorage::Graph;
   
 private:
+  // The MemoryResource used to allocate `bindings' and `multibindings'.
+  MemoryResource& memory_resource;
+  
+  // An id that identifies this object among all the NormalizedComponentStorage objects created by this process. Unlike the
+  // address of this object, it's never reused after this object is destroyed, so it can be used to check whether a
+  // BindingHandle was obtained from this object.
+  const std::uint64_t id;
+  
   // A graph with types as nodes (each node stores the BindingData for the type) and dependencies as edges.
   // For types that have a constructed object already, the corresponding node is stored as terminal node.
   SemistaticGraph<TypeId, NormalizedBindingData> bindings;
   
-  // Maps the type index of a type T to a set of the corresponding BindingData objects (for multibindings).
-  std::unordered_map<TypeId, NormalizedMultibindingData> multibindings;
+  // The multibindings of the component. Injectors created from this object use this table directly instead of copying it.
+  NormalizedMultibindingTable multibindings;
   
   // Contains data on the set of types that can be allocated using this component.
   FixedSizeAllocator::FixedSizeAllocatorData fixed_size_allocator_data;
@@ -59,14 +69,66 @@ private:
   // Stores information on binding compression that was performed in bindings of this object.
   // See also the documentation for BindingCompressionInfoMap.
   // We hold this via a unique_ptr to avoid including Boost's hashmap implementation.
+  // This is nullptr in a normalized component created by extending another one: extending doesn't compress bindings, and
+  // the map of the first component of the chain is shared instead (see findBindingCompression()).
   std::unique_ptr<BindingNormalization::BindingCompressionInfoMap> bindingCompressionInfoMap;
   
+  // The bindingCompressionInfoMap of this object, or of the first component of the chain of `base's.
+  const BindingNormalization::BindingCompressionInfoMap* shared_binding_compressions;
+  
+  // The types in *shared_binding_compressions whose binding compression was undone by this object or by its bases.
+  // This is usually very small.
+  std::vector<TypeId> undone_binding_compressions;
+  
+  // Whether the fields above were loaded from an image instead of normalizing a component.
+  bool loaded_from_image = false;
+  
+  // If this object was created by extending another NormalizedComponentStorage, this points to it (`bindings' shares data
+  // with the bindings of `base'). Otherwise this is nullptr.
+  const NormalizedComponentStorage* base = nullptr;
+  
+  // The maximum number of node IDs that a lookup in `bindings' may have to compare, in a normalized component created by
+  // extending another one, before the index of the graph is rebuilt with a perfect hash function.
+  static constexpr std::size_t max_bucket_size_before_rehash = 4;
+  
   friend class InjectorStorage;
+  friend class PreparedDeltaStorage;
+  friend class NormalizedComponentImage;
+  friend class NormalizedComponentStorageHolder;
+  
+  // Normalizes `component' into the fields above.
+  void normalize(const ComponentStorage& component, const std::vector<TypeId>& exposed_types);
+  
+  // Returns the binding compression performed for the type `c_type_id' in the bindings of this object, or nullptr if there
+  // is none (or if it was undone).
+  const BindingNormalization::BindingCompressionInfo* findBindingCompression(TypeId c_type_id) const;
   
 public:
   NormalizedComponentStorage() = delete;
   
-  NormalizedComponentStorage(const ComponentStorage& component, const std::vector<TypeId>& exposed_types);
+  // `memory_resource' must remain valid until this object has been destroyed.
+  NormalizedComponentStorage(const ComponentStorage& component,
+                             const std::vector<TypeId>& exposed_types,
+                             MemoryResource& memory_resource);
+  
+  // Loads the normalized bindings from an image previously written by NormalizedComponentImage::write() for `component' and
+  // `exposed_types'. If the image can't be used (e.g. it's from a different build), `component' is normalized instead.
+  NormalizedComponentStorage(const ComponentStorage& component,
+                             const std::vector<TypeId>& exposed_types,
+                             const void* image,
+                             std::size_t image_size,
+                             const std::string& build_fingerprint,
+                             MemoryResource& memory_resource);
+
+  // Creates a normalized component with the bindings of `normalized_component' and the ones in `component'. Only the
+  // bindings in `component' are normalized; the bindings of `normalized_component' are shared (the pages of nodes are
+  // copied on write, the edges and the binding compressions are not copied), so `normalized_component' must remain valid
+  // until this object has been destroyed. The multibindings are merged into a single table, so that injectors created from
+  // this object can use it as their base table, but the multibindings of `normalized_component' are not copied.
+  NormalizedComponentStorage(const NormalizedComponentStorage& normalized_component,
+                             const ComponentStorage& component,
+                             std::vector<TypeId>&& exposed_types,
+                             MemoryResource& memory_resource);
 
   NormalizedComponentStorage(NormalizedComponentStorage&&) = delete;
   NormalizedComponentStorage(const NormalizedComponentStorage&) = delete;
@@ -77,6 +139,16 @@ public:
   // We don't use the default destructor because that will require the inclusion of
   // the Boost's hashmap header. We define this in the cpp file instead.
   ~NormalizedComponentStorage();
+  
+  // Returns true if this object was loaded from an image (instead of normalizing the component).
+  bool isLoadedFromImage() const;
+  
+  // Returns true if this object was created by extending another NormalizedComponentStorage.
+  bool isExtension() const;
+  
+  // Returns the index of the node of `type' in `bindings' (see SemistaticGraph::nodeIndex()). Injectors created from this
+  // object have the node of `type' at the same index. `type' must be one of the exposed types.
+  std::size_t getNodeIndex(TypeId type);
 };
 
 } // namespace impl
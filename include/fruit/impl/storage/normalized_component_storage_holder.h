@@ -17,7 +17,9 @@
 #ifndef FRUIT_NORMALIZED_COMPONENT_STORAGE_HOLDER_H
 #define FRUIT_NORMALIZED_COMPONENT_STORAGE_HOLDER_H
 
+#include <cstdint>
 #include <memory>
+#include <string>
 #include <fruit/impl/fruit_internal_forward_decls.h>
 #include <fruit/fruit_forward_decls.h>
 
@@ -34,15 +36,40 @@ private:
   std::unique_ptr<NormalizedComponentStorage> storage;
   
   friend class InjectorStorage;
+  friend class PreparedDeltaStorageHolder;
   
   template <typename... P>
   friend class fruit::Injector;
   
+  template <typename... P>
+  friend class fruit::NormalizedComponent;
+  
 public:
   NormalizedComponentStorageHolder() = delete;
   
-  NormalizedComponentStorageHolder(const ComponentStorage& component, const std::vector<TypeId>& exposed_types);
+  NormalizedComponentStorageHolder(const ComponentStorage& component,
+                                   const std::vector<TypeId>& exposed_types,
+                                   MemoryResource& memory_resource);
+  
+  // Loads the normalized component from an image, see NormalizedComponentStorage.
+  NormalizedComponentStorageHolder(const ComponentStorage& component,
+                                   const std::vector<TypeId>& exposed_types,
+                                   const void* image,
+                                   std::size_t image_size,
+                                   const std::string& build_fingerprint,
+                                   MemoryResource& memory_resource);
 
+  // Extends the normalized component in `normalized_component' with the bindings in `component', see
+  // NormalizedComponentStorage.
+  NormalizedComponentStorageHolder(const NormalizedComponentStorageHolder& normalized_component,
+                                   const ComponentStorage& component,
+                                   std::vector<TypeId>&& exposed_types,
+                                   MemoryResource& memory_resource);
+
+  // Used when returning a NormalizedComponent from NormalizedComponent::extend(). This is defined in the cpp file, to avoid
+  // including normalized_component_storage.h.
+  NormalizedComponentStorageHolder(NormalizedComponentStorageHolder&&);
+  
   NormalizedComponentStorageHolder(NormalizedComponentStorage&&) = delete;
   NormalizedComponentStorageHolder(const NormalizedComponentStorage&) = delete;
   
@@ -52,6 +79,19 @@ public:
   // We don't use the default destructor because that would require the inclusion of
   // normalized_component_storage.h. We define this in the cpp file instead.
   ~NormalizedComponentStorageHolder();
+  
+  // See NormalizedComponentImage::write().
+  std::string writeImage(const ComponentStorage& component,
+                         const std::vector<TypeId>& exposed_types,
+                         const std::string& build_fingerprint) const;
+  
+  bool isLoadedFromImage() const;
+  
+  // See NormalizedComponentStorage::getNodeIndex().
+  std::size_t getNodeIndex(TypeId type) const;
+  
+  // Returns the id of the NormalizedComponentStorage (see BindingHandle).
+  std::uint64_t getId() const;
 };
 
 } // namespace impl
@@ -0,0 +1,52 @@
+/*
+ * Copyright 2014 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FRUIT_NORMALIZED_MULTIBINDING_TABLE_DEFN_H
+#define FRUIT_NORMALIZED_MULTIBINDING_TABLE_DEFN_H
+
+#include <fruit/impl/fruit_assert.h>
+
+// Redundant, but makes KDevelop happy.
+#include <fruit/impl/storage/normalized_multibinding_table.h>
+
+namespace fruit {
+namespace impl {
+
+inline std::size_t NormalizedMultibindingTable::numGroups() const {
+  return groups.size();
+}
+
+inline std::size_t NormalizedMultibindingTable::find(TypeId type) const {
+  if (groups.size() == 0) {
+    // `index' is not valid in this case.
+    return 0;
+  }
+  const std::size_t* i = index.find(type);
+  if (i == nullptr) {
+    return groups.size();
+  }
+  return *i;
+}
+
+inline const NormalizedMultibindingData& NormalizedMultibindingTable::getGroup(std::size_t i) const {
+  FruitAssert(i < groups.size());
+  return groups[i];
+}
+
+} // namespace impl
+} // namespace fruit
+
+#endif // FRUIT_NORMALIZED_MULTIBINDING_TABLE_DEFN_H
@@ -0,0 +1,122 @@
+/*
+ * Copyright 2014 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FRUIT_NORMALIZED_MULTIBINDING_TABLE_H
+#define FRUIT_NORMALIZED_MULTIBINDING_TABLE_H
+
+#include <fruit/impl/binding_data.h>
+#include <fruit/impl/data_structures/fixed_size_allocator.h>
+#include <fruit/impl/data_structures/fixed_size_vector.h>
+#include <fruit/impl/data_structures/semistatic_map.h>
+
+#include <vector>
+
+namespace fruit {
+namespace impl {
+
+/**
+ * Stores the normalized multibindings for a set of types in flat arrays: a NormalizedMultibindingData object per type
+ * (indexed by a perfect-hashing SemistaticMap) and a single array with the elems of all types.
+ * 
+ * A table is immutable once constructed (except for patching the objects of instance multibindings, see
+ * PreparedDeltaStorage), so a table can be shared by many injectors. Each injector keeps the multibinding vectors it
+ * constructs separately (see InjectorStorage).
+ * 
+ * A table can also be used as an overlay on top of a "base" table (e.g. the multibindings of a component on top of the ones
+ * of a normalized component): a type that has multibindings in both tables has all its multibindings in the overlay, so
+ * types should first be looked up in the overlay and then in the base table.
+ */
+class NormalizedMultibindingTable {
+public:
+  using Elem = NormalizedMultibindingData::Elem;
+  
+private:
+  // Maps each type to the index of its NormalizedMultibindingData in `groups'.
+  // This is only valid if `groups' is not empty.
+  SemistaticMap<TypeId, std::size_t> index;
+  
+  FixedSizeVector<NormalizedMultibindingData> groups;
+  
+  // The elems of each element of `groups' are a contiguous range of this vector.
+  FixedSizeVector<Elem> elems;
+  
+  friend class InjectorStorage;
+  friend class PreparedDeltaStorage;
+  
+public:
+  // Constructs an empty table.
+  NormalizedMultibindingTable() = default;
+  
+  // Creates a table with the multibindings in `multibindings'. The multibindings for each type keep the order they have in
+  // `multibindings'.
+  // If `base' is not nullptr, for each type that also has multibindings in `base' the elems in `base' are added first, so
+  // that this table can be used as an overlay on top of `base'.
+  // The types of the objects that will be constructed for the new multibindings (and of the multibinding vectors) are added
+  // to `fixed_size_allocator_data'.
+  NormalizedMultibindingTable(const std::vector<std::pair<TypeId, MultibindingData>>& multibindings,
+                              const NormalizedMultibindingTable* base,
+                              FixedSizeAllocator::FixedSizeAllocatorData& fixed_size_allocator_data,
+                              MemoryResource& memory_resource);
+  
+  // Creates a copy of `x', allocated from `memory_resource'. The groups and elems are copied, but the index is shared with
+  // `x', so `x' must be destroyed after this object.
+  NormalizedMultibindingTable(const NormalizedMultibindingTable& x, MemoryResource& memory_resource);
+  
+  // Creates a table with all the multibindings of `overlay' (that must have been constructed as an overlay on top of
+  // `base') and the ones of `base' for types that don't have multibindings in `overlay'. The groups and the elems of
+  // `overlay' are copied, but the groups for the other types refer to the elems of `base', so `base' must be destroyed
+  // after this object.
+  NormalizedMultibindingTable(const NormalizedMultibindingTable& overlay,
+                              const NormalizedMultibindingTable& base,
+                              MemoryResource& memory_resource);
+  
+  NormalizedMultibindingTable(NormalizedMultibindingTable&&) = default;
+  NormalizedMultibindingTable(const NormalizedMultibindingTable&) = delete;
+  
+  NormalizedMultibindingTable& operator=(NormalizedMultibindingTable&&) = default;
+  NormalizedMultibindingTable& operator=(const NormalizedMultibindingTable&) = delete;
+  
+  ~NormalizedMultibindingTable();
+  
+  // The number of types in this table.
+  std::size_t numGroups() const;
+  
+  // Returns the index of the NormalizedMultibindingData for `type', or numGroups() if there are no multibindings for
+  // `type' in this table.
+  std::size_t find(TypeId type) const;
+  
+  // Precondition: i < numGroups().
+  const NormalizedMultibindingData& getGroup(std::size_t i) const;
+  
+  // Restores the elems of this table to the ones in `x', without allocating memory.
+  // Precondition: this table must be a copy of `x' (possibly with different objects in the elems), and `x' must not be a
+  // merge of two tables.
+  void resetElems(const NormalizedMultibindingTable& x);
+  
+  // Writes this table to `writer' (see NormalizedComponentImage).
+  // This table must not be an overlay, a copy of another table or a merge of two tables.
+  void writeImage(ImageWriter& writer) const;
+  
+  // Replaces the contents of this table with the ones written by writeImage().
+  void readImage(ImageReader& reader, MemoryResource& memory_resource);
+};
+
+} // namespace impl
+} // namespace fruit
+
+#include <fruit/impl/storage/normalized_multibinding_table.defn.h>
+
+#endif // FRUIT_NORMALIZED_MULTIBINDING_TABLE_H
@@ -0,0 +1,103 @@
+/*
+ * Copyright 2014 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef FRUIT_PREPARED_DELTA_STORAGE_H
+#define FRUIT_PREPARED_DELTA_STORAGE_H
+
+#ifndef IN_FRUIT_CPP_FILE
+// We don't want to include it in public headers to save some compile time.
+#error "prepared_delta_storage.h included in non-cpp file."
+#endif
+
+#include <fruit/impl/util/type_info.h>
+#include <fruit/impl/binding_data.h>
+#include <fruit/impl/data_structures/semistatic_graph.h>
+#include <fruit/impl/fruit_internal_forward_decls.h>
+#include <fruit/impl/storage/injector_storage.h>
+
+#include <unordered_map>
+#include <vector>
+
+namespace fruit {
+namespace impl {
+
+/**
+ * The result of merging a "prototype" ComponentStorage into a NormalizedComponentStorage, done once so that injectors
+ * can later be created from a NormalizedComponentStorage and a ComponentStorage with the same shape without
+ * normalizing the bindings again.
+ * 
+ * Two ComponentStorage objects have the same shape if they have the same bindings and multibindings in the same order,
+ * except that the objects bound by instance bindings can differ. Creating an injector with a component of the same
+ * shape just copies the pre-merged data and patches the object pointers of the instance bindings.
+ */
+class PreparedDeltaStorage {
+public:
+  using Graph = InjectorStorage::Graph;
+  
+private:
+  // The normalized component used to create this object. Used when the component passed to matches() has a different
+  // shape.
+  // The data in this object is allocated from the MemoryResource of `normalized_component'.
+  const NormalizedComponentStorage& normalized_component;
+  
+  // The bindings and multibindings of the prototype component, in the same order as in the ComponentStorage.
+  std::vector<std::pair<TypeId, BindingData>> prototype_bindings;
+  std::vector<std::pair<TypeId, MultibindingData>> prototype_multibindings;
+  
+  // For each element of prototype_bindings, true if it's an instance binding whose object is stored in its own node of
+  // `bindings', so that a different object can be patched in. For instance bindings that are not patchable (e.g. because
+  // the same type is also bound in the normalized component), the object must be the same as in the prototype.
+  std::vector<bool> patchable_bindings;
+  
+  // For each element of prototype_multibindings, the index of the corresponding element in multibindings.elems if it's an
+  // instance multibinding, or `not_patchable' otherwise.
+  std::vector<std::size_t> patchable_multibinding_indexes;
+  
+  static constexpr std::size_t not_patchable = ~std::size_t(0);
+  
+  // The bindings of the normalized component merged with the ones in the prototype component.
+  // This shares data with the graph in `normalized_component'.
+  Graph bindings;
+  
+  // The multibindings in the prototype component, as an overlay on the multibindings of the normalized component (i.e.
+  // this only contains the types that have multibindings in the prototype component).
+  NormalizedMultibindingTable multibindings;
+  
+  // Contains data on the set of types that can be allocated using the merged bindings.
+  FixedSizeAllocator::FixedSizeAllocatorData fixed_size_allocator_data;
+  
+  friend class InjectorStorage;
+  
+public:
+  PreparedDeltaStorage(const NormalizedComponentStorage& normalized_component,
+                       const ComponentStorage& prototype_component);
+  
+  PreparedDeltaStorage(PreparedDeltaStorage&&) = delete;
+  PreparedDeltaStorage(const PreparedDeltaStorage&) = delete;
+  
+  PreparedDeltaStorage& operator=(PreparedDeltaStorage&&) = delete;
+  PreparedDeltaStorage& operator=(const PreparedDeltaStorage&) = delete;
+  
+  // Returns true if `component' (the result of ComponentStorage::flatten()) has the same shape as the prototype component.
+  // This is O(#bindings + #multibindings in `component') and doesn't allocate memory.
+  bool matches(const BindingSegment& component) const;
+};
+
+} // namespace impl
+} // namespace fruit
+
+#endif // FRUIT_PREPARED_DELTA_STORAGE_H
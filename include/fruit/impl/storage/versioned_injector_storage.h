@@ -0,0 +1,145 @@
+/*
+ * Copyright 2014 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FRUIT_VERSIONED_INJECTOR_STORAGE_H
+#define FRUIT_VERSIONED_INJECTOR_STORAGE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <vector>
+
+namespace fruit {
+namespace impl {
+
+/**
+ * The non-templated part of VersionedInjector: an atomic pointer to the current version (the injector is type-erased
+ * here) and the epoch-based reclamation of the old versions.
+ *
+ * Readers announce the epoch in which they loaded the current version in a Reader object. When a new version is
+ * published, the global epoch is incremented (after swapping the pointer) and the old version is retired with the new
+ * epoch: once no reader announces an older epoch, no reader can still hold the old version and it's destroyed.
+ * Readers never take locks; publishing new versions (and destroying old ones) is serialized with a mutex.
+ */
+class VersionedInjectorStorage {
+public:
+  using destroy_t = void(*)(void*);
+
+  struct Version {
+    // The type-erased injector.
+    void* injector;
+
+    // 1 for the initial version, incremented each time a new version is published.
+    std::uint64_t number;
+  };
+
+  // The state of a reader. A Reader is used by a single snapshot at a time, but it's then re-used by other snapshots
+  // (possibly in other threads) once released. Readers are only deallocated when this object is destroyed.
+  class Reader {
+  private:
+    // The global epoch when this reader loaded the current version, or `quiescent' if it doesn't hold a version.
+    std::atomic<std::uint64_t> epoch;
+
+    std::atomic<bool> in_use;
+
+    // The next reader in the list of all readers. This never changes after the reader is added to the list.
+    Reader* next;
+
+    Reader();
+
+    friend class VersionedInjectorStorage;
+  };
+
+private:
+  static constexpr std::uint64_t quiescent = std::numeric_limits<std::uint64_t>::max();
+
+  struct RetiredVersion {
+    Version* version;
+
+    // `version' can be destroyed when no reader is in an epoch older than this one.
+    std::uint64_t epoch;
+  };
+
+  destroy_t destroy_injector;
+
+  std::atomic<Version*> current;
+
+  std::atomic<std::uint64_t> epoch;
+
+  // A lock-free list with all the readers allocated so far. Readers are only added to the front.
+  std::atomic<Reader*> readers;
+
+  // Held by publish() and by the methods that destroy retired versions.
+  mutable std::mutex writer_mutex;
+
+  // The versions that were replaced by a new one but that might still be used by some reader.
+  // Only accessed while holding writer_mutex.
+  std::vector<RetiredVersion> retired_versions;
+
+  // The size of retired_versions. This is used to avoid locking writer_mutex when there's nothing to destroy.
+  std::atomic<std::size_t> num_retired_versions;
+
+  // Removes the retired versions that can no longer be used by a reader from retired_versions, and returns them.
+  // They are destroyed by the caller after unlocking writer_mutex, since the destructors of the injected objects might do
+  // anything (even publish a new version).
+  // Precondition: writer_mutex must be locked.
+  std::vector<Version*> takeUnreachableVersions();
+
+  void destroyVersions(const std::vector<Version*>& versions);
+
+public:
+  // `injector' is the initial version, destroyed with `destroy_injector' (as will be the ones passed to publish()).
+  VersionedInjectorStorage(void* injector, destroy_t destroy_injector);
+
+  VersionedInjectorStorage(VersionedInjectorStorage&&) = delete;
+  VersionedInjectorStorage(const VersionedInjectorStorage&) = delete;
+
+  VersionedInjectorStorage& operator=(VersionedInjectorStorage&&) = delete;
+  VersionedInjectorStorage& operator=(const VersionedInjectorStorage&) = delete;
+
+  // Destroys all versions. There must be no unreleased readers.
+  ~VersionedInjectorStorage();
+
+  // Returns an unused reader, allocating a new one if all are in use. This is lock-free.
+  Reader* acquireReader();
+
+  // Loads the current version and protects it from destruction until releaseReader(reader) is called. This is lock-free.
+  // Precondition: `reader' must have been returned by acquireReader() and not released yet.
+  const Version* enter(Reader* reader);
+
+  // Releases `reader' (and the version it protected). Then, if there are retired versions and no other thread is
+  // publishing a version, destroys the ones that are no longer used. This doesn't wait for locks (it only tries to lock
+  // writer_mutex).
+  void releaseReader(Reader* reader);
+
+  // Makes `injector' the current version. The previous version is destroyed once no reader holds it: here if there are no
+  // readers, otherwise when the last reader holding it is released (or, if that races with another publish(), in a later
+  // call to publish() or releaseReader()).
+  void publish(void* injector);
+
+  // Returns the number of the current version.
+  std::uint64_t getCurrentVersionNumber() const;
+
+  // Returns the number of versions that were replaced but not destroyed yet (because they might still be in use).
+  std::size_t getNumRetiredVersions() const;
+};
+
+} // namespace impl
+} // namespace fruit
+
+#endif // FRUIT_VERSIONED_INJECTOR_STORAGE_H
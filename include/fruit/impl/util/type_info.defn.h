@@ -74,6 +74,13 @@ inline std::string TypeInfo::name() const {
     return "<unknown> (type name not accessible due to -fno-rtti)";
 }
 
+inline const char* TypeInfo::rawName() const {
+  if (info != nullptr)
+    return info->name();
+  else
+    return nullptr;
+}
+
 inline size_t TypeInfo::size() const {
 #ifdef FRUIT_EXTRA_DEBUG
   FruitAssert(!concrete_type_info.is_abstract);
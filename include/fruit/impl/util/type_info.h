@@ -47,6 +47,9 @@ struct alignas(1) alignas(void*) TypeInfo {
   constexpr TypeInfo(const std::type_info& info, ConcreteTypeInfo concrete_type_info);
 
   std::string name() const;
+  
+  // The name returned by std::type_info::name() (that, unlike name(), is not demangled), or nullptr if RTTI is disabled.
+  const char* rawName() const;
 
   size_t size() const;
 
@@ -0,0 +1,97 @@
+/*
+ * Copyright 2014 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FRUIT_VERSIONED_INJECTOR_DEFN_H
+#define FRUIT_VERSIONED_INJECTOR_DEFN_H
+
+// Redundant, but makes KDevelop happy.
+#include <fruit/versioned_injector.h>
+
+namespace fruit {
+
+template <typename... P>
+inline VersionedInjector<P...>::Snapshot::Snapshot(fruit::impl::VersionedInjectorStorage& storage)
+  : storage(&storage),
+    reader(storage.acquireReader()),
+    version(storage.enter(reader)) {
+}
+
+template <typename... P>
+inline VersionedInjector<P...>::Snapshot::Snapshot(Snapshot&& other)
+  : storage(other.storage), reader(other.reader), version(other.version) {
+  other.reader = nullptr;
+}
+
+template <typename... P>
+inline VersionedInjector<P...>::Snapshot::~Snapshot() {
+  if (reader != nullptr) {
+    storage->releaseReader(reader);
+  }
+}
+
+template <typename... P>
+inline Injector<P...>& VersionedInjector<P...>::Snapshot::operator*() const {
+  return *static_cast<Injector<P...>*>(version->injector);
+}
+
+template <typename... P>
+inline Injector<P...>* VersionedInjector<P...>::Snapshot::operator->() const {
+  return static_cast<Injector<P...>*>(version->injector);
+}
+
+template <typename... P>
+inline std::uint64_t VersionedInjector<P...>::Snapshot::getVersion() const {
+  return version->number;
+}
+
+template <typename... P>
+inline VersionedInjector<P...>::VersionedInjector(Injector<P...>&& injector) {
+  Injector<P...>* first_version = new Injector<P...>(std::move(injector));
+  first_version->enableConcurrentInjection();
+  storage = std::unique_ptr<fruit::impl::VersionedInjectorStorage>(
+      new fruit::impl::VersionedInjectorStorage(first_version, destroyInjector));
+}
+
+template <typename... P>
+inline typename VersionedInjector<P...>::Snapshot VersionedInjector<P...>::getSnapshot() {
+  return Snapshot(*storage);
+}
+
+template <typename... P>
+inline void VersionedInjector<P...>::publish(Injector<P...>&& injector) {
+  Injector<P...>* new_version = new Injector<P...>(std::move(injector));
+  new_version->enableConcurrentInjection();
+  storage->publish(new_version);
+}
+
+template <typename... P>
+inline std::uint64_t VersionedInjector<P...>::getVersion() const {
+  return storage->getCurrentVersionNumber();
+}
+
+template <typename... P>
+inline std::size_t VersionedInjector<P...>::getNumRetiredVersions() const {
+  return storage->getNumRetiredVersions();
+}
+
+template <typename... P>
+inline void VersionedInjector<P...>::destroyInjector(void* injector) {
+  delete static_cast<Injector<P...>*>(injector);
+}
+
+} // namespace fruit
+
+#endif // FRUIT_VERSIONED_INJECTOR_DEFN_H
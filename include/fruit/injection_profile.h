@@ -0,0 +1,128 @@
+/*
+ * Copyright 2014 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef FRUIT_INJECTION_PROFILE_H
+#define FRUIT_INJECTION_PROFILE_H
+
+#include <fruit/impl/fruit_internal_forward_decls.h>
+#include <fruit/impl/util/type_info.h>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace fruit {
+
+/**
+ * The time and memory spent constructing the objects of an injector, returned by Injector::getProfile().
+ * 
+ * Profiling is opt-in at two levels:
+ * - The profiling code is only compiled in if Fruit is configured with FRUIT_ENABLE_PROFILING (e.g. with
+ *   `cmake -DFRUIT_ENABLE_PROFILING=ON'). This is a library-wide setting stored in fruit-config-base.h, like
+ *   FRUIT_USES_BOOST, so all the code using Fruit agrees on it. When it's off (the default) constructing an object has no
+ *   profiling cost at all, and Injector::enableProfiling() has no effect.
+ * - When it's on, constructions are only recorded after Injector::enableProfiling() is called on the injector. Until then
+ *   the only cost is a check of a pointer each time an object is constructed (getting an object that was already
+ *   constructed doesn't check anything), and no memory is allocated for the profile.
+ * 
+ * An entry is recorded each time the injector constructs an object with a constructor or a provider, in construction
+ * order. Since the dependencies of an object are constructed while constructing it, entries form a tree: the entries
+ * with depth 0 were requested directly (e.g. with Injector::get()), and the other ones were constructed as (direct)
+ * dependencies of their parent entry.
+ * 
+ * Example usage:
+ * 
+ * Injector<Foo> injector(getFooComponent());
+ * injector.enableProfiling();
+ * injector.get<Foo*>();
+ * std::ofstream("injection.folded") << injector.getProfile().toFoldedStacks();
+ * 
+ * The resulting file can then be rendered e.g. with `flamegraph.pl injection.folded > injection.svg'.
+ */
+class InjectionProfile {
+public:
+  class Entry {
+  public:
+    // The index of the entry for the object whose construction caused the construction of this one.
+    // Only meaningful if depth > 0.
+    std::size_t parent;
+    
+    // The number of entries that were being constructed when the construction of this one began (0 for objects requested
+    // directly).
+    std::size_t depth;
+    
+    // The wall time spent constructing this object, including (total_time_ns) or excluding (self_time_ns) the time spent
+    // constructing the objects of the nested entries.
+    std::uint64_t total_time_ns;
+    std::uint64_t self_time_ns;
+    
+    // The number of bytes of the injector's memory used for this object, including (total_allocated_bytes) or excluding
+    // (self_allocated_bytes) the ones of the nested entries. This includes padding, but it doesn't include objects
+    // allocated by a provider (e.g. with new) and then just owned by the injector.
+    std::size_t total_allocated_bytes;
+    std::size_t self_allocated_bytes;
+    
+    // Returns the name of the constructed type (including annotations, if any).
+    std::string getTypeName() const;
+    
+  private:
+    fruit::impl::TypeId type;
+    
+    friend class InjectionProfile;
+  };
+  
+  const std::vector<Entry>& getEntries() const;
+  
+  // Returns the entries (with their self time in nanoseconds) in the "folded stacks" format used by flame graph tools:
+  // one line per entry, with the types in the construction stack separated by ';' followed by a space and the value, e.g.:
+  // 
+  // Foo;Bar;Baz 1234
+  std::string toFoldedStacks() const;
+  
+private:
+  // An entry whose construction hasn't completed yet.
+  struct OpenEntry {
+    std::size_t index;
+    std::chrono::steady_clock::time_point start_time;
+    std::size_t start_allocated_bytes;
+    std::uint64_t nested_time_ns;
+    std::size_t nested_allocated_bytes;
+  };
+  
+  std::vector<Entry> entries;
+  
+  // The entries being constructed, innermost last.
+  std::vector<OpenEntry> open_entries;
+  
+  // Records the beginning of the construction of an object of type `type', when `allocated_bytes' bytes of the injector's
+  // memory have been used so far.
+  void beginConstruction(fruit::impl::TypeId type, std::size_t allocated_bytes);
+  
+  // Records the end of the innermost construction started with beginConstruction().
+  void endConstruction(std::size_t allocated_bytes);
+  
+  // Removes all entries.
+  void clear();
+  
+  friend class fruit::impl::InjectorStorage;
+};
+
+} // namespace fruit
+
+#endif // FRUIT_INJECTION_PROFILE_H
@@ -23,6 +23,11 @@
 #include <fruit/component.h>
 #include <fruit/provider.h>
 #include <fruit/normalized_component.h>
+#include <fruit/memory_resource.h>
+#include <fruit/multibindings_range.h>
+#include <fruit/injection_profile.h>
+
+#include <array>
 
 namespace fruit {
 
@@ -61,8 +66,12 @@ public:
    * Injector<Foo, Bar> injector(getFooBarComponent());
    * Foo* foo = injector.get<Foo*>();
    * Bar* bar(injector); // Equivalent to: Bar* bar = injector.get<Bar*>();
+   * 
+   * In this and the other constructors, `memory_resource' is used to allocate the internal data structures of the injector
+   * and the memory where the injected objects are constructed. It must remain valid until the injector has been destroyed.
+   * See MemoryResource for more details.
    */
-  Injector(const Component<P...>& component);
+  Injector(const Component<P...>& component, MemoryResource& memory_resource = getDefaultMemoryResource());
   
   /**
    * Creation of an injector from a normalized component and a component.
@@ -100,7 +109,8 @@ public:
    * }
    */
   template <typename... NormalizedComponentParams, typename... ComponentParams>
-  Injector(const NormalizedComponent<NormalizedComponentParams...>& normalized_component, Component<ComponentParams...> component);
+  Injector(const NormalizedComponent<NormalizedComponentParams...>& normalized_component, Component<ComponentParams...> component,
+           MemoryResource& memory_resource = getDefaultMemoryResource());
   
   /**
    * Deleted constructor, to ensure that constructing an Injector from a temporary NormalizedComponent doesn't compile.
@@ -108,7 +118,132 @@ public:
    */
   template <typename... NormalizedComponentParams, typename... ComponentParams>
   Injector(NormalizedComponent<NormalizedComponentParams...>&& normalized_component, 
-           Component<ComponentParams...> component) = delete;
+           Component<ComponentParams...> component,
+           MemoryResource& memory_resource = getDefaultMemoryResource()) = delete;
+  
+  /**
+   * Creation of an injector from a PreparedDelta and a component.
+   * 
+   * This is equivalent to the constructor that takes the NormalizedComponent used to construct `prepared_delta' and
+   * `component', but if `component' has the same shape as the prototype component of `prepared_delta' (see PreparedDelta for
+   * details), the bindings in `component' are not normalized again: the already-merged bindings are copied and only the
+   * objects bound with bindInstance() and addInstanceMultibinding() are replaced.
+   * 
+   * The PreparedDelta must remain valid during the lifetime of any Injector object constructed with it.
+   * 
+   * Example usage:
+   * 
+   * // At startup (e.g. inside main()).
+   * NormalizedComponent<Required<Request>, Bar, Bar2> normalizedComponent = ...;
+   * Request prototypeRequest;
+   * PreparedDelta<Required<Request>, Bar, Bar2> preparedDelta(normalizedComponent, getRequestComponent(prototypeRequest));
+   * 
+   * ...
+   * for (...) {
+   *   // For each request.
+   *   Request request = ...;
+   *   
+   *   Injector<Foo, Bar> injector(preparedDelta, getRequestComponent(request));
+   *   Foo* foo = injector.get<Foo*>();
+   *   ...
+   * }
+   */
+  template <typename... NormalizedComponentParams, typename... ComponentParams>
+  Injector(const PreparedDelta<NormalizedComponentParams...>& prepared_delta, Component<ComponentParams...> component,
+           MemoryResource& memory_resource = getDefaultMemoryResource());
+  
+  /**
+   * Deleted constructor, to ensure that constructing an Injector from a temporary PreparedDelta doesn't compile.
+   * The PreparedDelta must remain valid during the lifetime of any Injector object constructed with it.
+   */
+  template <typename... NormalizedComponentParams, typename... ComponentParams>
+  Injector(PreparedDelta<NormalizedComponentParams...>&& prepared_delta,
+           Component<ComponentParams...> component,
+           MemoryResource& memory_resource = getDefaultMemoryResource()) = delete;
+  
+  /**
+   * Creation of an injector from a normalized component alone.
+   * 
+   * This is useful when the bindings are fully known at startup (e.g. when they come from a single static component): the
+   * bindings are normalized once when constructing the NormalizedComponent, and then each injector is created by just copying
+   * the already-normalized binding graph, without processing any binding. The copy shares the lookup table and the pages of
+   * nodes of the NormalizedComponent's graph (a page is only copied when an object in it is constructed), so it doesn't
+   * copy the bindings one by one.
+   * 
+   * Note that the binding graph is still built at runtime (once per NormalizedComponent), not at compile time: it's
+   * indexed by TypeId, i.e. by the address of a TypeInfo object, and its nodes contain function and object pointers, and
+   * none of these can be hashed or compared in a C++11 constant expression.
+   * 
+   * The NormalizedComponent can't have requirements, since there's no other component that could provide them.
+   * The NormalizedComponent must remain valid during the lifetime of any Injector object constructed with it.
+   * 
+   * Example usage:
+   * 
+   * // At startup (e.g. inside main()).
+   * NormalizedComponent<Foo, Bar> normalizedComponent(getFooBarComponent());
+   * 
+   * ...
+   * for (...) {
+   *   Injector<Foo> injector(normalizedComponent);
+   *   Foo* foo = injector.get<Foo*>();
+   *   ...
+   * }
+   */
+  template <typename... NormalizedComponentParams>
+  Injector(const NormalizedComponent<NormalizedComponentParams...>& normalized_component,
+           MemoryResource& memory_resource = getDefaultMemoryResource());
+  
+  /**
+   * Deleted constructor, to ensure that constructing an Injector from a temporary NormalizedComponent doesn't compile.
+   * The NormalizedComponent must remain valid during the lifetime of any Injector object constructed with it.
+   */
+  template <typename... NormalizedComponentParams>
+  Injector(NormalizedComponent<NormalizedComponentParams...>&& normalized_component,
+           MemoryResource& memory_resource = getDefaultMemoryResource()) = delete;
+  
+  /**
+   * Creation of a child injector, that shares the objects of `parent_injector' and adds the bindings in `component'.
+   * 
+   * This is an alternative to the constructor that takes a NormalizedComponent, for per-request injectors that should use
+   * objects constructed once (by the parent injector) instead of constructing their own. Only the bindings in `component'
+   * are processed, so the cost of creating the child injector (both in time and in memory) only depends on the number of
+   * bindings in `component', not on the ones in the parent injector.
+   * 
+   * Types bound in the parent injector are never bound again in the child injector: injecting them (directly or as a
+   * dependency of the bindings in `component') returns the parent's object, constructing it in the parent injector if it
+   * wasn't constructed yet. The component can have requirements, as long as they're provided by the parent injector. The
+   * multibindings of a type in the child injector are the ones of the parent injector, followed by the ones in `component'.
+   * 
+   * The parent injector must remain valid (and must not be reset) during the lifetime of the child injector. If multiple
+   * threads use the parent injector (e.g. through different child injectors), its concurrent mode must be enabled (see
+   * enableConcurrentInjection()).
+   * 
+   * Example usage:
+   * 
+   * // In the global scope.
+   * Component<Required<Bar>, Foo> getRequestComponent(Request& request) {
+   *   return fruit::createComponent()
+   *       .bindInstance(request);
+   * }
+   * 
+   * // At startup (e.g. inside main()).
+   * Injector<Bar> parentInjector(getBarComponent());
+   * parentInjector.enableConcurrentInjection();
+   * 
+   * ...
+   * for (...) {
+   *   // For each request.
+   *   Request request = ...;
+   *   
+   *   Injector<Foo, Bar> injector(parentInjector, getRequestComponent(request));
+   *   Foo* foo = injector.get<Foo*>();
+   *   ...
+   * }
+   */
+  template <typename... ParentParams, typename... ComponentParams>
+  Injector(Injector<ParentParams...>& parent_injector,
+           Component<ComponentParams...> component,
+           MemoryResource& memory_resource = getDefaultMemoryResource());
   
   /**
    * Returns an instance of the specified type. For any class C in the Injector's template parameters, the following variations
@@ -165,6 +300,25 @@ public:
   template <typename C>
   RemoveAnnotations<C>* unsafeGet();
   
+  /**
+   * Returns a pointer to the instance of C (constructing it if necessary), using a handle obtained from a
+   * NormalizedComponent (see BindingHandle). If this injector was created from that NormalizedComponent (directly or through
+   * a PreparedDelta), this doesn't need to look up C, even if C is not in P...; otherwise C is looked up as in unsafeGet().
+   * 
+   * C can be annotated; with C=Annotated<Annotation, SomeClass>, this returns a SomeClass*.
+   * 
+   * Unlike get<C*>(), there's no compile-time check that C is provided by this injector. It's always bound in injectors
+   * created from the NormalizedComponent of the handle; if C is not bound in this injector, this is a fatal error.
+   */
+  template <typename C>
+  RemoveAnnotations<C>* get(const BindingHandle<C>& handle);
+  
+  /**
+   * Similar to get(handle), but returns nullptr if C is not bound in this injector instead of reporting an error.
+   */
+  template <typename C>
+  RemoveAnnotations<C>* unsafeGet(const BindingHandle<C>& handle);
+  
   /**
    * This is a convenient way to call get(). E.g.:
    * 
@@ -189,6 +343,18 @@ public:
   template <typename T>
   const std::vector<RemoveAnnotations<T>*>& getMultibindings();
   
+  /**
+   * Similar to getMultibindings(), but returns a MultibindingsRange<RemoveAnnotations<T>> instead of a std::vector.
+   * 
+   * Unlike getMultibindings(), this never allocates memory: the array of pointers to the objects is stored in the memory
+   * that the injector reserves for the injected objects. So this is preferable e.g. when iterating over the multibindings
+   * in a hot loop. The objects are still constructed (if needed) the first time the multibindings for T are requested.
+   * 
+   * The returned range is valid until the injector is destroyed (or reset).
+   */
+  template <typename T>
+  MultibindingsRange<RemoveAnnotations<T>> getMultibindingsRange();
+  
   /**
    * Eagerly injects all reachable bindings and multibindings of this injector.
    * This only creates instances of the types that are either:
@@ -203,9 +369,118 @@ public:
    * After calling this method, get() and getMultibindings() can be called concurrently on the same injector, with no locking.
    * Note that the guarantee only applies after this method returns; specifically, this method can NOT be called concurrently
    * unless it has been called before on the same injector and returned.
+   * 
+   * If you don't want to construct all reachable objects in advance (e.g. because some of them are only used through a
+   * Provider and might never be needed), use enableConcurrentInjection() instead.
    */
   void eagerlyInjectAll();
   
+  /**
+   * Similar to eagerlyInjectAll(), but objects that don't depend on each other are constructed concurrently, using the
+   * specified executor. This is useful when there are many objects with expensive constructors.
+   * 
+   * The executor must have a method execute(F f) where F is a callable object with no arguments; the executor must call
+   * f() exactly once, on any thread, at some point after the call to execute(). execute() might be called multiple times
+   * before the first task completes (as long as there are independent objects to construct), so tasks should not be run
+   * inline if that would limit the parallelism.
+   * This method blocks until all objects are constructed; the multibindings are constructed on the calling thread at the
+   * end.
+   * 
+   * Note that the dependency graph doesn't distinguish between types injected directly and types injected through a
+   * Provider, so unlike eagerlyInjectAll() this will also construct the types that are only injected through a Provider.
+   * 
+   * The thread-safety guarantees after this method returns are the same as for eagerlyInjectAll(). If concurrent mode is
+   * enabled (see enableConcurrentInjection()), other threads can keep using this injector while this method runs: getting
+   * an object that was already constructed doesn't block, while constructing one waits until this method returns.
+   * Otherwise, this method must not be called concurrently with any other method of this injector.
+   * 
+   * If profiling is enabled (see enableProfiling()), the objects constructed by the executor's tasks are not recorded,
+   * since they don't form a single construction stack; the multibindings constructed at the end are recorded as usual.
+   * If a constructor throws an exception, no other objects are constructed after the ones already being constructed, and
+   * the first exception thrown is rethrown on the calling thread once those constructions have completed.
+   */
+  template <typename Executor>
+  void eagerlyInjectAll(Executor& executor);
+  
+  /**
+   * Switches this injector to concurrent mode. After calling this method, get(), unsafeGet(), getMultibindings() and the
+   * get() method of Providers obtained from this injector can be called concurrently on the same injector, and objects are
+   * still constructed lazily (when first requested).
+   * 
+   * Getting an object that has already been constructed doesn't require any locking, so multiple threads can do that
+   * concurrently without contention. Constructing objects is serialized instead, across all types: there is a single
+   * (recursive) lock per injector, held while constructing any object and its dependencies. So two threads never
+   * construct objects of this injector at the same time, even objects of unrelated types; if a thread needs to construct
+   * an object while another thread is constructing one, it waits until that construction is complete (and if it was the
+   * same object, it then returns the same instance).
+   * Note that this means that constructors (and providers) of injected types must not wait for other threads that use
+   * the same injector, and that slow constructors delay all the other threads that need to construct an object. To
+   * construct independent objects in parallel, use eagerlyInjectAll(executor) instead.
+   * 
+   * The guarantee only applies after this method returns; this method can NOT be called concurrently with any other
+   * method of this injector (or with itself).
+   * Calling this more than once is allowed, but has no further effect.
+   */
+  void enableConcurrentInjection();
+  
+  /**
+   * Destroys all the objects constructed by this injector (in the same order as the Injector's destructor would), and then
+   * makes this injector equivalent to a newly-constructed Injector(prepared_delta, component).
+   * 
+   * If this injector was constructed (or last reset) from the same PreparedDelta, and `component' has the same shape as the
+   * prototype component of `prepared_delta' (see PreparedDelta), the memory already allocated by this injector is reused,
+   * so that no memory is allocated (other than by the constructors of the injected types and when getting multibindings).
+   * Otherwise this has the same cost as constructing a new injector.
+   * 
+   * This is useful to re-use a single injector (e.g. one per worker thread in a server) for many requests:
+   * 
+   * // In each worker thread.
+   * Request request = ...;
+   * Injector<Foo, Bar> injector(preparedDelta, getRequestComponent(request));
+   * while (...) {
+   *   Foo* foo = injector.get<Foo*>();
+   *   ...
+   *   request = ...;
+   *   injector.reset(preparedDelta, getRequestComponent(request));
+   * }
+   * 
+   * If concurrent mode was enabled (see enableConcurrentInjection()) it stays enabled. Any new memory is allocated from the
+   * MemoryResource passed to the constructor.
+   * This method must not be called concurrently with any other method of this injector, and any object previously
+   * obtained from this injector (including Providers) must not be used after this is called.
+   * The PreparedDelta must remain valid during the lifetime of this injector.
+   */
+  template <typename... NormalizedComponentParams, typename... ComponentParams>
+  void reset(const PreparedDelta<NormalizedComponentParams...>& prepared_delta, Component<ComponentParams...> component);
+  
+  /**
+   * Deleted method, to ensure that resetting an Injector using a temporary PreparedDelta doesn't compile.
+   */
+  template <typename... NormalizedComponentParams, typename... ComponentParams>
+  void reset(PreparedDelta<NormalizedComponentParams...>&& prepared_delta, Component<ComponentParams...> component) = delete;
+  
+  /**
+   * Starts recording the constructions of objects in this injector (see getProfile()). The objects constructed before
+   * this call are not recorded.
+   * This has no effect unless Fruit was configured with FRUIT_ENABLE_PROFILING (see InjectionProfile).
+   * Objects constructed in parallel by eagerlyInjectAll(executor) are never recorded.
+   * 
+   * This must not be called while other threads might be constructing objects in this injector.
+   */
+  void enableProfiling();
+  
+  /**
+   * Returns the time and memory spent constructing the objects of this injector since enableProfiling() was called (see
+   * InjectionProfile). The profile is empty if enableProfiling() was never called, or if Fruit was configured without
+   * FRUIT_ENABLE_PROFILING. Objects constructed by
+   * eagerlyInjectAll(executor) are not recorded, since they are constructed by multiple threads at once.
+   * 
+   * reset() clears the profile (but profiling stays enabled). The returned reference is valid until this injector is
+   * destroyed or enableProfiling() is called; this method must not be called while other threads might be constructing
+   * objects in this injector.
+   */
+  const InjectionProfile& getProfile() const;
+  
 private:
   using Comp = fruit::impl::meta::Eval<fruit::impl::meta::ConstructComponentImpl(fruit::impl::meta::Type<P>...)>;
 
@@ -222,6 +497,19 @@ private:
   static_assert(true || sizeof(Check2), "");
   
   std::unique_ptr<fruit::impl::InjectorStorage> storage;
+  
+  using ExposedNodes = std::array<fruit::impl::InjectorStorage::Graph::node_iterator, sizeof...(P)>;
+  
+  // The nodes for the types in P... (in the same order), looked up when the injector is created (or reset()), so that get() for
+  // these types is just an indexed load instead of a lookup in the bindings graph.
+  ExposedNodes exposed_nodes;
+  
+  ExposedNodes lookupExposedNodes();
+  
+  template <typename... OtherPs>
+  friend class Injector;
+  
+  friend class FrozenInjector<P...>;
 };
 
 } // namespace fruit
@@ -0,0 +1,78 @@
+/*
+ * Copyright 2014 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FRUIT_MEMORY_RESOURCE_H
+#define FRUIT_MEMORY_RESOURCE_H
+
+#include <cstddef>
+
+namespace fruit {
+
+/**
+ * A source of memory for the internal data structures of injectors and normalized components (the bindings graph, the
+ * multibindings and the memory where injected objects are constructed). This is similar to std::pmr::memory_resource, but
+ * it's also available in C++11.
+ *
+ * Implementing this interface allows e.g. to use a per-thread arena for the injectors created while serving a request,
+ * and then release all their memory at once.
+ *
+ * The MemoryResource passed to a NormalizedComponent or Injector constructor must remain valid until the constructed object
+ * has been destroyed. Fruit doesn't synchronize the calls to allocate() and deallocate(): if the same MemoryResource is used
+ * by objects accessed from multiple threads, the implementation must be thread-safe.
+ *
+ * Example usage:
+ *
+ * class ArenaMemoryResource : public fruit::MemoryResource {
+ * public:
+ *   void* allocate(std::size_t bytes, std::size_t alignment) override {
+ *     ... // Bump a pointer in the current chunk.
+ *   }
+ *   void deallocate(void* p, std::size_t bytes, std::size_t alignment) override {
+ *     // Nothing to do, the memory is released when the arena is destroyed.
+ *   }
+ * };
+ *
+ * ...
+ * for (...) {
+ *   // For each request.
+ *   ArenaMemoryResource arena;
+ *   Injector<Foo, Bar> injector(normalizedComponent, getRequestComponent(request), arena);
+ *   ...
+ * }
+ */
+class MemoryResource {
+public:
+  virtual ~MemoryResource() = default;
+
+  // Returns a chunk of memory of at least `bytes' bytes, aligned to `alignment' (a power of 2, that is never greater than
+  // alignof(std::max_align_t)).
+  // This can be called with bytes==0, but must not return nullptr. If the allocation fails, this must throw an exception.
+  virtual void* allocate(std::size_t bytes, std::size_t alignment) = 0;
+
+  // Releases a chunk of memory previously returned by allocate(bytes, alignment), with the same values of `bytes' and
+  // `alignment'.
+  virtual void deallocate(void* p, std::size_t bytes, std::size_t alignment) = 0;
+};
+
+/**
+ * Returns the MemoryResource used when none is specified explicitly. It allocates memory using operator new and releases
+ * it using operator delete. It's thread-safe.
+ */
+MemoryResource& getDefaultMemoryResource();
+
+} // namespace fruit
+
+#endif // FRUIT_MEMORY_RESOURCE_H
@@ -0,0 +1,107 @@
+/*
+ * Copyright 2014 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FRUIT_MULTIBINDINGS_RANGE_H
+#define FRUIT_MULTIBINDINGS_RANGE_H
+
+#include <fruit/impl/fruit_internal_forward_decls.h>
+
+#include <cstddef>
+#include <iterator>
+
+namespace fruit {
+
+/**
+ * A read-only view over the multibindings for C in an injector, returned by Injector::getMultibindingsRange<C>().
+ * Unlike the std::vector returned by Injector::getMultibindings<C>(), getting a MultibindingsRange doesn't allocate memory:
+ * the pointers to the objects are stored in the injector's own memory (that's reserved in advance when the injector is
+ * created), so getting and iterating a range is cheap enough to do in hot loops. E.g.:
+ * 
+ * for (Listener* listener : injector.getMultibindingsRange<Listener>()) {
+ *   listener->notify();
+ * }
+ * 
+ * A MultibindingsRange is only valid until the injector that returned it is destroyed (or reset).
+ */
+template <typename C>
+class MultibindingsRange {
+public:
+  class iterator {
+  public:
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = C*;
+    using difference_type = std::ptrdiff_t;
+    using pointer = C* const*;
+    using reference = C*;
+    
+    iterator() = default;
+    
+    C* operator*() const;
+    C* operator[](std::ptrdiff_t i) const;
+    
+    iterator& operator++();
+    iterator operator++(int);
+    iterator& operator--();
+    iterator operator--(int);
+    
+    iterator& operator+=(std::ptrdiff_t n);
+    iterator& operator-=(std::ptrdiff_t n);
+    iterator operator+(std::ptrdiff_t n) const;
+    iterator operator-(std::ptrdiff_t n) const;
+    std::ptrdiff_t operator-(iterator other) const;
+    
+    bool operator==(iterator other) const;
+    bool operator!=(iterator other) const;
+    bool operator<(iterator other) const;
+    bool operator<=(iterator other) const;
+    bool operator>(iterator other) const;
+    bool operator>=(iterator other) const;
+    
+  private:
+    // Each element is a C*, stored as a void*.
+    void* const* p = nullptr;
+    
+    explicit iterator(void* const* p);
+    
+    friend class MultibindingsRange;
+  };
+  
+  // An empty range.
+  MultibindingsRange() = default;
+  
+  iterator begin() const;
+  iterator end() const;
+  
+  std::size_t size() const;
+  bool empty() const;
+  
+  // Precondition: i < size().
+  C* operator[](std::size_t i) const;
+  
+private:
+  void* const* objects_begin = nullptr;
+  void* const* objects_end = nullptr;
+  
+  MultibindingsRange(void* const* objects_begin, void* const* objects_end);
+  
+  friend class fruit::impl::InjectorStorage;
+};
+
+} // namespace fruit
+
+#include <fruit/impl/multibindings_range.defn.h>
+
+#endif // FRUIT_MULTIBINDINGS_RANGE_H
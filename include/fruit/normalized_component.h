@@ -21,10 +21,14 @@
 #include <fruit/impl/injection_errors.h>
 
 #include <fruit/fruit_forward_decls.h>
+#include <fruit/binding_handle.h>
+#include <fruit/memory_resource.h>
 #include <fruit/impl/fruit_internal_forward_decls.h>
 #include <fruit/impl/meta/component.h>
 #include <fruit/impl/storage/normalized_component_storage_holder.h>
+#include <fruit/impl/storage/prepared_delta_storage_holder.h>
 #include <memory>
+#include <string>
 
 namespace fruit {
 
@@ -59,7 +63,27 @@ class NormalizedComponent {
 public:
   // The Component used as parameter can have (and usually has) unsatisfied requirements, so it's usually of the form
   // Component<Required<...>, ...>.
-  NormalizedComponent(const Component<Params...>& component);
+  // The normalized bindings (and any PreparedDelta created from this object) are allocated from `memory_resource', that must
+  // remain valid until this object has been destroyed.
+  NormalizedComponent(const Component<Params...>& component,
+                      MemoryResource& memory_resource = getDefaultMemoryResource());
+  
+  // Same as the constructor above, but the normalized bindings are loaded from `image' (a buffer of `image_size' bytes
+  // returned by serialize(), possibly in another process) instead of normalizing `component'. For large components this
+  // avoids most of the cost of the constructor above, e.g. the image can be written to a file at build time and loaded with
+  // mmap() at startup.
+  // `component' must be constructed in the same way as the one passed to serialize(): the image only stores positions in
+  // `component', the actual pointers (e.g. to the objects bound with bindInstance()) are taken from `component'.
+  // If the image was created with a different `build_fingerprint', or for a component with a different shape (e.g. a
+  // different number of bindings), the image is ignored and `component' is normalized as in the constructor above.
+  // The build fingerprint should identify the binary (e.g. it could be a build ID), since images can't be used across
+  // different builds.
+  // The image doesn't need to remain valid after the constructor returns.
+  NormalizedComponent(const Component<Params...>& component,
+                      const void* image,
+                      std::size_t image_size,
+                      const std::string& build_fingerprint,
+                      MemoryResource& memory_resource = getDefaultMemoryResource());
   
   NormalizedComponent(NormalizedComponent&&) = default;
   NormalizedComponent(const NormalizedComponent&) = delete;
@@ -67,14 +91,63 @@ public:
   NormalizedComponent& operator=(NormalizedComponent&&) = delete;
   NormalizedComponent& operator=(const NormalizedComponent&) = delete;
   
+  // Returns an image of this object, that can be used to construct an equivalent NormalizedComponent with the constructor
+  // above. `component' must be the component that was used to construct this object; if it's detected that this is not the
+  // case, an empty string is returned.
+  std::string serialize(const Component<Params...>& component, const std::string& build_fingerprint) const;
+  
+  // Returns true if this object was loaded from an image, false if the component was normalized (either because the other
+  // constructor was used, or because the image could not be used).
+  bool isLoadedFromImage() const;
+  
+  // Returns a handle for the binding of C (that can be annotated) in this object, that can be used to get the object of C
+  // from injectors created from this object without looking it up. C must be provided by this NormalizedComponent (i.e.
+  // it must be in Params...). See BindingHandle for more details.
+  template <typename C>
+  BindingHandle<C> getBindingHandle() const;
+  
+  // Returns a NormalizedComponent with the bindings of this object and the ones in `component'. This is equivalent to
+  // normalizing a component that installs both, but only the bindings in `component' are normalized: the normalized
+  // bindings of this object are shared with the result, so the cost of this is roughly proportional to the number of
+  // bindings in `component' (plus a copy of the array of nodes of this object).
+  // This can be called on the result too, e.g. to add the bindings of plugins loaded at runtime one at a time.
+  // 
+  // The types provided by NewParams... must be provided by this object or by `component', and the requirements of this
+  // object and of `component' that are not provided by either of them must be declared in NewParams... (as
+  // Required<...>).
+  // 
+  // This object must remain valid until the result (and any NormalizedComponent, PreparedDelta or Injector created from
+  // it) has been destroyed. The data that isn't shared with this object is allocated from `memory_resource', that must
+  // remain valid until the result has been destroyed.
+  // The result can be serialized, but its serialize() method must be called with a component that installs this object's
+  // component and `component'; the image is the one of the normalization of that component (so it's as expensive as
+  // the NormalizedComponent constructor), and the NormalizedComponent loaded from it is not an extension.
+  template <typename... NewParams, typename... ComponentParams>
+  NormalizedComponent<NewParams...> extend(Component<ComponentParams...> component,
+                                           MemoryResource& memory_resource = getDefaultMemoryResource()) const;
+  
 private:  
   // This is held via a unique_ptr to avoid including normalized_component_storage.h
   // in fruit.h.
   fruit::impl::NormalizedComponentStorageHolder storage;
   
+  // Used by extend().
+  NormalizedComponent(const fruit::impl::NormalizedComponentStorageHolder& normalized_component,
+                      const fruit::impl::ComponentStorage& component,
+                      MemoryResource& memory_resource);
+  
+  // Returns the types exposed by this component (the ones provided by Params...).
+  static std::vector<fruit::impl::TypeId> getExposedTypes();
+  
   template <typename... OtherParams>
   friend class Injector;
   
+  template <typename... OtherParams>
+  friend class PreparedDelta;
+  
+  template <typename... OtherParams>
+  friend class NormalizedComponent;
+  
   using Comp = fruit::impl::meta::Eval<fruit::impl::meta::ConstructComponentImpl(fruit::impl::meta::Type<Params>...)>;
 
   using Check1 = typename fruit::impl::meta::CheckIfError<Comp>::type;
@@ -82,6 +155,79 @@ private:
   static_assert(true || sizeof(Check1), "");
 };
 
+/**
+ * This class allows for even faster creation of injectors from a NormalizedComponent and a component, when the component
+ * always has the same "shape", i.e. it always has the same bindings and multibindings (in the same order), and only the
+ * objects bound with bindInstance() and addInstanceMultibinding() differ.
+ * 
+ * A PreparedDelta is constructed from a NormalizedComponent and a prototype component with that shape. The bindings of the
+ * prototype component are normalized and merged with the ones in the NormalizedComponent once, here. When an injector is
+ * then constructed from the PreparedDelta and a component with the same shape, no binding normalization is performed: the
+ * merged bindings are copied and only the bound instances are replaced, so the cost of creating the injector no longer
+ * depends on the number of hash map operations needed to merge the component.
+ * 
+ * Components with a different shape can also be used; the resulting injector is the same as if the NormalizedComponent
+ * was used directly (and so is the cost of creating it).
+ * 
+ * Example usage in a server:
+ * 
+ * // In the global scope.
+ * Component<Request> getRequestComponent(Request& request) {
+ *   return fruit::createComponent()
+ *       .bindInstance(request);
+ * }
+ * 
+ * // At startup (e.g. inside main()).
+ * NormalizedComponent<Required<Request>, Bar, Bar2> normalizedComponent = ...;
+ * Request prototypeRequest;
+ * PreparedDelta<Required<Request>, Bar, Bar2> preparedDelta(normalizedComponent, getRequestComponent(prototypeRequest));
+ * 
+ * ...
+ * for (...) {
+ *   // For each request.
+ *   Request request = ...;
+ *   
+ *   Injector<Foo, Bar> injector(preparedDelta, getRequestComponent(request));
+ *   Foo* foo = injector.get<Foo*>();
+ *   ...
+ * }
+ * 
+ * The NormalizedComponent must remain valid during the lifetime of the PreparedDelta, and the PreparedDelta must remain
+ * valid during the lifetime of any Injector object constructed with it. The prototype component (and the objects bound in
+ * it) don't need to outlive the constructor.
+ * 
+ * The checks done at compile time are the same as for the Injector constructor that takes a NormalizedComponent and a
+ * component; they're done when constructing the Injector, not when constructing the PreparedDelta.
+ */
+template <typename... Params>
+class PreparedDelta {
+public:
+  template <typename... ComponentParams>
+  PreparedDelta(const NormalizedComponent<Params...>& normalized_component,
+                const Component<ComponentParams...>& prototype_component);
+  
+  /**
+   * Deleted constructor, to ensure that constructing a PreparedDelta from a temporary NormalizedComponent doesn't compile.
+   */
+  template <typename... ComponentParams>
+  PreparedDelta(NormalizedComponent<Params...>&& normalized_component,
+                const Component<ComponentParams...>& prototype_component) = delete;
+  
+  PreparedDelta(PreparedDelta&&) = default;
+  PreparedDelta(const PreparedDelta&) = delete;
+  
+  PreparedDelta& operator=(PreparedDelta&&) = delete;
+  PreparedDelta& operator=(const PreparedDelta&) = delete;
+  
+private:
+  // This is held via a unique_ptr to avoid including prepared_delta_storage.h
+  // in fruit.h.
+  fruit::impl::PreparedDeltaStorageHolder storage;
+  
+  template <typename... OtherParams>
+  friend class Injector;
+};
+
 } // namespace fruit
 
 #include <fruit/impl/normalized_component.defn.h>
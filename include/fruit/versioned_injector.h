@@ -0,0 +1,136 @@
+/*
+ * Copyright 2014 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FRUIT_VERSIONED_INJECTOR_H
+#define FRUIT_VERSIONED_INJECTOR_H
+
+#include <fruit/injector.h>
+#include <fruit/impl/storage/versioned_injector_storage.h>
+
+#include <cstdint>
+#include <memory>
+
+namespace fruit {
+
+/**
+ * Holds the current version of an injector, that can be replaced with a new injector (e.g. when the configuration it was
+ * created from changes) while other threads are using it.
+ *
+ * Readers get a Snapshot of the current version, and use the injector in it. Getting (and releasing) a snapshot never
+ * locks, and the injector in a snapshot is in concurrent mode (see Injector::enableConcurrentInjection()), so its objects
+ * can be injected concurrently without locking too (other than while constructing them).
+ * A new version is published with publish(). This atomically replaces the current version: snapshots taken after that use
+ * the new injector, while the snapshots taken before keep using the old one. The old injector (with all the objects it
+ * constructed) is destroyed once all the snapshots that use it have been released.
+ *
+ * Example usage:
+ *
+ * VersionedInjector<Foo> versionedInjector(Injector<Foo>(getFooComponent(config)));
+ *
+ * // In worker threads.
+ * for (...) {
+ *   VersionedInjector<Foo>::Snapshot snapshot = versionedInjector.getSnapshot();
+ *   Foo* foo = snapshot->get<Foo*>();
+ *   // `foo' can be used until `snapshot' is destroyed.
+ *   ...
+ * }
+ *
+ * // When the configuration changes.
+ * versionedInjector.publish(Injector<Foo>(getFooComponent(newConfig)));
+ *
+ * Old versions are reclaimed with epoch-based reclamation, so a snapshot that's held for a long time delays the
+ * destruction of all versions published after it was taken (but it doesn't block publish()). Snapshots should be held
+ * for the duration of a unit of work (e.g. a request), not stored.
+ *
+ * publish() can be called concurrently with getSnapshot() and with itself. Injectors published here can be constructed
+ * from a NormalizedComponent (or a PreparedDelta), that must remain valid until they're destroyed (in the worst case,
+ * until this object is destroyed).
+ */
+template <typename... P>
+class VersionedInjector {
+public:
+  /**
+   * A version of the injector, that remains valid until this object is destroyed.
+   * A snapshot must be used by a single thread at a time (different threads should get different snapshots).
+   */
+  class Snapshot {
+  public:
+    Snapshot(Snapshot&& other);
+    Snapshot(const Snapshot&) = delete;
+
+    Snapshot& operator=(Snapshot&&) = delete;
+    Snapshot& operator=(const Snapshot&) = delete;
+
+    ~Snapshot();
+
+    Injector<P...>& operator*() const;
+    Injector<P...>* operator->() const;
+
+    // Returns the number of this version: 1 for the injector passed to the VersionedInjector constructor, and incremented
+    // each time a new version is published.
+    std::uint64_t getVersion() const;
+
+  private:
+    explicit Snapshot(fruit::impl::VersionedInjectorStorage& storage);
+
+    fruit::impl::VersionedInjectorStorage* storage;
+
+    // This is nullptr if this snapshot was moved from.
+    fruit::impl::VersionedInjectorStorage::Reader* reader;
+
+    const fruit::impl::VersionedInjectorStorage::Version* version;
+
+    friend class VersionedInjector;
+  };
+
+  // `injector' becomes the first version. Its concurrent mode is enabled here.
+  explicit VersionedInjector(Injector<P...>&& injector);
+
+  VersionedInjector(VersionedInjector&&) = default;
+  VersionedInjector(const VersionedInjector&) = delete;
+
+  VersionedInjector& operator=(VersionedInjector&&) = delete;
+  VersionedInjector& operator=(const VersionedInjector&) = delete;
+
+  // Destroys all versions. All snapshots must have been released before.
+  ~VersionedInjector() = default;
+
+  // Returns a snapshot of the current version. This doesn't lock.
+  Snapshot getSnapshot();
+
+  // Makes `injector' the current version, after enabling its concurrent mode. The previous version is destroyed when the
+  // last snapshot using it is released (or here, if there are none).
+  void publish(Injector<P...>&& injector);
+
+  // Returns the number of the current version (see Snapshot::getVersion()).
+  std::uint64_t getVersion() const;
+
+  // Returns the number of versions that have been replaced but not destroyed yet, because some snapshot might still use
+  // them.
+  std::size_t getNumRetiredVersions() const;
+
+private:
+  // Held via a unique_ptr so that snapshots remain valid if this object is moved.
+  std::unique_ptr<fruit::impl::VersionedInjectorStorage> storage;
+
+  static void destroyInjector(void* injector);
+};
+
+} // namespace fruit
+
+#include <fruit/impl/versioned_injector.defn.h>
+
+#endif // FRUIT_VERSIONED_INJECTOR_H
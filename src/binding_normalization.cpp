@@ -26,6 +26,7 @@
 #include <fruit/impl/storage/injector_storage.h>
 #include <fruit/impl/storage/component_storage.h>
 #include <fruit/impl/data_structures/semistatic_graph.templates.h>
+#include <fruit/impl/data_structures/fixed_size_hash_map.templates.h>
 #include <fruit/impl/meta/basics.h>
 #include <fruit/impl/storage/normalized_component_storage.h>
 
@@ -43,9 +44,12 @@ std::string multipleBindingsError(TypeId type) {
         + "If the source of the problem is unclear, try exposing this type in all the component signatures where it's bound; if no component hides it this can't happen.\n";
 }
 
-auto typeInfoLessThanForMultibindings = [](const std::pair<TypeId, MultibindingData>& x,
-                                           const std::pair<TypeId, MultibindingData>& y) {
-  return x.first < y.first;
+// A compressed binding I->C, stored in a map indexed by C.
+struct CompressibleBinding {
+  TypeId i_id;
+  BindingData binding_data;
+  // This is set to false when we find out that the binding can't be compressed.
+  bool can_compress;
 };
 
 } // namespace
@@ -60,20 +64,18 @@ BindingNormalization::normalizeBindings(const std::vector<std::pair<TypeId, Bind
                                         const std::vector<std::pair<TypeId, MultibindingData>>& multibindings_vector,
                                         const std::vector<TypeId>& exposed_types,
                                         BindingNormalization::BindingCompressionInfoMap& bindingCompressionInfoMap) {
-  HashMap<TypeId, BindingData> binding_data_map = createHashMap<TypeId, BindingData>(bindings_vector.size());
+  // The maps here are FixedSizeHashMaps instead of HashMaps, since their maximum size is known in advance. That way they are
+  // allocated once instead of allocating a node for each binding.
+  FixedSizeHashMap<TypeId, BindingData> binding_data_map(bindings_vector.size());
   
   for (auto& p : bindings_vector) {
-    auto itr = binding_data_map.find(p.first);
-    if (itr != binding_data_map.end()) {
-      if (!(p.second == itr->second)) {
+    auto itr = binding_data_map.insert(p.first, p.second);
+    if (!itr.second) {
+      if (!(p.second == itr.first->second)) {
         std::cerr << multipleBindingsError(p.first) << std::endl;
         exit(1);
       }
       // Otherwise ok, duplicate but consistent binding.
-      
-    } else {
-      // New binding, add it to the map.
-      binding_data_map[p.first] = p.second;
     }
   }
   
@@ -87,29 +89,39 @@ BindingNormalization::normalizeBindings(const std::vector<std::pair<TypeId, Bind
   
   // Remove duplicates from `compressedBindingsVector'.
   
-  // CtypeId -> (ItypeId, bindingData)
-  HashMap<TypeId, std::pair<TypeId, BindingData>> compressed_bindings_map =
-      createHashMap<TypeId, std::pair<TypeId, BindingData>>(compressed_bindings_vector.size());
+  // CtypeId -> (ItypeId, bindingData, canCompress)
+  FixedSizeHashMap<TypeId, CompressibleBinding> compressed_bindings_map(compressed_bindings_vector.size());
   
-  // This also removes any duplicates. No need to check for multiple I->C, I2->C mappings, will filter these out later when 
-  // considering deps.
+  // This also removes any duplicates (the last one wins). No need to check for multiple I->C, I2->C mappings, will filter
+  // these out later when considering deps.
   for (CompressedBinding& compressed_binding : compressed_bindings_vector) {
-    compressed_bindings_map[compressed_binding.class_id] = {compressed_binding.interface_id, compressed_binding.binding_data};
+    CompressibleBinding compressible_binding{compressed_binding.interface_id, compressed_binding.binding_data, true};
+    auto itr = compressed_bindings_map.insert(compressed_binding.class_id, compressible_binding);
+    if (!itr.second) {
+      itr.first->second = compressible_binding;
+    }
   }
   
+  auto disallowCompression = [&compressed_bindings_map](TypeId c_id) {
+    auto itr = compressed_bindings_map.find(c_id);
+    if (itr != compressed_bindings_map.end()) {
+      itr->second.can_compress = false;
+    }
+  };
+  
   // We can't compress the binding if C is a dep of a multibinding.
-  for (auto p : multibindings_vector) {
+  for (const auto& p : multibindings_vector) {
     const BindingDeps* deps = p.second.deps;
     if (deps != nullptr) {
       for (std::size_t i = 0; i < deps->num_deps; ++i) {
-        compressed_bindings_map.erase(deps->deps[i]);
+        disallowCompression(deps->deps[i]);
       }
     }
   }
   
   // We can't compress the binding if C is an exposed type (but I is likely to be exposed instead).
   for (TypeId type : exposed_types) {
-    compressed_bindings_map.erase(type);
+    disallowCompression(type);
   }
   
   // We can't compress the binding if some type X depends on C and X!=I.
@@ -120,8 +132,8 @@ BindingNormalization::normalizeBindings(const std::vector<std::pair<TypeId, Bind
       for (std::size_t i = 0; i < binding_data.getDeps()->num_deps; ++i) {
         TypeId c_id = binding_data.getDeps()->deps[i];
         auto itr = compressed_bindings_map.find(c_id);
-        if (itr != compressed_bindings_map.end() && itr->second.first != x_id) {
-          compressed_bindings_map.erase(itr);
+        if (itr != compressed_bindings_map.end() && itr->second.i_id != x_id) {
+          itr->second.can_compress = false;
         }
       }
     }
@@ -130,14 +142,23 @@ BindingNormalization::normalizeBindings(const std::vector<std::pair<TypeId, Bind
   // Two pairs of compressible bindings (I->C) and (C->X) can not exist (the C of a compressible binding is always bound either
   // using constructor binding or provider binding, it can't be a binding itself). So no need to check for that.
   
+  std::size_t num_compressed_bindings = 0;
+  for (auto& p : compressed_bindings_map) {
+    if (p.second.can_compress) {
+      ++num_compressed_bindings;
+    }
+  }
   bindingCompressionInfoMap = 
-      createHashMap<TypeId, BindingNormalization::BindingCompressionInfo>(compressed_bindings_map.size());
+      createHashMap<TypeId, BindingNormalization::BindingCompressionInfo>(num_compressed_bindings);
   
   // Now perform the binding compression.
   for (auto& p : compressed_bindings_map) {
+    if (!p.second.can_compress) {
+      continue;
+    }
     TypeId c_id = p.first;
-    TypeId i_id = p.second.first;
-    BindingData binding_data = p.second.second;
+    TypeId i_id = p.second.i_id;
+    BindingData binding_data = p.second.binding_data;
     auto i_binding_data = binding_data_map.find(i_id);
     auto c_binding_data = binding_data_map.find(c_id);
     FruitAssert(i_binding_data != binding_data_map.end());
@@ -146,58 +167,22 @@ BindingNormalization::normalizeBindings(const std::vector<std::pair<TypeId, Bind
     // Note that even if I is the one that remains, C is the one that will be allocated, not I.
     FruitAssert(!i_binding_data->second.needsAllocation());
     i_binding_data->second = binding_data;
-    binding_data_map.erase(c_binding_data);
 #ifdef FRUIT_EXTRA_DEBUG
     std::cout << "InjectorStorage: performing binding compression for the edge " << i_id << "->" << c_id << std::endl;
 #endif
   }
 
-  // Copy the normalized bindings into the result vector.
+  // Copy the normalized bindings into the result vector, except for the ones of the C types of the compressed bindings.
   std::vector<std::pair<TypeId, BindingData>> result;
-  result.reserve(binding_data_map.size());
+  result.reserve(binding_data_map.size() - num_compressed_bindings);
   for (auto& p : binding_data_map) {
-    result.push_back(p);
-  }
-  return result;
-}
-
-void BindingNormalization::addMultibindings(std::unordered_map<TypeId, NormalizedMultibindingData>& multibindings,
-                                            FixedSizeAllocator::FixedSizeAllocatorData& fixed_size_allocator_data,
-                                            const std::vector<std::pair<TypeId, MultibindingData>>& multibindingsVector) {
-
-  std::vector<std::pair<TypeId, MultibindingData>> sortedMultibindingsVector = multibindingsVector;
-  std::sort(sortedMultibindingsVector.begin(), sortedMultibindingsVector.end(),
-            typeInfoLessThanForMultibindings);
-  
-#ifdef FRUIT_EXTRA_DEBUG
-  std::cout << "InjectorStorage: adding multibindings:" << std::endl;
-#endif
-  // Now we must merge multiple bindings for the same type.
-  for (auto i = sortedMultibindingsVector.begin(); i != sortedMultibindingsVector.end(); /* no increment */) {
-    const std::pair<TypeId, MultibindingData>& x = *i;
-    NormalizedMultibindingData& b = multibindings[x.first];
-    
-    // Might be set already, but we need to set it if there was no multibinding for this type.
-    b.get_multibindings_vector = x.second.get_multibindings_vector;
-    
-#ifdef FRUIT_EXTRA_DEBUG
-    std::cout << x.first << " has " << std::distance(i, sortedMultibindingsVector.end()) << " multibindings." << std::endl;
-#endif
-    // Insert all multibindings for this type (note that x is also inserted here).
-    for (; i != sortedMultibindingsVector.end() && i->first == x.first; ++i) {
-      b.elems.push_back(NormalizedMultibindingData::Elem(i->second));
-      if (i->second.needs_allocation) {
-        fixed_size_allocator_data.addType(x.first);
-      } else {
-        fixed_size_allocator_data.addExternallyAllocatedType(x.first);
-      }
+    auto itr = compressed_bindings_map.find(p.first);
+    if (itr == compressed_bindings_map.end() || !itr->second.can_compress) {
+      result.push_back(p);
     }
-#ifdef FRUIT_EXTRA_DEBUG
-    std::cout << std::endl;
-#endif
   }
+  return result;
 }
 
-
 } // namespace impl
 } // namespace fruit
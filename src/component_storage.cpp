@@ -25,6 +25,7 @@
 #include <fruit/impl/util/type_info.h>
 
 #include <fruit/impl/storage/component_storage.h>
+#include <fruit/impl/util/hash_helpers.h>
 
 using std::cout;
 using std::endl;
@@ -33,11 +34,62 @@ namespace fruit {
 namespace impl {
 
 void ComponentStorage::install(const ComponentStorage& other) throw() {
-  bindings.insert(
-      bindings.end(), other.bindings.begin(), other.bindings.end());
-  compressed_bindings.insert(
-      compressed_bindings.end(), other.compressed_bindings.begin(), other.compressed_bindings.end());
-  multibindings.insert(multibindings.end(), other.multibindings.begin(), other.multibindings.end());
+  if (other.segment == nullptr) {
+    return;
+  }
+  BindingSegment& mutable_segment = getMutableSegment();
+  mutable_segment.installed_segments.emplace_back(mutable_segment.multibindings.size(), other.segment);
+}
+
+namespace {
+
+// Appends the bindings of `segment' and of the segments installed in it to `result' (visiting each segment only once).
+void flattenInto(const BindingSegment& segment,
+                 BindingSegment& result,
+                 HashSet<const BindingSegment*>& visited_segments) {
+  result.bindings.insert(result.bindings.end(), segment.bindings.begin(), segment.bindings.end());
+  result.compressed_bindings.insert(
+      result.compressed_bindings.end(), segment.compressed_bindings.begin(), segment.compressed_bindings.end());
+  std::size_t num_multibindings_added = 0;
+  for (const auto& p : segment.installed_segments) {
+    result.multibindings.insert(result.multibindings.end(),
+                                segment.multibindings.begin() + num_multibindings_added,
+                                segment.multibindings.begin() + p.first);
+    num_multibindings_added = p.first;
+    if (visited_segments.insert(p.second.get()).second) {
+      flattenInto(*p.second, result, visited_segments);
+    }
+  }
+  result.multibindings.insert(result.multibindings.end(),
+                              segment.multibindings.begin() + num_multibindings_added,
+                              segment.multibindings.end());
+}
+
+} // namespace
+
+const BindingSegment& ComponentStorage::flatten(std::unique_ptr<BindingSegment>& flattened_segment) const {
+  // This uses raw pointers (instead of copying the shared_ptr) since this is called for each injector, and most of the time
+  // it doesn't need to create a new segment.
+  const BindingSegment* root = segment.get();
+  // A component that only installs another component (e.g. after converting a Component to another Component type) has
+  // the same bindings as that component.
+  while (root != nullptr && root->installed_segments.size() == 1 && root->bindings.empty()
+         && root->compressed_bindings.empty() && root->multibindings.empty()) {
+    root = root->installed_segments[0].second.get();
+  }
+  if (root == nullptr) {
+    static const BindingSegment empty_segment{};
+    return empty_segment;
+  }
+  if (root->installed_segments.empty()) {
+    return *root;
+  }
+  
+  flattened_segment = std::unique_ptr<BindingSegment>(new BindingSegment());
+  HashSet<const BindingSegment*> visited_segments = createHashSet<const BindingSegment*>();
+  visited_segments.insert(root);
+  flattenInto(*root, *flattened_segment, visited_segments);
+  return *flattened_segment;
 }
 
 ComponentStorage::~ComponentStorage() {
@@ -18,6 +18,7 @@
 
 #include <fruit/impl/data_structures/fixed_size_allocator.h>
 #include <fruit/impl/data_structures/fixed_size_vector.templates.h>
+#include <fruit/impl/storage/normalized_component_image.h>
 
 using namespace fruit::impl;
 
@@ -25,15 +26,62 @@ namespace fruit {
 namespace impl {
 
 FixedSizeAllocator::~FixedSizeAllocator() {
+  destroyAll();
+  if (storage_begin != nullptr) {
+    memory_resource->deallocate(storage_begin, storage_size, 1);
+  }
+}
+
+void FixedSizeAllocator::destroyAll() {
   // Destroy all objects in reverse order.
   std::pair<destroy_t, void*>* p = on_destruction.end();
   while (p != on_destruction.begin()) {
     --p;
     p->first(p->second);
   }
-  delete [] storage_begin;
+  on_destruction.clear();
+}
+
+void FixedSizeAllocator::reset(const FixedSizeAllocatorData& allocator_data) {
+  destroyAll();
+  storage_last_used = storage_begin;
+#ifdef FRUIT_EXTRA_DEBUG
+  remaining_types = allocator_data.types;
+  remaining_pointers = allocator_data.num_pointers;
+#else
+  (void)allocator_data;
+#endif
+}
+
+void FixedSizeAllocator::FixedSizeAllocatorData::writeImage(ImageWriter& writer) const {
+  writer.write(total_size);
+  writer.write(num_types_to_destroy);
+#ifdef FRUIT_EXTRA_DEBUG
+  writer.write(types.size());
+  for (const std::pair<const TypeId, std::size_t>& p : types) {
+    writer.write(p.first);
+    writer.write(p.second);
+  }
+  writer.write(num_pointers);
+#endif
 }
 
+void FixedSizeAllocator::FixedSizeAllocatorData::readImage(ImageReader& reader) {
+  reader.read(total_size);
+  reader.read(num_types_to_destroy);
+#ifdef FRUIT_EXTRA_DEBUG
+  types.clear();
+  std::size_t num_types = reader.readSize(2);
+  for (std::size_t i = 0; i < num_types; ++i) {
+    TypeId type_id;
+    std::size_t count;
+    reader.read(type_id);
+    reader.read(count);
+    types[type_id] = count;
+  }
+  reader.read(num_pointers);
+#endif
+}
 
 } // namespace impl
 } // namespace fruit
@@ -0,0 +1,106 @@
+/*
+ * Copyright 2014 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#define IN_FRUIT_CPP_FILE
+
+#include <fruit/injection_profile.h>
+#include <fruit/impl/fruit_assert.h>
+
+#include <algorithm>
+
+namespace fruit {
+
+std::string InjectionProfile::Entry::getTypeName() const {
+  return std::string(type);
+}
+
+const std::vector<InjectionProfile::Entry>& InjectionProfile::getEntries() const {
+  return entries;
+}
+
+std::string InjectionProfile::toFoldedStacks() const {
+  std::string result;
+  std::vector<std::string> names;
+  names.reserve(entries.size());
+  for (const Entry& entry : entries) {
+    names.push_back(entry.getTypeName());
+  }
+  std::vector<std::size_t> stack;
+  for (std::size_t i = 0; i < entries.size(); ++i) {
+    stack.clear();
+    std::size_t j = i;
+    while (true) {
+      stack.push_back(j);
+      if (entries[j].depth == 0) {
+        break;
+      }
+      j = entries[j].parent;
+    }
+    for (auto itr = stack.rbegin(); itr != stack.rend(); ++itr) {
+      if (itr != stack.rbegin()) {
+        result += ';';
+      }
+      result += names[*itr];
+    }
+    result += ' ';
+    result += std::to_string(entries[i].self_time_ns);
+    result += '\n';
+  }
+  return result;
+}
+
+void InjectionProfile::beginConstruction(fruit::impl::TypeId type, std::size_t allocated_bytes) {
+  Entry entry;
+  entry.type = type;
+  entry.depth = open_entries.size();
+  entry.parent = open_entries.empty() ? 0 : open_entries.back().index;
+  entry.total_time_ns = 0;
+  entry.self_time_ns = 0;
+  entry.total_allocated_bytes = 0;
+  entry.self_allocated_bytes = 0;
+  entries.push_back(entry);
+  
+  // The clock is read last, so that the time spent above isn't attributed to this entry.
+  open_entries.push_back(OpenEntry{entries.size() - 1, std::chrono::steady_clock::time_point(), allocated_bytes, 0, 0});
+  open_entries.back().start_time = std::chrono::steady_clock::now();
+}
+
+void InjectionProfile::endConstruction(std::size_t allocated_bytes) {
+  std::chrono::steady_clock::time_point end_time = std::chrono::steady_clock::now();
+  FruitAssert(!open_entries.empty());
+  OpenEntry open_entry = open_entries.back();
+  open_entries.pop_back();
+  
+  Entry& entry = entries[open_entry.index];
+  entry.total_time_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end_time - open_entry.start_time).count();
+  entry.self_time_ns = entry.total_time_ns - std::min(entry.total_time_ns, open_entry.nested_time_ns);
+  // The allocator never releases memory while objects are being constructed, so this can't underflow.
+  entry.total_allocated_bytes = allocated_bytes - open_entry.start_allocated_bytes;
+  entry.self_allocated_bytes = entry.total_allocated_bytes - open_entry.nested_allocated_bytes;
+  
+  if (!open_entries.empty()) {
+    open_entries.back().nested_time_ns += entry.total_time_ns;
+    open_entries.back().nested_allocated_bytes += entry.total_allocated_bytes;
+  }
+}
+
+void InjectionProfile::clear() {
+  entries.clear();
+  open_entries.clear();
+}
+
+} // namespace fruit
@@ -21,6 +21,9 @@
 #include <vector>
 #include <iostream>
 #include <algorithm>
+#include <condition_variable>
+#include <exception>
+#include <tuple>
 #include <fruit/impl/util/type_info.h>
 
 #include <fruit/impl/storage/injector_storage.h>
@@ -28,6 +31,7 @@
 #include <fruit/impl/data_structures/semistatic_graph.templates.h>
 #include <fruit/impl/meta/basics.h>
 #include <fruit/impl/storage/normalized_component_storage.h>
+#include <fruit/impl/storage/prepared_delta_storage.h>
 
 using std::cout;
 using std::endl;
@@ -72,13 +76,28 @@ namespace {
       return Value();
     }
   };
+  
+  // Used as the multibindings of the normalized component for child injectors, that don't have one (see the constructor
+  // that takes a parent InjectorStorage).
+  const NormalizedMultibindingTable& getEmptyMultibindingTable() {
+    static const NormalizedMultibindingTable empty_table;
+    return empty_table;
+  }
 }
 
-InjectorStorage::InjectorStorage(const ComponentStorage& component, const std::vector<TypeId>& exposed_types)
-  : normalized_component_storage_ptr(new NormalizedComponentStorage(component, exposed_types)),
-    allocator(normalized_component_storage_ptr->fixed_size_allocator_data),
-    bindings(normalized_component_storage_ptr->bindings, (DummyNode<TypeId, NormalizedBindingData>*)nullptr, (DummyNode<TypeId, NormalizedBindingData>*)nullptr),
-    multibindings(std::move(normalized_component_storage_ptr->multibindings)) {
+InjectorStorage::InjectorStorage(const ComponentStorage& component,
+                                 const std::vector<TypeId>& exposed_types,
+                                 MemoryResource& memory_resource)
+  : memory_resource(memory_resource),
+    normalized_component_storage_ptr(new NormalizedComponentStorage(component, exposed_types, memory_resource)),
+    allocator(normalized_component_storage_ptr->fixed_size_allocator_data, memory_resource),
+    bindings(normalized_component_storage_ptr->bindings,
+             (DummyNode<TypeId, NormalizedBindingData>*)nullptr,
+             (DummyNode<TypeId, NormalizedBindingData>*)nullptr,
+             memory_resource),
+    normalized_multibindings(&normalized_component_storage_ptr->multibindings) {
+  
+  initMultibindingObjects();
 
 #ifdef FRUIT_EXTRA_DEBUG
   bindings.checkFullyConstructed();
@@ -87,22 +106,45 @@ InjectorStorage::InjectorStorage(const ComponentStorage& component, const std::v
 
 InjectorStorage::InjectorStorage(const NormalizedComponentStorage& normalized_component,
                                  const ComponentStorage& component,
-                                 std::vector<TypeId>&& exposed_types)
-  : multibindings(normalized_component.multibindings) {
+                                 std::vector<TypeId>&& exposed_types,
+                                 MemoryResource& memory_resource)
+  : memory_resource(memory_resource),
+    base_normalized_component_id(normalized_component.id),
+    normalized_multibindings(&normalized_component.multibindings) {
 
   FixedSizeAllocator::FixedSizeAllocatorData fixed_size_allocator_data = normalized_component.fixed_size_allocator_data;
   
-  ;
+  mergeBindings(normalized_component, component, std::move(exposed_types),
+                bindings, multibindings, fixed_size_allocator_data, memory_resource);
+  
+  allocator = FixedSizeAllocator(fixed_size_allocator_data, memory_resource);
+  initMultibindingObjects();
+  
+#ifdef FRUIT_EXTRA_DEBUG
+  bindings.checkFullyConstructed();
+#endif
+}
+
+void InjectorStorage::mergeBindings(const NormalizedComponentStorage& normalized_component,
+                                    const ComponentStorage& component,
+                                    std::vector<TypeId>&& exposed_types,
+                                    Graph& bindings,
+                                    NormalizedMultibindingTable& multibindings,
+                                    FixedSizeAllocator::FixedSizeAllocatorData& fixed_size_allocator_data,
+                                    MemoryResource& memory_resource,
+                                    std::vector<TypeId>* undone_binding_compressions) {
+  std::unique_ptr<BindingSegment> flattened_segment;
+  const BindingSegment& flat_component = component.flatten(flattened_segment);
   
   // Step 1: Remove duplicates among the new bindings, and check for inconsistent bindings within `component' alone.
   // Note that we do NOT use component.compressed_bindings here, to avoid having to check if these compressions can be undone.
   // We don't expect many binding compressions here that weren't already performed in the normalized component.
   BindingNormalization::BindingCompressionInfoMap bindingCompressionInfoMapUnused;
   std::vector<std::pair<TypeId, BindingData>> normalized_bindings =
-      BindingNormalization::normalizeBindings(component.bindings,
+      BindingNormalization::normalizeBindings(flat_component.bindings,
                                               fixed_size_allocator_data,
                                               std::vector<CompressedBinding>{},
-                                              component.multibindings,
+                                              flat_component.multibindings,
                                               std::move(exposed_types),
                                               bindingCompressionInfoMapUnused);
   FruitAssert(bindingCompressionInfoMapUnused.empty());
@@ -115,12 +157,11 @@ InjectorStorage::InjectorStorage(const NormalizedComponentStorage& normalized_co
                             [&normalized_component, &binding_compressions_to_undo](const std::pair<TypeId, BindingData>& p) {
                               if (!p.second.isCreated()) {
                                 for (std::size_t i = 0; i < p.second.getDeps()->num_deps; ++i) {
-                                  auto binding_compression_itr = 
-                                      normalized_component.bindingCompressionInfoMap->find(p.second.getDeps()->deps[i]);
-                                  if (binding_compression_itr != normalized_component.bindingCompressionInfoMap->end()
-                                      && binding_compression_itr->second.iTypeId != p.first) {
+                                  const BindingNormalization::BindingCompressionInfo* binding_compression =
+                                      normalized_component.findBindingCompression(p.second.getDeps()->deps[i]);
+                                  if (binding_compression != nullptr && binding_compression->iTypeId != p.first) {
                                     // The binding compression for `p.second.getDeps()->deps[i]' must be undone because something
-                                    // different from binding_compression_itr->iTypeId is now bound to it.
+                                    // different from binding_compression->iTypeId is now bound to it.
                                     binding_compressions_to_undo.insert(p.second.getDeps()->deps[i]);
                                   }
                                 }
@@ -141,56 +182,774 @@ InjectorStorage::InjectorStorage(const NormalizedComponentStorage& normalized_co
   
   // Step 3: undo any binding compressions that can no longer be applied.
   for (TypeId cTypeId : binding_compressions_to_undo) {
-    auto binding_compression_itr = normalized_component.bindingCompressionInfoMap->find(cTypeId);
-    FruitAssert(binding_compression_itr != normalized_component.bindingCompressionInfoMap->end());
-    FruitAssert(!binding_compression_itr->second.iBinding.needsAllocation());
-    normalized_bindings.emplace_back(cTypeId, binding_compression_itr->second.cBinding);
+    const BindingNormalization::BindingCompressionInfo* binding_compression =
+        normalized_component.findBindingCompression(cTypeId);
+    FruitAssert(binding_compression != nullptr);
+    FruitAssert(!binding_compression->iBinding.needsAllocation());
+    normalized_bindings.emplace_back(cTypeId, binding_compression->cBinding);
     // This TypeId is already in normalized_component.bindings, we overwrite it here.
-    FruitAssert(!(normalized_component.bindings.find(binding_compression_itr->second.iTypeId) == normalized_component.bindings.end()));
-    normalized_bindings.emplace_back(binding_compression_itr->second.iTypeId, binding_compression_itr->second.iBinding);
+    FruitAssert(!(normalized_component.bindings.find(binding_compression->iTypeId) == normalized_component.bindings.end()));
+    normalized_bindings.emplace_back(binding_compression->iTypeId, binding_compression->iBinding);
+    if (undone_binding_compressions != nullptr) {
+      undone_binding_compressions->push_back(cTypeId);
+    }
 #ifdef FRUIT_EXTRA_DEBUG
-    std::cout << "InjectorStorage: undoing binding compression for: " << binding_compression_itr->second.iTypeId << "->" << cTypeId << std::endl;  
+    std::cout << "InjectorStorage: undoing binding compression for: " << binding_compression->iTypeId << "->" << cTypeId << std::endl;  
 #endif
   }
   
   bindings = Graph(normalized_component.bindings,
                    BindingDataNodeIter{normalized_bindings.begin()},
-                   BindingDataNodeIter{normalized_bindings.end()});
+                   BindingDataNodeIter{normalized_bindings.end()},
+                   memory_resource);
+  
+  // Step 4: Add multibindings. The ones of `normalized_component' are not copied, only the types that have multibindings in
+  // `component' are stored in the new table.
+  multibindings = NormalizedMultibindingTable(flat_component.multibindings,
+                                              &normalized_component.multibindings,
+                                              fixed_size_allocator_data,
+                                              memory_resource);
+}
+
+InjectorStorage::InjectorStorage(const PreparedDeltaStorage& prepared_delta,
+                                 const ComponentStorage& component,
+                                 std::vector<TypeId>&& exposed_types,
+                                 MemoryResource& memory_resource)
+  : memory_resource(memory_resource) {
+  initFromPreparedDelta(prepared_delta, component, std::move(exposed_types));
+}
+
+void InjectorStorage::initFromPreparedDelta(const PreparedDeltaStorage& prepared_delta,
+                                            const ComponentStorage& component,
+                                            std::vector<TypeId>&& exposed_types) {
+  std::unique_ptr<BindingSegment> flattened_segment;
+  const BindingSegment& flat_component = component.flatten(flattened_segment);
+  if (!prepared_delta.matches(flat_component)) {
+    // Slow path: `component' doesn't have the same shape as the prototype component, so we have to normalize its
+    // bindings as if the PreparedDelta wasn't there.
+    const NormalizedComponentStorage& normalized_component = prepared_delta.normalized_component;
+    FixedSizeAllocator::FixedSizeAllocatorData fixed_size_allocator_data = normalized_component.fixed_size_allocator_data;
+    mergeBindings(normalized_component, component, std::move(exposed_types),
+                  bindings, multibindings, fixed_size_allocator_data, memory_resource);
+    allocator = FixedSizeAllocator(fixed_size_allocator_data, memory_resource);
+    base_normalized_component_id = normalized_component.id;
+    normalized_multibindings = &normalized_component.multibindings;
+    initMultibindingObjects();
+    copied_prepared_delta = nullptr;
+    
+#ifdef FRUIT_EXTRA_DEBUG
+    bindings.checkFullyConstructed();
+#endif
+    return;
+  }
+  
+  // Fast path: the bindings have already been merged in `prepared_delta', we only need to copy them and then replace the
+  // objects of the instance bindings with the ones in `component'.
+  allocator = FixedSizeAllocator(prepared_delta.fixed_size_allocator_data, memory_resource);
+  bindings = Graph(prepared_delta.bindings,
+                   (DummyNode<TypeId, NormalizedBindingData>*)nullptr,
+                   (DummyNode<TypeId, NormalizedBindingData>*)nullptr,
+                   memory_resource);
+  // Only the elems need to be copied (so that they can be patched), the multibindings of the normalized component are
+  // shared.
+  multibindings = NormalizedMultibindingTable(prepared_delta.multibindings, memory_resource);
+  base_normalized_component_id = prepared_delta.normalized_component.id;
+  normalized_multibindings = &prepared_delta.normalized_component.multibindings;
+  initMultibindingObjects();
+  copied_prepared_delta = &prepared_delta;
+  
+  patchInstances(prepared_delta, flat_component);
+  
+#ifdef FRUIT_EXTRA_DEBUG
+  bindings.checkFullyConstructed();
+#endif
+}
+
+void InjectorStorage::patchInstances(const PreparedDeltaStorage& prepared_delta,
+                                     const BindingSegment& component) {
+  for (std::size_t i = 0; i < component.bindings.size(); ++i) {
+    if (prepared_delta.patchable_bindings[i]) {
+      const std::pair<TypeId, BindingData>& p = component.bindings[i];
+      bindings.at(p.first).getNode() = NormalizedBindingData(p.second.getObject());
+    }
+  }
+  for (std::size_t i = 0; i < component.multibindings.size(); ++i) {
+    std::size_t elem_index = prepared_delta.patchable_multibinding_indexes[i];
+    if (elem_index != PreparedDeltaStorage::not_patchable) {
+      const std::pair<TypeId, MultibindingData>& p = component.multibindings[i];
+      multibindings.elems[elem_index].object = p.second.object;
+    }
+  }
+}
+
+bool InjectorStorage::resetInPlace(const PreparedDeltaStorage& prepared_delta, const ComponentStorage& component) {
+  if (copied_prepared_delta != &prepared_delta) {
+    return false;
+  }
+  std::unique_ptr<BindingSegment> flattened_segment;
+  const BindingSegment& flat_component = component.flatten(flattened_segment);
+  if (!prepared_delta.matches(flat_component)) {
+    return false;
+  }
+  
+  // This destroys all the objects constructed so far, in reverse order of construction (as ~InjectorStorage() would do).
+  allocator.reset(prepared_delta.fixed_size_allocator_data);
+  constructed_any_object = false;
+  if (profile != nullptr) {
+    profile->clear();
+  }
+  
+  // `bindings' is a copy of prepared_delta.bindings with no additional nodes, so the node index map and the edges (shared
+  // with prepared_delta.bindings) are still valid; only the nodes need to be restored.
+  bindings.resetNodes(prepared_delta.bindings);
+  
+  // The multibinding vectors have just been destroyed by allocator.reset(), and the memory of the arrays of objects will be
+  // reused.
+  multibindings.resetElems(prepared_delta.multibindings);
+  for (MultibindingObjects& x : multibinding_objects) {
+    x = MultibindingObjects{nullptr, nullptr, nullptr};
+  }
+  
+  patchInstances(prepared_delta, flat_component);
+  
+  if (concurrent_objects != nullptr) {
+    for (std::size_t i = 0, num_nodes = bindings.numNodes(); i < num_nodes; ++i) {
+      concurrent_objects[i].store(nullptr, std::memory_order_relaxed);
+    }
+  }
+  
+#ifdef FRUIT_EXTRA_DEBUG
+  bindings.checkFullyConstructed();
+#endif
+  return true;
+}
+
+void InjectorStorage::reset(const PreparedDeltaStorage& prepared_delta,
+                            const ComponentStorage& component,
+                            std::vector<TypeId>&& exposed_types) {
+  bool concurrent = (concurrent_objects != nullptr);
+  releaseConcurrentObjects();
+  
+  // Destroy the existing objects first, in case their destructors release resources needed by the new bindings.
+  allocator = FixedSizeAllocator();
+  constructed_any_object = false;
+  if (profile != nullptr) {
+    profile->clear();
+  }
+  
+  // A child injector becomes a normal injector.
+  if (parent != nullptr) {
+    --parent->num_child_injectors;
+  }
+  parent = nullptr;
+  parent_nodes = FixedSizeVector<Graph::node_iterator>();
+  
+  initFromPreparedDelta(prepared_delta, component, std::move(exposed_types));
+  
+  // The old graph might have shared data with the NormalizedComponentStorage owned by this object, so we can only release
+  // it now.
+  normalized_component_storage_ptr.reset();
+  
+  if (concurrent) {
+    enableConcurrentInjection();
+  }
+}
+
+InjectorStorage::InjectorStorage(InjectorStorage& parent,
+                                 const ComponentStorage& component,
+                                 std::vector<TypeId>&& exposed_types,
+                                 MemoryResource& memory_resource)
+  : memory_resource(memory_resource),
+    normalized_multibindings(&getEmptyMultibindingTable()),
+    parent(&parent) {
+  ++parent.num_child_injectors;
+  std::unique_ptr<BindingSegment> flattened_segment;
+  const BindingSegment& flat_component = component.flatten(flattened_segment);
+  
+  // Step 1: normalize the bindings of `component' alone. As in mergeBindings(), binding compressions are not performed.
+  FixedSizeAllocator::FixedSizeAllocatorData fixed_size_allocator_data;
+  BindingNormalization::BindingCompressionInfoMap bindingCompressionInfoMapUnused;
+  std::vector<std::pair<TypeId, BindingData>> normalized_bindings =
+      BindingNormalization::normalizeBindings(flat_component.bindings,
+                                              fixed_size_allocator_data,
+                                              std::vector<CompressedBinding>{},
+                                              flat_component.multibindings,
+                                              exposed_types,
+                                              bindingCompressionInfoMapUnused);
+  FruitAssert(bindingCompressionInfoMapUnused.empty());
+  
+  // Step 2: drop the bindings for types that are already bound in `parent', those objects are shared with the parent.
+  // As in mergeBindings(), bindings that differ from the parent's are a fatal error.
+  auto itr = std::remove_if(normalized_bindings.begin(), normalized_bindings.end(),
+                            [&parent](const std::pair<TypeId, BindingData>& p) {
+                              Graph::node_iterator parent_itr = parent.bindings.find(p.first);
+                              if (parent_itr == parent.bindings.end()) {
+                                return false;
+                              }
+                              parent.checkSameBindingAsParent(p.first, parent_itr, p.second);
+                              return true;
+                            });
+  normalized_bindings.erase(itr, normalized_bindings.end());
+  
+  // Step 3: add a node for each type of `parent' that this injector might need: the dependencies of the remaining bindings
+  // and of the multibindings of `component', and the exposed types. If the parent's object is already constructed, the node
+  // is a terminal node with that object; otherwise it's a node with no dependencies that gets the object from the parent
+  // (see createFromParent()). Both kinds of node don't allocate anything in this injector.
+  static const BindingDeps no_deps{nullptr, 0};
+  HashSet<TypeId> bound_types = createHashSet<TypeId>(normalized_bindings.size());
+  for (const std::pair<TypeId, BindingData>& p : normalized_bindings) {
+    bound_types.insert(p.first);
+  }
+  std::vector<std::pair<TypeId, Graph::node_iterator>> forwarded_nodes;
+  std::size_t num_normalized_bindings = normalized_bindings.size();
+  auto addParentNode = [&](TypeId type) {
+    if (!bound_types.insert(type).second) {
+      return;
+    }
+    Graph::node_iterator parent_itr = parent.bindings.find(type);
+    if (parent_itr == parent.bindings.end()) {
+      // Not bound anywhere. This can't happen for the types that are actually injected, since those are checked at compile
+      // time; the graph will contain a placeholder node as usual.
+      return;
+    }
+    void* object = nullptr;
+    if (parent.concurrent_objects != nullptr) {
+      // The parent's node might be being modified by another thread, we can only read its slot in concurrent_objects.
+      object = parent.concurrent_objects[parent.bindings.nodeIndex(parent_itr)].load(std::memory_order_acquire);
+    } else if (parent_itr.isTerminal()) {
+      object = parent_itr.getConstNode().getObject();
+    }
+    if (object != nullptr) {
+      normalized_bindings.emplace_back(type, BindingData(object));
+    } else {
+      normalized_bindings.emplace_back(type, BindingData(createFromParent, &no_deps, false /* needs_allocation */));
+      forwarded_nodes.emplace_back(type, parent_itr);
+    }
+  };
+  for (std::size_t i = 0; i < num_normalized_bindings; ++i) {
+    // Note that normalized_bindings[i] can't be used as a reference here, since addParentNode() might reallocate the vector.
+    BindingData binding_data = normalized_bindings[i].second;
+    if (!binding_data.isCreated()) {
+      const BindingDeps* deps = binding_data.getDeps();
+      for (std::size_t j = 0; j < deps->num_deps; ++j) {
+        addParentNode(deps->deps[j]);
+      }
+    }
+  }
+  for (const std::pair<TypeId, MultibindingData>& p : flat_component.multibindings) {
+    if (p.second.deps != nullptr) {
+      for (std::size_t j = 0; j < p.second.deps->num_deps; ++j) {
+        addParentNode(p.second.deps->deps[j]);
+      }
+    }
+  }
+  for (TypeId type : exposed_types) {
+    addParentNode(type);
+  }
+  
+  bindings = Graph(BindingDataNodeIter{normalized_bindings.begin()},
+                   BindingDataNodeIter{normalized_bindings.end()},
+                   memory_resource);
   
-  // Step 4: Add multibindings.
-  BindingNormalization::addMultibindings(multibindings, fixed_size_allocator_data, std::move(component.multibindings));
+  parent_nodes = FixedSizeVector<Graph::node_iterator>(bindings.numNodes(), parent.bindings.end(), memory_resource);
+  for (const std::pair<TypeId, Graph::node_iterator>& p : forwarded_nodes) {
+    parent_nodes[bindings.nodeIndex(bindings.at(p.first))] = p.second;
+  }
+  
+  // Step 4: the multibindings. The ones of `parent' are not copied: the objects constructed by the parent are prepended to
+  // the ones of this injector when they're needed (see ensureConstructedMultibindings()), so here we only reserve space
+  // for them.
+  multibindings = NormalizedMultibindingTable(flat_component.multibindings,
+                                              nullptr,
+                                              fixed_size_allocator_data,
+                                              memory_resource);
+  for (std::size_t i = 0; i < multibindings.numGroups(); ++i) {
+    fixed_size_allocator_data.addPointerArray(parent.numMultibindings(multibindings.getGroup(i).type));
+  }
+  
+  allocator = FixedSizeAllocator(fixed_size_allocator_data, memory_resource);
+  initMultibindingObjects();
   
-  allocator = FixedSizeAllocator(fixed_size_allocator_data);
+#ifdef FRUIT_EXTRA_DEBUG
+  bindings.checkFullyConstructed();
+#endif
+}
+
+void InjectorStorage::checkSameBindingAsParent(TypeId type,
+                                               Graph::node_iterator node_itr,
+                                               const BindingData& binding_data) {
+  if (parent != nullptr && !(parent_nodes[bindings.nodeIndex(node_itr)] == parent->bindings.end())) {
+    // This node forwards to the parent, the binding is there.
+    parent->checkSameBindingAsParent(type, parent_nodes[bindings.nodeIndex(node_itr)], binding_data);
+    return;
+  }
+  std::unique_lock<std::recursive_mutex> lock;
+  if (concurrent_objects != nullptr) {
+    // The node might be being modified by another thread.
+    lock = std::unique_lock<std::recursive_mutex>(concurrent_injection_mutex);
+  }
+  if (node_itr.isTerminal() && !binding_data.isCreated()) {
+    // Once the object is constructed the node only holds the object, so the original binding can't be compared.
+    fatal("the type " + type.type_info->name() + " is bound both in the component of a child injector and in its parent "
+          + "injector (that has already constructed it), and these bindings can't be checked to be the same. Expose this "
+          + "type in the parent injector and don't bind it again in the child's component.");
+  }
+  if (!(node_itr.getConstNode() == NormalizedBindingData(binding_data))) {
+    std::cerr << multipleBindingsError(type) << std::endl;
+    exit(1);
+  }
+}
+
+BindingData::object_t InjectorStorage::createFromParent(InjectorStorage& storage, Graph::node_iterator node_itr) {
+  InjectorStorage& parent = *storage.parent;
+  void* object = parent.getPtrInternal(storage.parent_nodes[storage.bindings.nodeIndex(node_itr)]);
+  node_itr.setTerminal();
+  return object;
+}
+
+InjectorStorage::InjectorStorage(const NormalizedComponentStorage& normalized_component, MemoryResource& memory_resource)
+  : memory_resource(memory_resource),
+    allocator(normalized_component.fixed_size_allocator_data, memory_resource),
+    bindings(normalized_component.bindings,
+             (DummyNode<TypeId, NormalizedBindingData>*)nullptr,
+             (DummyNode<TypeId, NormalizedBindingData>*)nullptr,
+             memory_resource),
+    base_normalized_component_id(normalized_component.id),
+    normalized_multibindings(&normalized_component.multibindings) {
   
+  initMultibindingObjects();
+
 #ifdef FRUIT_EXTRA_DEBUG
   bindings.checkFullyConstructed();
 #endif
 }
 
 InjectorStorage::~InjectorStorage() {
+  if (parent != nullptr) {
+    --parent->num_child_injectors;
+  }
+  releaseConcurrentObjects();
+  if (frozen_objects != nullptr) {
+    frozen_objects_memory_resource->deallocate(frozen_objects, num_frozen_objects * sizeof(void*), alignof(void*));
+  }
+}
+
+void* InjectorStorage::getPtrInternalConcurrent(Graph::node_iterator node_itr) {
+  std::lock_guard<std::recursive_mutex> lock(concurrent_injection_mutex);
+  std::atomic<void*>& object = concurrent_objects[bindings.nodeIndex(node_itr)];
+  // Another thread might have constructed the object while we were waiting for the lock.
+  // A relaxed load is enough here, since all stores happen while holding the lock.
+  void* p = object.load(std::memory_order_relaxed);
+  if (p == nullptr) {
+    if (!node_itr.isTerminal()) {
+      constructed_any_object = true;
+      node_itr.getNode().create(*this, node_itr);
+      FruitAssert(node_itr.isTerminal());
+    }
+    p = node_itr.getConstNode().getObject();
+    // This publishes the object (and anything done by its constructor) to threads that read it without holding the lock.
+    object.store(p, std::memory_order_release);
+  }
+  return p;
+}
+
+void InjectorStorage::enableConcurrentInjection() {
+  if (concurrent_objects != nullptr) {
+    // Already enabled.
+    return;
+  }
+  // Nodes are then modified by several threads, and concurrently read by child injectors. So they can't be in pages shared
+  // with the normalized component, that would be copied (and replaced) when modifying a node for the first time.
+  // Only the nodes that are not constructed yet will be modified, so the pages that only contain constructed objects (e.g.
+  // the ones bound with bindInstance()) stay shared.
+  bindings.copySharedPagesOfNonTerminalNodes();
+  std::size_t num_nodes = bindings.numNodes();
+  std::atomic<void*>* objects = reinterpret_cast<std::atomic<void*>*>(
+      memory_resource.allocate(num_nodes * sizeof(std::atomic<void*>), alignof(std::atomic<void*>)));
+  for (std::size_t i = 0; i < num_nodes; ++i) {
+    new (objects + i) std::atomic<void*>(nullptr);
+  }
+  concurrent_objects = objects;
+}
+
+void InjectorStorage::enableProfiling() {
+#if FRUIT_ENABLE_PROFILING
+  profile.reset(new InjectionProfile());
+  active_profile = profile.get();
+#endif
+}
+
+const InjectionProfile& InjectorStorage::getProfile() const {
+  static const InjectionProfile empty_profile{};
+  if (profile == nullptr) {
+    return empty_profile;
+  }
+  return *profile;
+}
+
+void InjectorStorage::releaseConcurrentObjects() {
+  if (concurrent_objects == nullptr) {
+    return;
+  }
+  // std::atomic<void*> is trivially destructible, so there's no need to call the destructors.
+  memory_resource.deallocate(concurrent_objects,
+                             bindings.numNodes() * sizeof(std::atomic<void*>),
+                             alignof(std::atomic<void*>));
+  concurrent_objects = nullptr;
+}
+
+std::size_t InjectorStorage::findMultibindings(TypeId type) const {
+  // The types in `multibindings' must be looked up first, since they also include the multibindings in
+  // *normalized_multibindings.
+  std::size_t i = multibindings.find(type);
+  if (i != multibindings.numGroups()) {
+    return i;
+  }
+  return multibindings.numGroups() + normalized_multibindings->find(type);
+}
+
+std::size_t InjectorStorage::numMultibindings(TypeId type) const {
+  std::size_t num_multibindings = (parent != nullptr) ? parent->numMultibindings(type) : 0;
+  std::size_t i = findMultibindings(type);
+  if (i != multibinding_objects.size()) {
+    const NormalizedMultibindingData& multibinding_data = getNormalizedMultibindingData(i);
+    num_multibindings += multibinding_data.elems_end - multibinding_data.elems_begin;
+  }
+  return num_multibindings;
+}
+
+const NormalizedMultibindingData& InjectorStorage::getNormalizedMultibindingData(std::size_t i) const {
+  if (i < multibindings.numGroups()) {
+    return multibindings.getGroup(i);
+  }
+  return normalized_multibindings->getGroup(i - multibindings.numGroups());
 }
 
-void InjectorStorage::ensureConstructedMultibinding(NormalizedMultibindingData& bindingDataForMultibinding) {
-  for (NormalizedMultibindingData::Elem& elem : bindingDataForMultibinding.elems) {
-    if (elem.object == nullptr) {
-      elem.object = elem.create(*this);
+InjectorStorage::MultibindingObjects& InjectorStorage::ensureConstructedMultibindings(std::size_t i) {
+  MultibindingObjects& objects = multibinding_objects[i];
+  if (objects.objects_begin == nullptr) {
+    const NormalizedMultibindingData& multibinding_data = getNormalizedMultibindingData(i);
+    std::size_t num_objects = multibinding_data.elems_end - multibinding_data.elems_begin;
+    // In a child injector, the objects of the parent come first. They're constructed (if needed) by the parent.
+    std::pair<void* const*, void* const*> parent_objects(nullptr, nullptr);
+    if (parent != nullptr) {
+      parent_objects = parent->getMultibindingsRange(multibinding_data.type);
+    }
+    std::size_t num_parent_objects = parent_objects.second - parent_objects.first;
+    // The space for this array was reserved by NormalizedMultibindingTable (and, for the objects of the parent, by the
+    // constructor of the child injector).
+    void** array = allocator.allocatePointerArray(num_parent_objects + num_objects);
+    std::copy(parent_objects.first, parent_objects.second, array);
+    constructed_any_object = true;
+    for (std::size_t j = 0; j < num_objects; ++j) {
+      const NormalizedMultibindingData::Elem& elem = multibinding_data.elems_begin[j];
+      // The elems are shared with other injectors, so objects constructed here are only stored in the array.
+      array[num_parent_objects + j] = (elem.object != nullptr) ? elem.object : elem.create(*this);
     }
+    objects.objects_end = array + num_parent_objects + num_objects;
+    objects.objects_begin = array;
   }
+  return objects;
 }
 
-void* InjectorStorage::getMultibindings(TypeId typeInfo) {
-  NormalizedMultibindingData* bindingDataVector = getNormalizedMultibindingData(typeInfo);
-  if (bindingDataVector == nullptr) {
-    // Not registered.
-    return nullptr;
+void* InjectorStorage::getMultibindings(TypeId type) {
+  std::unique_lock<std::recursive_mutex> lock;
+  if (concurrent_objects != nullptr) {
+    lock = std::unique_lock<std::recursive_mutex>(concurrent_injection_mutex);
+  }
+  std::size_t i = findMultibindings(type);
+  if (i == multibinding_objects.size()) {
+    // Not registered here, but a child injector shares the multibindings of its parent.
+    return (parent != nullptr) ? parent->getMultibindings(type) : nullptr;
+  }
+  MultibindingObjects& objects = ensureConstructedMultibindings(i);
+  if (objects.vector == nullptr) {
+    objects.vector = getNormalizedMultibindingData(i).get_multibindings_vector(*this,
+                                                                               objects.objects_begin,
+                                                                               objects.objects_end);
+  }
+  return objects.vector;
+}
+
+std::pair<void* const*, void* const*> InjectorStorage::getMultibindingsRange(TypeId type) {
+  std::unique_lock<std::recursive_mutex> lock;
+  if (concurrent_objects != nullptr) {
+    lock = std::unique_lock<std::recursive_mutex>(concurrent_injection_mutex);
+  }
+  std::size_t i = findMultibindings(type);
+  if (i == multibinding_objects.size()) {
+    // Not registered here, but a child injector shares the multibindings of its parent.
+    if (parent != nullptr) {
+      return parent->getMultibindingsRange(type);
+    }
+    return std::pair<void* const*, void* const*>(nullptr, nullptr);
   }
-  return bindingDataVector->get_multibindings_vector(*this).get();
+  MultibindingObjects& objects = ensureConstructedMultibindings(i);
+  return std::pair<void* const*, void* const*>(objects.objects_begin, objects.objects_end);
+}
+
+void InjectorStorage::initMultibindingObjects() {
+  multibinding_objects = FixedSizeVector<MultibindingObjects>(
+      multibindings.numGroups() + normalized_multibindings->numGroups(),
+      MultibindingObjects{nullptr, nullptr, nullptr},
+      memory_resource);
 }
 
 void InjectorStorage::eagerlyInjectMultibindings() {
-  for (auto& typeInfoInfoPair : multibindings) {
-    typeInfoInfoPair.second.get_multibindings_vector(*this);
+  std::unique_lock<std::recursive_mutex> lock;
+  if (concurrent_objects != nullptr) {
+    lock = std::unique_lock<std::recursive_mutex>(concurrent_injection_mutex);
+  }
+  for (std::size_t i = 0; i < multibinding_objects.size(); ++i) {
+    if (i >= multibindings.numGroups()
+        && multibindings.find(normalized_multibindings->getGroup(i - multibindings.numGroups()).type)
+            != multibindings.numGroups()) {
+      // This type is also in `multibindings', so this group is never used.
+      continue;
+    }
+    ensureConstructedMultibindings(i);
+  }
+}
+
+std::vector<std::vector<InjectorStorage::Graph::node_iterator>> InjectorStorage::getNodesByLayer(
+    const Graph::node_iterator* roots_begin, const Graph::node_iterator* roots_end) {
+  const std::size_t unvisited = ~std::size_t(0);
+  const std::size_t in_progress = unvisited - 1;
+  
+  Graph::node_iterator bindings_begin = bindings.begin();
+  
+  // Nodes that are already constructed are in layer 0, the other ones are in the layer after the last layer of their
+  // dependencies.
+  // This is a non-recursive DFS, since the dependency chains might be long.
+  std::vector<std::size_t> layers(bindings.numNodes(), unvisited);
+  // nodes_by_layer[i] contains the nodes in layer i+1.
+  std::vector<std::vector<Graph::node_iterator>> nodes_by_layer;
+  // Each element contains a node and the edge iterator to its next neighbor to visit.
+  std::vector<std::pair<Graph::node_iterator, Graph::edge_iterator>> stack;
+  
+  // In a child injector, the nodes that forward to the parent are resolved here, on this thread: the parent might not be in
+  // concurrent mode, so its objects can't be constructed by the tasks below.
+  auto resolveIfForwarded = [this](Graph::node_iterator node_itr) {
+    if (parent != nullptr
+        && !node_itr.isTerminal()
+        && !(parent_nodes[bindings.nodeIndex(node_itr)] == parent->bindings.end())) {
+      getPtrInternal(node_itr);
+    }
+  };
+  
+  for (const Graph::node_iterator* root_itr = roots_begin; root_itr != roots_end; ++root_itr) {
+    Graph::node_iterator root = *root_itr;
+    resolveIfForwarded(root);
+    std::size_t& root_layer = layers[bindings.nodeIndex(root)];
+    if (root_layer != unvisited) {
+      continue;
+    }
+    if (root.isTerminal()) {
+      root_layer = 0;
+      continue;
+    }
+    root_layer = in_progress;
+    stack.push_back(std::make_pair(root, root.neighborsBegin()));
+    
+    while (!stack.empty()) {
+      Graph::node_iterator node_itr = stack.back().first;
+      Graph::edge_iterator& edge_itr = stack.back().second;
+      if (edge_itr.isEnd()) {
+        // All dependencies have been visited.
+        std::size_t layer = 1;
+        for (Graph::edge_iterator i = node_itr.neighborsBegin(); !i.isEnd(); ++i) {
+          std::size_t neighbor_layer = layers[bindings.nodeIndex(i.getNodeIterator(bindings_begin))];
+          FruitAssert(neighbor_layer < in_progress);
+          layer = std::max(layer, neighbor_layer + 1);
+        }
+        layers[bindings.nodeIndex(node_itr)] = layer;
+        if (nodes_by_layer.size() < layer) {
+          nodes_by_layer.resize(layer);
+        }
+        nodes_by_layer[layer - 1].push_back(node_itr);
+        stack.pop_back();
+        continue;
+      }
+      
+      Graph::node_iterator neighbor_itr = edge_itr.getNodeIterator(bindings_begin);
+      ++edge_itr;
+      std::size_t& neighbor_layer = layers[bindings.nodeIndex(neighbor_itr)];
+      // Dependency loops are detected when constructing the component, so there can't be any here.
+      FruitAssert(neighbor_layer != in_progress);
+      if (neighbor_layer == unvisited) {
+        resolveIfForwarded(neighbor_itr);
+        if (neighbor_itr.isTerminal()) {
+          neighbor_layer = 0;
+        } else {
+          neighbor_layer = in_progress;
+          // Note that this invalidates edge_itr.
+          stack.push_back(std::make_pair(neighbor_itr, neighbor_itr.neighborsBegin()));
+        }
+      }
+    }
+  }
+  
+  return nodes_by_layer;
+}
+
+void InjectorStorage::eagerlyInjectAllInParallel(const std::vector<TypeId>& types,
+                                                 const std::function<void(std::function<void()>)>& schedule) {
+  // In concurrent mode other threads might use this injector meanwhile. While this lock is held they can still get the
+  // objects that are already constructed (that doesn't require the lock), but if they need to construct an object they
+  // wait until this method completes.
+  std::unique_lock<std::recursive_mutex> concurrent_injection_lock;
+  if (concurrent_objects != nullptr) {
+    concurrent_injection_lock = std::unique_lock<std::recursive_mutex>(concurrent_injection_mutex);
+  }
+  
+  // Step 1: assign a layer to each node reachable from `types'.
+  std::vector<Graph::node_iterator> roots;
+  roots.reserve(types.size());
+  for (TypeId type : types) {
+    roots.push_back(bindings.at(type));
+  }
+  std::vector<std::vector<Graph::node_iterator>> nodes_by_layer =
+      getNodesByLayer(roots.data(), roots.data() + roots.size());
+  
+  // Step 2: construct the nodes, one layer at a time. The nodes in a layer only depend on nodes in previous layers, so
+  // they can be constructed concurrently.
+  // Since a layer only starts after the previous one is complete, each object is registered in the allocator after all
+  // its dependencies, so they are still destroyed in the right order.
+  // Two nodes in the same page might be modified at the same time, so the pages of the nodes that will be constructed
+  // can't be copied lazily. The other pages stay shared.
+  // In concurrent mode the tasks get the dependencies from concurrent_objects, and they can't construct them under the lock
+  // held by this thread (that would deadlock). The dependencies constructed here are stored there by the task that
+  // constructs them, the ones that were already constructed are stored there now.
+  Graph::node_iterator bindings_begin = bindings.begin();
+  for (const std::vector<Graph::node_iterator>& layer_nodes : nodes_by_layer) {
+    for (Graph::node_iterator node_itr : layer_nodes) {
+      bindings.copySharedPage(node_itr);
+      if (concurrent_objects != nullptr) {
+        for (Graph::edge_iterator i = node_itr.neighborsBegin(); !i.isEnd(); ++i) {
+          Graph::node_iterator neighbor_itr = i.getNodeIterator(bindings_begin);
+          if (neighbor_itr.isTerminal()) {
+            concurrent_objects[bindings.nodeIndex(neighbor_itr)].store(neighbor_itr.getConstNode().getObject(),
+                                                                       std::memory_order_release);
+          }
+        }
+      }
+    }
+  }
+  std::mutex allocator_mutex;
+  allocator.setMutex(&allocator_mutex);
+  InjectionProfile* suspended_profile = active_profile;
+  active_profile = nullptr;
+  constructed_any_object = true;
+  
+  std::mutex mutex;
+  std::condition_variable all_done;
+  std::size_t num_pending_tasks = 0;
+  // The first exception thrown by a task (or by `schedule'). Once it's set no other layer is started, and it's rethrown on
+  // this thread after the tasks already scheduled have completed (they refer to the local variables of this function).
+  std::exception_ptr exception;
+  
+  // Marks a task as completed when destroyed, even if the construction threw.
+  struct TaskCompletion {
+    std::mutex& mutex;
+    std::condition_variable& all_done;
+    std::size_t& num_pending_tasks;
+    
+    ~TaskCompletion() {
+      std::lock_guard<std::mutex> lock(mutex);
+      --num_pending_tasks;
+      if (num_pending_tasks == 0) {
+        all_done.notify_all();
+      }
+    }
+  };
+  
+  for (const std::vector<Graph::node_iterator>& layer_nodes : nodes_by_layer) {
+    num_pending_tasks = layer_nodes.size();
+    for (std::size_t i = 0; i < layer_nodes.size(); ++i) {
+      Graph::node_iterator node_itr = layer_nodes[i];
+      try {
+        schedule([this, node_itr, &mutex, &all_done, &num_pending_tasks, &exception]() {
+          TaskCompletion completion{mutex, all_done, num_pending_tasks};
+          try {
+            Graph::node_iterator itr = node_itr;
+            NormalizedBindingData& binding_data = itr.getNode();
+            binding_data.create(*this, itr);
+            FruitAssert(itr.isTerminal());
+            if (concurrent_objects != nullptr) {
+              concurrent_objects[bindings.nodeIndex(itr)].store(binding_data.getObject(), std::memory_order_release);
+            }
+          } catch (...) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!exception) {
+              exception = std::current_exception();
+            }
+          }
+        });
+      } catch (...) {
+        // The tasks for this node and for the following ones in this layer will never run.
+        std::lock_guard<std::mutex> lock(mutex);
+        num_pending_tasks -= layer_nodes.size() - i;
+        if (!exception) {
+          exception = std::current_exception();
+        }
+        break;
+      }
+    }
+    std::unique_lock<std::mutex> lock(mutex);
+    all_done.wait(lock, [&num_pending_tasks]() {
+      return num_pending_tasks == 0;
+    });
+    if (exception) {
+      break;
+    }
+  }
+  
+  allocator.setMutex(nullptr);
+  active_profile = suspended_profile;
+  if (exception) {
+    std::rethrow_exception(exception);
   }
+  
+  // Step 3: multibindings are constructed on this thread.
+  eagerlyInjectMultibindings();
+}
+
+void* const* InjectorStorage::freeze(const Graph::node_iterator* exposed_nodes_begin,
+                                     const Graph::node_iterator* exposed_nodes_end,
+                                     MemoryResource& objects_memory_resource) {
+  FruitAssert(frozen_objects == nullptr);
+  if (constructed_any_object) {
+    fatal("a FrozenInjector can only be constructed from an Injector that hasn't constructed any object yet.");
+  }
+  if (num_child_injectors != 0) {
+    fatal("a FrozenInjector can't be constructed from an Injector that has child injectors.");
+  }
+  
+  // The nodes are constructed in the same order as in eagerlyInjectAllInParallel(), so that the dependencies of each node
+  // (including the ones injected through a Provider) are already constructed when it's constructed.
+  for (const std::vector<Graph::node_iterator>& layer_nodes : getNodesByLayer(exposed_nodes_begin, exposed_nodes_end)) {
+    for (Graph::node_iterator node_itr : layer_nodes) {
+      getPtrInternal(node_itr);
+    }
+  }
+  eagerlyInjectMultibindings();
+  
+  std::size_t num_objects = exposed_nodes_end - exposed_nodes_begin;
+  void** objects = reinterpret_cast<void**>(objects_memory_resource.allocate(num_objects * sizeof(void*), alignof(void*)));
+  for (std::size_t i = 0; i < num_objects; ++i) {
+    objects[i] = getPtrInternal(exposed_nodes_begin[i]);
+  }
+  frozen_objects = objects;
+  num_frozen_objects = num_objects;
+  frozen_objects_memory_resource = &objects_memory_resource;
+  
+  // All the nodes that can still be reached are terminal, so what's only needed to construct objects can be released.
+  // Without concurrent_objects, getPtrInternal() just reads the (terminal) node, without locking.
+  releaseConcurrentObjects();
+  parent_nodes = FixedSizeVector<Graph::node_iterator>();
+  bindings.releaseEdges();
+  
+  return objects;
 }
 
 } // namespace impl
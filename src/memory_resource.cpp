@@ -0,0 +1,49 @@
+/*
+ * Copyright 2014 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define IN_FRUIT_CPP_FILE
+
+#include <fruit/memory_resource.h>
+
+#include <new>
+
+namespace fruit {
+
+namespace {
+
+class DefaultMemoryResource : public MemoryResource {
+public:
+  void* allocate(std::size_t bytes, std::size_t alignment) override {
+    // operator new always returns memory aligned to alignof(std::max_align_t), and that's the maximum alignment allowed.
+    (void)alignment;
+    return operator new(bytes);
+  }
+  
+  void deallocate(void* p, std::size_t bytes, std::size_t alignment) override {
+    (void)bytes;
+    (void)alignment;
+    operator delete(p);
+  }
+};
+
+} // namespace
+
+MemoryResource& getDefaultMemoryResource() {
+  static DefaultMemoryResource default_memory_resource;
+  return default_memory_resource;
+}
+
+} // namespace fruit
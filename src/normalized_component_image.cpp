@@ -0,0 +1,483 @@
+/*
+ * Copyright 2014 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#define IN_FRUIT_CPP_FILE
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <fruit/impl/storage/normalized_component_image.h>
+#include <fruit/impl/storage/normalized_component_storage.h>
+#include <fruit/impl/storage/component_storage.h>
+
+#include <fruit/impl/data_structures/semistatic_map.templates.h>
+#include <fruit/impl/data_structures/semistatic_graph.templates.h>
+
+using namespace fruit;
+using namespace fruit::impl;
+
+namespace {
+
+// "FRUITIMG" on little-endian platforms. Images written on a platform with a different endianness are rejected, since the
+// magic number won't match.
+constexpr std::uint64_t image_magic = 0x474d495449555246ull;
+
+// This must be incremented when the image format changes.
+constexpr std::uint64_t image_version = 4;
+
+// Images can only be loaded by a binary with the same pointer size and the same FRUIT_EXTRA_DEBUG setting, since these
+// affect the layout of the data structures.
+constexpr std::uint64_t image_layout = sizeof(void*)
+#ifdef FRUIT_EXTRA_DEBUG
+    | 0x100
+#endif
+    ;
+
+// The positions of the words in the image header. The header is followed by the payload, written by an ImageWriter.
+constexpr std::size_t header_magic = 0;
+constexpr std::size_t header_version = 1;
+constexpr std::size_t header_layout = 2;
+constexpr std::size_t header_fingerprint_hash = 3;
+constexpr std::size_t header_shape_hash = 4;
+constexpr std::size_t header_dictionary_size = 5;
+constexpr std::size_t header_payload_size = 6;
+constexpr std::size_t header_payload_checksum = 7;
+constexpr std::size_t num_header_words = 8;
+
+// The hashes in the header use FNV-1a. These only need to detect accidental mismatches, not malicious ones.
+constexpr std::uint64_t fnv_offset_basis = 14695981039346656037ull;
+constexpr std::uint64_t fnv_prime = 1099511628211ull;
+
+inline void hashCombine(std::uint64_t& hash, std::uint64_t x) {
+  hash = (hash ^ x) * fnv_prime;
+}
+
+std::uint64_t hashString(const std::string& s) {
+  std::uint64_t hash = fnv_offset_basis;
+  for (char c : s) {
+    hashCombine(hash, static_cast<unsigned char>(c));
+  }
+  return hash;
+}
+
+// Returns a hash of the name of `type'. This is 0 if RTTI is disabled, so in that case types can only be told apart by
+// their position in the component.
+std::uint64_t hashTypeName(TypeId type) {
+  std::uint64_t hash = fnv_offset_basis;
+  const char* name = type.type_info->rawName();
+  if (name != nullptr) {
+    for (const char* p = name; *p != '\0'; ++p) {
+      hashCombine(hash, static_cast<unsigned char>(*p));
+    }
+  }
+  return hash;
+}
+
+std::uint64_t hashWords(const char* words_begin, std::size_t num_words) {
+  std::uint64_t hash = fnv_offset_basis;
+  for (std::size_t i = 0; i < num_words; ++i) {
+    std::uint64_t word;
+    std::memcpy(&word, words_begin + i * sizeof(std::uint64_t), sizeof(std::uint64_t));
+    hashCombine(hash, word);
+  }
+  return hash;
+}
+
+} // namespace
+
+namespace fruit {
+namespace impl {
+
+ImageWriter::ImageWriter(const std::vector<const void*>& dictionary)
+  : pointer_indexes(createHashMap<const void*, std::size_t>(dictionary.size())) {
+  for (std::size_t i = 0; i < dictionary.size(); ++i) {
+    // If the pointer is already in the map, this keeps the first index.
+    pointer_indexes.insert(std::make_pair(dictionary[i], i + 1));
+  }
+}
+
+void ImageWriter::writeWord(std::uint64_t x) {
+  words.push_back(x);
+}
+
+void ImageWriter::writePointer(const void* p) {
+  if (p == nullptr) {
+    writeWord(0);
+    return;
+  }
+  auto itr = pointer_indexes.find(p);
+  if (itr == pointer_indexes.end()) {
+    failed = true;
+    writeWord(0);
+    return;
+  }
+  writeWord(itr->second);
+}
+
+void ImageWriter::write(TypeId x) {
+  writePointer(x.type_info);
+}
+
+void ImageWriter::write(std::size_t x) {
+  writeWord(x);
+}
+
+void ImageWriter::write(SemistaticGraphInternalNodeId x) {
+  writeWord(x.id);
+}
+
+void ImageWriter::write(NormalizedBindingData x) {
+  // This is either the create operation or the object, both are stored in the same way.
+  writePointer(x.getObject());
+}
+
+void ImageWriter::write(BindingData x) {
+  writeWord(x.isCreated());
+  if (x.isCreated()) {
+    writePointer(x.getObject());
+  } else {
+    writePointer(reinterpret_cast<void*>(x.getCreate()));
+    writePointer(x.getDeps());
+    writeWord(x.needsAllocation());
+  }
+}
+
+bool ImageWriter::hasFailed() const {
+  return failed;
+}
+
+const std::vector<std::uint64_t>& ImageWriter::getWords() const {
+  return words;
+}
+
+ImageReader::ImageReader(const char* words_begin, std::size_t num_words, const std::vector<const void*>& dictionary)
+  : next(words_begin), num_remaining_words(num_words), dictionary(dictionary) {
+}
+
+std::uint64_t ImageReader::readWord() {
+  if (num_remaining_words == 0) {
+    failed = true;
+    return 0;
+  }
+  std::uint64_t word;
+  std::memcpy(&word, next, sizeof(std::uint64_t));
+  next += sizeof(std::uint64_t);
+  --num_remaining_words;
+  return word;
+}
+
+std::size_t ImageReader::readSize(std::size_t words_per_elem) {
+  std::uint64_t n = readWord();
+  if (n > num_remaining_words / words_per_elem) {
+    failed = true;
+    return 0;
+  }
+  return std::size_t(n);
+}
+
+const void* ImageReader::readPointer() {
+  std::uint64_t index = readWord();
+  if (index == 0) {
+    return nullptr;
+  }
+  if (index > dictionary.size()) {
+    failed = true;
+    return nullptr;
+  }
+  return dictionary[index - 1];
+}
+
+void ImageReader::read(TypeId& x) {
+  x.type_info = static_cast<const TypeInfo*>(readPointer());
+  if (x.type_info == nullptr) {
+    fail();
+  }
+}
+
+void ImageReader::read(std::size_t& x) {
+  x = std::size_t(readWord());
+}
+
+void ImageReader::read(SemistaticGraphInternalNodeId& x) {
+  x.id = std::size_t(readWord());
+}
+
+void ImageReader::read(NormalizedBindingData& x) {
+  x = NormalizedBindingData(BindingData::object_t(const_cast<void*>(readPointer())));
+}
+
+void ImageReader::read(BindingData& x) {
+  bool is_created = readWord() != 0;
+  if (is_created) {
+    x = BindingData(BindingData::object_t(const_cast<void*>(readPointer())));
+  } else {
+    BindingData::create_t create = reinterpret_cast<BindingData::create_t>(const_cast<void*>(readPointer()));
+    const BindingDeps* deps = static_cast<const BindingDeps*>(readPointer());
+    bool needs_allocation = readWord() != 0;
+    if (deps == nullptr) {
+      fail();
+      return;
+    }
+    x = BindingData(create, deps, needs_allocation);
+  }
+}
+
+void ImageReader::fail() {
+  failed = true;
+}
+
+bool ImageReader::hasFailed() const {
+  return failed;
+}
+
+bool ImageReader::atEnd() const {
+  return num_remaining_words == 0;
+}
+
+void NormalizedComponentImage::buildDictionary(const ComponentStorage& component,
+                                               const std::vector<TypeId>& exposed_types,
+                                               std::vector<const void*>& dictionary,
+                                               std::uint64_t& shape_hash) {
+  shape_hash = fnv_offset_basis;
+  
+  // The types are part of the shape: the first time a type is found its name is hashed, and later it's hashed as the index
+  // of its first occurrence (so that each name is only hashed once). The size of the types isn't part of the shape, since
+  // it's not available for abstract types.
+  HashMap<const TypeInfo*, std::size_t> type_indexes = createHashMap<const TypeInfo*, std::size_t>();
+  auto addType = [&](TypeId type) {
+    auto p = type_indexes.insert(std::make_pair(type.type_info, type_indexes.size()));
+    if (p.second) {
+      hashCombine(shape_hash, 0);
+      hashCombine(shape_hash, hashTypeName(type));
+    } else {
+      hashCombine(shape_hash, 1);
+      hashCombine(shape_hash, p.first->second);
+    }
+    dictionary.push_back(type.type_info);
+  };
+  auto addDeps = [&](const BindingDeps* deps) {
+    dictionary.push_back(deps);
+    hashCombine(shape_hash, deps->num_deps);
+    for (std::size_t i = 0; i < deps->num_deps; ++i) {
+      addType(deps->deps[i]);
+    }
+  };
+  auto addBindingData = [&](const BindingData& binding_data) {
+    hashCombine(shape_hash, binding_data.isCreated());
+    if (binding_data.isCreated()) {
+      dictionary.push_back(binding_data.getObject());
+    } else {
+      hashCombine(shape_hash, binding_data.needsAllocation());
+      dictionary.push_back(reinterpret_cast<void*>(binding_data.getCreate()));
+      addDeps(binding_data.getDeps());
+    }
+  };
+  
+  std::unique_ptr<BindingSegment> flattened_segment;
+  const BindingSegment& flat_component = component.flatten(flattened_segment);
+  hashCombine(shape_hash, flat_component.bindings.size());
+  hashCombine(shape_hash, flat_component.compressed_bindings.size());
+  hashCombine(shape_hash, flat_component.multibindings.size());
+  hashCombine(shape_hash, exposed_types.size());
+  
+  for (const std::pair<TypeId, BindingData>& x : flat_component.bindings) {
+    addType(x.first);
+    addBindingData(x.second);
+  }
+  for (const CompressedBinding& x : flat_component.compressed_bindings) {
+    addType(x.interface_id);
+    addType(x.class_id);
+    addBindingData(x.binding_data);
+  }
+  for (const std::pair<TypeId, MultibindingData>& x : flat_component.multibindings) {
+    addType(x.first);
+    hashCombine(shape_hash, x.second.create != nullptr);
+    if (x.second.create != nullptr) {
+      hashCombine(shape_hash, x.second.needs_allocation);
+      dictionary.push_back(reinterpret_cast<void*>(x.second.create));
+      addDeps(x.second.deps);
+    } else {
+      dictionary.push_back(x.second.object);
+    }
+    dictionary.push_back(reinterpret_cast<void*>(x.second.get_multibindings_vector));
+  }
+  for (TypeId type : exposed_types) {
+    addType(type);
+  }
+}
+
+std::string NormalizedComponentImage::write(const NormalizedComponentStorage& storage,
+                                            const ComponentStorage& component,
+                                            const std::vector<TypeId>& exposed_types,
+                                            const std::string& build_fingerprint) {
+  if (storage.base != nullptr) {
+    // The bindings of an extended component share their edges (and binding compressions) with the ones of the base
+    // component, so they can't be written as they are. `component' provides the same types as `storage' (and it must be
+    // equivalent to the base component plus its extensions), so we write the image of its normalization instead; loading
+    // the image then results in a standalone NormalizedComponent.
+    NormalizedComponentStorage flattened_storage(component, exposed_types, storage.memory_resource);
+    return write(flattened_storage, component, exposed_types, build_fingerprint);
+  }
+  
+  std::vector<const void*> dictionary;
+  std::uint64_t shape_hash;
+  buildDictionary(component, exposed_types, dictionary, shape_hash);
+  
+  ImageWriter writer(dictionary);
+  
+  // The positions of the dictionary that contain the same pointer as an earlier position. When reading the image, these
+  // must still contain the same pointers, otherwise the component is not the one that was written.
+  std::vector<std::pair<std::size_t, std::size_t>> duplicates;
+  HashMap<const void*, std::size_t> first_positions = createHashMap<const void*, std::size_t>(dictionary.size());
+  for (std::size_t i = 0; i < dictionary.size(); ++i) {
+    auto p = first_positions.insert(std::make_pair(dictionary[i], i));
+    if (!p.second) {
+      duplicates.emplace_back(i, p.first->second);
+    }
+  }
+  writer.writeWord(duplicates.size());
+  for (const std::pair<std::size_t, std::size_t>& p : duplicates) {
+    writer.writeWord(p.first);
+    writer.writeWord(p.second);
+  }
+  
+  storage.bindings.writeImage(writer);
+  storage.multibindings.writeImage(writer);
+  storage.fixed_size_allocator_data.writeImage(writer);
+  
+  writer.writeWord(storage.bindingCompressionInfoMap->size());
+  for (const auto& p : *storage.bindingCompressionInfoMap) {
+    writer.write(p.first);
+    writer.write(p.second.iTypeId);
+    writer.write(p.second.iBinding);
+    writer.write(p.second.cBinding);
+  }
+  
+  if (writer.hasFailed()) {
+    return std::string();
+  }
+  
+  const std::vector<std::uint64_t>& payload = writer.getWords();
+  std::uint64_t header[num_header_words];
+  header[header_magic] = image_magic;
+  header[header_version] = image_version;
+  header[header_layout] = image_layout;
+  header[header_fingerprint_hash] = hashString(build_fingerprint);
+  header[header_shape_hash] = shape_hash;
+  header[header_dictionary_size] = dictionary.size();
+  header[header_payload_size] = payload.size();
+  header[header_payload_checksum] =
+      hashWords(reinterpret_cast<const char*>(payload.data()), payload.size());
+  
+  std::string image((num_header_words + payload.size()) * sizeof(std::uint64_t), '\0');
+  std::memcpy(&image[0], header, sizeof(header));
+  std::memcpy(&image[sizeof(header)], payload.data(), payload.size() * sizeof(std::uint64_t));
+  return image;
+}
+
+bool NormalizedComponentImage::read(NormalizedComponentStorage& storage,
+                                    const ComponentStorage& component,
+                                    const std::vector<TypeId>& exposed_types,
+                                    const void* image,
+                                    std::size_t image_size,
+                                    const std::string& build_fingerprint) {
+  // Step 1: check the header and the checksum, before doing anything with the component.
+  if (image_size < num_header_words * sizeof(std::uint64_t) || image_size % sizeof(std::uint64_t) != 0) {
+    return false;
+  }
+  std::uint64_t header[num_header_words];
+  std::memcpy(header, image, sizeof(header));
+  const char* payload = static_cast<const char*>(image) + sizeof(header);
+  std::size_t payload_size = image_size / sizeof(std::uint64_t) - num_header_words;
+  if (header[header_magic] != image_magic
+      || header[header_version] != image_version
+      || header[header_layout] != image_layout
+      || header[header_fingerprint_hash] != hashString(build_fingerprint)
+      || header[header_payload_size] != payload_size
+      || header[header_payload_checksum] != hashWords(payload, payload_size)) {
+    return false;
+  }
+  
+  // Step 2: check that the component has the same shape as the one that was written.
+  std::vector<const void*> dictionary;
+  std::uint64_t shape_hash;
+  buildDictionary(component, exposed_types, dictionary, shape_hash);
+  if (header[header_dictionary_size] != dictionary.size() || header[header_shape_hash] != shape_hash) {
+    return false;
+  }
+  
+  // The positions that contained the same pointer when the image was written must still contain the same pointer, and the
+  // other ones (the first position of each pointer) must contain distinct pointers, otherwise e.g. two instances that were
+  // bound separately might now be the same object.
+  ImageReader reader(payload, payload_size, dictionary);
+  std::size_t num_duplicates = reader.readSize(2);
+  std::vector<bool> is_duplicate(dictionary.size(), false);
+  for (std::size_t i = 0; i < num_duplicates; ++i) {
+    std::uint64_t position = reader.readWord();
+    std::uint64_t first_position = reader.readWord();
+    if (position >= dictionary.size()
+        || first_position >= position
+        || is_duplicate[first_position]
+        || dictionary[position] != dictionary[first_position]) {
+      return false;
+    }
+    is_duplicate[position] = true;
+  }
+  HashSet<const void*> distinct_pointers = createHashSet<const void*>(dictionary.size());
+  for (std::size_t i = 0; i < dictionary.size(); ++i) {
+    if (!is_duplicate[i] && !distinct_pointers.insert(dictionary[i]).second) {
+      return false;
+    }
+  }
+  
+  // Step 3: read the data. This is done in local variables, so that `storage' is not modified if the image is invalid.
+  MemoryResource& memory_resource = storage.memory_resource;
+  SemistaticGraph<TypeId, NormalizedBindingData> bindings;
+  bindings.readImage(reader, memory_resource);
+  NormalizedMultibindingTable multibindings;
+  multibindings.readImage(reader, memory_resource);
+  FixedSizeAllocator::FixedSizeAllocatorData fixed_size_allocator_data;
+  fixed_size_allocator_data.readImage(reader);
+  
+  // Each element takes at least 6 words (a BindingData takes at least 2).
+  std::size_t num_compressed_bindings = reader.readSize(6);
+  BindingNormalization::BindingCompressionInfoMap binding_compression_info_map =
+      createHashMap<TypeId, BindingNormalization::BindingCompressionInfo>(num_compressed_bindings);
+  for (std::size_t i = 0; i < num_compressed_bindings; ++i) {
+    TypeId c_type_id;
+    BindingNormalization::BindingCompressionInfo info;
+    reader.read(c_type_id);
+    reader.read(info.iTypeId);
+    reader.read(info.iBinding);
+    reader.read(info.cBinding);
+    binding_compression_info_map[c_type_id] = info;
+  }
+  
+  if (reader.hasFailed() || !reader.atEnd()) {
+    return false;
+  }
+  
+  storage.bindings = std::move(bindings);
+  storage.multibindings = std::move(multibindings);
+  storage.fixed_size_allocator_data = std::move(fixed_size_allocator_data);
+  storage.bindingCompressionInfoMap->swap(binding_compression_info_map);
+  return true;
+}
+
+} // namespace impl
+} // namespace fruit
@@ -16,6 +16,8 @@
 
 #define IN_FRUIT_CPP_FILE
 
+#include <atomic>
+#include <cstdint>
 #include <cstdlib>
 #include <memory>
 #include <vector>
@@ -25,6 +27,7 @@
 
 #include <fruit/impl/storage/normalized_component_storage.h>
 #include <fruit/impl/storage/component_storage.h>
+#include <fruit/impl/storage/normalized_component_image.h>
 
 #include <fruit/impl/data_structures/semistatic_map.templates.h>
 #include <fruit/impl/data_structures/semistatic_graph.templates.h>
@@ -35,30 +38,136 @@ using std::endl;
 using namespace fruit;
 using namespace fruit::impl;
 
+namespace {
+
+// Ids start from 1, so that 0 can be used for "no NormalizedComponentStorage".
+std::uint64_t newNormalizedComponentId() {
+  static std::atomic<std::uint64_t> next_id{1};
+  return next_id++;
+}
+
+} // namespace
+
 namespace fruit {
 namespace impl {
 
-NormalizedComponentStorage::NormalizedComponentStorage(const ComponentStorage& component, const std::vector<TypeId>& exposed_types)
-  : bindingCompressionInfoMap(
+NormalizedComponentStorage::NormalizedComponentStorage(const ComponentStorage& component,
+                                                       const std::vector<TypeId>& exposed_types,
+                                                       MemoryResource& memory_resource)
+  : memory_resource(memory_resource),
+    id(newNormalizedComponentId()),
+    bindingCompressionInfoMap(
       std::unique_ptr<BindingNormalization::BindingCompressionInfoMap>(
           new BindingNormalization::BindingCompressionInfoMap(
-              createHashMap<TypeId, BindingNormalization::BindingCompressionInfo>()))) {
+              createHashMap<TypeId, BindingNormalization::BindingCompressionInfo>()))),
+    shared_binding_compressions(bindingCompressionInfoMap.get()) {
+  normalize(component, exposed_types);
+}
+
+NormalizedComponentStorage::NormalizedComponentStorage(const ComponentStorage& component,
+                                                       const std::vector<TypeId>& exposed_types,
+                                                       const void* image,
+                                                       std::size_t image_size,
+                                                       const std::string& build_fingerprint,
+                                                       MemoryResource& memory_resource)
+  : memory_resource(memory_resource),
+    id(newNormalizedComponentId()),
+    bindingCompressionInfoMap(
+      std::unique_ptr<BindingNormalization::BindingCompressionInfoMap>(
+          new BindingNormalization::BindingCompressionInfoMap(
+              createHashMap<TypeId, BindingNormalization::BindingCompressionInfo>()))),
+    shared_binding_compressions(bindingCompressionInfoMap.get()) {
+  loaded_from_image =
+      NormalizedComponentImage::read(*this, component, exposed_types, image, image_size, build_fingerprint);
+  if (!loaded_from_image) {
+    normalize(component, exposed_types);
+  }
+}
+
+NormalizedComponentStorage::NormalizedComponentStorage(const NormalizedComponentStorage& normalized_component,
+                                                       const ComponentStorage& component,
+                                                       std::vector<TypeId>&& exposed_types,
+                                                       MemoryResource& memory_resource)
+  : memory_resource(memory_resource),
+    id(newNormalizedComponentId()),
+    fixed_size_allocator_data(normalized_component.fixed_size_allocator_data),
+    shared_binding_compressions(normalized_component.shared_binding_compressions),
+    undone_binding_compressions(normalized_component.undone_binding_compressions),
+    base(&normalized_component) {
+  
+  NormalizedMultibindingTable multibindings_overlay;
+  // These binding compressions can't be undone again by components installed on top of this one.
+  InjectorStorage::mergeBindings(normalized_component, component, std::move(exposed_types),
+                                 bindings, multibindings_overlay, fixed_size_allocator_data, memory_resource,
+                                 &undone_binding_compressions);
+  
+  // After a few extensions the index of the graph might have long bucket chains, making each lookup slower. In that case
+  // it's rebuilt here (in time proportional to the number of nodes, not to the number of edges).
+  bindings.rehashIfNeeded(max_bucket_size_before_rehash, memory_resource);
+  
+  // Injectors only support a single level of overlay on top of the multibindings of a normalized component, so here the
+  // two levels are merged into a single table (that still refers to the multibindings of `normalized_component', without
+  // copying them).
+  multibindings = NormalizedMultibindingTable(multibindings_overlay, normalized_component.multibindings, memory_resource);
+}
+
+void NormalizedComponentStorage::normalize(const ComponentStorage& component, const std::vector<TypeId>& exposed_types) {
+  std::unique_ptr<BindingSegment> flattened_segment;
+  const BindingSegment& flat_component = component.flatten(flattened_segment);
   std::vector<std::pair<TypeId, BindingData>> normalized_bindings =
-      BindingNormalization::normalizeBindings(component.bindings,
+      BindingNormalization::normalizeBindings(flat_component.bindings,
                                               fixed_size_allocator_data,
-                                              std::vector<CompressedBinding>(component.compressed_bindings.begin(), component.compressed_bindings.end()),
-                                              std::vector<std::pair<TypeId, MultibindingData>>(component.multibindings.begin(), component.multibindings.end()),
+                                              std::vector<CompressedBinding>(flat_component.compressed_bindings.begin(), flat_component.compressed_bindings.end()),
+                                              std::vector<std::pair<TypeId, MultibindingData>>(flat_component.multibindings.begin(), flat_component.multibindings.end()),
                                               exposed_types,
                                               *bindingCompressionInfoMap);
   
+  // The graph stores nodes in DFS order starting from the first bindings, so we start from the exposed types: those are
+  // the ones that will be requested from the injectors.
+  HashSet<TypeId> exposed_type_set = createHashSet<TypeId>(exposed_types.size());
+  exposed_type_set.insert(exposed_types.begin(), exposed_types.end());
+  std::stable_partition(normalized_bindings.begin(), normalized_bindings.end(),
+                        [&exposed_type_set](const std::pair<TypeId, BindingData>& binding) {
+                          return exposed_type_set.count(binding.first) != 0;
+                        });
+  
   bindings = SemistaticGraph<TypeId, NormalizedBindingData>(InjectorStorage::BindingDataNodeIter{normalized_bindings.begin()},
-                                                            InjectorStorage::BindingDataNodeIter{normalized_bindings.end()});
+                                                            InjectorStorage::BindingDataNodeIter{normalized_bindings.end()},
+                                                            memory_resource);
   
-  BindingNormalization::addMultibindings(multibindings, fixed_size_allocator_data, std::vector<std::pair<TypeId, MultibindingData>>(component.multibindings.begin(), component.multibindings.end()));
+  multibindings = NormalizedMultibindingTable(flat_component.multibindings,
+                                              nullptr /* base */,
+                                              fixed_size_allocator_data,
+                                              memory_resource);
 }
 
 NormalizedComponentStorage::~NormalizedComponentStorage() {
 }
 
+bool NormalizedComponentStorage::isLoadedFromImage() const {
+  return loaded_from_image;
+}
+
+const BindingNormalization::BindingCompressionInfo* NormalizedComponentStorage::findBindingCompression(
+    TypeId c_type_id) const {
+  if (std::find(undone_binding_compressions.begin(), undone_binding_compressions.end(), c_type_id)
+      != undone_binding_compressions.end()) {
+    return nullptr;
+  }
+  auto itr = shared_binding_compressions->find(c_type_id);
+  if (itr == shared_binding_compressions->end()) {
+    return nullptr;
+  }
+  return &itr->second;
+}
+
+bool NormalizedComponentStorage::isExtension() const {
+  return base != nullptr;
+}
+
+std::size_t NormalizedComponentStorage::getNodeIndex(TypeId type) {
+  return bindings.nodeIndex(bindings.at(type));
+}
+
 } // namespace impl
 } // namespace fruit
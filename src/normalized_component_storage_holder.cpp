@@ -18,6 +18,7 @@
 
 #include <fruit/impl/storage/normalized_component_storage_holder.h>
 #include <fruit/impl/storage/normalized_component_storage.h>
+#include <fruit/impl/storage/normalized_component_image.h>
 
 using namespace fruit;
 using namespace fruit::impl;
@@ -26,12 +27,46 @@ namespace fruit {
 namespace impl {
 
 NormalizedComponentStorageHolder::NormalizedComponentStorageHolder(
-  const ComponentStorage& component, const std::vector<TypeId>& exposed_types)
-  : storage(new NormalizedComponentStorage(component, exposed_types)) {
+  const ComponentStorage& component, const std::vector<TypeId>& exposed_types, MemoryResource& memory_resource)
+  : storage(new NormalizedComponentStorage(component, exposed_types, memory_resource)) {
 }
 
+NormalizedComponentStorageHolder::NormalizedComponentStorageHolder(
+  const ComponentStorage& component, const std::vector<TypeId>& exposed_types, const void* image, std::size_t image_size,
+  const std::string& build_fingerprint, MemoryResource& memory_resource)
+  : storage(new NormalizedComponentStorage(component, exposed_types, image, image_size, build_fingerprint,
+                                           memory_resource)) {
+}
+
+NormalizedComponentStorageHolder::NormalizedComponentStorageHolder(
+  const NormalizedComponentStorageHolder& normalized_component, const ComponentStorage& component,
+  std::vector<TypeId>&& exposed_types, MemoryResource& memory_resource)
+  : storage(new NormalizedComponentStorage(*normalized_component.storage, component, std::move(exposed_types),
+                                           memory_resource)) {
+}
+
+NormalizedComponentStorageHolder::NormalizedComponentStorageHolder(NormalizedComponentStorageHolder&&) = default;
+
 NormalizedComponentStorageHolder::~NormalizedComponentStorageHolder() {
 }
 
+std::string NormalizedComponentStorageHolder::writeImage(const ComponentStorage& component,
+                                                         const std::vector<TypeId>& exposed_types,
+                                                         const std::string& build_fingerprint) const {
+  return NormalizedComponentImage::write(*storage, component, exposed_types, build_fingerprint);
+}
+
+bool NormalizedComponentStorageHolder::isLoadedFromImage() const {
+  return storage->isLoadedFromImage();
+}
+
+std::size_t NormalizedComponentStorageHolder::getNodeIndex(TypeId type) const {
+  return storage->getNodeIndex(type);
+}
+
+std::uint64_t NormalizedComponentStorageHolder::getId() const {
+  return storage->id;
+}
+
 } // namespace impl
 } // namespace fruit
@@ -0,0 +1,254 @@
+/*
+ * Copyright 2014 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define IN_FRUIT_CPP_FILE
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+#include <fruit/impl/storage/normalized_multibinding_table.h>
+#include <fruit/impl/storage/normalized_component_image.h>
+#include <fruit/impl/data_structures/semistatic_map.templates.h>
+
+using namespace fruit::impl;
+
+namespace {
+
+auto typeInfoLessThanForMultibindings = [](const std::pair<TypeId, MultibindingData>& x,
+                                           const std::pair<TypeId, MultibindingData>& y) {
+  return x.first < y.first;
+};
+
+} // namespace
+
+namespace fruit {
+namespace impl {
+
+NormalizedMultibindingTable::NormalizedMultibindingTable(
+    const std::vector<std::pair<TypeId, MultibindingData>>& multibindings,
+    const NormalizedMultibindingTable* base,
+    FixedSizeAllocator::FixedSizeAllocatorData& fixed_size_allocator_data,
+    MemoryResource& memory_resource)
+  : groups(0, memory_resource), elems(0, memory_resource) {
+  
+  std::vector<std::pair<TypeId, MultibindingData>> sorted_multibindings = multibindings;
+  // This is a stable sort so that multibindings for the same type are added in the order in which they appear in
+  // `multibindings'; PreparedDeltaStorage relies on this.
+  std::stable_sort(sorted_multibindings.begin(), sorted_multibindings.end(),
+                   typeInfoLessThanForMultibindings);
+  
+  // First pass: count the groups and the elems (including the ones copied from `base').
+  std::size_t num_groups = 0;
+  std::size_t num_elems = sorted_multibindings.size();
+  for (auto i = sorted_multibindings.begin(); i != sorted_multibindings.end(); /* no increment */) {
+    TypeId type = i->first;
+    ++num_groups;
+    if (base != nullptr) {
+      std::size_t base_index = base->find(type);
+      if (base_index != base->numGroups()) {
+        const NormalizedMultibindingData& base_group = base->groups[base_index];
+        num_elems += base_group.elems_end - base_group.elems_begin;
+      }
+    }
+    while (i != sorted_multibindings.end() && i->first == type) {
+      ++i;
+    }
+  }
+  
+  groups = FixedSizeVector<NormalizedMultibindingData>(num_groups, memory_resource);
+  elems = FixedSizeVector<Elem>(num_elems, memory_resource);
+  
+#ifdef FRUIT_EXTRA_DEBUG
+  std::cout << "InjectorStorage: adding multibindings:" << std::endl;
+#endif
+  // Second pass: fill `elems' and `groups'. Since `elems' never reallocates, the pointers in the groups stay valid.
+  std::vector<std::pair<TypeId, std::size_t>> index_values;
+  index_values.reserve(num_groups);
+  for (auto i = sorted_multibindings.begin(); i != sorted_multibindings.end(); /* no increment */) {
+    const std::pair<TypeId, MultibindingData>& x = *i;
+    
+    NormalizedMultibindingData group;
+    group.type = x.first;
+    group.elems_begin = elems.end();
+    group.get_multibindings_vector = x.second.get_multibindings_vector;
+    
+    bool in_base = false;
+    if (base != nullptr) {
+      std::size_t base_index = base->find(x.first);
+      if (base_index != base->numGroups()) {
+        in_base = true;
+        const NormalizedMultibindingData& base_group = base->groups[base_index];
+        for (const Elem* elem = base_group.elems_begin; elem != base_group.elems_end; ++elem) {
+          elems.push_back(*elem);
+        }
+      }
+    }
+    
+#ifdef FRUIT_EXTRA_DEBUG
+    std::cout << x.first << " has " << std::distance(i, sorted_multibindings.end()) << " multibindings." << std::endl;
+#endif
+    // Insert all multibindings for this type (note that x is also inserted here).
+    std::size_t num_new_elems = 0;
+    for (; i != sorted_multibindings.end() && i->first == x.first; ++i, ++num_new_elems) {
+      elems.push_back(Elem(i->second));
+      if (i->second.needs_allocation) {
+        fixed_size_allocator_data.addType(x.first);
+      } else {
+        fixed_size_allocator_data.addExternallyAllocatedType(x.first);
+      }
+    }
+    
+    // For the array of objects of this group (see InjectorStorage::getMultibindingsRange()). If the type is also in `base',
+    // the space reserved for the array of the group in `base' is used too.
+    fixed_size_allocator_data.addPointerArray(num_new_elems);
+    
+    if (!in_base) {
+      // For the std::vector<T*> returned by getMultibindings(). If the type is also in `base', the vector for the group in
+      // `base' is never constructed, so its slot can be used instead.
+      fixed_size_allocator_data.addExternallyAllocatedType(x.first);
+    }
+    
+    group.elems_end = elems.end();
+    index_values.emplace_back(x.first, groups.size());
+    groups.push_back(group);
+#ifdef FRUIT_EXTRA_DEBUG
+    std::cout << std::endl;
+#endif
+  }
+  
+  if (num_groups != 0) {
+    index = SemistaticMap<TypeId, std::size_t>(index_values.begin(), index_values.size(),
+                                               SemistaticMap<TypeId, std::size_t>::PerfectHashing(),
+                                               memory_resource);
+  }
+}
+
+NormalizedMultibindingTable::NormalizedMultibindingTable(const NormalizedMultibindingTable& x,
+                                                         MemoryResource& memory_resource)
+  : groups(x.groups, x.groups.size(), memory_resource),
+    elems(x.elems, x.elems.size(), memory_resource) {
+  if (groups.size() != 0) {
+    // A shallow copy, `index' is never modified after construction.
+    index = SemistaticMap<TypeId, std::size_t>(x.index, std::vector<std::pair<TypeId, std::size_t>>{}, memory_resource);
+  }
+  // Make the groups point to the copied elems.
+  for (NormalizedMultibindingData& group : groups) {
+    group.elems_begin = elems.data() + (group.elems_begin - x.elems.data());
+    group.elems_end = elems.data() + (group.elems_end - x.elems.data());
+  }
+}
+
+NormalizedMultibindingTable::NormalizedMultibindingTable(const NormalizedMultibindingTable& overlay,
+                                                         const NormalizedMultibindingTable& base,
+                                                         MemoryResource& memory_resource)
+  : groups(0, memory_resource), elems(0, memory_resource) {
+  // The groups of `overlay' already contain the elems of the corresponding groups in `base', so only the groups of `base'
+  // for the other types are needed. Those still point to the elems in `base', only the elems of `overlay' are copied.
+  std::vector<const NormalizedMultibindingData*> base_only_groups;
+  for (const NormalizedMultibindingData& group : base.groups) {
+    if (overlay.find(group.type) == overlay.numGroups()) {
+      base_only_groups.push_back(&group);
+    }
+  }
+  
+  std::size_t num_groups = overlay.groups.size() + base_only_groups.size();
+  groups = FixedSizeVector<NormalizedMultibindingData>(num_groups, memory_resource);
+  elems = FixedSizeVector<Elem>(overlay.elems, overlay.elems.size(), memory_resource);
+  
+  std::vector<std::pair<TypeId, std::size_t>> index_values;
+  index_values.reserve(num_groups);
+  for (const NormalizedMultibindingData& x : overlay.groups) {
+    NormalizedMultibindingData group = x;
+    group.elems_begin = elems.data() + (x.elems_begin - overlay.elems.data());
+    group.elems_end = elems.data() + (x.elems_end - overlay.elems.data());
+    index_values.emplace_back(group.type, groups.size());
+    groups.push_back(group);
+  }
+  for (const NormalizedMultibindingData* group : base_only_groups) {
+    index_values.emplace_back(group->type, groups.size());
+    groups.push_back(*group);
+  }
+  
+  if (num_groups != 0) {
+    index = SemistaticMap<TypeId, std::size_t>(index_values.begin(), index_values.size(),
+                                               SemistaticMap<TypeId, std::size_t>::PerfectHashing(),
+                                               memory_resource);
+  }
+}
+
+NormalizedMultibindingTable::~NormalizedMultibindingTable() = default;
+
+void NormalizedMultibindingTable::resetElems(const NormalizedMultibindingTable& x) {
+  FruitAssert(elems.size() == x.elems.size());
+  std::copy(x.elems.begin(), x.elems.end(), elems.begin());
+}
+
+void NormalizedMultibindingTable::writeImage(ImageWriter& writer) const {
+  writer.writeWord(elems.size());
+  for (const Elem& elem : elems) {
+    writer.writePointer(reinterpret_cast<void*>(elem.create));
+    writer.writePointer(elem.object);
+  }
+  writer.writeWord(groups.size());
+  for (const NormalizedMultibindingData& group : groups) {
+    writer.write(group.type);
+    writer.writeWord(std::uint64_t(group.elems_begin - elems.data()));
+    writer.writeWord(std::uint64_t(group.elems_end - elems.data()));
+    writer.writePointer(reinterpret_cast<void*>(group.get_multibindings_vector));
+  }
+  if (groups.size() != 0) {
+    index.writeImage(writer);
+  }
+}
+
+void NormalizedMultibindingTable::readImage(ImageReader& reader, MemoryResource& memory_resource) {
+  std::size_t num_elems = reader.readSize(2);
+  elems = FixedSizeVector<Elem>(num_elems, memory_resource);
+  for (std::size_t i = 0; i < num_elems; ++i) {
+    Elem elem(MultibindingData(nullptr, nullptr));
+    elem.create = reinterpret_cast<MultibindingData::create_t>(const_cast<void*>(reader.readPointer()));
+    elem.object = const_cast<void*>(reader.readPointer());
+    elems.push_back(elem);
+  }
+  
+  std::size_t num_groups = reader.readSize(4);
+  groups = FixedSizeVector<NormalizedMultibindingData>(num_groups, memory_resource);
+  for (std::size_t i = 0; i < num_groups; ++i) {
+    NormalizedMultibindingData group;
+    reader.read(group.type);
+    std::uint64_t elems_begin = reader.readWord();
+    std::uint64_t elems_end = reader.readWord();
+    if (elems_begin >= elems_end || elems_end > num_elems) {
+      reader.fail();
+      return;
+    }
+    group.elems_begin = elems.data() + elems_begin;
+    group.elems_end = elems.data() + elems_end;
+    group.get_multibindings_vector =
+        reinterpret_cast<MultibindingData::get_multibindings_vector_t>(const_cast<void*>(reader.readPointer()));
+    groups.push_back(group);
+  }
+  
+  if (num_groups != 0) {
+    index.readImage(reader, memory_resource, [num_groups](std::size_t group_index) {
+      return group_index < num_groups;
+    });
+  }
+}
+
+} // namespace impl
+} // namespace fruit
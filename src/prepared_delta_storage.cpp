@@ -0,0 +1,139 @@
+/*
+ * Copyright 2014 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#define IN_FRUIT_CPP_FILE
+
+#include <vector>
+#include <fruit/impl/util/type_info.h>
+#include <fruit/impl/util/hash_helpers.h>
+
+#include <fruit/impl/storage/prepared_delta_storage.h>
+#include <fruit/impl/storage/component_storage.h>
+#include <fruit/impl/storage/normalized_component_storage.h>
+
+#include <fruit/impl/data_structures/semistatic_graph.templates.h>
+
+using namespace fruit;
+using namespace fruit::impl;
+
+namespace {
+
+// Returns true if x and y only differ (if at all) in the object of an instance multibinding.
+bool haveSameShape(const MultibindingData& x, const MultibindingData& y) {
+  return x.create == y.create
+      && x.deps == y.deps
+      && x.get_multibindings_vector == y.get_multibindings_vector
+      && x.needs_allocation == y.needs_allocation;
+}
+
+} // namespace
+
+namespace fruit {
+namespace impl {
+
+constexpr std::size_t PreparedDeltaStorage::not_patchable;
+
+PreparedDeltaStorage::PreparedDeltaStorage(const NormalizedComponentStorage& normalized_component,
+                                           const ComponentStorage& prototype_component)
+  : normalized_component(normalized_component),
+    fixed_size_allocator_data(normalized_component.fixed_size_allocator_data) {
+  std::unique_ptr<BindingSegment> flattened_segment;
+  const BindingSegment& flat_prototype_component = prototype_component.flatten(flattened_segment);
+  prototype_bindings = flat_prototype_component.bindings;
+  prototype_multibindings = flat_prototype_component.multibindings;
+  
+  
+  // The exposed types only affect binding compression, and no binding compression is done for the bindings of
+  // `prototype_component'.
+  InjectorStorage::mergeBindings(normalized_component, prototype_component, std::vector<TypeId>{},
+                                 bindings, multibindings, fixed_size_allocator_data, normalized_component.memory_resource);
+  
+  HashMap<TypeId, std::size_t> num_bindings_for_type = createHashMap<TypeId, std::size_t>(prototype_bindings.size());
+  for (const std::pair<TypeId, BindingData>& p : prototype_bindings) {
+    ++num_bindings_for_type[p.first];
+  }
+  
+  patchable_bindings.reserve(prototype_bindings.size());
+  for (const std::pair<TypeId, BindingData>& p : prototype_bindings) {
+    // If the type is bound more than once, or if it's also bound in the normalized component, the object must be checked
+    // against the other bindings for the type. We don't do that in the fast path, so such bindings are not patchable.
+    bool patchable = p.second.isCreated()
+        && num_bindings_for_type[p.first] == 1
+        && normalized_component.bindings.find(p.first) == normalized_component.bindings.end();
+    if (patchable) {
+      Graph::node_iterator node_itr = bindings.find(p.first);
+      patchable = !(node_itr == bindings.end())
+          && node_itr.isTerminal()
+          && node_itr.getConstNode().getObject() == p.second.getObject();
+    }
+    patchable_bindings.push_back(patchable);
+  }
+  
+  // Multibindings for the same type are added after the ones in the normalized component, in the same order as in
+  // prototype_multibindings (see NormalizedMultibindingTable).
+  HashMap<TypeId, std::size_t> next_elem_index_for_type = createHashMap<TypeId, std::size_t>();
+  patchable_multibinding_indexes.reserve(prototype_multibindings.size());
+  for (const std::pair<TypeId, MultibindingData>& p : prototype_multibindings) {
+    auto itr = next_elem_index_for_type.find(p.first);
+    if (itr == next_elem_index_for_type.end()) {
+      const NormalizedMultibindingData& group = multibindings.getGroup(multibindings.find(p.first));
+      std::size_t first_elem_index = group.elems_begin - multibindings.elems.data();
+      const NormalizedMultibindingTable& normalized_multibindings = normalized_component.multibindings;
+      std::size_t normalized_group_index = normalized_multibindings.find(p.first);
+      if (normalized_group_index != normalized_multibindings.numGroups()) {
+        const NormalizedMultibindingData& normalized_group = normalized_multibindings.getGroup(normalized_group_index);
+        first_elem_index += normalized_group.elems_end - normalized_group.elems_begin;
+      }
+      itr = next_elem_index_for_type.insert(std::make_pair(p.first, first_elem_index)).first;
+    }
+    std::size_t elem_index = itr->second++;
+    if (p.second.create == nullptr) {
+      FruitAssert(multibindings.elems[elem_index].object == p.second.object);
+      patchable_multibinding_indexes.push_back(elem_index);
+    } else {
+      patchable_multibinding_indexes.push_back(not_patchable);
+    }
+  }
+}
+
+bool PreparedDeltaStorage::matches(const BindingSegment& component) const {
+  if (component.bindings.size() != prototype_bindings.size()
+      || component.multibindings.size() != prototype_multibindings.size()) {
+    return false;
+  }
+  for (std::size_t i = 0; i < prototype_bindings.size(); ++i) {
+    const std::pair<TypeId, BindingData>& x = component.bindings[i];
+    const std::pair<TypeId, BindingData>& y = prototype_bindings[i];
+    if (!(x.first == y.first)) {
+      return false;
+    }
+    if (patchable_bindings[i] ? !x.second.isCreated() : !(x.second == y.second)) {
+      return false;
+    }
+  }
+  for (std::size_t i = 0; i < prototype_multibindings.size(); ++i) {
+    const std::pair<TypeId, MultibindingData>& x = component.multibindings[i];
+    const std::pair<TypeId, MultibindingData>& y = prototype_multibindings[i];
+    if (!(x.first == y.first) || !haveSameShape(x.second, y.second)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+} // namespace impl
+} // namespace fruit
@@ -29,6 +29,7 @@ namespace fruit {
 namespace impl {
 
 template class SemistaticMap<TypeId, SemistaticGraphInternalNodeId>;
+template class SemistaticMap<TypeId, std::size_t>;
 
 } // namespace impl
 } // namespace fruit
@@ -0,0 +1,155 @@
+/*
+ * Copyright 2014 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define IN_FRUIT_CPP_FILE
+
+#include <fruit/impl/storage/versioned_injector_storage.h>
+#include <fruit/impl/fruit_assert.h>
+
+#include <algorithm>
+
+namespace fruit {
+namespace impl {
+
+constexpr std::uint64_t VersionedInjectorStorage::quiescent;
+
+VersionedInjectorStorage::Reader::Reader()
+  : epoch(quiescent), in_use(false), next(nullptr) {
+}
+
+VersionedInjectorStorage::VersionedInjectorStorage(void* injector, destroy_t destroy_injector)
+  : destroy_injector(destroy_injector),
+    current(new Version{injector, 1}),
+    epoch(0),
+    readers(nullptr),
+    num_retired_versions(0) {
+}
+
+VersionedInjectorStorage::~VersionedInjectorStorage() {
+  std::vector<Version*> versions;
+  for (const RetiredVersion& retired_version : retired_versions) {
+    versions.push_back(retired_version.version);
+  }
+  versions.push_back(current.load());
+  destroyVersions(versions);
+
+  Reader* next = nullptr;
+  for (Reader* reader = readers.load(); reader != nullptr; reader = next) {
+    FruitAssert(!reader->in_use.load());
+    next = reader->next;
+    delete reader;
+  }
+}
+
+VersionedInjectorStorage::Reader* VersionedInjectorStorage::acquireReader() {
+  for (Reader* reader = readers.load(std::memory_order_acquire); reader != nullptr; reader = reader->next) {
+    bool expected = false;
+    if (!reader->in_use.load(std::memory_order_relaxed)
+        && reader->in_use.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+      return reader;
+    }
+  }
+
+  // All readers are in use, add a new one. This is sequentially consistent so that if a publish() doesn't see the new
+  // reader, the reader will see the epoch incremented by that publish() in enter().
+  Reader* reader = new Reader();
+  reader->in_use.store(true, std::memory_order_relaxed);
+  reader->next = readers.load();
+  while (!readers.compare_exchange_weak(reader->next, reader)) {
+  }
+  return reader;
+}
+
+const VersionedInjectorStorage::Version* VersionedInjectorStorage::enter(Reader* reader) {
+  // These must be sequentially consistent: if publish() then sees this reader as quiescent (or in the new epoch), the
+  // load of `current' below must see the new version.
+  reader->epoch.store(epoch.load());
+  return current.load();
+}
+
+void VersionedInjectorStorage::releaseReader(Reader* reader) {
+  // The store to reader->epoch and the load of num_retired_versions are sequentially consistent (and so is the store in
+  // takeUnreachableVersions()): either a concurrent publish() sees this reader as quiescent, or this sees the version
+  // that it retired.
+  reader->epoch.store(quiescent);
+  reader->in_use.store(false, std::memory_order_release);
+
+  if (num_retired_versions.load() != 0) {
+    std::unique_lock<std::mutex> lock(writer_mutex, std::try_to_lock);
+    if (lock.owns_lock()) {
+      std::vector<Version*> unreachable_versions = takeUnreachableVersions();
+      lock.unlock();
+      destroyVersions(unreachable_versions);
+    }
+  }
+}
+
+void VersionedInjectorStorage::publish(void* injector) {
+  Version* version = new Version{injector, 0};
+  std::vector<Version*> unreachable_versions;
+  {
+    std::lock_guard<std::mutex> lock(writer_mutex);
+    version->number = current.load()->number + 1;
+    Version* old_version = current.exchange(version);
+    // Readers that see this epoch (or a later one) in enter() will load the new version.
+    std::uint64_t new_epoch = epoch.fetch_add(1) + 1;
+    retired_versions.push_back(RetiredVersion{old_version, new_epoch});
+    unreachable_versions = takeUnreachableVersions();
+  }
+  destroyVersions(unreachable_versions);
+}
+
+std::vector<VersionedInjectorStorage::Version*> VersionedInjectorStorage::takeUnreachableVersions() {
+  std::vector<Version*> unreachable_versions;
+  if (!retired_versions.empty()) {
+    std::uint64_t min_reader_epoch = quiescent;
+    for (Reader* reader = readers.load(); reader != nullptr; reader = reader->next) {
+      min_reader_epoch = std::min(min_reader_epoch, reader->epoch.load());
+    }
+
+    auto itr = std::remove_if(retired_versions.begin(), retired_versions.end(),
+                              [&](const RetiredVersion& retired_version) {
+                                if (retired_version.epoch <= min_reader_epoch) {
+                                  unreachable_versions.push_back(retired_version.version);
+                                  return true;
+                                }
+                                return false;
+                              });
+    retired_versions.erase(itr, retired_versions.end());
+  }
+  num_retired_versions.store(retired_versions.size());
+  return unreachable_versions;
+}
+
+void VersionedInjectorStorage::destroyVersions(const std::vector<Version*>& versions) {
+  for (Version* version : versions) {
+    destroy_injector(version->injector);
+    delete version;
+  }
+}
+
+std::uint64_t VersionedInjectorStorage::getCurrentVersionNumber() const {
+  // The lock is needed because without a reader the current version might be destroyed by a concurrent publish().
+  std::lock_guard<std::mutex> lock(writer_mutex);
+  return current.load()->number;
+}
+
+std::size_t VersionedInjectorStorage::getNumRetiredVersions() const {
+  return num_retired_versions.load();
+}
+
+} // namespace impl
+} // namespace fruit
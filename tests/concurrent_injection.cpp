@@ -0,0 +1,131 @@
+/*
+ * Copyright 2014 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "test_common.h"
+
+#include <atomic>
+#include <thread>
+
+struct X {
+  INJECT(X()) {
+    num_constructed++;
+    // Make it more likely that other threads request X while it's being constructed.
+    std::this_thread::yield();
+  }
+
+  static std::atomic<int> num_constructed;
+};
+
+std::atomic<int> X::num_constructed(0);
+
+struct Y {
+  INJECT(Y(X* x)) : x(x) {
+    num_constructed++;
+  }
+
+  X* x;
+
+  static std::atomic<int> num_constructed;
+};
+
+std::atomic<int> Y::num_constructed(0);
+
+struct Z {
+  INJECT(Z()) {
+    num_constructed++;
+  }
+
+  static std::atomic<int> num_constructed;
+};
+
+std::atomic<int> Z::num_constructed(0);
+
+struct W {
+  INJECT(W(fruit::Provider<Z> zProvider)) : zProvider(zProvider) {
+  }
+
+  fruit::Provider<Z> zProvider;
+};
+
+struct Multi {
+  virtual ~Multi() = default;
+};
+
+struct MultiImpl : public Multi {
+};
+
+fruit::Component<X, Y, W> getComponent() {
+  return fruit::createComponent()
+    .addMultibindingProvider([](){return static_cast<Multi*>(new MultiImpl());});
+}
+
+int main() {
+  const int num_threads = 8;
+  const int num_iterations = 1000;
+
+  fruit::Injector<X, Y, W> injector(getComponent());
+  injector.enableConcurrentInjection();
+
+  // Calling this again is allowed.
+  injector.enableConcurrentInjection();
+
+  X* x = nullptr;
+  Y* y = nullptr;
+  Z* z = nullptr;
+
+  std::vector<std::thread> threads;
+  std::vector<X*> xs(num_threads);
+  std::vector<Y*> ys(num_threads);
+  std::vector<Z*> zs(num_threads);
+  std::vector<const std::vector<Multi*>*> multis(num_threads);
+  for (int i = 0; i < num_threads; i++) {
+    threads.push_back(std::thread([&injector, &xs, &ys, &zs, &multis, i]() {
+      for (int j = 0; j < num_iterations; j++) {
+        // Threads request the types in different orders.
+        if (i % 2 == 0) {
+          xs[i] = injector.get<X*>();
+          ys[i] = injector.get<Y*>();
+        } else {
+          ys[i] = injector.get<Y*>();
+          xs[i] = injector.get<X*>();
+        }
+        zs[i] = injector.get<W&>().zProvider.get<Z*>();
+        multis[i] = &injector.getMultibindings<Multi>();
+      }
+    }));
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  x = injector.get<X*>();
+  y = injector.get<Y*>();
+  z = injector.get<W&>().zProvider.get<Z*>();
+
+  Assert(X::num_constructed == 1);
+  Assert(Y::num_constructed == 1);
+  Assert(Z::num_constructed == 1);
+  Assert(y->x == x);
+  for (int i = 0; i < num_threads; i++) {
+    Assert(xs[i] == x);
+    Assert(ys[i] == y);
+    Assert(zs[i] == z);
+    Assert(multis[i] == &injector.getMultibindings<Multi>());
+    Assert(multis[i]->size() == 1);
+  }
+
+  return 0;
+}
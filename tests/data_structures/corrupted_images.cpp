@@ -0,0 +1,186 @@
+/*
+ * Copyright 2014 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../test_common.h"
+
+#define IN_FRUIT_CPP_FILE
+#include <fruit/impl/data_structures/semistatic_graph.templates.h>
+#include <fruit/impl/data_structures/semistatic_map.templates.h>
+#include <fruit/impl/storage/normalized_component_image.h>
+#include <fruit/impl/storage/normalized_multibinding_table.h>
+
+using namespace std;
+using namespace fruit::impl;
+
+using Graph = SemistaticGraph<TypeId, NormalizedBindingData>;
+
+struct SimpleNode {
+  TypeId id;
+  NormalizedBindingData value;
+  const vector<TypeId>* neighbors;
+  bool is_terminal;
+
+  TypeId getId() { return id; }
+  NormalizedBindingData getValue() { return value; }
+  bool isTerminal() { return is_terminal; }
+  vector<TypeId>::const_iterator getEdgesBegin() { return neighbors->begin(); }
+  vector<TypeId>::const_iterator getEdgesEnd() { return neighbors->end(); }
+};
+
+int x = 1;
+int y = 2;
+
+BindingData::object_t getMultibindingsVector(InjectorStorage&, const BindingData::object_t*,
+                                             const BindingData::object_t*) {
+  return nullptr;
+}
+
+vector<const void*> getDictionary() {
+  return vector<const void*>{
+    getTypeId<int>().type_info,
+    getTypeId<double>().type_info,
+    &x,
+    &y,
+    reinterpret_cast<void*>(getMultibindingsVector)};
+}
+
+// Returns the position of the value of the first element of the SemistaticMap image that starts at `pos'.
+size_t firstMapValuePosition(const vector<uint64_t>& words, size_t pos) {
+  size_t num_displacements = words[pos + 4];
+  return pos + 7 + num_displacements;
+}
+
+// Returns the position right after the end of the SemistaticMap image that starts at `pos'.
+size_t mapImageEnd(const vector<uint64_t>& words, size_t pos) {
+  size_t num_displacements = words[pos + 4];
+  size_t num_values = words[pos + 5 + num_displacements];
+  size_t num_buckets = words[pos + 6 + num_displacements + 2 * num_values];
+  return pos + 7 + num_displacements + 2 * num_values + 2 * num_buckets;
+}
+
+vector<uint64_t> writeGraph() {
+  vector<TypeId> neighbors{getTypeId<double>()};
+  vector<TypeId> no_neighbors{};
+  vector<SimpleNode> values{
+    {getTypeId<int>(), NormalizedBindingData(BindingData::object_t(&x)), &neighbors, false},
+    {getTypeId<double>(), NormalizedBindingData(BindingData::object_t(&y)), &no_neighbors, true}};
+  Graph graph(values.begin(), values.end());
+
+  vector<const void*> dictionary = getDictionary();
+  ImageWriter writer(dictionary);
+  graph.writeImage(writer);
+  Assert(!writer.hasFailed());
+  return writer.getWords();
+}
+
+bool readGraph(const vector<uint64_t>& words, size_t num_words) {
+  vector<const void*> dictionary = getDictionary();
+  ImageReader reader(reinterpret_cast<const char*>(words.data()), num_words, dictionary);
+  Graph graph;
+  graph.readImage(reader, fruit::getDefaultMemoryResource());
+  return !reader.hasFailed() && reader.atEnd();
+}
+
+vector<uint64_t> writeMultibindingTable() {
+  vector<pair<TypeId, MultibindingData>> multibindings{
+    {getTypeId<int>(), MultibindingData(BindingData::object_t(&x), getMultibindingsVector)},
+    {getTypeId<int>(), MultibindingData(BindingData::object_t(&y), getMultibindingsVector)}};
+  FixedSizeAllocator::FixedSizeAllocatorData fixed_size_allocator_data;
+  NormalizedMultibindingTable table(multibindings, nullptr, fixed_size_allocator_data,
+                                    fruit::getDefaultMemoryResource());
+
+  vector<const void*> dictionary = getDictionary();
+  ImageWriter writer(dictionary);
+  table.writeImage(writer);
+  Assert(!writer.hasFailed());
+  return writer.getWords();
+}
+
+bool readMultibindingTable(const vector<uint64_t>& words, size_t num_words) {
+  vector<const void*> dictionary = getDictionary();
+  ImageReader reader(reinterpret_cast<const char*>(words.data()), num_words, dictionary);
+  NormalizedMultibindingTable table;
+  table.readImage(reader, fruit::getDefaultMemoryResource());
+  return !reader.hasFailed() && reader.atEnd();
+}
+
+void test_graph() {
+  vector<uint64_t> words = writeGraph();
+  Assert(readGraph(words, words.size()));
+
+  vector<const void*> dictionary = getDictionary();
+  ImageReader reader(reinterpret_cast<const char*>(words.data()), words.size(), dictionary);
+  Graph graph;
+  graph.readImage(reader, fruit::getDefaultMemoryResource());
+  Assert(!reader.hasFailed());
+  Graph::node_iterator itr = graph.at(getTypeId<int>());
+  Assert(!itr.isTerminal());
+  Assert(itr.neighborsBegin().getNodeIterator(graph.begin()).getConstNode().getObject() == &y);
+  Assert(graph.at(getTypeId<double>()).isTerminal());
+}
+
+void test_graph_truncated() {
+  vector<uint64_t> words = writeGraph();
+  for (size_t i = 0; i < words.size(); ++i) {
+    Assert(!readGraph(words, i));
+  }
+}
+
+void test_graph_node_id_out_of_range() {
+  vector<uint64_t> words = writeGraph();
+  size_t num_nodes = words[0];
+  words[firstMapValuePosition(words, 1)] = num_nodes;
+  Assert(!readGraph(words, words.size()));
+}
+
+void test_graph_edges_without_end_marker() {
+  vector<uint64_t> words = writeGraph();
+  size_t edges_pos = mapImageEnd(words, 1);
+  size_t num_edges = words[edges_pos];
+  Assert(words[edges_pos + num_edges] == ~uint64_t(0));
+  // A valid node ID, but the edges of the last node with edges would continue past the end of the edges.
+  words[edges_pos + num_edges] = 0;
+  Assert(!readGraph(words, words.size()));
+}
+
+void test_multibinding_table() {
+  vector<uint64_t> words = writeMultibindingTable();
+  Assert(readMultibindingTable(words, words.size()));
+  for (size_t i = 0; i < words.size(); ++i) {
+    Assert(!readMultibindingTable(words, i));
+  }
+}
+
+void test_multibinding_table_group_index_out_of_range() {
+  vector<uint64_t> words = writeMultibindingTable();
+  size_t num_elems = words[0];
+  size_t num_groups_pos = 1 + 2 * num_elems;
+  size_t num_groups = words[num_groups_pos];
+  size_t index_pos = num_groups_pos + 1 + 4 * num_groups;
+  words[firstMapValuePosition(words, index_pos)] = num_groups;
+  Assert(!readMultibindingTable(words, words.size()));
+}
+
+int main() {
+  test_graph();
+  test_graph_truncated();
+  test_graph_node_id_out_of_range();
+  test_graph_edges_without_end_marker();
+  test_multibinding_table();
+  test_multibinding_table_group_index_out_of_range();
+
+  return 0;
+}
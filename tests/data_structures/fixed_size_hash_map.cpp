@@ -0,0 +1,102 @@
+/*
+ * Copyright 2014 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../test_common.h"
+
+#define IN_FRUIT_CPP_FILE
+#include <fruit/impl/data_structures/fixed_size_hash_map.templates.h>
+
+#include <vector>
+
+using namespace std;
+using namespace fruit::impl;
+
+void test_empty() {
+  FixedSizeHashMap<int, char> map(0);
+  const FixedSizeHashMap<int, char>& const_map = map;
+  Assert(map.size() == 0);
+  Assert(map.begin() == map.end());
+  Assert(map.find(2) == map.end());
+  Assert(const_map.find(2) == const_map.end());
+}
+
+void test_insert_and_find() {
+  FixedSizeHashMap<int, char> map(3);
+  Assert(map.insert(2, 'a').second);
+  Assert(map.insert(5, 'b').second);
+  Assert(map.size() == 2);
+  Assert(map.find(2)->first == 2);
+  Assert(map.find(2)->second == 'a');
+  Assert(map.find(5)->second == 'b');
+  Assert(map.find(7) == map.end());
+}
+
+void test_insert_existing_key() {
+  FixedSizeHashMap<int, char> map(3);
+  map.insert(2, 'a');
+  std::pair<FixedSizeHashMap<int, char>::iterator, bool> p = map.insert(2, 'b');
+  Assert(!p.second);
+  Assert(p.first == map.find(2));
+  // The value is not overwritten.
+  Assert(p.first->second == 'a');
+  Assert(map.size() == 1);
+  p.first->second = 'c';
+  Assert(map.find(2)->second == 'c');
+}
+
+void test_iteration_in_insertion_order() {
+  FixedSizeHashMap<int, int> map(100);
+  for (int i = 99; i >= 0; --i) {
+    map.insert(i * 16, i);
+  }
+  // Reinserting an existing key doesn't change the order.
+  map.insert(32, 0);
+  int expected = 99;
+  for (const std::pair<int, int>& p : map) {
+    Assert(p.first == expected * 16);
+    Assert(p.second == expected);
+    --expected;
+  }
+  Assert(expected == -1);
+}
+
+void test_full() {
+  // Keys with the same low bits, as addresses of aligned objects (e.g. TypeIds) have.
+  std::vector<long> keys;
+  for (long i = 0; i < 1000; ++i) {
+    keys.push_back(i * 4096);
+  }
+  FixedSizeHashMap<long, long> map(keys.size());
+  for (long key : keys) {
+    Assert(map.insert(key, key + 1).second);
+  }
+  Assert(map.size() == keys.size());
+  for (long key : keys) {
+    Assert(map.find(key) != map.end());
+    Assert(map.find(key)->second == key + 1);
+    Assert(map.find(key + 1) == map.end());
+  }
+}
+
+int main() {
+  test_empty();
+  test_insert_and_find();
+  test_insert_existing_key();
+  test_iteration_in_insertion_order();
+  test_full();
+  
+  return 0;
+}
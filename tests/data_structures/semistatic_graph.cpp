@@ -218,6 +218,26 @@ void test_set_terminal() {
   Assert(cgraph.find(5) == cgraph.end());
 }
 
+void test_copy_shared_pages_of_non_terminal_nodes() {
+  vector<SimpleNode> terminal_values{{2, "foo", &no_neighbors, true}, {4, "baz", &no_neighbors, true}};
+  Graph terminal_graph(terminal_values.begin(), terminal_values.end());
+  Graph terminal_copy(terminal_graph, terminal_values.end(), terminal_values.end());
+  terminal_copy.copySharedPagesOfNonTerminalNodes();
+  // The page only contains terminal nodes, so it's still shared.
+  Assert(&terminal_copy.at(2).getConstNode() == &terminal_graph.at(2).getConstNode());
+  
+  vector<SimpleNode> values{{2, "foo", &no_neighbors, false}, {4, "baz", &no_neighbors, true}};
+  Graph graph(values.begin(), values.end());
+  Graph copy(graph, values.end(), values.end());
+  Assert(&copy.at(4).getConstNode() == &graph.at(4).getConstNode());
+  copy.copySharedPagesOfNonTerminalNodes();
+  Assert(&copy.at(4).getConstNode() != &graph.at(4).getConstNode());
+  Assert(copy.at(2).getConstNode() == string("foo"));
+  Assert(copy.at(2).isTerminal() == false);
+  Assert(copy.at(4).getConstNode() == string("baz"));
+  Assert(copy.at(4).isTerminal() == true);
+}
+
 void test_move_constructor() {
   vector<int> neighbors = {2};
   vector<SimpleNode> values{{2, "foo", &no_neighbors, false}, {3, "bar", &neighbors, false}};
@@ -281,6 +301,7 @@ int main() {
   test_3_nodes_two_edges();
   test_add_node();
   test_set_terminal();
+  test_copy_shared_pages_of_non_terminal_nodes();
   test_move_constructor();
   test_move_assignment();
   test_incomplete_graph();
@@ -132,6 +132,172 @@ void test_move_assignment() {
   Assert(map.find(5) == nullptr);
 }
 
+void test_perfect_hashing_empty() {
+  vector<pair<int, std::string>> values{};
+  SemistaticMap<int, std::string> map(values.begin(), values.size(), SemistaticMap<int, std::string>::PerfectHashing());
+  Assert(map.find(0) == nullptr);
+  Assert(map.find(2) == nullptr);
+  Assert(map.find(5) == nullptr);
+}
+
+void test_perfect_hashing_3_elem() {
+  vector<pair<int, std::string>> values{{1, "foo"}, {3, "bar"}, {4, "baz"}};
+  SemistaticMap<int, std::string> map(values.begin(), values.size(), SemistaticMap<int, std::string>::PerfectHashing());
+  Assert(map.find(0) == nullptr);
+  Assert(map.find(1) != nullptr);
+  Assert(map.at(1) == "foo");
+  Assert(map.find(2) == nullptr);
+  Assert(map.find(3) != nullptr);
+  Assert(map.at(3) == "bar");
+  Assert(map.find(4) != nullptr);
+  Assert(map.at(4) == "baz");
+  Assert(map.find(5) == nullptr);
+}
+
+void test_perfect_hashing_many_elems() {
+  // 1024 is a power of 2, so in this case there are as many buckets as keys.
+  for (int n : {1000, 1024, 5000}) {
+    vector<pair<int, int>> values;
+    for (int i = 0; i < n; ++i) {
+      values.push_back(std::make_pair(i * 16, i));
+    }
+    SemistaticMap<int, int> map(values.begin(), values.size(), SemistaticMap<int, int>::PerfectHashing());
+    for (int i = 0; i < n; ++i) {
+      Assert(map.find(i * 16) != nullptr);
+      Assert(map.at(i * 16) == i);
+      Assert(map.find(i * 16 + 1) == nullptr);
+    }
+  }
+}
+
+void test_perfect_hashing_3_elem_3_inserted() {
+  vector<pair<int, std::string>> values{{1, "1"}, {3, "3"}, {5, "5"}};
+  SemistaticMap<int, std::string> old_map(values.begin(), values.size(), SemistaticMap<int, std::string>::PerfectHashing());
+  vector<pair<int, std::string>> new_values{{2, "2"}, {4, "4"}, {16, "16"}};
+  SemistaticMap<int, std::string> map(old_map, std::move(new_values));
+  Assert(map.find(0) == nullptr);
+  Assert(map.find(1) != nullptr);
+  Assert(map.at(1) == "1");
+  Assert(map.find(2) != nullptr);
+  Assert(map.at(2) == "2");
+  Assert(map.find(3) != nullptr);
+  Assert(map.at(3) == "3");
+  Assert(map.find(4) != nullptr);
+  Assert(map.at(4) == "4");
+  Assert(map.find(5) != nullptr);
+  Assert(map.at(5) == "5");
+  Assert(map.find(6) == nullptr);
+  Assert(map.find(16) != nullptr);
+  Assert(map.at(16) == "16");
+}
+
+void test_pointer_keys_empty() {
+  vector<pair<const int*, int>> values{};
+  SemistaticMap<const int*, int> map(values.begin(), values.size());
+  int x = 0;
+  Assert(map.find(nullptr) == nullptr);
+  Assert(map.find(&x) == nullptr);
+}
+
+// With pointer keys, find() compares the keys in a bucket with SIMD instructions (when available). Inserting many keys in a
+// shallow copy makes some buckets longer than a vector register.
+void test_pointer_keys_many_inserted() {
+  vector<int> targets(2000);
+  vector<pair<const int*, int>> values;
+  for (int i = 0; i < 1000; ++i) {
+    values.push_back(std::make_pair(&targets[i], i));
+  }
+  SemistaticMap<const int*, int> old_map(values.begin(), values.size());
+  vector<pair<const int*, int>> new_values;
+  for (int i = 1000; i < 1990; ++i) {
+    new_values.push_back(std::make_pair(&targets[i], i));
+  }
+  SemistaticMap<const int*, int> map(old_map, std::move(new_values));
+  for (int i = 0; i < 1990; ++i) {
+    Assert(map.find(&targets[i]) != nullptr);
+    Assert(map.at(&targets[i]) == i);
+  }
+  for (int i = 1990; i < 2000; ++i) {
+    Assert(map.find(&targets[i]) == nullptr);
+  }
+  Assert(map.find(nullptr) == nullptr);
+}
+
+void test_pointer_keys_perfect_hashing_many_elems() {
+  vector<int> targets(5000);
+  vector<pair<const int*, int>> values;
+  for (int i = 0; i < 4990; ++i) {
+    values.push_back(std::make_pair(&targets[i], i));
+  }
+  SemistaticMap<const int*, int> map(values.begin(), values.size(), SemistaticMap<const int*, int>::PerfectHashing());
+  for (int i = 0; i < 4990; ++i) {
+    Assert(map.find(&targets[i]) != nullptr);
+    Assert(map.at(&targets[i]) == i);
+  }
+  for (int i = 4990; i < 5000; ++i) {
+    Assert(map.find(&targets[i]) == nullptr);
+  }
+}
+
+void test_perfect_hashing_copy_of_shallow_copy() {
+  vector<pair<int, std::string>> values{{1, "foo"}, {3, "bar"}, {4, "baz"}};
+  SemistaticMap<int, std::string> map1(values.begin(), values.size(), SemistaticMap<int, std::string>::PerfectHashing());
+  Assert(map1.maxBucketSize() == 1);
+  vector<pair<int, std::string>> new_values;
+  for (int i = 10; i < 100; ++i) {
+    new_values.push_back(std::make_pair(i, std::to_string(i)));
+  }
+  SemistaticMap<int, std::string> map2(map1, std::move(new_values));
+  Assert(map2.maxBucketSize() > 1);
+  SemistaticMap<int, std::string> map(map2, SemistaticMap<int, std::string>::PerfectHashing());
+  Assert(map.maxBucketSize() == 1);
+  Assert(map.at(1) == "foo");
+  Assert(map.at(3) == "bar");
+  Assert(map.at(4) == "baz");
+  for (int i = 10; i < 100; ++i) {
+    Assert(map.at(i) == std::to_string(i));
+  }
+  Assert(map.find(0) == nullptr);
+  Assert(map.find(5) == nullptr);
+  Assert(map.find(100) == nullptr);
+}
+
+void test_shallow_copy_of_shallow_copy() {
+  vector<pair<int, int>> values;
+  for (int i = 0; i < 1000; ++i) {
+    values.push_back(std::make_pair(i * 16, i));
+  }
+  SemistaticMap<int, int> map1(values.begin(), values.size(), SemistaticMap<int, int>::PerfectHashing());
+  vector<pair<int, int>> new_values2;
+  for (int i = 1000; i < 1010; ++i) {
+    new_values2.push_back(std::make_pair(i * 16, i));
+  }
+  SemistaticMap<int, int> map2(map1, std::move(new_values2));
+  vector<pair<int, int>> new_values3;
+  for (int i = 1010; i < 1020; ++i) {
+    new_values3.push_back(std::make_pair(i * 16, i));
+  }
+  SemistaticMap<int, int> map3(map2, std::move(new_values3));
+  SemistaticMap<int, int> map4(map3, vector<pair<int, int>>{});
+  for (int i = 0; i < 1020; ++i) {
+    Assert(map1.find(i * 16) == (i < 1000 ? &map1.at(i * 16) : nullptr));
+    Assert(map2.find(i * 16) == (i < 1010 ? &map2.at(i * 16) : nullptr));
+    Assert(map3.find(i * 16) != nullptr);
+    Assert(map3.at(i * 16) == i);
+    Assert(map4.find(i * 16) != nullptr);
+    Assert(map4.at(i * 16) == i);
+  }
+  for (int i = 0; i < 1010; ++i) {
+    Assert(map2.at(i * 16) == i);
+  }
+  Assert(map4.find(1020 * 16) == nullptr);
+  SemistaticMap<int, int> map(map4, SemistaticMap<int, int>::PerfectHashing());
+  Assert(map.maxBucketSize() == 1);
+  for (int i = 0; i < 1020; ++i) {
+    Assert(map.at(i * 16) == i);
+  }
+}
+
 int main() {
   
   test_empty();
@@ -142,6 +308,15 @@ int main() {
   test_3_elem_3_inserted();
   test_move_constructor();
   test_move_assignment();
+  test_perfect_hashing_empty();
+  test_perfect_hashing_3_elem();
+  test_perfect_hashing_many_elems();
+  test_perfect_hashing_3_elem_3_inserted();
+  test_pointer_keys_empty();
+  test_pointer_keys_many_inserted();
+  test_pointer_keys_perfect_hashing_many_elems();
+  test_perfect_hashing_copy_of_shallow_copy();
+  test_shallow_copy_of_shallow_copy();
   
   return 0;
 }
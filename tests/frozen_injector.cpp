@@ -0,0 +1,226 @@
+/*
+ * Copyright 2014 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "test_common.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// A MemoryResource that uses the default one, and keeps track of the number of bytes that haven't been deallocated yet.
+class CountingMemoryResource : public fruit::MemoryResource {
+public:
+  std::size_t num_live_bytes = 0;
+  std::size_t num_allocations = 0;
+
+  void* allocate(std::size_t bytes, std::size_t alignment) override {
+    num_live_bytes += bytes;
+    num_allocations++;
+    return fruit::getDefaultMemoryResource().allocate(bytes, alignment);
+  }
+
+  void deallocate(void* p, std::size_t bytes, std::size_t alignment) override {
+    num_live_bytes -= bytes;
+    fruit::getDefaultMemoryResource().deallocate(p, bytes, alignment);
+  }
+};
+
+struct Config {
+  int value;
+};
+
+struct Z {
+  INJECT(Z()) {
+    num_constructed++;
+  }
+
+  static std::atomic<int> num_constructed;
+};
+
+std::atomic<int> Z::num_constructed(0);
+
+struct Y {
+  INJECT(Y(Config& config)) : value(config.value) {
+    num_constructed++;
+  }
+
+  int value;
+
+  static std::atomic<int> num_constructed;
+};
+
+std::atomic<int> Y::num_constructed(0);
+
+struct Listener {
+  virtual ~Listener() = default;
+};
+
+struct ListenerImpl : public Listener {
+  INJECT(ListenerImpl()) = default;
+};
+
+struct MainListener {};
+
+struct X {
+  // Z is only injected through a Provider.
+  INJECT(X(Y& y, fruit::Provider<Z> zProvider, ANNOTATED(MainListener, Listener*) listener))
+    : y(y), zProvider(zProvider), listener(listener) {
+    num_constructed++;
+  }
+
+  Y& y;
+  fruit::Provider<Z> zProvider;
+  Listener* listener;
+
+  static std::atomic<int> num_constructed;
+};
+
+std::atomic<int> X::num_constructed(0);
+
+// Not reachable from X.
+struct W {
+  INJECT(W()) {
+    num_constructed++;
+  }
+
+  static std::atomic<int> num_constructed;
+};
+
+std::atomic<int> W::num_constructed(0);
+
+fruit::Component<fruit::Required<Config>, X, fruit::Annotated<MainListener, Listener>> getXComponent() {
+  return fruit::createComponent()
+    .bind<fruit::Annotated<MainListener, Listener>, ListenerImpl>()
+    .registerConstructor<W()>();
+}
+
+fruit::Component<Config> getConfigComponent(Config& config) {
+  return fruit::createComponent()
+    .bindInstance(config);
+}
+
+fruit::Component<X, fruit::Annotated<MainListener, Listener>> getRootComponent(Config& config) {
+  return fruit::createComponent()
+    .install(getXComponent())
+    .install(getConfigComponent(config));
+}
+
+void resetCounters() {
+  X::num_constructed = 0;
+  Y::num_constructed = 0;
+  Z::num_constructed = 0;
+  W::num_constructed = 0;
+}
+
+void checkFrozenInjector(const fruit::FrozenInjector<X, fruit::Annotated<MainListener, Listener>>& injector,
+                         int expected_value) {
+  const int num_threads = 8;
+
+  // All objects reachable from X were constructed when freezing the injector, including Z (that's only injected through a
+  // Provider).
+  Assert(X::num_constructed == 1);
+  Assert(Y::num_constructed == 1);
+  Assert(Z::num_constructed == 1);
+  Assert(W::num_constructed == 0);
+
+  X* x = injector.get<X*>();
+  Assert(x->y.value == expected_value);
+  Assert(&(injector.get<X&>()) == x);
+  Assert(&(injector.get<const X&>()) == x);
+  Assert(injector.get<const X*>() == x);
+  Assert(injector.get<std::shared_ptr<X>>().get() == x);
+  Assert(injector.get<X>().listener == x->listener);
+  Assert(injector.get<fruit::Annotated<MainListener, Listener*>>() == x->listener);
+  Assert(dynamic_cast<ListenerImpl*>(x->listener) != nullptr);
+  X* x2(injector);
+  Assert(x2 == x);
+
+  Z* z = x->zProvider.get();
+  Assert(injector.get<fruit::Provider<X>>().get() == x);
+
+  std::atomic<int> num_errors(0);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < num_threads; ++i) {
+    threads.push_back(std::thread([&injector, x, z, &num_errors]() {
+      for (int j = 0; j < 1000; ++j) {
+        X* x1 = injector.get<X*>();
+        if (x1 != x || x1->zProvider.get() != z || &(x1->y) != &(x->y)) {
+          num_errors++;
+        }
+      }
+    }));
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  Assert(num_errors == 0);
+
+  // No other object was constructed.
+  Assert(X::num_constructed == 1);
+  Assert(Y::num_constructed == 1);
+  Assert(Z::num_constructed == 1);
+  Assert(W::num_constructed == 0);
+}
+
+void test_from_component() {
+  resetCounters();
+  Config config{1};
+  CountingMemoryResource memory_resource;
+  {
+    fruit::Injector<X, fruit::Annotated<MainListener, Listener>> injector(getRootComponent(config));
+    Assert(X::num_constructed == 0);
+
+    fruit::FrozenInjector<X, fruit::Annotated<MainListener, Listener>> frozenInjector(std::move(injector),
+                                                                                      memory_resource);
+    // The only allocation is the array with the 2 objects.
+    Assert(memory_resource.num_allocations == 1);
+    Assert(memory_resource.num_live_bytes == 2 * sizeof(void*));
+
+    fruit::FrozenInjector<X, fruit::Annotated<MainListener, Listener>> movedFrozenInjector(std::move(frozenInjector));
+    checkFrozenInjector(movedFrozenInjector, 1);
+  }
+  Assert(memory_resource.num_live_bytes == 0);
+}
+
+void test_from_normalized_component() {
+  fruit::NormalizedComponent<fruit::Required<Config>, X, fruit::Annotated<MainListener, Listener>> normalizedComponent(
+      getXComponent());
+  for (int i = 0; i < 3; ++i) {
+    resetCounters();
+    Config config{i};
+    fruit::FrozenInjector<X, fruit::Annotated<MainListener, Listener>> frozenInjector(
+        fruit::Injector<X, fruit::Annotated<MainListener, Listener>>(normalizedComponent, getConfigComponent(config)));
+    checkFrozenInjector(frozenInjector, i);
+  }
+}
+
+void test_concurrent_injector() {
+  resetCounters();
+  Config config{5};
+  fruit::Injector<X, fruit::Annotated<MainListener, Listener>> injector(getRootComponent(config));
+  injector.enableConcurrentInjection();
+
+  fruit::FrozenInjector<X, fruit::Annotated<MainListener, Listener>> frozenInjector(std::move(injector));
+  checkFrozenInjector(frozenInjector, 5);
+}
+
+int main() {
+  test_from_component();
+  test_from_normalized_component();
+  test_concurrent_injector();
+
+  return 0;
+}
@@ -0,0 +1,113 @@
+/*
+ * Copyright 2014 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "test_common.h"
+
+#include <string>
+
+struct X {
+  INJECT(X()) = default;
+  
+  char data[100];
+};
+
+struct Y {
+  INJECT(Y(X& x)) : x(x) {
+  }
+  
+  X& x;
+};
+
+struct Z {
+  Y& y;
+};
+
+struct Listener {
+  virtual ~Listener() = default;
+};
+
+struct ListenerImpl : public Listener {
+};
+
+fruit::Component<Z> getComponent() {
+  return fruit::createComponent()
+    .registerProvider([](Y& y) {
+      return Z{y};
+    })
+    .addMultibindingProvider([]() {
+      return static_cast<Listener*>(new ListenerImpl());
+    });
+}
+
+int main() {
+  {
+    // Constructions are not recorded unless profiling is enabled.
+    fruit::Injector<Z> injector(getComponent());
+    injector.get<Z*>();
+    Assert(injector.getProfile().getEntries().empty());
+  }
+  
+  fruit::Injector<Z> injector(getComponent());
+  injector.enableProfiling();
+  Assert(injector.getProfile().getEntries().empty());
+  
+#if !FRUIT_ENABLE_PROFILING
+  // The create functions don't contain any profiling code, so nothing is recorded.
+  injector.get<Z*>();
+  Assert(injector.getMultibindings<Listener>().size() == 1);
+  Assert(injector.getProfile().getEntries().empty());
+#else
+  injector.get<Z*>();
+  // Getting an object that was already constructed doesn't add entries.
+  injector.get<Z*>();
+  
+  const std::vector<fruit::InjectionProfile::Entry>& entries = injector.getProfile().getEntries();
+  Assert(entries.size() == 3);
+  
+  // Entries are in construction order, and the construction of Z starts first.
+  Assert(entries[0].getTypeName() == "Z");
+  Assert(entries[0].depth == 0);
+  Assert(entries[1].getTypeName() == "Y");
+  Assert(entries[1].depth == 1);
+  Assert(entries[1].parent == 0);
+  Assert(entries[2].getTypeName() == "X");
+  Assert(entries[2].depth == 2);
+  Assert(entries[2].parent == 1);
+  
+  for (const fruit::InjectionProfile::Entry& entry : entries) {
+    Assert(entry.self_time_ns <= entry.total_time_ns);
+    Assert(entry.self_allocated_bytes <= entry.total_allocated_bytes);
+  }
+  Assert(entries[0].total_time_ns >= entries[1].total_time_ns);
+  Assert(entries[2].self_allocated_bytes >= sizeof(X));
+  Assert(entries[1].total_allocated_bytes == entries[1].self_allocated_bytes + entries[2].total_allocated_bytes);
+  Assert(entries[0].total_allocated_bytes == entries[0].self_allocated_bytes + entries[1].total_allocated_bytes);
+  
+  std::string folded_stacks = injector.getProfile().toFoldedStacks();
+  Assert(folded_stacks.find("Z " + std::to_string(entries[0].self_time_ns) + "\n") == 0);
+  Assert(folded_stacks.find("\nZ;Y " + std::to_string(entries[1].self_time_ns) + "\n") != std::string::npos);
+  Assert(folded_stacks.find("\nZ;Y;X " + std::to_string(entries[2].self_time_ns) + "\n") != std::string::npos);
+  
+  // Multibindings constructed with a provider are also recorded.
+  Assert(injector.getMultibindings<Listener>().size() == 1);
+  Assert(injector.getProfile().getEntries().size() == 4);
+  Assert(injector.getProfile().getEntries()[3].getTypeName() == "Listener");
+  Assert(injector.getProfile().getEntries()[3].depth == 0);
+#endif
+  
+  return 0;
+}
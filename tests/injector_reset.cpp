@@ -0,0 +1,145 @@
+/*
+ * Copyright 2014 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "test_common.h"
+
+#include <cstdlib>
+#include <new>
+
+// Counts the calls to operator new, to check that resetting an injector in place doesn't allocate memory.
+std::size_t num_allocations = 0;
+
+void* operator new(std::size_t size) {
+  num_allocations++;
+  void* p = std::malloc(size == 0 ? 1 : size);
+  if (p == nullptr) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+void operator delete(void* p) noexcept {
+  std::free(p);
+}
+
+struct Request {
+  int id;
+};
+
+struct Y {
+  INJECT(Y(Request& request)) : request(request) {
+    num_alive++;
+  }
+  
+  ~Y() {
+    num_alive--;
+  }
+  
+  Request& request;
+  
+  static int num_alive;
+};
+
+int Y::num_alive = 0;
+
+struct Z {
+  INJECT(Z()) = default;
+};
+
+fruit::Component<fruit::Required<Request>, Y> getComponent() {
+  return fruit::createComponent();
+}
+
+fruit::Component<Request> getRequestComponent(Request& request) {
+  return fruit::createComponent()
+    .bindInstance(request)
+    .addInstanceMultibinding(request);
+}
+
+fruit::Component<Request, Z> getRequestComponentWithZ(Request& request) {
+  return fruit::createComponent()
+    .bindInstance(request)
+    .registerConstructor<Z()>();
+}
+
+int main() {
+  fruit::NormalizedComponent<fruit::Required<Request>, Y> normalizedComponent(getComponent());
+  Request prototypeRequest{0};
+  fruit::PreparedDelta<fruit::Required<Request>, Y> preparedDelta(normalizedComponent,
+                                                                  getRequestComponent(prototypeRequest));
+  
+  Request request1{1};
+  fruit::Injector<Y> injector(preparedDelta, getRequestComponent(request1));
+  Y* y = injector.get<Y*>();
+  Assert(&y->request == &request1);
+  Assert(injector.getMultibindings<Request>().size() == 1);
+  Assert(injector.getMultibindings<Request>()[0] == &request1);
+  Assert(Y::num_alive == 1);
+  
+  for (int i = 2; i < 10; i++) {
+    Request request{i};
+    fruit::Component<Request> requestComponent = getRequestComponent(request);
+    
+    std::size_t num_allocations_before_reset = num_allocations;
+    injector.reset(preparedDelta, std::move(requestComponent));
+    Assert(Y::num_alive == 0);
+    Y* new_y = injector.get<Y*>();
+#ifndef FRUIT_EXTRA_DEBUG
+    // In extra debug mode some debugging data structures are copied, so this doesn't hold.
+    Assert(num_allocations == num_allocations_before_reset);
+#else
+    (void)num_allocations_before_reset;
+#endif
+    
+    Assert(Y::num_alive == 1);
+    Assert(&new_y->request == &request);
+    // The memory for Y is reused.
+    Assert(new_y == y);
+    
+    // Getting the multibindings as a range doesn't allocate memory.
+    std::size_t num_allocations_before_range = num_allocations;
+    fruit::MultibindingsRange<Request> requests = injector.getMultibindingsRange<Request>();
+    Assert(num_allocations == num_allocations_before_range);
+    Assert(requests.size() == 1);
+    Assert(requests[0] == &request);
+    
+    Assert(injector.getMultibindings<Request>().size() == 1);
+    Assert(injector.getMultibindings<Request>()[0] == &request);
+  }
+  
+  // A component with a different shape, this rebuilds the injector.
+  Request request2{2};
+  injector.reset(preparedDelta, getRequestComponentWithZ(request2));
+  Assert(Y::num_alive == 0);
+  Assert(&injector.get<Y&>().request == &request2);
+  Assert(injector.getMultibindings<Request>().empty());
+  
+  // And then back to a component with the same shape as the prototype.
+  Request request3{3};
+  injector.reset(preparedDelta, getRequestComponent(request3));
+  Assert(&injector.get<Y&>().request == &request3);
+  injector.reset(preparedDelta, getRequestComponent(request3));
+  Assert(&injector.get<Y&>().request == &request3);
+  
+  // Concurrent mode stays enabled after a reset.
+  injector.enableConcurrentInjection();
+  injector.get<Y*>();
+  Request request4{4};
+  injector.reset(preparedDelta, getRequestComponent(request4));
+  Assert(&injector.get<Y&>().request == &request4);
+  
+  return 0;
+}
@@ -0,0 +1,173 @@
+/*
+ * Copyright 2014 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "test_common.h"
+
+#include <cstdint>
+#include <new>
+
+// A MemoryResource that allocates from a fixed buffer (releasing memory is a no-op), and keeps track of the number of
+// bytes that haven't been deallocated yet.
+class ArenaMemoryResource : public fruit::MemoryResource {
+private:
+  alignas(std::max_align_t) char buffer[64 * 1024];
+  std::size_t used = 0;
+  
+public:
+  std::size_t num_live_bytes = 0;
+  std::size_t num_allocations = 0;
+  
+  void* allocate(std::size_t bytes, std::size_t alignment) override {
+    used = (used + alignment - 1) / alignment * alignment;
+    if (used + bytes > sizeof(buffer)) {
+      throw std::bad_alloc();
+    }
+    void* p = buffer + used;
+    used += bytes;
+    num_live_bytes += bytes;
+    num_allocations++;
+    return p;
+  }
+  
+  void deallocate(void* p, std::size_t bytes, std::size_t alignment) override {
+    (void)alignment;
+    Assert(contains(p));
+    num_live_bytes -= bytes;
+  }
+  
+  bool contains(const void* p) const {
+    return std::uintptr_t(buffer) <= std::uintptr_t(p) && std::uintptr_t(p) < std::uintptr_t(buffer + sizeof(buffer));
+  }
+};
+
+struct Request {
+  int id;
+};
+
+struct Y {
+  INJECT(Y(Request& request)) : request(request) {
+  }
+  
+  Request& request;
+};
+
+struct Z {
+  INJECT(Z(Y& y)) : y(y) {
+  }
+  
+  Y& y;
+};
+
+struct Listener {
+  virtual ~Listener() = default;
+};
+
+struct ListenerImpl : public Listener {
+  INJECT(ListenerImpl()) = default;
+};
+
+fruit::Component<fruit::Required<Request>, Z> getComponent() {
+  return fruit::createComponent()
+    .addMultibinding<Listener, ListenerImpl>();
+}
+
+fruit::Component<Request> getRequestComponent(Request& request) {
+  return fruit::createComponent()
+    .bindInstance(request);
+}
+
+fruit::Component<Z> getFullComponent(Request& request) {
+  return fruit::createComponent()
+    .install(getComponent())
+    .install(getRequestComponent(request));
+}
+
+int main() {
+  Request request{1};
+  
+  // Injector from a Component.
+  {
+    ArenaMemoryResource arena;
+    {
+      fruit::Injector<Z> injector(getFullComponent(request), arena);
+      Z* z = injector.get<Z*>();
+      Assert(arena.contains(z));
+      Assert(arena.contains(&(z->y)));
+      Assert(&(z->y.request) == &request);
+      const std::vector<Listener*>& listeners = injector.getMultibindings<Listener>();
+      Assert(listeners.size() == 1);
+      Assert(arena.contains(listeners[0]));
+      Assert(arena.num_allocations != 0);
+    }
+    Assert(arena.num_live_bytes == 0);
+  }
+  
+  // NormalizedComponent and Injector using different MemoryResources.
+  {
+    ArenaMemoryResource normalized_component_arena;
+    {
+      fruit::NormalizedComponent<fruit::Required<Request>, Z> normalizedComponent(getComponent(),
+                                                                                  normalized_component_arena);
+      Assert(normalized_component_arena.num_allocations != 0);
+      
+      ArenaMemoryResource injector_arena;
+      {
+        std::size_t num_normalized_component_allocations = normalized_component_arena.num_allocations;
+        fruit::Injector<Z> injector(normalizedComponent, getRequestComponent(request), injector_arena);
+        Z* z = injector.get<Z*>();
+        Assert(injector_arena.contains(z));
+        Assert(&(z->y.request) == &request);
+        Assert(injector.getMultibindings<Listener>().size() == 1);
+        Assert(injector_arena.contains(injector.getMultibindings<Listener>()[0]));
+        // Creating the injector doesn't allocate memory from the NormalizedComponent's MemoryResource.
+        Assert(normalized_component_arena.num_allocations == num_normalized_component_allocations);
+      }
+      Assert(injector_arena.num_live_bytes == 0);
+      
+      // PreparedDelta (with reset) and concurrent mode.
+      {
+        Request request2{2};
+        fruit::PreparedDelta<fruit::Required<Request>, Z> preparedDelta(normalizedComponent, getRequestComponent(request));
+        fruit::Injector<Z> injector(preparedDelta, getRequestComponent(request), injector_arena);
+        injector.enableConcurrentInjection();
+        Z* z = injector.get<Z*>();
+        Assert(injector_arena.contains(z));
+        Assert(&(z->y.request) == &request);
+        
+        injector.reset(preparedDelta, getRequestComponent(request2));
+        z = injector.get<Z*>();
+        Assert(injector_arena.contains(z));
+        Assert(&(z->y.request) == &request2);
+      }
+      Assert(injector_arena.num_live_bytes == 0);
+    }
+    Assert(normalized_component_arena.num_live_bytes == 0);
+  }
+  
+  // Injector from a NormalizedComponent alone.
+  {
+    ArenaMemoryResource arena;
+    {
+      fruit::NormalizedComponent<Z> normalizedComponent(getFullComponent(request));
+      fruit::Injector<Z> injector(normalizedComponent, arena);
+      Assert(arena.contains(injector.get<Z*>()));
+      Assert(arena.contains(injector.getMultibindings<Listener>()[0]));
+    }
+    Assert(arena.num_live_bytes == 0);
+  }
+  
+  return 0;
+}
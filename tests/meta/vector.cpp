@@ -34,6 +34,15 @@ void test_IsInVector() {
 	Assert(IsInVector(A, Vector<A>));
 }
 
+void test_IndexInVector() {
+	AssertSameType(Id<IndexInVector(A, Vector<>)>, Int<0>);
+	AssertSameType(Id<IndexInVector(A, Vector<A>)>, Int<0>);
+	AssertSameType(Id<IndexInVector(A, Vector<B>)>, Int<1>);
+	AssertSameType(Id<IndexInVector(B, Vector<A, B, C>)>, Int<1>);
+	AssertSameType(Id<IndexInVector(C, Vector<A, B, C>)>, Int<2>);
+	AssertSameType(Id<IndexInVector(A, Vector<B, A, A>)>, Int<1>);
+}
+
 void test_IsSameVector() {
 	AssertNotSameType(Vector<A, B>, Vector<B, A>);
 	AssertNotSameType(Vector<A>, Vector<>);
@@ -73,6 +82,7 @@ void test_VectorRemoveFirstN() {
 int main() {
 
 	test_IsInVector();
+	test_IndexInVector();
 	test_IsSameVector();
 	test_VectorSize();
 	test_ConcatVectors();
@@ -0,0 +1,219 @@
+/*
+ * Copyright 2014 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "test_common.h"
+
+#include <algorithm>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Runs each task in a new thread.
+struct ThreadPerTaskExecutor {
+  std::vector<std::thread> threads;
+  std::size_t num_tasks = 0;
+
+  void execute(std::function<void()> task) {
+    num_tasks++;
+    threads.push_back(std::thread(std::move(task)));
+  }
+
+  ~ThreadPerTaskExecutor() {
+    for (std::thread& thread : threads) {
+      thread.join();
+    }
+  }
+};
+
+std::mutex events_mutex;
+std::vector<std::string> events;
+
+void addEvent(std::string event) {
+  std::lock_guard<std::mutex> lock(events_mutex);
+  events.push_back(event);
+}
+
+std::size_t findEvent(std::string event) {
+  std::size_t result = std::find(events.begin(), events.end(), event) - events.begin();
+  Assert(result != events.size());
+  // Each event must happen only once.
+  Assert(std::count(events.begin(), events.end(), event) == 1);
+  return result;
+}
+
+// The dependency graph is:
+// X -> Y1, Y2, Y3, Provider<Z>
+// Y1, Y2, Y3 -> W
+template <int i>
+struct Tracked {
+  Tracked() {
+    addEvent("construct " + std::to_string(i));
+  }
+
+  ~Tracked() {
+    addEvent("destroy " + std::to_string(i));
+  }
+};
+
+struct W : public Tracked<0> {
+  INJECT(W()) = default;
+};
+
+template <int i>
+struct Y : public Tracked<i> {
+  INJECT(Y(W&)) {
+  }
+};
+
+struct Z : public Tracked<4> {
+  INJECT(Z()) = default;
+};
+
+struct X : public Tracked<5> {
+  INJECT(X(Y<1>&, Y<2>&, Y<3>&, fruit::Provider<Z>)) {
+  }
+};
+
+struct Unreachable : public Tracked<6> {
+  INJECT(Unreachable()) = default;
+};
+
+struct Multi : public Tracked<7> {
+};
+
+fruit::Component<X> getComponent() {
+  return fruit::createComponent()
+    .registerConstructor<Unreachable()>()
+    .addMultibindingProvider([](W&) { return new Multi(); });
+}
+
+struct ConstructionFailure {};
+
+struct Throwing {
+  INJECT(Throwing(W&)) {
+    throw ConstructionFailure();
+  }
+};
+
+// Depends on Throwing, so it's in a later layer.
+struct DependsOnThrowing {
+  INJECT(DependsOnThrowing(Throwing&, Y<1>&)) {
+    num_constructed++;
+  }
+
+  static int num_constructed;
+};
+
+int DependsOnThrowing::num_constructed = 0;
+
+fruit::Component<DependsOnThrowing> getThrowingComponent() {
+  return fruit::createComponent();
+}
+
+void testThrowingConstructor() {
+  events.clear();
+  {
+    fruit::Injector<DependsOnThrowing> injector(getThrowingComponent());
+    ThreadPerTaskExecutor executor;
+    bool thrown = false;
+    try {
+      injector.eagerlyInjectAll(executor);
+    } catch (const ConstructionFailure&) {
+      thrown = true;
+    }
+    // The exception is rethrown on this thread, and the following layers are not started.
+    Assert(thrown);
+    Assert(DependsOnThrowing::num_constructed == 0);
+    // W, then Throwing and Y<1>.
+    Assert(executor.num_tasks == 3);
+    Assert(findEvent("construct 0") < findEvent("construct 1"));
+    Assert(events.size() == 2);
+  }
+  // The objects that were constructed are still destroyed.
+  Assert(events.size() == 4);
+  Assert(findEvent("destroy 1") < findEvent("destroy 0"));
+}
+
+void testConcurrentMode() {
+  events.clear();
+  {
+    fruit::Injector<X> injector(getComponent());
+    // W is constructed before switching to concurrent mode, so the tasks that depend on it must still be able to get it.
+    injector.unsafeGet<W>();
+    injector.enableConcurrentInjection();
+    // Other threads can use the injector during the parallel eager injection.
+    std::thread other_thread([&injector]() {
+      Assert(injector.unsafeGet<Z>() != nullptr);
+    });
+    {
+      ThreadPerTaskExecutor executor;
+      injector.eagerlyInjectAll(executor);
+      // Y<1>, Y<2>, Y<3>, X, and also Z unless the other thread constructed it first.
+      Assert(executor.num_tasks == 4 || executor.num_tasks == 5);
+    }
+    other_thread.join();
+    // Each object is constructed only once.
+    for (int i = 0; i < 6; ++i) {
+      findEvent("construct " + std::to_string(i));
+    }
+    findEvent("construct 7");
+    Assert(events.size() == 7);
+  }
+  Assert(events.size() == 14);
+}
+
+int main() {
+  {
+    fruit::Injector<X> injector(getComponent());
+    ThreadPerTaskExecutor executor;
+    injector.eagerlyInjectAll(executor);
+    // W, Y<1>, Y<2>, Y<3>, Z and X.
+    Assert(executor.num_tasks == 6);
+
+    Assert(findEvent("construct 0") < findEvent("construct 1"));
+    Assert(findEvent("construct 0") < findEvent("construct 2"));
+    Assert(findEvent("construct 0") < findEvent("construct 3"));
+    Assert(findEvent("construct 1") < findEvent("construct 5"));
+    Assert(findEvent("construct 2") < findEvent("construct 5"));
+    Assert(findEvent("construct 3") < findEvent("construct 5"));
+    Assert(findEvent("construct 4") < findEvent("construct 5"));
+    Assert(findEvent("construct 5") < findEvent("construct 7"));
+    Assert(std::count(events.begin(), events.end(), "construct 6") == 0);
+    Assert(events.size() == 7);
+
+    // Nothing else is constructed after this point.
+    injector.get<X&>();
+    injector.getMultibindings<Multi>();
+    Assert(events.size() == 7);
+  }
+
+  // Objects are destroyed in the reverse order of their dependencies.
+  Assert(events.size() == 14);
+  Assert(findEvent("destroy 5") < findEvent("destroy 1"));
+  Assert(findEvent("destroy 5") < findEvent("destroy 2"));
+  Assert(findEvent("destroy 5") < findEvent("destroy 3"));
+  Assert(findEvent("destroy 5") < findEvent("destroy 4"));
+  Assert(findEvent("destroy 1") < findEvent("destroy 0"));
+  Assert(findEvent("destroy 2") < findEvent("destroy 0"));
+  Assert(findEvent("destroy 3") < findEvent("destroy 0"));
+  Assert(findEvent("destroy 7") < findEvent("destroy 0"));
+
+  testThrowingConstructor();
+  testConcurrentMode();
+
+  return 0;
+}
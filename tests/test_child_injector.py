@@ -0,0 +1,454 @@
+#!/usr/bin/env python3
+#  Copyright 2016 Google Inc. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS-IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+from nose2.tools import params
+
+from fruit_test_common import *
+
+COMMON_DEFINITIONS = '''
+    #include "test_common.h"
+
+    struct Annotation1 {};
+    '''
+
+@params(
+    ('X', 'X&'),
+    ('fruit::Annotated<Annotation1, X>', 'ANNOTATED(Annotation1, X&)'))
+def test_child_injector_shares_parent_objects_success(XAnnot, X_ANNOT_REF):
+    source = '''
+        struct X {
+          INJECT(X()) {
+            ++num_constructed;
+          }
+
+          static int num_constructed;
+        };
+
+        int X::num_constructed = 0;
+
+        struct Request {
+          int id;
+        };
+
+        struct Y {
+          X& x;
+          Request& request;
+
+          INJECT(Y(X_ANNOT_REF x, Request& request)) : x(x), request(request) {}
+        };
+
+        fruit::Component<XAnnot> getParentComponent() {
+          return fruit::createComponent();
+        }
+
+        fruit::Component<fruit::Required<XAnnot>, Y> getRequestComponent(Request& request) {
+          return fruit::createComponent()
+            .bindInstance(request);
+        }
+
+        int main() {
+          fruit::Injector<XAnnot> parentInjector(getParentComponent());
+
+          Request request1{1};
+          fruit::Injector<Y> child1(parentInjector, getRequestComponent(request1));
+          Y* y1 = child1.get<Y*>();
+          Assert(&y1->request == &request1);
+          // X is constructed (once) in the parent injector, when it's first needed.
+          Assert(X::num_constructed == 1);
+          Assert(&y1->x == parentInjector.unsafeGet<XAnnot>());
+
+          Request request2{2};
+          fruit::Injector<XAnnot, Y> child2(parentInjector, getRequestComponent(request2));
+          Y* y2 = child2.get<Y*>();
+          Assert(y2 != y1);
+          Assert(&y2->request == &request2);
+          Assert(&y2->x == &y1->x);
+          Assert(child2.unsafeGet<XAnnot>() == &y1->x);
+          Assert(X::num_constructed == 1);
+        }
+        '''
+    expect_success(
+        COMMON_DEFINITIONS,
+        source,
+        locals())
+
+def test_child_injector_parent_object_constructed_before_success():
+    source = '''
+        struct X {
+          INJECT(X()) = default;
+        };
+
+        struct Y {
+          X& x;
+
+          INJECT(Y(X& x)) : x(x) {}
+
+          ~Y() {
+            ++num_destroyed;
+          }
+
+          static int num_destroyed;
+        };
+
+        int Y::num_destroyed = 0;
+
+        fruit::Component<X> getParentComponent() {
+          return fruit::createComponent();
+        }
+
+        fruit::Component<fruit::Required<X>, Y> getChildComponent() {
+          return fruit::createComponent();
+        }
+
+        int main() {
+          fruit::Injector<X> parentInjector(getParentComponent());
+          X* x = parentInjector.get<X*>();
+          {
+            fruit::Injector<Y> child(parentInjector, getChildComponent());
+            Assert(&child.get<Y&>().x == x);
+            // Types of the parent that the child doesn't need can still be got with unsafeGet().
+            Assert(child.unsafeGet<X>() == x);
+          }
+          // The objects of the child are destroyed with the child, the ones of the parent are not.
+          Assert(Y::num_destroyed == 1);
+          Assert(parentInjector.get<X*>() == x);
+        }
+        '''
+    expect_success(
+        COMMON_DEFINITIONS,
+        source)
+
+def test_child_injector_multibindings_success():
+    source = '''
+        struct Listener {
+          virtual ~Listener() = default;
+        };
+
+        struct ListenerA : public Listener {
+          INJECT(ListenerA()) = default;
+        };
+
+        struct ListenerB : public Listener {
+          INJECT(ListenerB()) = default;
+        };
+
+        struct Other {
+          INJECT(Other()) = default;
+        };
+
+        struct Y {
+          INJECT(Y()) = default;
+        };
+
+        fruit::Component<> getParentComponent() {
+          return fruit::createComponent()
+            .addMultibinding<Listener, ListenerA>()
+            .addMultibinding<Other, Other>();
+        }
+
+        fruit::Component<Y> getChildComponent() {
+          return fruit::createComponent()
+            .addMultibinding<Listener, ListenerB>();
+        }
+
+        int main() {
+          fruit::Injector<> parentInjector(getParentComponent());
+          fruit::Injector<Y> child(parentInjector, getChildComponent());
+
+          // The multibindings of the parent come first, and their objects are shared with the parent.
+          const std::vector<Listener*>& listeners = child.getMultibindings<Listener>();
+          Assert(listeners.size() == 2);
+          Assert(listeners[0] == parentInjector.getMultibindings<Listener>()[0]);
+          Assert(dynamic_cast<ListenerA*>(listeners[0]) != nullptr);
+          Assert(dynamic_cast<ListenerB*>(listeners[1]) != nullptr);
+          Assert(parentInjector.getMultibindings<Listener>().size() == 1);
+
+          fruit::MultibindingsRange<Listener> range = child.getMultibindingsRange<Listener>();
+          Assert(range.size() == 2);
+          Assert(range[0] == listeners[0]);
+          Assert(range[1] == listeners[1]);
+
+          // Types with multibindings only in the parent.
+          Assert(child.getMultibindings<Other>().size() == 1);
+          Assert(child.getMultibindings<Other>()[0] == parentInjector.getMultibindings<Other>()[0]);
+          Assert(child.getMultibindingsRange<Other>().size() == 1);
+
+          child.eagerlyInjectAll();
+        }
+        '''
+    expect_success(
+        COMMON_DEFINITIONS,
+        source)
+
+def test_child_injector_of_child_injector_success():
+    source = '''
+        struct X {
+          INJECT(X()) = default;
+        };
+
+        struct Y {
+          X& x;
+
+          INJECT(Y(X& x)) : x(x) {}
+        };
+
+        struct Z {
+          X& x;
+          Y& y;
+
+          INJECT(Z(X& x, Y& y)) : x(x), y(y) {}
+        };
+
+        fruit::Component<X> getParentComponent() {
+          return fruit::createComponent();
+        }
+
+        fruit::Component<fruit::Required<X>, Y> getChildComponent() {
+          return fruit::createComponent();
+        }
+
+        fruit::Component<fruit::Required<X, Y>, Z> getGrandchildComponent() {
+          return fruit::createComponent();
+        }
+
+        int main() {
+          fruit::Injector<X> parentInjector(getParentComponent());
+          fruit::Injector<X, Y> child(parentInjector, getChildComponent());
+          fruit::Injector<Z> grandchild(child, getGrandchildComponent());
+
+          Z* z = grandchild.get<Z*>();
+          Assert(&z->y == child.get<Y*>());
+          Assert(&z->x == parentInjector.get<X*>());
+          Assert(&z->y.x == &z->x);
+        }
+        '''
+    expect_success(
+        COMMON_DEFINITIONS,
+        source)
+
+def test_child_injector_concurrent_parent_success():
+    source = '''
+        struct X {
+          INJECT(X()) = default;
+        };
+
+        struct Y {
+          X& x;
+
+          INJECT(Y(X& x)) : x(x) {}
+        };
+
+        struct InlineExecutor {
+          void execute(std::function<void()> f) {
+            f();
+          }
+        };
+
+        fruit::Component<X> getParentComponent() {
+          return fruit::createComponent();
+        }
+
+        fruit::Component<fruit::Required<X>, Y> getChildComponent() {
+          return fruit::createComponent();
+        }
+
+        int main() {
+          fruit::Injector<X> parentInjector(getParentComponent());
+          parentInjector.enableConcurrentInjection();
+
+          fruit::Injector<Y> child1(parentInjector, getChildComponent());
+          InlineExecutor executor;
+          child1.eagerlyInjectAll(executor);
+          X* x = &child1.get<Y*>()->x;
+          Assert(x == parentInjector.get<X*>());
+
+          // Now X is already constructed when the child is created.
+          fruit::Injector<Y> child2(parentInjector, getChildComponent());
+          child2.enableConcurrentInjection();
+          Assert(&child2.get<Y*>()->x == x);
+        }
+        '''
+    expect_success(
+        COMMON_DEFINITIONS,
+        source)
+
+def test_child_injector_same_binding_as_parent_success():
+    source = '''
+        struct X {
+          INJECT(X()) = default;
+        };
+
+        struct Y {
+          INJECT(Y(X&)) {}
+        };
+
+        struct Z {
+          X& x;
+
+          INJECT(Z(X& x, Y&)) : x(x) {}
+        };
+
+        // X is bound (but not exposed) in both components.
+        fruit::Component<Y> getParentComponent() {
+          return fruit::createComponent();
+        }
+
+        fruit::Component<fruit::Required<Y>, Z> getChildComponent() {
+          return fruit::createComponent();
+        }
+
+        int main() {
+          fruit::Injector<Y> parentInjector(getParentComponent());
+          fruit::Injector<Z> child(parentInjector, getChildComponent());
+          X* x = &child.get<Z&>().x;
+          Assert(parentInjector.unsafeGet<X>() == x);
+        }
+        '''
+    expect_success(
+        COMMON_DEFINITIONS,
+        source)
+
+@params(
+    ('X', '(struct )?X'),
+    ('fruit::Annotated<Annotation1, X>', '(struct )?fruit::Annotated<(struct )?Annotation1, ?(struct )?X>'),
+)
+def test_child_injector_binding_clash_with_parent_error(XAnnot, XAnnotRegex):
+    source = '''
+        struct X {};
+
+        struct Y {
+          using Inject = Y(XAnnot);
+          Y(X) {}
+        };
+
+        struct Z {
+          using Inject = Z(XAnnot, Y&);
+          Z(X, Y&) {}
+        };
+
+        fruit::Component<Y> getParentComponent(X& x) {
+          return fruit::createComponent()
+            .bindInstance<XAnnot, X>(x);
+        }
+
+        fruit::Component<fruit::Required<Y>, Z> getChildComponent(X& x) {
+          return fruit::createComponent()
+            .bindInstance<XAnnot, X>(x);
+        }
+
+        int main() {
+          X x1;
+          X x2;
+          fruit::Injector<Y> parentInjector(getParentComponent(x1));
+          fruit::Injector<Z> child(parentInjector, getChildComponent(x2));
+        }
+        '''
+    expect_runtime_error(
+        'Fatal injection error: the type XAnnotRegex was provided more than once, with different bindings.',
+        COMMON_DEFINITIONS,
+        source,
+        locals())
+
+def test_child_injector_binding_of_constructed_parent_object_error():
+    source = '''
+        struct X {
+          INJECT(X()) = default;
+        };
+
+        struct Y {
+          INJECT(Y(X&)) {}
+        };
+
+        struct Z {
+          INJECT(Z(X&, Y&)) {}
+        };
+
+        fruit::Component<Y> getParentComponent() {
+          return fruit::createComponent();
+        }
+
+        fruit::Component<fruit::Required<Y>, Z> getChildComponent() {
+          return fruit::createComponent();
+        }
+
+        int main() {
+          fruit::Injector<Y> parentInjector(getParentComponent());
+          parentInjector.get<Y&>();
+          fruit::Injector<Z> child(parentInjector, getChildComponent());
+        }
+        '''
+    expect_runtime_error(
+        'Fatal injection error: the type (struct )?X is bound both in the component of a child injector and in its parent injector',
+        COMMON_DEFINITIONS,
+        source)
+
+@params('X', 'fruit::Annotated<Annotation1, X>')
+def test_child_injector_requirement_not_provided_by_parent_error(XAnnot):
+    source = '''
+        struct X {};
+
+        struct Y {};
+
+        fruit::Component<Y> getParentComponent() {
+          return fruit::createComponent()
+            .registerConstructor<Y()>();
+        }
+
+        fruit::Component<fruit::Required<XAnnot>> getChildComponent() {
+          return fruit::createComponent();
+        }
+
+        int main() {
+          fruit::Injector<Y> parentInjector(getParentComponent());
+          fruit::Injector<> child(parentInjector, getChildComponent());
+        }
+        '''
+    expect_compile_error(
+        'UnsatisfiedRequirementsInChildInjectorError<XAnnot>',
+        'The requirements in UnsatisfiedRequirements are required by the Component but are not provided by the parent injector',
+        COMMON_DEFINITIONS,
+        source,
+        locals())
+
+@params('X', 'fruit::Annotated<Annotation1, X>')
+def test_child_injector_type_not_provided_error(XAnnot):
+    source = '''
+        struct X {};
+
+        struct Y {};
+
+        fruit::Component<Y> getParentComponent() {
+          return fruit::createComponent()
+            .registerConstructor<Y()>();
+        }
+
+        fruit::Component<> getChildComponent() {
+          return fruit::createComponent();
+        }
+
+        int main() {
+          fruit::Injector<Y> parentInjector(getParentComponent());
+          fruit::Injector<XAnnot> child(parentInjector, getChildComponent());
+        }
+        '''
+    expect_compile_error(
+        'TypesInInjectorNotProvidedError<XAnnot>',
+        'The types in TypesNotProvided are declared as provided by the injector, but none of the two components passed to the Injector constructor provides them.',
+        COMMON_DEFINITIONS,
+        source,
+        locals())
+
+if __name__ == '__main__':
+    import nose2
+    nose2.main()
@@ -0,0 +1,96 @@
+#!/usr/bin/env python3
+#  Copyright 2016 Google Inc. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS-IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+from nose2.tools import params
+
+from fruit_test_common import *
+
+COMMON_DEFINITIONS = '''
+    #include "test_common.h"
+
+    struct X {
+      INJECT(X()) = default;
+    };
+
+    struct Y {
+      INJECT(Y(X&)) {}
+    };
+
+    fruit::Component<Y> getComponent() {
+      return fruit::createComponent();
+    }
+
+    fruit::Component<fruit::Required<Y>> getChildComponent() {
+      return fruit::createComponent();
+    }
+    '''
+
+def test_frozen_injector_object_constructed_before_error():
+    source = '''
+        int main() {
+          fruit::Injector<Y> injector(getComponent());
+          injector.get<Y&>();
+          fruit::FrozenInjector<Y> frozenInjector(std::move(injector));
+        }
+        '''
+    expect_runtime_error(
+        'Fatal injection error: a FrozenInjector can only be constructed from an Injector that hasn.t constructed any object yet.',
+        COMMON_DEFINITIONS,
+        source)
+
+def test_frozen_injector_provider_got_before_success():
+    source = '''
+        int main() {
+          fruit::Injector<Y> injector(getComponent());
+          // Getting a Provider doesn't construct any object.
+          injector.get<fruit::Provider<Y>>();
+          fruit::FrozenInjector<Y> frozenInjector(std::move(injector));
+          frozenInjector.get<Y&>();
+        }
+        '''
+    expect_success(
+        COMMON_DEFINITIONS,
+        source)
+
+def test_frozen_injector_with_child_injector_error():
+    source = '''
+        int main() {
+          fruit::Injector<Y> injector(getComponent());
+          fruit::Injector<Y> childInjector(injector, getChildComponent());
+          fruit::FrozenInjector<Y> frozenInjector(std::move(injector));
+        }
+        '''
+    expect_runtime_error(
+        'Fatal injection error: a FrozenInjector can.t be constructed from an Injector that has child injectors.',
+        COMMON_DEFINITIONS,
+        source)
+
+def test_frozen_injector_child_injector_destroyed_success():
+    source = '''
+        int main() {
+          fruit::Injector<Y> injector(getComponent());
+          {
+            fruit::Injector<> childInjector(injector, getChildComponent());
+          }
+          fruit::FrozenInjector<Y> frozenInjector(std::move(injector));
+          frozenInjector.get<Y&>();
+        }
+        '''
+    expect_success(
+        COMMON_DEFINITIONS,
+        source)
+
+if __name__ == '__main__':
+    import nose2
+    nose2.main()
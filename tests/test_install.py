@@ -116,6 +116,138 @@ def test_with_requirements_not_specified_in_child_component_error():
         COMMON_DEFINITIONS,
         source)
 
+def test_same_component_installed_through_multiple_paths_success():
+    source = '''
+        struct Listener {
+          virtual ~Listener() = default;
+        };
+
+        struct ListenerA : public Listener {
+          INJECT(ListenerA()) = default;
+        };
+
+        struct ListenerB : public Listener {
+          INJECT(ListenerB()) = default;
+        };
+
+        struct ListenerC : public Listener {
+          INJECT(ListenerC()) = default;
+        };
+
+        const fruit::Component<>& getListenerBComponent() {
+          static const fruit::Component<> comp = fruit::createComponent()
+            .addMultibinding<Listener, ListenerB>();
+          return comp;
+        }
+
+        fruit::Component<> getComponent1() {
+          return fruit::createComponent()
+            .install(getListenerBComponent());
+        }
+
+        fruit::Component<> getComponent2() {
+          return fruit::createComponent()
+            .install(getListenerBComponent());
+        }
+
+        fruit::Component<> getComponent() {
+          return fruit::createComponent()
+            .addMultibinding<Listener, ListenerA>()
+            .install(getComponent1())
+            .install(getComponent2())
+            .addMultibinding<Listener, ListenerC>();
+        }
+
+        int main() {
+          fruit::Injector<> injector(getComponent());
+          std::vector<Listener*> listeners = injector.getMultibindings<Listener>();
+          // The component object installed through 2 paths only contributes its multibindings once.
+          Assert(listeners.size() == 3);
+          int num_a = 0, num_b = 0, num_c = 0;
+          for (Listener* listener : listeners) {
+            num_a += dynamic_cast<ListenerA*>(listener) != nullptr;
+            num_b += dynamic_cast<ListenerB*>(listener) != nullptr;
+            num_c += dynamic_cast<ListenerC*>(listener) != nullptr;
+          }
+          Assert(num_a == 1);
+          Assert(num_b == 1);
+          Assert(num_c == 1);
+        }
+        '''
+    expect_success(COMMON_DEFINITIONS, source)
+
+def test_wide_diamond_installs_deduplicated_success():
+    source = '''
+        struct Listener {
+          virtual ~Listener() = default;
+        };
+
+        struct ListenerImpl : public Listener {
+          INJECT(ListenerImpl()) = default;
+        };
+
+        // getComponent<N, I>() installs both components of level N-1, so the component of level 0 is reachable through
+        // 2^N install paths.
+        template <int N, int I>
+        struct ComponentGetter {
+          static const fruit::Component<>& get() {
+            static const fruit::Component<> comp = fruit::createComponent()
+              .install(ComponentGetter<N - 1, 0>::get())
+              .install(ComponentGetter<N - 1, 1>::get());
+            return comp;
+          }
+        };
+
+        template <int I>
+        struct ComponentGetter<0, I> {
+          static const fruit::Component<>& get() {
+            static const fruit::Component<> comp = fruit::createComponent()
+              .addMultibinding<Listener, ListenerImpl>();
+            return comp;
+          }
+        };
+
+        int main() {
+          fruit::Injector<> injector(ComponentGetter<40, 0>::get());
+          // Both components of level 0 contribute a multibinding.
+          Assert(injector.getMultibindings<Listener>().size() == 2);
+        }
+        '''
+    expect_success(COMMON_DEFINITIONS, source)
+
+def test_copied_component_installed_and_modified_success():
+    source = '''
+        struct X {
+          int n;
+          X(int n) : n(n) {}
+        };
+
+        struct Y {
+          INJECT(Y()) = default;
+        };
+
+        fruit::Component<X> getXComponent() {
+          return fruit::createComponent()
+            .registerProvider([]() { return X(5); });
+        }
+
+        int main() {
+          fruit::Component<X> xComponent = getXComponent();
+          // These share the bindings of xComponent.
+          fruit::Component<X> xComponentCopy = xComponent;
+          fruit::Component<X, Y> xyComponent = fruit::createComponent()
+            .install(xComponent);
+          fruit::Injector<X> injector1(xComponentCopy);
+          Assert(injector1.get<X>().n == 5);
+          fruit::Injector<X, Y> injector2(xyComponent);
+          Assert(injector2.get<X>().n == 5);
+          injector2.get<Y*>();
+          fruit::Injector<X> injector3(xComponent);
+          Assert(injector3.get<X>().n == 5);
+        }
+        '''
+    expect_success(COMMON_DEFINITIONS, source)
+
 if __name__ == '__main__':
     import nose2
     nose2.main()
@@ -13,6 +13,8 @@
 # See the License for the specific language governing permissions and
 # limitations under the License.
 
+from nose2.tools import params
+
 from fruit_test_common import *
 
 COMMON_DEFINITIONS = '''
@@ -44,6 +46,68 @@ def test_get_none():
         COMMON_DEFINITIONS,
         source)
 
+def test_get_range_none():
+    source = '''
+        struct X {};
+
+        fruit::Component<> getComponent() {
+          return fruit::createComponent();
+        }
+
+        int main() {
+          fruit::Injector<> injector(getComponent());
+
+          fruit::MultibindingsRange<X> multibindings = injector.getMultibindingsRange<X>();
+          Assert(multibindings.empty());
+          Assert(multibindings.size() == 0);
+          Assert(multibindings.begin() == multibindings.end());
+        }
+        '''
+    expect_success(
+        COMMON_DEFINITIONS,
+        source)
+
+@params('X', 'fruit::Annotated<Annotation, X>')
+def test_get_range(XAnnot):
+    source = '''
+        struct X {
+          int n;
+        };
+
+        static int numXConstructed = 0;
+
+        fruit::Component<> getComponent(X& x) {
+          return fruit::createComponent()
+            .addInstanceMultibinding<XAnnot, X>(x)
+            .addMultibindingProvider<XAnnot()>([](){ numXConstructed++; return X{2}; });
+        }
+
+        int main() {
+          X x{1};
+          fruit::Injector<> injector(getComponent(x));
+
+          fruit::MultibindingsRange<X> multibindings = injector.getMultibindingsRange<XAnnot>();
+          Assert(multibindings.size() == 2);
+          Assert(multibindings[0] == &x);
+          Assert(multibindings[1]->n == 2);
+          int sum = 0;
+          for (X* p : multibindings) {
+            sum += p->n;
+          }
+          Assert(sum == 3);
+
+          // The objects are only constructed once, and they're the same returned by getMultibindings().
+          const std::vector<X*>& v = injector.getMultibindings<XAnnot>();
+          Assert(std::vector<X*>(multibindings.begin(), multibindings.end()) == v);
+          Assert(injector.getMultibindingsRange<XAnnot>().begin() == multibindings.begin());
+          Assert(numXConstructed == 1);
+        }
+        '''
+    expect_success(
+        COMMON_DEFINITIONS,
+        source,
+        locals())
+
 def test_multiple_various_kinds():
     source = '''
         static int numNotificationsToListener1 = 0;
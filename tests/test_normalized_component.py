@@ -149,6 +149,725 @@ def test_unsatisfied_requirements(XAnnot):
         source,
         locals())
 
+@params(
+    ('X', 'X', 'Y'),
+    ('fruit::Annotated<Annotation1, X>', 'ANNOTATED(Annotation1, X)', 'fruit::Annotated<Annotation2, Y>'))
+def test_injector_from_normalized_component_only_success(XAnnot, X_ANNOT, YAnnot):
+    source = '''
+        struct X {
+          INJECT(X()) = default;
+        };
+
+        struct Y {
+          INJECT(Y(X_ANNOT)) {};
+        };
+
+        fruit::Component<YAnnot> getComponent() {
+          return fruit::createComponent();
+        }
+
+        int main() {
+          fruit::NormalizedComponent<YAnnot> normalizedComponent(getComponent());
+
+          for (int i = 0; i < 2; i++) {
+            fruit::Injector<YAnnot> injector(normalizedComponent);
+            injector.get<YAnnot>();
+          }
+        }
+        '''
+    expect_success(
+        COMMON_DEFINITIONS,
+        source,
+        locals())
+
+@params('X', 'fruit::Annotated<Annotation1, X>')
+def test_injector_from_normalized_component_only_unsatisfied_requirements(XAnnot):
+    source = '''
+        struct X {
+          INJECT(X());
+        };
+
+        fruit::Component<fruit::Required<XAnnot>> getComponent() {
+          return fruit::createComponent();
+        }
+
+        int main() {
+          fruit::NormalizedComponent<fruit::Required<XAnnot>> normalizedComponent(getComponent());
+          fruit::Injector<> injector(normalizedComponent);
+        }
+        '''
+    expect_compile_error(
+        'UnsatisfiedRequirementsInNormalizedComponentError<XAnnot>',
+        'The requirements in UnsatisfiedRequirements are required by the NormalizedComponent but are not provided by the Component',
+        COMMON_DEFINITIONS,
+        source,
+        locals())
+
+@params('X', 'fruit::Annotated<Annotation1, X>')
+def test_injector_from_normalized_component_only_type_not_provided(XAnnot):
+    source = '''
+        struct X {};
+
+        fruit::Component<> getComponent() {
+          return fruit::createComponent();
+        }
+
+        int main() {
+          fruit::NormalizedComponent<> normalizedComponent(getComponent());
+          fruit::Injector<XAnnot> injector(normalizedComponent);
+        }
+        '''
+    expect_compile_error(
+        'TypesInInjectorNotProvidedError<XAnnot>',
+        'The types in TypesNotProvided are declared as provided by the injector, but none of the two components passed to the Injector constructor provides them.',
+        COMMON_DEFINITIONS,
+        source,
+        locals())
+
+@params(
+    ('X', 'X&', 'Y', 'Y*'),
+    ('fruit::Annotated<Annotation1, X>', 'ANNOTATED(Annotation1, X&)', 'fruit::Annotated<Annotation2, Y>', 'fruit::Annotated<Annotation2, Y*>'))
+def test_injector_from_prepared_delta_success(XAnnot, X_ANNOT_REF, YAnnot, YPtrAnnot):
+    source = '''
+        struct X {
+          int n;
+        };
+
+        struct Y {
+          INJECT(Y(X_ANNOT_REF x)) : x(x) {};
+          X& x;
+        };
+
+        fruit::Component<fruit::Required<XAnnot>, YAnnot> getComponent() {
+          return fruit::createComponent();
+        }
+
+        fruit::Component<XAnnot> getXComponent(X& x) {
+          return fruit::createComponent()
+            .bindInstance<XAnnot, X>(x)
+            .addInstanceMultibinding<XAnnot, X>(x);
+        }
+
+        int main() {
+          fruit::NormalizedComponent<fruit::Required<XAnnot>, YAnnot> normalizedComponent(getComponent());
+          X prototypeX{0};
+          fruit::PreparedDelta<fruit::Required<XAnnot>, YAnnot> preparedDelta(normalizedComponent, getXComponent(prototypeX));
+
+          for (int i = 1; i <= 3; i++) {
+            X x{i};
+            fruit::Injector<YAnnot> injector(preparedDelta, getXComponent(x));
+            Y* y = injector.get<YPtrAnnot>();
+            Assert(&y->x == &x);
+            const std::vector<X*>& multibindings = injector.getMultibindings<XAnnot>();
+            Assert(multibindings.size() == 1);
+            Assert(multibindings[0] == &x);
+          }
+        }
+        '''
+    expect_success(
+        COMMON_DEFINITIONS,
+        source,
+        locals())
+
+@params(
+    ('X', 'X&', 'Y', 'Y*'),
+    ('fruit::Annotated<Annotation1, X>', 'ANNOTATED(Annotation1, X&)', 'fruit::Annotated<Annotation2, Y>', 'fruit::Annotated<Annotation2, Y*>'))
+def test_injector_from_prepared_delta_with_different_shape_success(XAnnot, X_ANNOT_REF, YAnnot, YPtrAnnot):
+    source = '''
+        struct X {
+          int n;
+        };
+
+        struct Y {
+          INJECT(Y(X_ANNOT_REF x)) : x(x) {};
+          X& x;
+        };
+
+        struct Z {
+          INJECT(Z()) = default;
+        };
+
+        fruit::Component<fruit::Required<XAnnot>, YAnnot> getComponent() {
+          return fruit::createComponent();
+        }
+
+        fruit::Component<XAnnot> getXComponent(X& x) {
+          return fruit::createComponent()
+            .bindInstance<XAnnot, X>(x);
+        }
+
+        fruit::Component<XAnnot, Z> getXZComponent(X& x) {
+          return fruit::createComponent()
+            .bindInstance<XAnnot, X>(x)
+            .addInstanceMultibinding<XAnnot, X>(x);
+        }
+
+        int main() {
+          fruit::NormalizedComponent<fruit::Required<XAnnot>, YAnnot> normalizedComponent(getComponent());
+          X prototypeX{0};
+          fruit::PreparedDelta<fruit::Required<XAnnot>, YAnnot> preparedDelta(normalizedComponent, getXComponent(prototypeX));
+
+          X x{1};
+          fruit::Injector<YAnnot, Z> injector(preparedDelta, getXZComponent(x));
+          Y* y = injector.get<YPtrAnnot>();
+          Assert(&y->x == &x);
+          injector.get<Z*>();
+          Assert(injector.getMultibindings<XAnnot>().size() == 1);
+        }
+        '''
+    expect_success(
+        COMMON_DEFINITIONS,
+        source,
+        locals())
+
+@params('X', 'fruit::Annotated<Annotation1, X>')
+def test_multibindings_shared_with_normalized_component(XAnnot):
+    source = '''
+        struct X {
+          int n;
+        };
+
+        struct Y {
+          int n;
+        };
+
+        static int numXConstructed = 0;
+
+        fruit::Component<> getComponent(X& x0, Y& y0) {
+          return fruit::createComponent()
+            .addInstanceMultibinding<XAnnot, X>(x0)
+            .addMultibindingProvider<XAnnot()>([](){ return X{100 + numXConstructed++}; })
+            .addInstanceMultibinding(y0);
+        }
+
+        fruit::Component<> getRequestComponent(X& x) {
+          return fruit::createComponent()
+            .addInstanceMultibinding<XAnnot, X>(x);
+        }
+
+        int main() {
+          X x0{0};
+          Y y0{0};
+          fruit::NormalizedComponent<> normalizedComponent(getComponent(x0, y0));
+          X prototypeX{-1};
+          fruit::PreparedDelta<> preparedDelta(normalizedComponent, getRequestComponent(prototypeX));
+
+          for (int i = 1; i <= 3; i++) {
+            X x{i};
+            fruit::Injector<> injector(normalizedComponent, getRequestComponent(x));
+            fruit::Injector<> injector2(preparedDelta, getRequestComponent(x));
+            fruit::Injector<> injector3(normalizedComponent);
+            for (fruit::Injector<>* inj : {&injector, &injector2}) {
+              // The multibindings of the normalized component come first.
+              const std::vector<X*>& multibindings = inj->getMultibindings<XAnnot>();
+              Assert(multibindings.size() == 3);
+              Assert(multibindings[0] == &x0);
+              Assert(multibindings[1]->n >= 100);
+              Assert(multibindings[2] == &x);
+              Assert(&inj->getMultibindings<XAnnot>() == &multibindings);
+              Assert(inj->getMultibindings<Y>().size() == 1);
+              Assert(inj->getMultibindings<Y>()[0] == &y0);
+            }
+            // Objects constructed for multibindings are not shared between injectors.
+            Assert(injector.getMultibindings<XAnnot>()[1] != injector2.getMultibindings<XAnnot>()[1]);
+            Assert(injector3.getMultibindings<XAnnot>().size() == 2);
+            Assert(injector3.getMultibindings<XAnnot>()[0] == &x0);
+          }
+          Assert(numXConstructed == 9);
+        }
+        '''
+    expect_success(
+        COMMON_DEFINITIONS,
+        source,
+        locals())
+
+@params(
+    ('X', 'X*'),
+    ('fruit::Annotated<Annotation1, X>', 'fruit::Annotated<Annotation1, X*>'))
+def test_normalized_component_image(XAnnot, XPtrAnnot):
+    source = '''
+        struct Y {
+          int n;
+        };
+
+        struct X {
+          virtual int get() = 0;
+        };
+
+        struct XImpl : public X {
+          Y& y;
+          INJECT(XImpl(Y& y)) : y(y) {}
+          int get() override {
+            return y.n;
+          }
+        };
+
+        struct Z {
+          int n;
+        };
+
+        fruit::Component<> getExtraComponent(bool extraMultibinding) {
+          if (extraMultibinding) {
+            return fruit::createComponent()
+              .addMultibindingProvider([](){ return Z{200}; });
+          } else {
+            return fruit::createComponent();
+          }
+        }
+
+        fruit::Component<fruit::Required<Y>, XAnnot> getComponent(Z& z, bool extraMultibinding) {
+          return fruit::createComponent()
+            .bind<XAnnot, fruit::Annotated<Annotation1, XImpl>>()
+            .registerConstructor<fruit::Annotated<Annotation1, XImpl>(Y&)>()
+            .addInstanceMultibinding(z)
+            .addMultibindingProvider([](){ return Z{100}; })
+            .install(getExtraComponent(extraMultibinding));
+        }
+
+        fruit::Component<Y> getYComponent(Y& y) {
+          return fruit::createComponent()
+            .bindInstance(y);
+        }
+
+        void check(fruit::NormalizedComponent<fruit::Required<Y>, XAnnot>& normalizedComponent, Z& z) {
+          for (int i = 1; i <= 2; i++) {
+            Y y{i};
+            fruit::Injector<XAnnot> injector(normalizedComponent, getYComponent(y));
+            Assert(injector.get<XPtrAnnot>()->get() == i);
+            const std::vector<Z*>& multibindings = injector.getMultibindings<Z>();
+            Assert(multibindings.size() == 2);
+            Assert(multibindings[0] == &z);
+            Assert(multibindings[1]->n == 100);
+          }
+        }
+
+        int main() {
+          std::string image;
+          {
+            Z z{1};
+            fruit::NormalizedComponent<fruit::Required<Y>, XAnnot> normalizedComponent(getComponent(z, false));
+            Assert(!normalizedComponent.isLoadedFromImage());
+            image = normalizedComponent.serialize(getComponent(z, false), "build1");
+            Assert(!image.empty());
+
+            // The image can't be created with a different component.
+            Z z2{2};
+            Assert(normalizedComponent.serialize(getComponent(z2, false), "build1").empty());
+          }
+
+          // The bound instances are taken from the component used to load the image.
+          Z z{3};
+          fruit::NormalizedComponent<fruit::Required<Y>, XAnnot> normalizedComponent(
+              getComponent(z, false), image.data(), image.size(), "build1");
+          Assert(normalizedComponent.isLoadedFromImage());
+          check(normalizedComponent, z);
+
+          // An image can also be created from a normalized component loaded from an image.
+          Assert(normalizedComponent.serialize(getComponent(z, false), "build1").size() == image.size());
+
+          // The image is ignored for a different build.
+          fruit::NormalizedComponent<fruit::Required<Y>, XAnnot> normalizedComponent2(
+              getComponent(z, false), image.data(), image.size(), "build2");
+          Assert(!normalizedComponent2.isLoadedFromImage());
+          check(normalizedComponent2, z);
+
+          // The image is ignored for a component with a different shape.
+          fruit::NormalizedComponent<fruit::Required<Y>, XAnnot> normalizedComponent3(
+              getComponent(z, true), image.data(), image.size(), "build1");
+          Assert(!normalizedComponent3.isLoadedFromImage());
+          Y y{1};
+          fruit::Injector<XAnnot> injector(normalizedComponent3, getYComponent(y));
+          Assert(injector.getMultibindings<Z>().size() == 3);
+
+          // The image is ignored if it's corrupted or truncated.
+          std::string corruptedImage = image;
+          corruptedImage[corruptedImage.size() - 1] ^= 1;
+          fruit::NormalizedComponent<fruit::Required<Y>, XAnnot> normalizedComponent4(
+              getComponent(z, false), corruptedImage.data(), corruptedImage.size(), "build1");
+          Assert(!normalizedComponent4.isLoadedFromImage());
+          check(normalizedComponent4, z);
+          fruit::NormalizedComponent<fruit::Required<Y>, XAnnot> normalizedComponent5(
+              getComponent(z, false), image.data(), image.size() / 2, "build1");
+          Assert(!normalizedComponent5.isLoadedFromImage());
+          check(normalizedComponent5, z);
+        }
+        '''
+    expect_success(
+        COMMON_DEFINITIONS,
+        source,
+        locals())
+
+def test_normalized_component_image_ignored_for_different_types_or_objects():
+    source = '''
+        struct Z {
+          int n;
+        };
+
+        struct W {
+          int n;
+        };
+
+        fruit::Component<> getComponent(Z& z1, Z& z2) {
+          return fruit::createComponent()
+            .addInstanceMultibinding(z1)
+            .addInstanceMultibinding(z2);
+        }
+
+        fruit::Component<> getWComponent(W& w, Z& z) {
+          return fruit::createComponent()
+            .addInstanceMultibinding(w)
+            .addInstanceMultibinding(z);
+        }
+
+        int main() {
+          Z z1{1};
+          Z z2{2};
+          W w{3};
+          fruit::NormalizedComponent<> normalizedComponent(getComponent(z1, z2));
+          std::string image = normalizedComponent.serialize(getComponent(z1, z2), "build1");
+          Assert(!image.empty());
+
+          fruit::NormalizedComponent<> normalizedComponent1(getComponent(z1, z2), image.data(), image.size(), "build1");
+          Assert(normalizedComponent1.isLoadedFromImage());
+
+          // The image is ignored for a component with the same shape but different types.
+          fruit::NormalizedComponent<> normalizedComponent2(getWComponent(w, z2), image.data(), image.size(), "build1");
+          Assert(!normalizedComponent2.isLoadedFromImage());
+          fruit::Injector<> injector2(normalizedComponent2);
+          Assert(injector2.getMultibindings<W>().size() == 1);
+          Assert(injector2.getMultibindings<W>()[0] == &w);
+
+          // The image is ignored if two objects that were distinct when the image was written are now the same.
+          fruit::NormalizedComponent<> normalizedComponent3(getComponent(z1, z1), image.data(), image.size(), "build1");
+          Assert(!normalizedComponent3.isLoadedFromImage());
+        }
+        '''
+    expect_success(
+        COMMON_DEFINITIONS,
+        source)
+
+@params('X', 'fruit::Annotated<Annotation1, X>')
+def test_injector_from_prepared_delta_unsatisfied_requirements(XAnnot):
+    source = '''
+        struct X {};
+
+        struct Y {};
+
+        fruit::Component<fruit::Required<XAnnot>> getComponent() {
+          return fruit::createComponent();
+        }
+
+        fruit::Component<Y> getYComponent(Y& y) {
+          return fruit::createComponent()
+            .bindInstance(y);
+        }
+
+        int main() {
+          fruit::NormalizedComponent<fruit::Required<XAnnot>> normalizedComponent(getComponent());
+          Y y;
+          fruit::PreparedDelta<fruit::Required<XAnnot>> preparedDelta(normalizedComponent, getYComponent(y));
+          fruit::Injector<Y> injector(preparedDelta, getYComponent(y));
+        }
+        '''
+    expect_compile_error(
+        'UnsatisfiedRequirementsInNormalizedComponentError<XAnnot>',
+        'The requirements in UnsatisfiedRequirements are required by the NormalizedComponent but are not provided by the Component',
+        COMMON_DEFINITIONS,
+        source,
+        locals())
+
+@params(
+    ('X', 'X&', 'Y', 'Y*'),
+    ('fruit::Annotated<Annotation1, X>', 'ANNOTATED(Annotation1, X&)', 'fruit::Annotated<Annotation2, Y>', 'ANNOTATED(Annotation2, Y*)'))
+def test_extend_success(XAnnot, X_ANNOT_REF, YAnnot, Y_ANNOT_PTR):
+    source = '''
+        struct X {
+          int n;
+        };
+
+        struct Y {
+          X& x;
+          INJECT(Y(X_ANNOT_REF x)) : x(x) {}
+        };
+
+        struct Z {
+          Y* y;
+          INJECT(Z(Y_ANNOT_PTR y)) : y(y) {}
+        };
+
+        struct W {
+          Z* z;
+          INJECT(W(Z* z)) : z(z) {}
+        };
+
+        fruit::Component<fruit::Required<XAnnot>, YAnnot> getComponent(X& x0) {
+          return fruit::createComponent()
+            .addInstanceMultibinding<XAnnot, X>(x0);
+        }
+
+        fruit::Component<XAnnot, Z> getPluginComponent(X& x, X& x1) {
+          return fruit::createComponent()
+            .bindInstance<XAnnot, X>(x)
+            .addInstanceMultibinding<XAnnot, X>(x1);
+        }
+
+        fruit::Component<fruit::Required<Z>, W> getPlugin2Component(X& x2) {
+          return fruit::createComponent()
+            .addInstanceMultibinding<XAnnot, X>(x2);
+        }
+
+        fruit::Component<YAnnot, Z> getExtendedComponent(X& x0, X& x, X& x1) {
+          return fruit::createComponent()
+            .install(getComponent(x0))
+            .install(getPluginComponent(x, x1));
+        }
+
+        int main() {
+          X x0{0};
+          X x{1};
+          X x1{2};
+          X x2{3};
+          fruit::NormalizedComponent<fruit::Required<XAnnot>, YAnnot> normalizedComponent(getComponent(x0));
+          fruit::NormalizedComponent<YAnnot, Z> extended =
+              normalizedComponent.extend<YAnnot, Z>(getPluginComponent(x, x1));
+          fruit::NormalizedComponent<YAnnot, Z, W> extended2 =
+              extended.extend<YAnnot, Z, W>(getPlugin2Component(x2));
+
+          // The original normalized component can still be used.
+          X x3{4};
+          fruit::Injector<YAnnot> injector(normalizedComponent, fruit::Component<XAnnot>(
+              fruit::createComponent().bindInstance<XAnnot, X>(x3)));
+          Assert(&(injector.get<YAnnot>().x) == &x3);
+          Assert(injector.getMultibindings<XAnnot>().size() == 1);
+
+          for (int i = 0; i < 2; i++) {
+            fruit::Injector<YAnnot, Z> injector1(extended);
+            Assert(&(injector1.get<Z*>()->y->x) == &x);
+            const std::vector<X*>& multibindings1 = injector1.getMultibindings<XAnnot>();
+            Assert(multibindings1.size() == 2);
+            Assert(multibindings1[0] == &x0);
+            Assert(multibindings1[1] == &x1);
+
+            fruit::Injector<W> injector2(extended2);
+            Assert(&(injector2.get<W*>()->z->y->x) == &x);
+            const std::vector<X*>& multibindings2 = injector2.getMultibindings<XAnnot>();
+            Assert(multibindings2.size() == 3);
+            Assert(multibindings2[0] == &x0);
+            Assert(multibindings2[1] == &x1);
+            Assert(multibindings2[2] == &x2);
+          }
+
+          // An extended component is serialized as the component that installs both components.
+          std::string image = extended.serialize(getExtendedComponent(x0, x, x1), "build1");
+          Assert(!image.empty());
+          fruit::NormalizedComponent<YAnnot, Z> loaded(getExtendedComponent(x0, x, x1), image.data(), image.size(),
+                                                       "build1");
+          Assert(loaded.isLoadedFromImage());
+          fruit::Injector<YAnnot, Z> injector3(loaded);
+          Assert(&(injector3.get<Z*>()->y->x) == &x);
+          const std::vector<X*>& multibindings3 = injector3.getMultibindings<XAnnot>();
+          Assert(multibindings3.size() == 2);
+          Assert(multibindings3[0] == &x0);
+          Assert(multibindings3[1] == &x1);
+        }
+        '''
+    expect_success(
+        COMMON_DEFINITIONS,
+        source,
+        locals())
+
+def test_extend_undoes_binding_compression_success():
+    source = '''
+        struct I {
+          virtual ~I() = default;
+        };
+
+        struct C : public I {
+          INJECT(C()) = default;
+        };
+
+        struct D {
+          C& c;
+          INJECT(D(C& c)) : c(c) {}
+        };
+
+        fruit::Component<I> getComponent() {
+          return fruit::createComponent()
+            .bind<I, C>();
+        }
+
+        fruit::Component<D> getPluginComponent() {
+          return fruit::createComponent();
+        }
+
+        int main() {
+          fruit::NormalizedComponent<I> normalizedComponent(getComponent());
+          fruit::NormalizedComponent<I, D> extended = normalizedComponent.extend<I, D>(getPluginComponent());
+          fruit::NormalizedComponent<I, D> extended2 = extended.extend<I, D>(fruit::Component<>(fruit::createComponent()));
+          for (fruit::NormalizedComponent<I, D>* nc : {&extended, &extended2}) {
+            fruit::Injector<I, D> injector(*nc);
+            Assert(injector.get<I*>() == &(injector.get<D*>()->c));
+          }
+        }
+        '''
+    expect_success(
+        COMMON_DEFINITIONS,
+        source,
+        locals())
+
+@params('X', 'fruit::Annotated<Annotation1, X>')
+def test_extend_type_not_provided(XAnnot):
+    source = '''
+        struct X {};
+
+        struct Y {};
+
+        fruit::Component<Y> getComponent() {
+          return fruit::createComponent()
+            .registerConstructor<Y()>();
+        }
+
+        int main() {
+          fruit::NormalizedComponent<Y> normalizedComponent(getComponent());
+          normalizedComponent.extend<Y, XAnnot>(fruit::Component<>(fruit::createComponent()));
+        }
+        '''
+    expect_compile_error(
+        'TypesInExtendedNormalizedComponentNotProvidedError<XAnnot>',
+        'The types in TypesNotProvided are declared as provided by the extended NormalizedComponent, but neither the NormalizedComponent nor the Component passed to NormalizedComponent::extend\(\) provides them.',
+        COMMON_DEFINITIONS,
+        source,
+        locals())
+
+@params('X', 'fruit::Annotated<Annotation1, X>')
+def test_extend_undeclared_requirements(XAnnot):
+    source = '''
+        struct X {};
+
+        struct Y {};
+
+        fruit::Component<fruit::Required<XAnnot>, Y> getComponent() {
+          return fruit::createComponent()
+            .registerConstructor<Y()>();
+        }
+
+        int main() {
+          fruit::NormalizedComponent<fruit::Required<XAnnot>, Y> normalizedComponent(getComponent());
+          normalizedComponent.extend<Y>(fruit::Component<>(fruit::createComponent()));
+        }
+        '''
+    expect_compile_error(
+        'UndeclaredRequirementsInExtendedNormalizedComponentError<XAnnot>',
+        'The requirements in UndeclaredRequirements are not provided by the NormalizedComponent nor by the Component passed to NormalizedComponent::extend\(\), but they are not declared as required by the extended NormalizedComponent.',
+        COMMON_DEFINITIONS,
+        source,
+        locals())
+
+@params(
+    ('X', 'X&'),
+    ('fruit::Annotated<Annotation1, X>', 'ANNOTATED(Annotation1, X&)'))
+def test_binding_handle_success(XAnnot, X_ANNOT_REF):
+    source = '''
+        struct X {};
+
+        struct Request {
+          int id;
+        };
+
+        struct Y {
+          X& x;
+          Request& request;
+
+          INJECT(Y(X_ANNOT_REF x, Request& request)) : x(x), request(request) {}
+        };
+
+        fruit::Component<fruit::Required<Request>, XAnnot, Y> getComponent() {
+          return fruit::createComponent()
+            .registerConstructor<XAnnot()>();
+        }
+
+        fruit::Component<Request> getRequestComponent(Request& request) {
+          return fruit::createComponent()
+            .bindInstance(request);
+        }
+
+        fruit::Component<XAnnot> getXComponent() {
+          return fruit::createComponent()
+            .registerConstructor<XAnnot()>();
+        }
+
+        int main() {
+          fruit::NormalizedComponent<fruit::Required<Request>, XAnnot, Y> normalizedComponent(getComponent());
+          fruit::BindingHandle<XAnnot> xHandle = normalizedComponent.getBindingHandle<XAnnot>();
+          fruit::BindingHandle<Y> yHandle = normalizedComponent.getBindingHandle<Y>();
+
+          Request request1{1};
+          // XAnnot is not in the injector's types, but the handle can still be used.
+          fruit::Injector<Y> injector1(normalizedComponent, getRequestComponent(request1));
+          X* x = injector1.get(xHandle);
+          Assert(x == injector1.unsafeGet<XAnnot>());
+          Y* y = injector1.get(yHandle);
+          Assert(y == injector1.get<Y*>());
+          Assert(&y->x == x);
+          Assert(&y->request == &request1);
+          Assert(injector1.unsafeGet(yHandle) == y);
+
+          // The same handle works with other injectors created from the same NormalizedComponent.
+          Request request2{2};
+          fruit::PreparedDelta<fruit::Required<Request>, XAnnot, Y> preparedDelta(normalizedComponent,
+                                                                                 getRequestComponent(request2));
+          fruit::Injector<Y> injector2(preparedDelta, getRequestComponent(request2));
+          injector2.enableConcurrentInjection();
+          Assert(&injector2.get(yHandle)->request == &request2);
+          Assert(injector2.get(xHandle) == &injector2.get(yHandle)->x);
+          Assert(injector2.get(xHandle) != x);
+
+          // With other injectors the type is looked up.
+          fruit::Injector<XAnnot> injector3(getXComponent());
+          Assert(injector3.get(xHandle) == injector3.unsafeGet<XAnnot>());
+          Assert(injector3.unsafeGet(yHandle) == nullptr);
+
+          // A handle obtained from a NormalizedComponent that was destroyed doesn't match a different NormalizedComponent,
+          // even if it's allocated at the same address.
+          std::unique_ptr<fruit::NormalizedComponent<fruit::Required<Request>, XAnnot, Y>> normalizedComponent2(
+              new fruit::NormalizedComponent<fruit::Required<Request>, XAnnot, Y>(getComponent()));
+          fruit::BindingHandle<Y> yHandle2 = normalizedComponent2->getBindingHandle<Y>();
+          normalizedComponent2.reset();
+          fruit::NormalizedComponent<XAnnot> normalizedComponent3(getXComponent());
+          fruit::Injector<XAnnot> injector4(normalizedComponent3);
+          Assert(injector4.get(xHandle) == injector4.unsafeGet<XAnnot>());
+          Assert(injector4.unsafeGet(yHandle2) == nullptr);
+        }
+        '''
+    expect_success(
+        COMMON_DEFINITIONS,
+        source,
+        locals())
+
+@params('X', 'fruit::Annotated<Annotation1, X>')
+def test_binding_handle_type_not_provided_error(XAnnot):
+    source = '''
+        struct X {};
+
+        struct Y {};
+
+        fruit::Component<Y> getComponent() {
+          return fruit::createComponent()
+            .registerConstructor<Y()>();
+        }
+
+        int main() {
+          fruit::NormalizedComponent<Y> normalizedComponent(getComponent());
+          normalizedComponent.getBindingHandle<XAnnot>();
+        }
+        '''
+    expect_compile_error(
+        'TypeNotProvidedByNormalizedComponentError<XAnnot>',
+        'Trying to get a BindingHandle for T, but T is not provided by this NormalizedComponent.',
+        COMMON_DEFINITIONS,
+        source,
+        locals())
+
 @params('X', 'fruit::Annotated<Annotation1, X>')
 def test_error_repeated_type(XAnnot):
     source = '''
@@ -0,0 +1,122 @@
+/*
+ * Copyright 2014 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "test_common.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+struct Config {
+  int value;
+};
+
+struct Service {
+  INJECT(Service(Config& config)) : value(config.value) {
+    num_alive++;
+  }
+
+  ~Service() {
+    num_alive--;
+  }
+
+  int value;
+
+  static std::atomic<int> num_alive;
+};
+
+std::atomic<int> Service::num_alive(0);
+
+fruit::Component<fruit::Required<Config>, Service> getServiceComponent() {
+  return fruit::createComponent();
+}
+
+fruit::Component<Config> getConfigComponent(Config& config) {
+  return fruit::createComponent()
+    .bindInstance(config);
+}
+
+int main() {
+  const int num_versions = 100;
+  const int num_threads = 8;
+
+  // configs[i] is used for version i+1.
+  std::vector<Config> configs;
+  for (int i = 0; i < num_versions; ++i) {
+    configs.push_back(Config{i + 1});
+  }
+
+  fruit::NormalizedComponent<fruit::Required<Config>, Service> normalizedComponent(getServiceComponent());
+
+  {
+    fruit::VersionedInjector<Service> versionedInjector(
+        fruit::Injector<Service>(normalizedComponent, getConfigComponent(configs[0])));
+    Assert(versionedInjector.getVersion() == 1);
+
+    {
+      fruit::VersionedInjector<Service>::Snapshot snapshot1 = versionedInjector.getSnapshot();
+      Assert(snapshot1.getVersion() == 1);
+      Assert(snapshot1->get<Service*>()->value == 1);
+
+      versionedInjector.publish(fruit::Injector<Service>(normalizedComponent, getConfigComponent(configs[1])));
+      Assert(versionedInjector.getVersion() == 2);
+      // The first version is still used by snapshot1.
+      Assert(versionedInjector.getNumRetiredVersions() == 1);
+
+      fruit::VersionedInjector<Service>::Snapshot snapshot2 = versionedInjector.getSnapshot();
+      Assert(snapshot2.getVersion() == 2);
+      Assert(snapshot2->get<Service*>()->value == 2);
+      Assert((*snapshot1).get<Service*>()->value == 1);
+      Assert(Service::num_alive == 2);
+    }
+    // Releasing snapshot1 destroyed the first version.
+    Assert(versionedInjector.getNumRetiredVersions() == 0);
+    Assert(Service::num_alive == 1);
+
+    std::atomic<bool> done(false);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < num_threads; ++i) {
+      threads.push_back(std::thread([&]() {
+        std::uint64_t last_version = 0;
+        do {
+          fruit::VersionedInjector<Service>::Snapshot snapshot = versionedInjector.getSnapshot();
+          Assert(snapshot.getVersion() >= last_version);
+          last_version = snapshot.getVersion();
+          Assert(snapshot->get<Service*>()->value == int(last_version));
+        } while (!done);
+      }));
+    }
+
+    for (int i = 2; i < num_versions; ++i) {
+      versionedInjector.publish(fruit::Injector<Service>(normalizedComponent, getConfigComponent(configs[i])));
+      std::this_thread::yield();
+    }
+    done = true;
+    for (std::thread& thread : threads) {
+      thread.join();
+    }
+    Assert(versionedInjector.getVersion() == num_versions);
+
+    // All snapshots have been released, so publishing a new version destroys all the old ones.
+    versionedInjector.publish(fruit::Injector<Service>(normalizedComponent, getConfigComponent(configs[0])));
+    Assert(versionedInjector.getNumRetiredVersions() == 0);
+    Assert(versionedInjector.getSnapshot()->get<Service*>()->value == 1);
+    Assert(Service::num_alive == 1);
+  }
+  Assert(Service::num_alive == 0);
+
+  return 0;
+}